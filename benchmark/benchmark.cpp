@@ -0,0 +1,616 @@
+// Headless benchmark of a large observation log.
+//
+//   MonoObsLogBenchmark generate <db> [--objects N] [--sessions N] [--observations N] [--seed N] [--force]
+//   MonoObsLogBenchmark run <db> [--output results.json] [--repeat N]
+//
+// generate fills a new database through DatabaseManager with a synthetic log, run times the
+// repository queries, row decoding with and without the native statement API, every tab's build and refreshData, the exports and the backup against it
+// and writes min/median/max per measurement as JSON. Run it on a copy: the backup and the WAL
+// archive are written next to the database as usual.
+
+#include "sampledatagenerator.h"
+#include "db/camerasrepository.h"
+#include "db/databasebackup.h"
+#include "db/databasemanager.h"
+#include "db/filtersrepository.h"
+#include "db/filtertypesrepository.h"
+#include "db/objectsrepository.h"
+#include "db/observationsrepository.h"
+#include "db/sessionsrepository.h"
+#include "db/telescopesrepository.h"
+#include "export/observationexcelexporter.h"
+#include "export/observationhtmlexporter.h"
+#include "export/staticsitegenerator.h"
+#include "export/tabledump.h"
+#include "settingsmanager.h"
+#include "tabs/camerastab.h"
+#include "tabs/diagnosticstab.h"
+#include "tabs/filterstab.h"
+#include "tabs/filtertypestab.h"
+#include "tabs/monthlystatstab.h"
+#include "tabs/objectstab.h"
+#include "tabs/objectstatstab.h"
+#include "tabs/observationstab.h"
+#include "tabs/sessionstab.h"
+#include "tabs/telescopestab.h"
+#include "trace.h"
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDate>
+#include <QDateTime>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QSqlQuery>
+#include <QSysInfo>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <algorithm>
+#include <memory>
+
+namespace
+{
+    QTextStream &out()
+    {
+        static QTextStream stream(stdout);
+        return stream;
+    }
+
+    QTextStream &err()
+    {
+        static QTextStream stream(stderr);
+        return stream;
+    }
+
+    struct Measurement
+    {
+        QString group;
+        QString name;
+        QVector<double> ms;
+        qint64 rows = -1; // -1 when the measurement has no row count
+    };
+
+    // Rows produced by one run of a measured operation
+    using Rows = std::expected<qint64, ER>;
+
+    template <typename T>
+    Rows rowsOf(const std::expected<QVector<T>, ER> &result)
+    {
+        if (!result)
+            return std::unexpected(result.error());
+        return result->size();
+    }
+
+    class Benchmark
+    {
+    public:
+        explicit Benchmark(const int repeat) : m_repeat(std::max(1, repeat)) {}
+
+        // Runs operation the configured number of times, or once when it changes state that
+        // the next run would see (backup, incremental site)
+        void measure(const QString &group, const QString &name, const std::function<Rows()> &operation,
+                     const bool once = false)
+        {
+            Measurement measurement{group, name, {}, -1};
+            const int runs = once ? 1 : m_repeat;
+            for (int i = 0; i < runs; ++i)
+            {
+                QElapsedTimer timer;
+                timer.start();
+                const Rows rows = operation();
+                // Work the operation queued, e.g. a model fetching its first page
+                QApplication::processEvents();
+                measurement.ms.append(timer.nsecsElapsed() / 1e6);
+                if (!rows)
+                {
+                    err() << group << " / " << name << " failed: " << rows.error().errorMessage << Qt::endl;
+                    m_failed = true;
+                    return;
+                }
+                measurement.rows = *rows;
+            }
+
+            QVector<double> sorted = measurement.ms;
+            std::ranges::sort(sorted);
+            out() << QString("%1 %2 %3 ms").arg(group, -12).arg(name, -48).arg(sorted[sorted.size() / 2], 10, 'f', 1);
+            if (measurement.rows >= 0)
+                out() << QString("  %L1 rows").arg(measurement.rows);
+            if (measurement.rows > 0)
+                out() << QString("  %L1 rows/s").arg(rowsPerSecond(measurement.rows, sorted[sorted.size() / 2]), 0, 'f', 0);
+            out() << Qt::endl;
+            m_measurements.append(measurement);
+        }
+
+        [[nodiscard]] bool failed() const { return m_failed; }
+
+        [[nodiscard]] QJsonArray toJson() const
+        {
+            QJsonArray result;
+            for (const Measurement &measurement : m_measurements)
+            {
+                QVector<double> sorted = measurement.ms;
+                std::ranges::sort(sorted);
+                QJsonArray runs;
+                for (const double ms : measurement.ms)
+                    runs.append(ms);
+
+                QJsonObject entry{
+                    {"group", measurement.group},
+                    {"name", measurement.name},
+                    {"runs_ms", runs},
+                    {"min_ms", sorted.first()},
+                    {"median_ms", sorted[sorted.size() / 2]},
+                    {"max_ms", sorted.last()},
+                };
+                if (measurement.rows >= 0)
+                    entry.insert("rows", measurement.rows);
+                if (measurement.rows > 0)
+                    entry.insert("rows_per_s", rowsPerSecond(measurement.rows, sorted[sorted.size() / 2]));
+                result.append(entry);
+            }
+            return result;
+        }
+
+    private:
+        static double rowsPerSecond(const qint64 rows, const double ms)
+        {
+            return ms > 0 ? rows * 1000.0 / ms : 0.0;
+        }
+
+        int m_repeat;
+        bool m_failed = false;
+        QVector<Measurement> m_measurements;
+    };
+
+    // Session date from which on the newest count observations lie, null when there are fewer
+    QDate newestObservationsFrom(DatabaseManager *dbManager, const int count)
+    {
+        QSqlQuery query(dbManager->database());
+        query.prepare(R"(
+            SELECT s.start_jd
+            FROM observations o
+            JOIN sessions s ON s.id = o.session_id
+            ORDER BY s.start_jd DESC
+            LIMIT 1 OFFSET ?
+        )");
+        query.bindValue(0, count - 1);
+        if (!query.exec() || !query.next())
+            return {};
+        return QDate::fromJulianDay(query.value(0).toLongLong());
+    }
+
+    void measureRepositories(Benchmark &benchmark, DatabaseManager *dbManager)
+    {
+        const QString group = "repository";
+        ObjectsRepository objects(dbManager);
+        SessionsRepository sessions(dbManager);
+        CamerasRepository cameras(dbManager);
+        TelescopesRepository telescopes(dbManager);
+        FiltersRepository filters(dbManager);
+        FilterTypesRepository filterTypes(dbManager);
+        ObservationsRepository observations(dbManager);
+
+        benchmark.measure(group, "getAllObjects", [&] { return rowsOf(objects.getAllObjects()); });
+        benchmark.measure(group, "getAllSessions", [&] { return rowsOf(sessions.getAllSessions()); });
+        benchmark.measure(group, "getAllCameras", [&] { return rowsOf(cameras.getAllCameras()); });
+        benchmark.measure(group, "getAllTelescopes", [&] { return rowsOf(telescopes.getAllTelescopes()); });
+        benchmark.measure(group, "getAllFilters", [&] { return rowsOf(filters.getAllFilters()); });
+        benchmark.measure(group, "getAllFilterTypes", [&] { return rowsOf(filterTypes.getAllFilterTypes()); });
+
+        benchmark.measure(group, "getDimensions", [&]() -> Rows
+        {
+            const auto dimensions = observations.getDimensions();
+            if (!dimensions)
+                return std::unexpected(dimensions.error());
+            return 1;
+        });
+        benchmark.measure(group, "getAllObservations", [&]() -> Rows
+        {
+            const auto set = observations.getAllObservations();
+            if (!set)
+                return std::unexpected(set.error());
+            return set->rows.size();
+        });
+        benchmark.measure(group, "forEachObservation", [&]() -> Rows
+        {
+            qint64 rows = 0;
+            const auto result = observations.forEachObservation({}, [&rows](const ObservationData &)
+            {
+                ++rows;
+                return true;
+            });
+            if (!result)
+                return std::unexpected(result.error());
+            return rows;
+        });
+        benchmark.measure(group, "countObservations", [&]() -> Rows
+        {
+            const auto count = observations.countObservations({});
+            if (!count)
+                return std::unexpected(count.error());
+            return *count;
+        });
+        benchmark.measure(group, "countObservationsByObject",
+                          [&] { return rowsOf(observations.countObservationsByObject({})); });
+
+        ObservationFilter lastYear;
+        lastYear.fromDate = QDate(2025, 1, 1);
+        benchmark.measure(group, "getObservations (2025)", [&]() -> Rows
+        {
+            const auto set = observations.getObservations(lastYear);
+            if (!set)
+                return std::unexpected(set.error());
+            return set->rows.size();
+        });
+
+        // The separation bound needs SQL that can compute it, see ObservationsRepository::hasAngularSeparation()
+        ObservationFilter darkNights;
+        darkNights.maxMoonIllumination = 25;
+        if (observations.hasAngularSeparation())
+            darkNights.minAngularSeparation = 90;
+        benchmark.measure(group, "countObservations (moon filter)", [&]() -> Rows
+        {
+            const auto count = observations.countObservations(darkNights);
+            if (!count)
+                return std::unexpected(count.error());
+            return *count;
+        });
+
+        // First page of the observations table in a few of its sort orders
+        const QList<std::pair<ObservationSortField, QString>> sortFields = {
+            {ObservationSortField::SessionDate, "session date"},
+            {ObservationSortField::Object, "object"},
+            {ObservationSortField::Filter, "filter"},
+            {ObservationSortField::TotalExposure, "total exposure"},
+            {ObservationSortField::MoonIllumination, "moon illumination"},
+            {ObservationSortField::AngularSeparation, "angular separation"},
+            {ObservationSortField::Comments, "comments"},
+        };
+        for (const auto &[field, label] : sortFields)
+        {
+            if (field == ObservationSortField::AngularSeparation && !observations.hasAngularSeparation())
+                continue;
+            ObservationPageQuery page;
+            page.sortField = field;
+            page.limit = 200;
+            benchmark.measure(group, QString("getObservationsPage (%1)").arg(label),
+                              [&observations, page] { return rowsOf(observations.getObservationsPage(page)); });
+        }
+
+        ObservationFilter search;
+        search.searchText = "clouds";
+        benchmark.measure(group, "searchObservations (clouds)",
+                          [&] { return rowsOf(observations.searchObservations(search, 200)); });
+
+        QList<int> ids;
+        for (int id = 1; id <= 200 * 997; id += 997)
+            ids.append(id);
+        benchmark.measure(group, "getObservationsByIds (200)",
+                          [&] { return rowsOf(observations.getObservationsByIds(ids)); });
+        benchmark.measure(group, "getObservationById", [&]() -> Rows
+        {
+            const auto observation = observations.getObservationById(1);
+            if (!observation)
+                return std::unexpected(observation.error());
+            return 1;
+        });
+    }
+
+    // Each tab the way MainWindow builds it, then its refreshData on its own
+    // Row decoding alone: forEachObservation with a callback that does nothing, through the native
+    // statement API and through SqlStatement's QSqlQuery fallback. Generate with
+    // --observations 1000000 to compare the two.
+    void measureDecoding(Benchmark &benchmark, DatabaseManager *dbManager)
+    {
+        const QString group = "decode";
+        ObservationsRepository observations(dbManager);
+        const auto decodeAll = [&observations]() -> Rows
+        {
+            qint64 rows = 0;
+            const auto result = observations.forEachObservation({}, [&rows](const ObservationData &)
+            {
+                ++rows;
+                return true;
+            });
+            if (!result)
+                return std::unexpected(result.error());
+            return rows;
+        };
+
+        if (dbManager->nativeHandle())
+            benchmark.measure(group, "forEachObservation (native)", decodeAll);
+        else
+            out() << "No native SQLite handle, only the QSqlQuery path is timed (see MONOOBSLOG_QT_SYSTEM_SQLITE)" << Qt::endl;
+
+        dbManager->setNativeStatements(false);
+        benchmark.measure(group, "forEachObservation (QSqlQuery)", decodeAll);
+        dbManager->setNativeStatements(true);
+    }
+
+    void measureTabs(Benchmark &benchmark, DatabaseManager *dbManager, SettingsManager *settingsManager)
+    {
+        struct TabSpec
+        {
+            QString name;
+            std::function<QWidget *()> build; // constructs and initializes
+            std::function<void(QWidget *)> refresh;
+        };
+
+        const QList<TabSpec> tabs = {
+            {"Objects", [=] { auto *t = new ObjectsTab(dbManager, settingsManager); t->initialize(); return t; },
+             [](QWidget *w) { static_cast<ObjectsTab *>(w)->refreshData(); }},
+            {"Sessions", [=] { auto *t = new SessionsTab(dbManager, settingsManager); t->initialize(); return t; },
+             [](QWidget *w) { static_cast<SessionsTab *>(w)->refreshData(); }},
+            {"Cameras", [=] { auto *t = new CamerasTab(dbManager); t->initialize(); return t; },
+             [](QWidget *w) { static_cast<CamerasTab *>(w)->refreshData(); }},
+            {"Filter Types", [=] { auto *t = new FilterTypesTab(dbManager); t->initialize(); return t; },
+             [](QWidget *w) { static_cast<FilterTypesTab *>(w)->refreshData(); }},
+            {"Filters", [=] { auto *t = new FiltersTab(dbManager); t->initialize(); return t; },
+             [](QWidget *w) { static_cast<FiltersTab *>(w)->refreshData(); }},
+            {"Telescopes", [=] { auto *t = new TelescopesTab(dbManager); t->initialize(); return t; },
+             [](QWidget *w) { static_cast<TelescopesTab *>(w)->refreshData(); }},
+            {"Observations",
+             [=] { auto *t = new ObservationsTab(dbManager, settingsManager); t->initialize(); return t; },
+             [](QWidget *w) { static_cast<ObservationsTab *>(w)->refreshData(); }},
+            {"Object Stats", [=] { auto *t = new ObjectStatsTab(dbManager); t->initialize(); return t; },
+             [](QWidget *w) { static_cast<ObjectStatsTab *>(w)->refreshData(); }},
+            {"Monthly Stats", [=] { auto *t = new MonthlyStatsTab(dbManager); t->initialize(); return t; },
+             [](QWidget *w) { static_cast<MonthlyStatsTab *>(w)->refreshData(); }},
+            {"Diagnostics", [=] { auto *t = new DiagnosticsTab(dbManager, {}); t->initialize(); return t; },
+             [](QWidget *w) { static_cast<DiagnosticsTab *>(w)->refreshData(); }},
+        };
+
+        for (const TabSpec &spec : tabs)
+        {
+            std::unique_ptr<QWidget> widget;
+            benchmark.measure("tab", spec.name + " build", [&]() -> Rows
+            {
+                widget.reset(spec.build());
+                return -1;
+            }, true);
+            if (widget)
+                benchmark.measure("tab", spec.name + " refreshData", [&]() -> Rows
+                {
+                    spec.refresh(widget.get());
+                    return -1;
+                });
+        }
+    }
+
+    void measureExports(Benchmark &benchmark, DatabaseManager *dbManager, const QString &directory)
+    {
+        const QString group = "export";
+        const ObservationHtmlExporter html(dbManager);
+        const ObservationExcelExporter excel(dbManager);
+
+        benchmark.measure(group, "HTML (all)", [&]
+        {
+            return Rows(html.exportToFile(directory + "/observations.html", {}));
+        });
+
+        // The Excel sizes the exporter has to stay usable at, plus the whole log
+        for (const int rows : {10000, 100000})
+        {
+            const QDate from = newestObservationsFrom(dbManager, rows);
+            if (!from.isValid())
+                continue;
+            ObservationExcelExportOptions options;
+            options.filter.fromDate = from;
+            benchmark.measure(group, QString("Excel (newest %L1)").arg(rows), [&]
+            {
+                return Rows(excel.exportToFile(directory + QString("/observations-%1.xlsx").arg(rows), options));
+            });
+        }
+        benchmark.measure(group, "Excel (all)", [&]
+        {
+            return Rows(excel.exportToFile(directory + "/observations.xlsx", {}));
+        });
+        benchmark.measure(group, "Excel (all, sheet per object)", [&]
+        {
+            ObservationExcelExportOptions options;
+            options.sheetPerObject = true;
+            return Rows(excel.exportToFile(directory + "/observations-objects.xlsx", options));
+        });
+
+        const StaticSiteGenerator site(dbManager);
+        benchmark.measure(group, "Static site (full)",
+                          [&] { return Rows(site.generate(directory + "/site", {})); }, true);
+        benchmark.measure(group, "Static site (unchanged)",
+                          [&] { return Rows(site.generate(directory + "/site", {})); });
+
+        const TableDumper dumper(dbManager);
+        benchmark.measure(group, "CSV dump", [&] { return Rows(dumper.dump(directory + "/csv", DumpFormat::Csv)); });
+    }
+
+    void measureBackup(Benchmark &benchmark, DatabaseManager *dbManager)
+    {
+        const auto backup = [dbManager]() -> Rows
+        {
+            QString errorMessage;
+            if (!DatabaseBackup::createBackup(dbManager->databasePath(), BackupRetention(), errorMessage))
+                return std::unexpected(ER::Error(errorMessage));
+            return -1;
+        };
+        // The first backup of a database stores every chunk, later ones only the changed ones
+        benchmark.measure("backup", "createBackup (first)", backup, true);
+        benchmark.measure("backup", "createBackup (unchanged)", backup, true);
+    }
+
+    int generate(const QCommandLineParser &parser, const QString &dbPath)
+    {
+        if (QFile::exists(dbPath))
+        {
+            if (!parser.isSet("force"))
+            {
+                err() << dbPath << " exists, use --force to replace it" << Qt::endl;
+                return 1;
+            }
+            for (const QString &suffix : {"", "-wal", "-shm"})
+                QFile::remove(dbPath + suffix);
+        }
+
+        SampleDataOptions options;
+        if (parser.isSet("objects"))
+            options.objects = parser.value("objects").toInt();
+        if (parser.isSet("sessions"))
+            options.sessions = parser.value("sessions").toInt();
+        if (parser.isSet("observations"))
+            options.observations = parser.value("observations").toInt();
+        if (parser.isSet("seed"))
+            options.seed = parser.value("seed").toULongLong();
+        if (options.objects < 1 || options.sessions < 1 || options.observations < 0)
+        {
+            err() << "Need at least one object and one session" << Qt::endl;
+            return 1;
+        }
+
+        DatabaseManager dbManager;
+        if (auto result = dbManager.initialize(dbPath); !result)
+        {
+            err() << "Failed to create " << dbPath << ": " << result.error().errorMessage << Qt::endl;
+            return 1;
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        const SampleDataGenerator generator(&dbManager);
+        const auto result = generator.generate(options, [](const char *phase, const int done, const int total)
+        {
+            out() << QString("\r%1 %L2 / %L3").arg(phase, -12).arg(done).arg(total) << Qt::flush;
+        });
+        out() << Qt::endl;
+        if (!result)
+        {
+            err() << "Generating failed: " << result.error().errorMessage << Qt::endl;
+            return 1;
+        }
+        out() << QString("Generated %L1 objects, %L2 sessions, %L3 observations in %4 s")
+                     .arg(options.objects)
+                     .arg(options.sessions)
+                     .arg(options.observations)
+                     .arg(timer.elapsed() / 1000.0, 0, 'f', 1)
+              << Qt::endl;
+        return 0;
+    }
+
+    int run(const QCommandLineParser &parser, const QString &dbPath)
+    {
+        if (!QFile::exists(dbPath))
+        {
+            err() << dbPath << " does not exist, create it with generate first" << Qt::endl;
+            return 1;
+        }
+
+        DatabaseManager dbManager;
+        if (auto result = dbManager.initialize(dbPath); !result)
+        {
+            err() << "Failed to open " << dbPath << ": " << result.error().errorMessage << Qt::endl;
+            return 1;
+        }
+        // Defaults, not the user's settings file
+        SettingsManager settingsManager;
+
+        QTemporaryDir exportDir;
+        if (!exportDir.isValid())
+        {
+            err() << "Failed to create a temporary directory: " << exportDir.errorString() << Qt::endl;
+            return 1;
+        }
+
+        Benchmark benchmark(parser.isSet("repeat") ? parser.value("repeat").toInt() : 3);
+        measureRepositories(benchmark, &dbManager);
+        measureDecoding(benchmark, &dbManager);
+        measureTabs(benchmark, &dbManager, &settingsManager);
+        measureExports(benchmark, &dbManager, exportDir.path());
+        measureBackup(benchmark, &dbManager);
+
+        QJsonObject counts;
+        QSqlQuery query(dbManager.database());
+        for (const char *table : {"objects", "sessions", "observations"})
+        {
+            if (query.exec(QString("SELECT COUNT(*) FROM %1").arg(table)) && query.next())
+                counts.insert(table, query.value(0).toLongLong());
+        }
+
+        const QJsonObject results{
+            {"created", QDateTime::currentDateTimeUtc().toString(Qt::ISODate)},
+            {"application_version", QCoreApplication::applicationVersion()},
+            {"qt_version", qVersion()},
+            {"platform", QSysInfo::prettyProductName()},
+            {"cpu", QSysInfo::currentCpuArchitecture()},
+            {"database", dbPath},
+            {"database_bytes", QFileInfo(dbPath).size()},
+            {"rows", counts},
+            {"measurements", benchmark.toJson()},
+        };
+
+        const QString outputFile = parser.isSet("output") ? parser.value("output") : "benchmark-results.json";
+        QSaveFile file(outputFile);
+        const QByteArray json = QJsonDocument(results).toJson();
+        if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size() || !file.commit())
+        {
+            err() << "Failed to write " << outputFile << ": " << file.errorString() << Qt::endl;
+            return 1;
+        }
+        out() << "Results written to " << outputFile << Qt::endl;
+        return benchmark.failed() ? 1 : 0;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    // Tabs are real widgets, they only need a platform that does not show them
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication app(argc, argv);
+    QApplication::setApplicationName("MonoObsLogBenchmark");
+    QApplication::setApplicationVersion("1.0.0");
+    QApplication::setOrganizationName("Prookyon");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Generates a large synthetic observation log and times the application against it.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("command", "generate or run");
+    parser.addPositionalArgument("database", "Database file");
+    parser.addOptions({
+        {"objects", "Objects to generate (5000).", "count"},
+        {"sessions", "Sessions to generate (3000).", "count"},
+        {"observations", "Observations to generate (500000).", "count"},
+        {"seed", "Random seed, the same seed gives the same database (1).", "seed"},
+        {"force", "Replace an existing database."},
+        {"output", "Results file (benchmark-results.json).", "file"},
+        {"repeat", "Runs per measurement (3).", "count"},
+        {"trace", "Also write a Chrome trace of the run to <file>.", "file"},
+    });
+    parser.process(app);
+
+    const QStringList arguments = parser.positionalArguments();
+    if (arguments.size() != 2 || (arguments[0] != "generate" && arguments[0] != "run"))
+    {
+        parser.showHelp(1);
+    }
+
+    const QString traceFile = parser.value("trace");
+    if (!traceFile.isEmpty())
+    {
+        if (Trace::isCompiledIn())
+            Trace::setEnabled(true);
+        else
+            qWarning() << "Tracing is not compiled into this build, configure with -DMONOOBSLOG_TRACING=ON";
+    }
+
+    const int exitCode = arguments[0] == "generate" ? generate(parser, arguments[1]) : run(parser, arguments[1]);
+
+    if (Trace::isEnabled())
+    {
+        if (auto result = Trace::writeChromeTrace(traceFile); !result)
+            qWarning() << "Failed to write trace:" << result.error().errorMessage;
+    }
+    return exitCode;
+}
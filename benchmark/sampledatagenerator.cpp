@@ -0,0 +1,237 @@
+#include "sampledatagenerator.h"
+#include "astrocalc.h"
+#include "db/databasemanager.h"
+#include <QDate>
+#include <QSet>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStringList>
+#include <cmath>
+#include <random>
+
+namespace
+{
+    struct FilterSpec
+    {
+        const char *name;
+        const char *type;
+        bool narrowband;
+    };
+
+    constexpr FilterSpec filterSpecs[] = {
+        {"L", "L", false},           {"R", "R", false},           {"G", "G", false},
+        {"B", "B", false},           {"Ha 7nm", "Ha", true},      {"OIII 7nm", "OIII", true},
+        {"SII 7nm", "SII", true},    {"Ha 3nm", "Ha", true},      {"OIII 3nm", "OIII", true},
+    };
+    constexpr const char *filterTypes[] = {"L", "R", "G", "B", "Ha", "OIII", "SII"};
+
+    constexpr const char *catalogs[] = {"NGC ", "IC ", "Sh2-", "LDN ", "vdB ", "Abell ", "Barnard "};
+    constexpr int catalogSizes[] = {7840, 5386, 313, 1802, 158, 4076, 370};
+
+    constexpr const char *commentWords[] = {
+        "seeing", "good", "poor", "clouds", "high", "thin", "dew", "wind", "guiding", "issues",
+        "moon", "haze", "transparency", "excellent", "focus", "drift", "flats", "darks", "satellite", "trails",
+    };
+
+    class Random
+    {
+    public:
+        explicit Random(const quint64 seed) : m_engine(seed) {}
+
+        int uniform(const int low, const int high) { return std::uniform_int_distribution<int>(low, high)(m_engine); }
+        double uniform() { return std::uniform_real_distribution<double>(0.0, 1.0)(m_engine); }
+        bool chance(const double probability) { return uniform() < probability; }
+        // Index in [0, count), low indices much more likely: a few popular objects get most time
+        int skewed(const int count) { return std::min(count - 1, static_cast<int>(count * std::pow(uniform(), 3.0))); }
+
+        QString words(const int count)
+        {
+            QStringList result;
+            for (int i = 0; i < count; ++i)
+                result << commentWords[uniform(0, std::size(commentWords) - 1)];
+            return result.join(' ');
+        }
+
+    private:
+        std::mt19937_64 m_engine;
+    };
+
+    std::expected<void, ER> exec(QSqlQuery &query)
+    {
+        if (!query.exec())
+        {
+            return std::unexpected(ER::Error(query.lastError().text()));
+        }
+        return {};
+    }
+}
+
+SampleDataGenerator::SampleDataGenerator(DatabaseManager *dbManager)
+    : m_dbManager(dbManager)
+{
+}
+
+std::expected<void, ER> SampleDataGenerator::generate(const SampleDataOptions &options,
+                                                      const SampleDataProgress &progress) const
+{
+    QSqlDatabase &db = m_dbManager->database();
+    Random random(options.seed);
+
+    // One transaction: a commit per row would measure the disk instead of building the log
+    if (!db.transaction())
+    {
+        return std::unexpected(ER::Error(db.lastError().text()));
+    }
+    const auto fail = [&db](const ER &error)
+    {
+        db.rollback();
+        return std::unexpected(error);
+    };
+
+    QSqlQuery query(db);
+
+    // Equipment
+    query.prepare("INSERT INTO filter_types (name, priority) VALUES (?, ?)");
+    for (int i = 0; i < static_cast<int>(std::size(filterTypes)); ++i)
+    {
+        query.bindValue(0, filterTypes[i]);
+        query.bindValue(1, i + 1);
+        if (auto result = exec(query); !result)
+            return fail(result.error());
+    }
+    query.prepare("INSERT INTO filters (name, filter_type_id) VALUES (?, (SELECT id FROM filter_types WHERE name = ?))");
+    for (const FilterSpec &filter : filterSpecs)
+    {
+        query.bindValue(0, filter.name);
+        query.bindValue(1, filter.type);
+        if (auto result = exec(query); !result)
+            return fail(result.error());
+    }
+    if (!query.exec(R"(INSERT INTO cameras (name, sensor, pixel_size, width, height) VALUES
+                         ('ASI1600MM Pro', 'Panasonic MN34230', 3.8, 4656, 3520),
+                         ('ASI2600MM Pro', 'Sony IMX571', 3.76, 6248, 4176),
+                         ('QHY268M', 'Sony IMX571', 3.76, 6280, 4210),
+                         ('ASI183MM Pro', 'Sony IMX183', 2.4, 5496, 3672))") ||
+        !query.exec(R"(INSERT INTO telescopes (name, aperture, f_ratio, focal_length) VALUES
+                         ('Esprit 100', 100, 5.5, 550),
+                         ('RedCat 51', 51, 4.9, 250),
+                         ('EdgeHD 8', 203, 7.0, 1422),
+                         ('FSQ-106', 106, 5.0, 530),
+                         ('Newtonian 200/800', 200, 4.0, 800))"))
+    {
+        return fail(ER::Error(query.lastError().text()));
+    }
+    constexpr int cameraCount = 4;
+    constexpr int telescopeCount = 5;
+
+    // Objects: catalog names, northern sky favoured, a tenth without coordinates
+    query.prepare("INSERT INTO objects (name, ra, dec, comments) VALUES (?, ?, ?, ?)");
+    QSet<QString> objectNames;
+    while (objectNames.size() < options.objects)
+    {
+        const int catalog = random.uniform(0, std::size(catalogs) - 1);
+        QString name = catalogs[catalog] + QString::number(random.uniform(1, catalogSizes[catalog]));
+        if (objectNames.contains(name))
+            name += QString(" %1").arg(objectNames.size()); // catalogs are exhausted for large logs
+        objectNames.insert(name);
+
+        query.bindValue(0, name);
+        const bool hasCoordinates = random.chance(0.9);
+        query.bindValue(1, hasCoordinates ? QVariant(random.uniform() * 24.0) : QVariant());
+        query.bindValue(2, hasCoordinates ? QVariant(std::asin(random.uniform() * 1.3 - 0.3) * 180.0 / M_PI) : QVariant());
+        query.bindValue(3, random.chance(0.1) ? QVariant(random.words(random.uniform(2, 6))) : QVariant());
+        if (auto result = exec(query); !result)
+            return fail(result.error());
+        if (progress && objectNames.size() % 1000 == 0)
+            progress("objects", static_cast<int>(objectNames.size()), options.objects);
+    }
+
+    // Sessions: one per night, dark nights preferred. The date range grows with the count so
+    // that roughly one night in four has a session.
+    query.prepare("INSERT INTO sessions (name, start_date, start_jd, moon_illumination, moon_ra, moon_dec, comments) "
+                  "VALUES (?, ?, ?, ?, ?, ?, ?)");
+    const qint64 lastDay = QDate(2025, 12, 31).toJulianDay();
+    const int dayRange = std::max(365, options.sessions * 4);
+    QSet<qint64> usedDays;
+    while (usedDays.size() < options.sessions)
+    {
+        const qint64 day = lastDay - random.uniform(0, dayRange - 1);
+        if (usedDays.contains(day))
+            continue;
+
+        const QDate date = QDate::fromJulianDay(day);
+        double illumination, moonRa, moonDec;
+        AstroCalc::moonInfoForDate(QDateTime(date.addDays(1), QTime(0, 0)), options.latitude, options.longitude,
+                                   &illumination, &moonRa, &moonDec);
+        if (!random.chance(1.0 - 0.8 * illumination / 100.0))
+            continue;
+        usedDays.insert(day);
+
+        query.bindValue(0, date.toString(Qt::ISODate));
+        query.bindValue(1, date.toString(Qt::ISODate));
+        query.bindValue(2, day);
+        query.bindValue(3, illumination);
+        query.bindValue(4, moonRa);
+        query.bindValue(5, moonDec);
+        query.bindValue(6, random.chance(0.3) ? QVariant(random.words(random.uniform(2, 8))) : QVariant());
+        if (auto result = exec(query); !result)
+            return fail(result.error());
+        if (progress && usedDays.size() % 500 == 0)
+            progress("sessions", static_cast<int>(usedDays.size()), options.sessions);
+    }
+
+    // Observations: each session images a few targets through a filter set, spread so that
+    // the total matches. Session and object ids are 1..N since the tables started empty.
+    query.prepare("INSERT INTO observations (image_count, exposure_length, total_exposure, comments, session_id, "
+                  "object_id, camera_id, telescope_id, filter_id) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)");
+    const int sessionCount = std::max(1, options.sessions);
+    int written = 0;
+    for (int session = 1; session <= sessionCount && written < options.observations; ++session)
+    {
+        const int remainingSessions = sessionCount - session + 1;
+        const int mean = (options.observations - written) / remainingSessions;
+        int rows = session == sessionCount ? options.observations - written
+                                           : std::max(0, mean + random.uniform(-mean / 2, mean / 2));
+        const int cameraId = random.uniform(1, cameraCount);
+        const int telescopeId = random.uniform(1, telescopeCount);
+
+        while (rows > 0)
+        {
+            const int objectId = random.skewed(options.objects) + 1;
+            const bool narrowband = random.chance(0.4);
+            for (int f = 0; f < static_cast<int>(std::size(filterSpecs)) && rows > 0; ++f)
+            {
+                if (filterSpecs[f].narrowband != narrowband || random.chance(0.3))
+                    continue;
+
+                static constexpr int broadbandExposures[] = {30, 60, 120, 180};
+                static constexpr int narrowbandExposures[] = {180, 300, 600};
+                const int exposure = narrowband ? narrowbandExposures[random.uniform(0, 2)]
+                                                : broadbandExposures[random.uniform(0, 3)];
+                const int imageCount = static_cast<int>(std::exp(random.uniform() * std::log(120.0))) + 4;
+
+                query.bindValue(0, imageCount);
+                query.bindValue(1, exposure);
+                query.bindValue(2, imageCount * exposure);
+                query.bindValue(3, random.chance(0.05) ? QVariant(random.words(random.uniform(1, 5))) : QVariant());
+                query.bindValue(4, session);
+                query.bindValue(5, objectId);
+                query.bindValue(6, cameraId);
+                query.bindValue(7, telescopeId);
+                query.bindValue(8, f + 1);
+                if (auto result = exec(query); !result)
+                    return fail(result.error());
+                --rows;
+                ++written;
+                if (progress && written % 10000 == 0)
+                    progress("observations", written, options.observations);
+            }
+        }
+    }
+
+    if (!db.commit())
+    {
+        return fail(ER::Error(db.lastError().text()));
+    }
+    return {};
+}
@@ -0,0 +1,39 @@
+#ifndef SAMPLEDATAGENERATOR_H
+#define SAMPLEDATAGENERATOR_H
+
+#include <QtGlobal>
+#include <expected>
+#include <functional>
+#include "ER.h"
+
+class DatabaseManager;
+
+struct SampleDataOptions
+{
+    int objects = 5000;
+    int sessions = 3000;
+    int observations = 500000;
+    quint64 seed = 1;     // same seed, same database
+    double latitude = 58.4; // observing site for the Moon data
+    double longitude = 26.7;
+};
+
+// Called with the phase ("objects", "sessions", "observations") and rows written so far
+using SampleDataProgress = std::function<void(const char *phase, int done, int total)>;
+
+// Fills an empty database created by DatabaseManager::initialize() with a synthetic log
+// through the real schema, indexes and triggers. Distributions follow a typical imaging log:
+// sessions cluster around new Moon, a few popular objects collect most observations, LRGB
+// and narrowband filter sets with their usual exposure lengths, occasional comments.
+class SampleDataGenerator
+{
+public:
+    explicit SampleDataGenerator(DatabaseManager *dbManager);
+
+    std::expected<void, ER> generate(const SampleDataOptions &options, const SampleDataProgress &progress = {}) const;
+
+private:
+    DatabaseManager *m_dbManager;
+};
+
+#endif // SAMPLEDATAGENERATOR_H
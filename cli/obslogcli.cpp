@@ -0,0 +1,499 @@
+// Batch commands on the observation log without the Widgets UI.
+//
+//   obslog-cli [--database <file>] export html|excel <file> [--from <date>] [--to <date>] [--sheet-per-object]
+//   obslog-cli [--database <file>] export site <directory>
+//   obslog-cli [--database <file>] export csv|jsonl <directory>
+//   obslog-cli [--database <file>] import csv|jsonl <directory>
+//   obslog-cli [--database <file>] backup
+//   obslog-cli [--database <file>] recompute-moon
+//   obslog-cli [--database <file>] stats monthly|objects
+//   obslog-cli [--database <file>] plan [--min-altitude <deg>] [--limit <count>]
+//   obslog-cli [--database <file>] resolve
+//
+// The database, observing site, backup retention and warning limits come from the
+// application's settings file unless given on the command line. Tables go to stdout as
+// tab separated text with a header line, messages to stderr.
+
+#include "astrocalc.h"
+#include "db/databasebackup.h"
+#include "db/databasemanager.h"
+#include "db/objectsrepository.h"
+#include "db/observationsrepository.h"
+#include "db/sessionsrepository.h"
+#include "db/statsrepository.h"
+#include "export/observationexcelexporter.h"
+#include "export/observationhtmlexporter.h"
+#include "export/staticsitegenerator.h"
+#include "export/tabledump.h"
+#include "settingsmanager.h"
+#include "simbadquery.h"
+#include "trace.h"
+#include "novas.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QEventLoop>
+#include <QFileInfo>
+#include <QHash>
+#include <QSqlError>
+#include <QTextStream>
+#include <algorithm>
+#include <cmath>
+#include <optional>
+
+namespace
+{
+    QTextStream &out()
+    {
+        static QTextStream stream(stdout);
+        return stream;
+    }
+
+    QTextStream &err()
+    {
+        static QTextStream stream(stderr);
+        return stream;
+    }
+
+    int fail(const QString &message)
+    {
+        err() << message << Qt::endl;
+        return 1;
+    }
+
+    int fail(const ER &error)
+    {
+        return fail(error.errorMessage);
+    }
+
+    // Progress on stderr, overwritten in place, so that stdout stays clean for pipes
+    ExportProgress progressPrinter(const QString &what)
+    {
+        return [what](const int exportedRows, const int totalRows)
+        {
+            err() << QString("\r%1 %L2 / %L3").arg(what).arg(exportedRows).arg(totalRows) << Qt::flush;
+            return true;
+        };
+    }
+
+    std::optional<QDate> dateOption(const QCommandLineParser &parser, const QString &name, bool &ok)
+    {
+        ok = true;
+        if (!parser.isSet(name))
+            return std::nullopt;
+        const QDate date = QDate::fromString(parser.value(name), Qt::ISODate);
+        ok = date.isValid();
+        return date;
+    }
+
+    int exportCommand(DatabaseManager *dbManager, const SettingsManager &settings, const QCommandLineParser &parser,
+                      const QStringList &arguments)
+    {
+        if (arguments.size() != 3)
+            return fail("Usage: export html|excel|site|csv|jsonl <file or directory>");
+        const QString kind = arguments[1];
+        const QString target = arguments[2];
+
+        ObservationFilter filter;
+        bool ok;
+        if (const auto from = dateOption(parser, "from", ok); from)
+            filter.fromDate = *from;
+        if (!ok)
+            return fail("--from needs a yyyy-MM-dd date");
+        if (const auto to = dateOption(parser, "to", ok); to)
+            filter.toDate = *to;
+        if (!ok)
+            return fail("--to needs a yyyy-MM-dd date");
+
+        QString filterDescription;
+        if (filter.fromDate.isValid() || filter.toDate.isValid())
+        {
+            filterDescription = QString("Sessions from %1 to %2")
+                                    .arg(filter.fromDate.isValid() ? filter.fromDate.toString(Qt::ISODate) : "start",
+                                         filter.toDate.isValid() ? filter.toDate.toString(Qt::ISODate) : "end");
+        }
+
+        std::expected<int, ER> result;
+        if (kind == "html")
+        {
+            ObservationHtmlExportOptions options;
+            options.filter = filter;
+            options.filterDescription = filterDescription;
+            options.moonWarningPercent = settings.moonIlluminationWarningPercent();
+            options.angularWarningDeg = settings.moonAngularSeparationWarningDeg();
+            result = ObservationHtmlExporter(dbManager).exportToFile(target, options, progressPrinter("Exported"));
+        }
+        else if (kind == "excel")
+        {
+            ObservationExcelExportOptions options;
+            options.filter = filter;
+            options.filterDescription = filterDescription;
+            options.sheetPerObject = parser.isSet("sheet-per-object");
+            result = ObservationExcelExporter(dbManager).exportToFile(target, options, progressPrinter("Exported"));
+        }
+        else if (kind == "site")
+        {
+            StaticSiteOptions options;
+            options.moonWarningPercent = settings.moonIlluminationWarningPercent();
+            options.angularWarningDeg = settings.moonAngularSeparationWarningDeg();
+            result = StaticSiteGenerator(dbManager).generate(target, options, progressPrinter("Pages"));
+        }
+        else if (kind == "csv" || kind == "jsonl")
+        {
+            const DumpFormat format = kind == "csv" ? DumpFormat::Csv : DumpFormat::JsonLines;
+            result = TableDumper(dbManager).dump(target, format, progressPrinter("Dumped"));
+        }
+        else
+        {
+            return fail(QString("Unknown export format %1, use html, excel, site, csv or jsonl").arg(kind));
+        }
+        err() << Qt::endl;
+
+        if (!result)
+            return fail(result.error());
+        err() << QString("Wrote %L1 %2 to %3").arg(*result).arg(QString(kind == "site" ? "pages" : "rows"), target) << Qt::endl;
+        return 0;
+    }
+
+    int importCommand(DatabaseManager *dbManager, const QStringList &arguments)
+    {
+        if (arguments.size() != 3 || (arguments[1] != "csv" && arguments[1] != "jsonl"))
+            return fail("Usage: import csv|jsonl <directory>");
+        const DumpFormat format = arguments[1] == "csv" ? DumpFormat::Csv : DumpFormat::JsonLines;
+
+        const auto report = TableImporter(dbManager).import(arguments[2], format,
+            [](qint64, qint64, const int importedRows)
+            {
+                err() << QString("\rImported %L1 rows").arg(importedRows) << Qt::flush;
+                return true;
+            });
+        err() << Qt::endl;
+        if (!report)
+            return fail(report.error());
+
+        err() << QString("Imported %L1 rows, skipped %L2 in %3 s")
+                     .arg(report->importedRows)
+                     .arg(report->skippedRows)
+                     .arg(report->seconds, 0, 'f', 1)
+              << Qt::endl;
+        for (const QString &problem : report->problems)
+            err() << "  " << problem << Qt::endl;
+        return 0;
+    }
+
+    int backupCommand(DatabaseManager *dbManager, const SettingsManager &settings)
+    {
+        BackupRetention retention;
+        retention.keepDaily = settings.backupKeepDaily();
+        retention.keepWeekly = settings.backupKeepWeekly();
+        retention.keepMonthly = settings.backupKeepMonthly();
+
+        QString errorMessage;
+        if (!DatabaseBackup::createBackup(dbManager->databasePath(), retention, errorMessage))
+            return fail(errorMessage);
+        err() << "Backup written to " << DatabaseBackup::getBackupDirectory(dbManager->databasePath()) << Qt::endl;
+        return 0;
+    }
+
+    // Moon values of every session again for the configured site, the way the Sessions tab
+    // computes them when a session is saved: local midnight after the session start date
+    int recomputeMoonCommand(DatabaseManager *dbManager, const SettingsManager &settings)
+    {
+        const SessionsRepository repository(dbManager);
+        const auto sessions = repository.getAllSessions();
+        if (!sessions)
+            return fail(sessions.error());
+
+        QSqlDatabase &db = dbManager->database();
+        if (!db.transaction())
+            return fail(db.lastError().text());
+        for (const SessionData &session : *sessions)
+        {
+            double illumination, ra, dec;
+            AstroCalc::moonInfoForDate(session.startDate.startOfDay().addDays(1), settings.latitude(),
+                                       settings.longitude(), &illumination, &ra, &dec);
+            if (auto result = repository.updateMoonData(session.id, illumination, ra, dec); !result)
+            {
+                db.rollback();
+                return fail(result.error());
+            }
+        }
+        if (!db.commit())
+            return fail(db.lastError().text());
+
+        err() << QString("Updated the Moon data of %L1 sessions for %2, %3")
+                     .arg(sessions->size())
+                     .arg(settings.latitude())
+                     .arg(settings.longitude())
+              << Qt::endl;
+        return 0;
+    }
+
+    int statsCommand(DatabaseManager *dbManager, const QStringList &arguments)
+    {
+        const StatsRepository repository(dbManager);
+        if (arguments.size() == 2 && arguments[1] == "monthly")
+        {
+            const auto months = repository.getMonthlyExposure();
+            if (!months)
+                return fail(months.error());
+            out() << "month\thours" << Qt::endl;
+            for (const MonthlyExposure &month : *months)
+                out() << month.month.toString("yyyy-MM") << '\t' << QString::number(month.totalSeconds / 3600.0, 'f', 2) << Qt::endl;
+            return 0;
+        }
+        if (arguments.size() == 2 && arguments[1] == "objects")
+        {
+            const auto table = repository.getObjectExposure();
+            if (!table)
+                return fail(table.error());
+            // Seconds, like the Object Stats tab
+            out() << "object";
+            for (const FilterTypeData &filterType : table->filterTypes)
+                out() << '\t' << filterType.name;
+            out() << "\ttotal" << Qt::endl;
+            for (const ObjectExposure &object : table->objects)
+            {
+                out() << object.name;
+                for (const qint64 seconds : object.seconds)
+                    out() << '\t' << seconds;
+                out() << '\t' << object.totalSeconds << Qt::endl;
+            }
+            return 0;
+        }
+        return fail("Usage: stats monthly|objects");
+    }
+
+    // Objects with coordinates that get above the minimum altitude at the configured site,
+    // in order of their next transit, with tonight's Moon and the exposure logged so far
+    int planCommand(DatabaseManager *dbManager, const SettingsManager &settings, const QCommandLineParser &parser)
+    {
+        const double minAltitude = parser.isSet("min-altitude") ? parser.value("min-altitude").toDouble() : 30.0;
+        const int limit = parser.isSet("limit") ? parser.value("limit").toInt() : -1;
+        const double lat = settings.latitude();
+        const double lon = settings.longitude();
+
+        const auto objects = ObjectsRepository(dbManager).getAllObjects();
+        if (!objects)
+            return fail(objects.error());
+        const auto exposure = StatsRepository(dbManager).getObjectExposure();
+        if (!exposure)
+            return fail(exposure.error());
+        QHash<int, qint64> loggedSeconds;
+        for (const ObjectExposure &object : exposure->objects)
+            loggedSeconds.insert(object.objectId, object.totalSeconds);
+
+        double moonIllumination, moonRa, moonDec;
+        AstroCalc::moonInfoForDate(QDate::currentDate().startOfDay().addDays(1), lat, lon, &moonIllumination, &moonRa,
+                                   &moonDec);
+
+        struct PlanRow
+        {
+            const ObjectData *object;
+            ObjectInfo info;
+            double maxAltitude;
+            double moonSeparation;
+        };
+        QVector<PlanRow> rows;
+        for (const ObjectData &object : *objects)
+        {
+            if (!object.ra || !object.dec)
+                continue;
+            // Altitude at transit
+            const double maxAltitude = 90.0 - std::abs(lat - *object.dec);
+            if (maxAltitude < minAltitude)
+                continue;
+            rows.append({&object, AstroCalc::getObjectInfo(lat, lon, *object.ra, *object.dec), maxAltitude,
+                         novas_sep(*object.ra * 15.0, *object.dec, moonRa, moonDec)});
+        }
+        std::ranges::sort(rows, [](const PlanRow &a, const PlanRow &b) { return a.info.transitTime < b.info.transitTime; });
+        if (limit >= 0 && rows.size() > limit)
+            rows.resize(limit);
+
+        err() << QString("Moon tonight: %1% illuminated").arg(moonIllumination, 0, 'f', 0) << Qt::endl;
+        out() << "object\ttransit\trise\tset\taltitude\tmax_altitude\tmoon_separation\tlogged_hours" << Qt::endl;
+        for (const PlanRow &row : rows)
+        {
+            QString name = row.object->name;
+            if (!row.object->comments.isEmpty())
+                name.append(" / " + row.object->comments);
+            // Circumpolar and never rising objects have no rise and set time
+            const auto localTime = [](const QDateTime &dateTime)
+            {
+                return dateTime.isValid() ? dateTime.toLocalTime().toString("yyyy-MM-dd hh:mm") : QString();
+            };
+            out() << name << '\t' << localTime(row.info.transitTime) << '\t' << localTime(row.info.riseTime) << '\t'
+                  << localTime(row.info.setTime) << '\t' << QString::number(row.info.altitude, 'f', 1) << '\t'
+                  << QString::number(row.maxAltitude, 'f', 1) << '\t' << QString::number(row.moonSeparation, 'f', 0)
+                  << '\t' << QString::number(loggedSeconds.value(row.object->id) / 3600.0, 'f', 2) << Qt::endl;
+        }
+        return 0;
+    }
+
+    // Coordinates of all objects that have none, from the SIMBAD cache or one batched SIMBAD
+    // query per thousand names. Objects with coordinates are never changed.
+    int resolveCommand(DatabaseManager *dbManager, const SettingsManager &settings)
+    {
+        const ObjectsRepository repository(dbManager);
+        const auto objects = repository.getAllObjects();
+        if (!objects)
+            return fail(objects.error());
+
+        // "M31" and "M 31" are one SIMBAD lookup
+        QHash<QString, QVector<const ObjectData *>> missing;
+        QStringList names;
+        for (const ObjectData &object : *objects)
+        {
+            if (!object.ra || !object.dec)
+            {
+                missing[SimbadCache::normalizedName(object.name)].append(&object);
+                names.append(object.name);
+            }
+        }
+        if (missing.isEmpty())
+        {
+            err() << "All objects have coordinates" << Qt::endl;
+            return 0;
+        }
+
+        SimbadQuery query;
+        query.setServiceUrl(QUrl(settings.simbadTapUrl()));
+        QEventLoop loop;
+        QVector<SimbadObject> resolved;
+        QStringList notFound;
+        QString error;
+        QObject::connect(&query, &SimbadQuery::objectsResolved, &loop,
+                         [&](int, const QVector<SimbadObject> &resolvedObjects, const QStringList &unknownNames)
+                         {
+                             resolved = resolvedObjects;
+                             notFound = unknownNames;
+                             loop.quit();
+                         });
+        QObject::connect(&query, &SimbadQuery::resolveFailed, &loop,
+                         [&](int, const QString &message)
+                         {
+                             error = message;
+                             loop.quit();
+                         });
+        query.resolveObjects(names);
+        loop.exec();
+        if (!error.isEmpty())
+            return fail(error);
+
+        int updated = 0;
+        for (const SimbadObject &simbadObject : resolved)
+        {
+            for (const ObjectData *object : missing.value(SimbadCache::normalizedName(simbadObject.queryName)))
+            {
+                // SIMBAD gives RA in degrees, the log keeps hours
+                if (auto result = repository.updateObject(object->id, object->name, simbadObject.ra / 15.0,
+                                                          simbadObject.dec, object->comments);
+                    !result)
+                    return fail(result.error());
+                ++updated;
+            }
+        }
+        for (const QString &name : notFound)
+            err() << "Not found in SIMBAD: " << name << Qt::endl;
+        err() << QString("Updated the coordinates of %L1 objects").arg(updated) << Qt::endl;
+        return 0;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("obslog-cli");
+    QCoreApplication::setApplicationVersion("1.0.0");
+    QCoreApplication::setOrganizationName("Prookyon");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Batch commands on the MonoObsLog database.\n\n"
+        "Commands:\n"
+        "  export html|excel <file>     Observations, optionally --from/--to session dates\n"
+        "  export site <directory>      Static site, only changed pages are written\n"
+        "  export csv|jsonl <directory> Dump of all tables\n"
+        "  import csv|jsonl <directory> Rows of a dump into the database\n"
+        "  backup                       Snapshot into the backup store\n"
+        "  recompute-moon               Moon data of all sessions for the configured site\n"
+        "  stats monthly|objects        Exposure per month or per object and filter type\n"
+        "  plan                         Objects to image tonight from the configured site\n"
+        "  resolve                      Coordinates of objects without them from SIMBAD");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("command", "Command and its arguments, see above.", "<command> [arguments]");
+    parser.addOptions({
+        {"database", "Database file instead of the one in the settings.", "file"},
+        {"latitude", "Observing site latitude instead of the one in the settings.", "degrees"},
+        {"longitude", "Observing site longitude instead of the one in the settings.", "degrees"},
+        {"from", "First session date of the export (yyyy-MM-dd).", "date"},
+        {"to", "Last session date of the export (yyyy-MM-dd).", "date"},
+        {"sheet-per-object", "Excel export with one sheet per object."},
+        {"min-altitude", "Plan: lowest transit altitude (30).", "degrees"},
+        {"limit", "Plan: at most this many objects.", "count"},
+        {"trace", "Write a Chrome trace of the run to <file>.", "file"},
+    });
+    parser.process(app);
+
+    const QStringList arguments = parser.positionalArguments();
+    if (arguments.isEmpty())
+        parser.showHelp(1);
+    const QString command = arguments[0];
+
+    const QString traceFile = parser.value("trace");
+    if (!traceFile.isEmpty())
+    {
+        if (Trace::isCompiledIn())
+            Trace::setEnabled(true);
+        else
+            qWarning() << "Tracing is not compiled into this build, configure with -DMONOOBSLOG_TRACING=ON";
+    }
+
+    SettingsManager settings;
+    if (!settings.initialize())
+        return fail("Failed to read the settings file");
+    if (parser.isSet("latitude"))
+        settings.setLatitude(parser.value("latitude").toDouble());
+    if (parser.isSet("longitude"))
+        settings.setLongitude(parser.value("longitude").toDouble());
+
+    const QString dbPath = parser.isSet("database") ? parser.value("database") : settings.databasePath();
+    if (dbPath.isEmpty())
+        return fail("No database configured, pass --database <file>");
+    // Only an import may start a new database, anything else on a missing file is a typo
+    if (command != "import" && !QFileInfo::exists(dbPath))
+        return fail(QString("Database %1 does not exist").arg(dbPath));
+
+    int exitCode;
+    {
+        DatabaseManager dbManager;
+        // The application may have the database open and archives its WAL
+        if (auto result = dbManager.initialize(dbPath, DatabaseManager::LeaveWalToApplication); !result)
+            return fail(QString("Failed to open %1: %2").arg(dbPath, result.error().errorMessage));
+
+        if (command == "export")
+            exitCode = exportCommand(&dbManager, settings, parser, arguments);
+        else if (command == "import")
+            exitCode = importCommand(&dbManager, arguments);
+        else if (command == "backup")
+            exitCode = backupCommand(&dbManager, settings);
+        else if (command == "recompute-moon")
+            exitCode = recomputeMoonCommand(&dbManager, settings);
+        else if (command == "stats")
+            exitCode = statsCommand(&dbManager, arguments);
+        else if (command == "plan")
+            exitCode = planCommand(&dbManager, settings, parser);
+        else if (command == "resolve")
+            exitCode = resolveCommand(&dbManager, settings);
+        else
+            exitCode = fail(QString("Unknown command %1, see --help").arg(command));
+    }
+
+    if (Trace::isEnabled())
+    {
+        if (auto result = Trace::writeChromeTrace(traceFile); !result)
+            qWarning() << "Failed to write trace:" << result.error().errorMessage;
+    }
+    return exitCode;
+}
@@ -0,0 +1,92 @@
+#ifndef BACKUPSTORE_H
+#define BACKUPSTORE_H
+
+#include <QDateTime>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <expected>
+#include <functional>
+#include "ER.h"
+
+// Snapshots pruning keeps: the keepLast newest ones, plus the newest snapshot of each of the
+// last keepDaily days, keepWeekly weeks and keepMonthly months that have one
+struct BackupRetention
+{
+    int keepLast = 3;
+    int keepDaily = 14;
+    int keepWeekly = 8;
+    int keepMonthly = 12;
+};
+
+struct BackupSnapshot
+{
+    QString id;        // manifest name, creation time as yyyyMMdd-HHmmss UTC
+    QDateTime created; // UTC
+};
+
+struct BackupStoreStats
+{
+    int chunks = 0;       // chunks of the snapshot
+    int newChunks = 0;    // chunks that were not in the store yet
+    qint64 size = 0;      // database bytes
+    qint64 newBytes = 0;  // compressed bytes added to the store
+};
+
+struct BackupVerifyReport
+{
+    int snapshots = 0;
+    int checkedChunks = 0;
+    QStringList problems; // empty if every snapshot can be restored
+};
+
+// Called with the work done so far and the total. Returning false cancels.
+using BackupProgress = std::function<bool(int done, int total)>;
+
+// Deduplicating backup store. A database copy is cut into content-defined chunks (a gear
+// rolling hash picks the cut points, so an edit only changes the chunks around it) and each
+// chunk is stored once, zlib compressed under its SHA-256 in chunks/. A snapshot is a small
+// JSON manifest in snapshots/ listing its chunks, so a daily snapshot only costs the chunks
+// whose pages changed since the previous one.
+//
+// Only files are touched, the store can be used from any thread.
+class BackupStore
+{
+public:
+    explicit BackupStore(const QString &directory);
+
+    // Adds a snapshot of a database file that is not being written to, see DatabaseBackup::copyDatabase().
+    // created is when the copy was started, WalArchive replays the commits after it.
+    std::expected<BackupSnapshot, ER> addSnapshot(const QString &databaseCopyPath, const QDateTime &created,
+                                                  BackupStoreStats *stats = nullptr);
+    // Newest first
+    [[nodiscard]] std::expected<QVector<BackupSnapshot>, ER> snapshots() const;
+    // Removes the snapshots the retention does not keep and the chunks no snapshot uses any more.
+    // Returns the number of removed snapshots.
+    std::expected<int, ER> prune(const BackupRetention &retention);
+    // Writes the database of a snapshot to targetPath, which is only replaced if the restored
+    // file matches the checksum in the manifest
+    [[nodiscard]] std::expected<void, ER> restore(const QString &snapshotId, const QString &targetPath) const;
+    // Reads every chunk of every snapshot and compares it with its hash
+    [[nodiscard]] std::expected<BackupVerifyReport, ER> verify(const BackupProgress &progress = {}) const;
+
+private:
+    struct Manifest
+    {
+        qint64 size = 0;
+        QString sha256;
+        QStringList chunks;
+    };
+
+    [[nodiscard]] QString chunkPath(const QString &hash) const;
+    [[nodiscard]] QString manifestPath(const QString &snapshotId) const;
+    [[nodiscard]] std::expected<Manifest, ER> readManifest(const QString &snapshotId) const;
+    [[nodiscard]] std::expected<QByteArray, ER> readChunk(const QString &hash) const;
+    // Deletes the chunk files whose hash is not in used
+    void removeUnusedChunks(const QSet<QString> &used) const;
+
+    QString m_directory;
+};
+
+#endif // BACKUPSTORE_H
@@ -3,6 +3,9 @@
 
 #include <QString>
 #include <QObject>
+#include "db/backupstore.h"
+
+class QThread;
 
 class DatabaseBackup : public QObject
 {
@@ -10,19 +13,39 @@ class DatabaseBackup : public QObject
 
 public:
     explicit DatabaseBackup(QObject *parent = nullptr);
+    // Stops a running background backup and waits for it
     ~DatabaseBackup() override;
 
+    // Runs checkAndBackupIfNeeded() on a worker thread. The copy is read through its own
+    // connection inside one read transaction, so the application keeps writing meanwhile.
+    void startBackupIfNeeded(const QString &dbPath, const BackupRetention &retention);
+    [[nodiscard]] bool isRunning() const { return m_thread != nullptr; }
+
     // Check if backup is needed and create if necessary
-    static bool checkAndBackupIfNeeded(const QString &dbPath, QString &errorMessage);
+    static bool checkAndBackupIfNeeded(const QString &dbPath, const BackupRetention &retention, QString &errorMessage);
 
-    // Force create a backup
-    static bool createBackup(const QString &dbPath, QString &errorMessage);
+    // Force create a backup: adds a snapshot to the BackupStore in the backup directory and
+    // prunes the snapshots the retention does not keep
+    static bool createBackup(const QString &dbPath, const BackupRetention &retention, QString &errorMessage);
 
-private:
+    // Copies the live database page by page with the SQLite online backup API, the copy is a
+    // consistent snapshot even while the application writes to the database. Without
+    // MONOOBSLOG_QT_SYSTEM_SQLITE the copy is made with VACUUM INTO through Qt's driver instead.
+    static bool copyDatabase(const QString &dbPath, const QString &copyPath, QString &errorMessage);
+
+    // ObsLogBackup next to the database, holds the BackupStore
     static QString getBackupDirectory(const QString &dbPath);
-    static QString getLatestBackupPath(const QString &backupDir);
-    static bool isBackupNeeded(const QString &latestBackupPath);
-    static bool createZipBackup(const QString &dbPath, const QString &backupPath, QString &errorMessage);
+
+signals:
+    // Emitted by startBackupIfNeeded() only when a snapshot is actually taken
+    void backupStarted();
+    void backupFinished(bool success, const QString &message);
+
+private:
+    // True if the newest snapshot is from before today
+    static bool isBackupNeeded(const QString &backupDir);
+
+    QThread *m_thread;
 };
 
 #endif // DATABASEBACKUP_H
\ No newline at end of file
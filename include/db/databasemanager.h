@@ -1,13 +1,64 @@
 #ifndef DATABASEMANAGER_H
 #define DATABASEMANAGER_H
 
+#include <QCache>
+#include <QHash>
 #include <QObject>
 #include <QSqlDatabase>
 #include <QString>
+#include <QVector>
 #include "ER.h"
+#include "db/querystats.h"
 #include <expected>
 
-#define OBSLOGDBVERSION 3
+#define OBSLOGDBVERSION 8
+
+struct sqlite3;
+struct sqlite3_stmt;
+class ReferenceDataCache;
+class WalArchiver;
+
+// Tables that publish row-level change notifications. Values are bit flags so that
+// tabs can describe the set of tables they depend on.
+enum class DbTable
+{
+    Unknown = 0x00,
+    FilterTypes = 0x01,
+    Cameras = 0x02,
+    Telescopes = 0x04,
+    Objects = 0x08,
+    Sessions = 0x10,
+    Filters = 0x20,
+    Observations = 0x40
+};
+Q_DECLARE_FLAGS(DbTables, DbTable)
+Q_DECLARE_OPERATORS_FOR_FLAGS(DbTables)
+
+enum class DbOperation
+{
+    Insert,
+    Update,
+    Delete
+};
+
+struct DbChange
+{
+    DbTable table;
+    DbOperation operation;
+    qint64 rowId;
+};
+
+// Page cache counters of the connection since it was opened, and the file sizes
+struct ConnectionStats
+{
+    bool available = false; // false without the native SQLite handle
+    qint64 cacheHits = 0;
+    qint64 cacheMisses = 0;
+    qint64 cacheWrites = 0;
+    qint64 cacheUsedBytes = 0;
+    qint64 databaseBytes = 0;
+    qint64 walBytes = 0;
+};
 
 class DatabaseManager : public QObject
 {
@@ -17,9 +68,57 @@ public:
     explicit DatabaseManager(QObject *parent = nullptr);
     ~DatabaseManager() override;
 
-    std::expected<void, ER> initialize(const QString &dbPath = "observations.db");
+    // Who takes care of the WAL. The application archives every commit for point-in-time restore
+    // and checkpoints itself; any other process writing to the same database (obslog-cli) must
+    // not archive too, the two archivers would store overlapping frame ranges.
+    enum WalHandling
+    {
+        ArchiveWal,
+        LeaveWalToApplication
+    };
+
+    std::expected<void, ER> initialize(const QString &dbPath = "observations.db",
+                                       WalHandling walHandling = ArchiveWal);
+    // Opens an existing database read-only on a connection of its own, for use on a worker
+    // thread. All queries see the database as it was when this returns, commits made
+    // meanwhile by the main connection stay invisible (WAL mode keeps both from blocking).
+    // No migrations are run and no change notifications are sent.
+    std::expected<void, ER> openSnapshot(const QString &dbPath);
+    [[nodiscard]] QString databasePath() const;
     [[nodiscard]] bool isOpen() const;
     QSqlDatabase &database();
+    // Shared id/name lists of the reference tables, kept in sync with committed changes
+    [[nodiscard]] ReferenceDataCache *referenceData() const;
+
+    // Native SQLite handle of the Qt driver connection, nullptr if not available or
+    // if the linked SQLite library is not the one used by the Qt driver
+    [[nodiscard]] sqlite3 *nativeHandle() const;
+    // Handle SqlStatement prepares on: nativeHandle() unless native statements are turned off,
+    // which the benchmark does to time the QSqlQuery fallback on the same build
+    [[nodiscard]] sqlite3 *statementHandle() const;
+    void setNativeStatements(bool enabled);
+
+    // True if the application SQL functions (angular_separation) are available in queries
+    [[nodiscard]] bool hasSqlFunctions() const;
+    // True if the SQLite library of the connection has its built-in math functions (acos, sin, ...),
+    // which lets plain SQL compute what angular_separation does
+    [[nodiscard]] bool hasMathFunctions() const;
+    // True if the commits of this connection are archived for point-in-time restore, which
+    // needs the native handle and ArchiveWal
+    [[nodiscard]] bool isWalArchived() const;
+
+    // Prepared statements kept for reuse by SqlStatement, keyed by their SQL text. A taken
+    // statement belongs to the caller until it is returned reset; nullptr if none is cached.
+    sqlite3_stmt *takeCachedStatement(const QString &sql);
+    void returnCachedStatement(const QString &sql, sqlite3_stmt *stmt);
+
+    // Timings of the statements run on this connection, by SQL text. Only recorded on the
+    // main connection; without the native handle only for statements run through SqlStatement.
+    [[nodiscard]] const QueryStats &queryStats() const;
+    void clearQueryStats();
+    // Adds a statement the trace hook does not see, ignored where the hook records or on snapshots
+    void recordQueryStats(const char *sql, qint64 nanoseconds, qint64 rows);
+    [[nodiscard]] ConnectionStats connectionStats() const;
 
     static int getSupportedDbVersion();
     [[nodiscard]] std::expected<int, ER> getActualDbVersion() const;
@@ -29,15 +128,54 @@ signals:
     void errorOccurred(const QString &error);
     void databaseInitialized();
 
+    // Emitted once per committed transaction (after control returns to the event loop)
+    // with the set of touched tables and every changed row in commit order.
+    void dataChanged(DbTables tables, const QVector<DbChange> &changes);
+
 private:
     [[nodiscard]] bool createTables() const;
     [[nodiscard]] bool tableExists(const QString &tableName) const;
     std::expected<void, ER> runMigrations(int fromVersion, int toVersion) const;
 
+    void checkNativeApi();
+    void registerSqlFunctions();
+    void checkMathFunctions();
+    void installChangeHooks();
+    void removeChangeHooks();
+    void flushChanges();
+
+    static void updateHook(void *context, int operation, const char *dbName, const char *tableName, qint64 rowId);
+    static int commitHook(void *context);
+    static void rollbackHook(void *context);
+    static int traceHook(unsigned type, void *context, void *statement, void *data);
+
+    // Finalizes its statement when dropped from the cache
+    struct CachedStatement
+    {
+        explicit CachedStatement(sqlite3_stmt *statement) : stmt(statement) {}
+        ~CachedStatement();
+        sqlite3_stmt *stmt;
+    };
 
     QSqlDatabase m_database;
     QString m_dbPath;
     bool m_initialized;
+    bool m_nativeApiUsable;
+    bool m_sqlFunctionsRegistered;
+    bool m_mathFunctions;
+    bool m_nativeStatements;
+    bool m_snapshot; // opened by openSnapshot()
+    ReferenceDataCache *m_referenceData;
+    WalArchiver *m_walArchiver; // nullptr for snapshots or without the native handle
+    QCache<QString, CachedStatement> m_statementCache; // one statement per SQL text, least recently used dropped
+
+    // Changes of the currently open transaction and committed changes waiting for dataChanged
+    QVector<DbChange> m_uncommittedChanges;
+    QVector<DbChange> m_committedChanges;
+    bool m_flushScheduled;
+
+    QueryStats m_queryStats;
+    QHash<sqlite3_stmt *, qint64> m_statementRows; // rows stepped by statements still running
 };
 
-#endif // DATABASEMANAGER_H
\ No newline at end of file
+#endif // DATABASEMANAGER_H
@@ -6,6 +6,7 @@
 #include <QVariant>
 #include <QVector>
 #include <expected>
+#include <optional>
 #include "ER.h"
 
 class DatabaseManager;
@@ -14,8 +15,8 @@ struct ObjectData
 {
     int id;
     QString name;
-    QVariant ra;  // Can be null
-    QVariant dec; // Can be null
+    std::optional<double> ra;  // hours, empty if unknown
+    std::optional<double> dec; // degrees, empty if unknown
     QString comments;
 };
 
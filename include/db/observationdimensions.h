@@ -0,0 +1,80 @@
+#ifndef OBSERVATIONDIMENSIONS_H
+#define OBSERVATIONDIMENSIONS_H
+
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <optional>
+
+struct ObservationData;
+
+// Deduplicates equal strings so that they share one implicitly shared buffer
+class StringPool
+{
+public:
+    QString intern(const QString &value);
+
+private:
+    QSet<QString> m_strings;
+};
+
+struct SessionDimension
+{
+    QString name;
+    QString date;
+    qint64 startJd = 0; // QDate::toJulianDay() of date
+    double moonIllumination = 0.0;
+    std::optional<double> moonRa;  // degrees
+    std::optional<double> moonDec; // degrees
+};
+
+struct ObjectDimension
+{
+    QString name;
+    QString comments;
+    std::optional<double> ra;  // hours
+    std::optional<double> dec; // degrees
+
+    // "name / comments" as shown in tables and combo boxes
+    [[nodiscard]] QString displayName() const;
+};
+
+// Reference rows observations point to. Observation rows only carry the ids, names and
+// coordinates are looked up here and shared by all rows.
+class ObservationDimensions
+{
+public:
+    void addSession(int id, const SessionDimension &session);
+    void addObject(int id, const ObjectDimension &object);
+    void addCamera(int id, const QString &name);
+    void addTelescope(int id, const QString &name);
+    void addFilter(int id, const QString &name);
+
+    // Unknown ids resolve to empty values
+    [[nodiscard]] const SessionDimension &session(int id) const;
+    [[nodiscard]] const ObjectDimension &object(int id) const;
+    [[nodiscard]] QString camera(int id) const;
+    [[nodiscard]] QString telescope(int id) const;
+    [[nodiscard]] QString filter(int id) const;
+
+    [[nodiscard]] const QHash<int, SessionDimension> &sessions() const { return m_sessions; }
+    [[nodiscard]] const QHash<int, ObjectDimension> &objects() const { return m_objects; }
+    [[nodiscard]] const QHash<int, QString> &cameras() const { return m_cameras; }
+    [[nodiscard]] const QHash<int, QString> &telescopes() const { return m_telescopes; }
+    [[nodiscard]] const QHash<int, QString> &filters() const { return m_filters; }
+
+    // Separation between object and moon of the session in degrees, negative if coordinates are missing
+    [[nodiscard]] double angularSeparation(const ObservationData &obs) const;
+    // True if every id the observation references is known
+    [[nodiscard]] bool contains(const ObservationData &obs) const;
+
+private:
+    StringPool m_strings;
+    QHash<int, SessionDimension> m_sessions;
+    QHash<int, ObjectDimension> m_objects;
+    QHash<int, QString> m_cameras;
+    QHash<int, QString> m_telescopes;
+    QHash<int, QString> m_filters;
+};
+
+#endif // OBSERVATIONDIMENSIONS_H
@@ -3,35 +3,134 @@
 
 #include <QObject>
 #include <QString>
+#include <QList>
+#include <QSet>
+#include <QHash>
 #include <QVector>
+#include <QVariant>
+#include <QDate>
 #include <expected>
+#include <functional>
+#include <optional>
 #include "ER.h"
+#include "db/observationdimensions.h"
 
 class DatabaseManager;
 
+// Compact observation row. Names, dates and coordinates of the referenced
+// session/object/camera/telescope/filter come from ObservationDimensions.
 struct ObservationData
 {
     int id;
     int imageCount;
     int exposureLength;
     int totalExposure;
-    QString comments;
     int sessionId;
     int objectId;
     int cameraId;
     int telescopeId;
     int filterId;
+    QString comments;
+};
 
-    // Joined data for display
-    QString sessionName;
-    QString sessionDate;
-    QString objectName;
-    QString objectComments;
-    QString cameraName;
-    QString telescopeName;
-    QString filterName;
-    double moonIllumination;
-    double angularSeparation;
+// Observation rows together with the dimensions they reference
+struct ObservationSet
+{
+    QVector<ObservationData> rows;
+    ObservationDimensions dimensions;
+};
+
+// Columns observations can be ordered by, in display order of the observations table
+enum class ObservationSortField
+{
+    SessionName,
+    SessionDate,
+    Object,
+    Camera,
+    Telescope,
+    Filter,
+    ImageCount,
+    ExposureLength,
+    TotalExposure,
+    MoonIllumination,
+    AngularSeparation,
+    Comments
+};
+
+// Conditions observations must satisfy, all of them combined with AND. Empty id lists and
+// unset bounds do not restrict. Ranges are inclusive.
+struct ObservationFilter
+{
+    QList<int> sessionIds;
+    QList<int> objectIds;
+    QList<int> cameraIds;
+    QList<int> telescopeIds;
+    QList<int> filterIds;
+    QList<int> filterTypeIds;
+    QDate fromDate; // session start date, null for open
+    QDate toDate;
+    std::optional<double> minMoonIllumination; // percent
+    std::optional<double> maxMoonIllumination;
+    std::optional<double> minAngularSeparation; // degrees, rows without coordinates never match
+    std::optional<double> maxAngularSeparation;
+    QString searchText; // words searched in observation, session and object comments
+
+    [[nodiscard]] bool isEmpty() const { return *this == ObservationFilter(); }
+    bool operator==(const ObservationFilter &other) const = default;
+};
+
+// Observation found by full text search
+struct ObservationSearchHit
+{
+    int observationId;
+    int sessionId;
+    int objectId;
+    QString snippet; // HTML escaped comment excerpt, matched words in <b>
+};
+
+// Number of observations of one object
+struct ObjectObservationCount
+{
+    int objectId;
+    int observationCount;
+};
+
+// Observations of one object or session. Changes whenever one of them is added, changed or
+// deleted: ids are never reused and every change takes a new revision.
+struct ObservationAggregate
+{
+    int observations = 0;
+    qint64 totalExposure = 0; // seconds
+    qint64 maxId = 0;
+    qint64 maxRevision = 0;   // 0 while no row was changed since DB version 8
+    qint64 lastJd = 0;        // start of the newest session
+};
+
+// Column observations are grouped by
+enum class ObservationGrouping
+{
+    Object,
+    Session
+};
+
+// Position of a row in a sort order: the sort value with the observation id as tie-breaker
+struct ObservationKey
+{
+    QVariant value;
+    int id = -1;
+};
+
+// One page of observations in keyset order. Either continue after a key or reload the
+// inclusive key range [from, to] of a page that was fetched before.
+struct ObservationPageQuery
+{
+    ObservationSortField sortField = ObservationSortField::SessionDate;
+    Qt::SortOrder order = Qt::DescendingOrder;
+    ObservationFilter filter;
+    std::optional<ObservationKey> after;
+    std::optional<ObservationKey> from;
+    std::optional<ObservationKey> to;
+    int limit = -1;
 };
 
 class ObservationsRepository : public QObject
@@ -43,8 +142,46 @@ public:
     ~ObservationsRepository() override = default;
 
     // Query operations
-    std::expected<QVector<ObservationData>, ER> getAllObservations() const;
-    std::expected<QVector<ObservationData>, ER> getObservationsByObject(int objectId) const;
+    std::expected<ObservationSet, ER> getAllObservations() const;
+    // Observations matching the filter, newest sessions first
+    std::expected<ObservationSet, ER> getObservations(const ObservationFilter &filter) const;
+    // Same rows and order as getObservations, passed to callback one by one without collecting them.
+    // Stops early when callback returns false, the result tells whether all rows were visited.
+    std::expected<bool, ER> forEachObservation(const ObservationFilter &filter,
+                                               const std::function<bool(const ObservationData &)> &callback) const;
+    std::expected<int, ER> countObservations(const ObservationFilter &filter) const;
+    // Objects with observations matching the filter, ordered by object name
+    std::expected<QVector<ObjectObservationCount>, ER> countObservationsByObject(const ObservationFilter &filter) const;
+    // Ids of all objects that have at least one observation
+    std::expected<QSet<int>, ER> getObservedObjectIds() const;
+    // Those of objectIds that have at least one observation, an index lookup per id
+    std::expected<QSet<int>, ER> getObservedObjectIds(const QList<int> &objectIds) const;
+    // Objects of the observations in ids, observations that no longer exist are skipped
+    std::expected<QSet<int>, ER> getObjectIdsOfObservations(const QList<int> &ids) const;
+    // Objects observed in the sessions, and the other way round
+    std::expected<QSet<int>, ER> getObjectIdsOfSessions(const QList<int> &sessionIds) const;
+    std::expected<QSet<int>, ER> getSessionIdsOfObjects(const QList<int> &objectIds) const;
+    // Aggregates of all observations by object or session, groups without observations are missing
+    std::expected<QHash<int, ObservationAggregate>, ER> getAggregates(ObservationGrouping grouping) const;
+    // Exposure in seconds by filter id of the observations of one object or session
+    std::expected<QHash<int, qint64>, ER> getExposureByFilter(ObservationGrouping grouping, int id) const;
+    std::expected<ObservationDimensions, ER> getDimensions() const;
+    std::expected<ObservationData, ER> getObservationById(int id) const;
+    // Rows that no longer exist or do not match the filter are silently skipped, order of the result is unspecified
+    std::expected<QVector<ObservationData>, ER> getObservationsByIds(const QList<int> &ids,
+                                                                    const ObservationFilter &filter = {}) const;
+    std::expected<QVector<ObservationData>, ER> getObservationsPage(const ObservationPageQuery &pageQuery) const;
+    // Best matches of filter.searchText within the other filter conditions, most relevant first
+    std::expected<QVector<ObservationSearchHit>, ER> searchObservations(const ObservationFilter &filter, int limit) const;
+
+    // True if queries can sort and filter by the Moon angular separation, either through the
+    // angular_separation() SQL function or SQLite's built-in math functions
+    [[nodiscard]] bool hasAngularSeparation() const;
+    // Sort key of an observation, compares the same way as the ORDER BY of getObservationsPage
+    ObservationKey sortKey(const ObservationData &obs, const ObservationDimensions &dimensions,
+                           ObservationSortField field) const;
+    // Negative, zero or positive like strcmp, ascending order
+    static int compareKeys(const ObservationKey &lhs, const ObservationKey &rhs);
     std::expected<void, ER> addObservation(int imageCount, int exposureLength, const QString &comments,
                                         int sessionId, int objectId, int cameraId, int telescopeId,
                                         int filterId) const;
@@ -0,0 +1,53 @@
+#ifndef QUERYSTATS_H
+#define QUERYSTATS_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include <array>
+
+// Totals of one SQL text, latencies in milliseconds
+struct QueryStat
+{
+    QString sql;
+    qint64 count = 0;
+    qint64 rows = 0;
+    double p50Ms = 0;
+    double p99Ms = 0;
+    double maxMs = 0;
+    double totalMs = 0;
+};
+
+// Execution count, rows returned and latency distribution per SQL text, fed by the
+// statement profile hook of DatabaseManager. Latencies are kept in a log-scale histogram
+// (four buckets per doubling from 1 µs), so percentiles are within about 19% and memory
+// does not grow with the number of executions.
+class QueryStats
+{
+public:
+    void record(const char *sql, qint64 nanoseconds, qint64 rows);
+    // Most total time first
+    [[nodiscard]] QVector<QueryStat> stats() const;
+    void clear();
+
+private:
+    static constexpr int bucketCount = 112; // up to 2^28 µs, longer runs land in the last bucket
+
+    struct Entry
+    {
+        qint64 count = 0;
+        qint64 rows = 0;
+        qint64 totalNs = 0;
+        qint64 maxNs = 0;
+        std::array<quint32, bucketCount> buckets{};
+    };
+
+    static int bucketIndex(qint64 nanoseconds);
+    static double bucketUpperMs(int index);
+    static double percentileMs(const Entry &entry, double fraction);
+
+    QHash<QByteArray, Entry> m_entries;
+};
+
+#endif // QUERYSTATS_H
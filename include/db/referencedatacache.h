@@ -0,0 +1,59 @@
+#ifndef REFERENCEDATACACHE_H
+#define REFERENCEDATACACHE_H
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <expected>
+#include <optional>
+#include "db/databasemanager.h"
+#include "db/observationdimensions.h"
+#include "ER.h"
+
+struct ReferenceItem
+{
+    int id;
+    QString name; // label as shown in combo boxes
+};
+
+// In-memory id/name lists of the reference tables (sessions, objects, cameras, telescopes,
+// filters, filter types) shared by all tabs. A table is loaded on first use and dropped
+// again when DatabaseManager reports a committed change to it.
+class ReferenceDataCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ReferenceDataCache(DatabaseManager *dbManager);
+    ~ReferenceDataCache() override = default;
+
+    // Items in display order: sessions newest first, filters by filter type priority, others by name
+    std::expected<QVector<ReferenceItem>, ER> items(DbTable table);
+    // Label of one row, empty if the id is unknown
+    QString name(DbTable table, int id);
+    // Dimensions for resolving observation rows
+    std::expected<ObservationDimensions, ER> observationDimensions();
+
+    void invalidate(DbTables tables);
+
+signals:
+    // Emitted after cached tables were dropped, before listeners of DatabaseManager::dataChanged run
+    void invalidated(DbTables tables);
+
+private:
+    struct Table
+    {
+        bool loaded = false;
+        QVector<ReferenceItem> items;
+        QHash<int, qsizetype> indexById;
+    };
+
+    std::expected<Table *, ER> load(DbTable table);
+
+    DatabaseManager *m_dbManager;
+    QHash<int, Table> m_tables; // keyed by DbTable value
+    std::optional<ObservationDimensions> m_dimensions;
+};
+
+#endif // REFERENCEDATACACHE_H
@@ -33,6 +33,8 @@ public:
     std::expected<void, ER> addSession(const QString &name, const QDate &startDate, const QString &comments, const double &moonIllumination, const double &moonRa, const double &moonDec) const;
     std::expected<void, ER> updateSession(int id, const QString &name, const QDate &startDate, const QString &comments, const double &moonIllumination, const double &moonRa, const double &moonDec) const;
     std::expected<void, ER> deleteSession(int id) const;
+    // Replaces the Moon values of a session, e.g. after the observing site changed
+    std::expected<void, ER> updateMoonData(int id, double moonIllumination, double moonRa, double moonDec) const;
 
 private:
     DatabaseManager *m_dbManager;
@@ -0,0 +1,79 @@
+#ifndef SQLSTATEMENT_H
+#define SQLSTATEMENT_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QSqlQuery>
+#include <QString>
+#include <QVariant>
+#include <optional>
+#include <string_view>
+
+class DatabaseManager;
+struct sqlite3_stmt;
+
+// Read-only statement that decodes result columns by ordinal without going through QVariant.
+// It is prepared directly on the native SQLite handle of the Qt connection. If the native API
+// is not usable (or turned off with DatabaseManager::setNativeStatements()) it falls back to a
+// forward-only QSqlQuery with the same interface.
+//
+// Resolve column ordinals with columnIndex() once after exec() and use them for every row.
+// Only positional "?" placeholders are supported.
+//
+// Statements that run often with the same text, like the pages of a filtered query, can be
+// Cached: the prepared statement is then taken from and handed back to the cache of the
+// DatabaseManager instead of being prepared and finalized every time.
+class SqlStatement
+{
+public:
+    enum Preparation
+    {
+        PrepareOnce,
+        Cached
+    };
+
+    SqlStatement(DatabaseManager *dbManager, const QString &sql, Preparation preparation = PrepareOnce);
+    ~SqlStatement();
+
+    SqlStatement(const SqlStatement &) = delete;
+    SqlStatement &operator=(const SqlStatement &) = delete;
+
+    void addBindValue(const QVariant &value);
+    bool exec();
+    bool next();
+    [[nodiscard]] QString lastError() const;
+
+    // Ordinal of a result column, -1 if the statement has no such column
+    [[nodiscard]] int columnIndex(const char *name) const;
+    [[nodiscard]] int columnCount() const;
+    // Name or alias of a result column
+    [[nodiscard]] QString columnName(int column) const;
+    // True if the value of the current row is an integer or a real, false for text, blobs and NULL
+    [[nodiscard]] bool isNumeric(int column) const;
+
+    [[nodiscard]] bool isNull(int column) const;
+    [[nodiscard]] int toInt(int column) const;
+    [[nodiscard]] qint64 toInt64(int column) const;
+    [[nodiscard]] double toDouble(int column) const;
+    [[nodiscard]] std::optional<double> toOptionalDouble(int column) const;
+    [[nodiscard]] QString toString(int column) const;
+    // UTF-8 bytes of a text column, valid until the next call to next() or toUtf8()
+    [[nodiscard]] std::string_view toUtf8(int column) const;
+
+private:
+    // Hands the fallback's timing to the query statistics, like the trace hook does for native statements
+    void recordFallbackStats();
+
+    DatabaseManager *m_dbManager;
+    QString m_sql; // cache key, empty if not cached
+    sqlite3_stmt *m_stmt;
+    std::optional<QSqlQuery> m_query; // fallback without native API
+    int m_bindIndex;
+    bool m_rowPending; // exec() already stepped onto the first row
+    QString m_error;
+    mutable QByteArray m_utf8Buffer; // backs toUtf8() in fallback mode
+    QElapsedTimer m_fallbackTimer;   // from exec() until the last row in fallback mode
+    qint64 m_fallbackRows;
+};
+
+#endif // SQLSTATEMENT_H
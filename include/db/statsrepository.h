@@ -0,0 +1,53 @@
+#ifndef STATSREPOSITORY_H
+#define STATSREPOSITORY_H
+
+#include <QDate>
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <expected>
+#include "db/filtertypesrepository.h"
+#include "ER.h"
+
+class DatabaseManager;
+
+// Exposure of all sessions that started in one month
+struct MonthlyExposure
+{
+    QDate month; // first day of the month
+    qint64 totalSeconds;
+};
+
+// Exposure of one object split by filter type
+struct ObjectExposure
+{
+    int objectId;
+    QString name; // "name / comments" when the object has comments
+    QVector<qint64> seconds; // per filter type, in the order of ObjectExposureTable::filterTypes
+    qint64 totalSeconds;
+};
+
+struct ObjectExposureTable
+{
+    QVector<FilterTypeData> filterTypes; // ordered by priority
+    QVector<ObjectExposure> objects;     // objects with observations, ordered by name
+};
+
+// Aggregates behind the statistics tabs
+class StatsRepository : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit StatsRepository(DatabaseManager *dbManager, QObject *parent = nullptr);
+    ~StatsRepository() override = default;
+
+    // Months with observations, oldest first
+    std::expected<QVector<MonthlyExposure>, ER> getMonthlyExposure() const;
+    std::expected<ObjectExposureTable, ER> getObjectExposure() const;
+
+private:
+    DatabaseManager *m_dbManager;
+};
+
+#endif // STATSREPOSITORY_H
@@ -0,0 +1,118 @@
+#ifndef WALARCHIVE_H
+#define WALARCHIVE_H
+
+#include <QDateTime>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+#include <expected>
+#include "ER.h"
+
+struct sqlite3;
+class DatabaseManager;
+class QFile;
+class QTimer;
+
+// Commit in an archived WAL segment: frames of the WAL generation up to and including the commit
+struct WalCommit
+{
+    qint32 frames;
+    qint64 msecs; // commit time, milliseconds since epoch UTC
+};
+
+// Archived run of WAL frames. Frames are numbered from the start of their WAL generation
+// (the WAL file between two resets, identified by its salts).
+struct WalSegment
+{
+    QString fileName;
+    quint32 pageSize = 0;
+    quint32 salt1 = 0;
+    quint32 salt2 = 0;
+    qint32 firstFrame = 0;
+    qint32 frameCount = 0;
+    QVector<WalCommit> commits;
+    QByteArray baseSha256; // of the database file (without its header) the generation started from,
+                           // only in the first segment of a generation
+    QByteArray sha256;     // of the uncompressed frames
+    QByteArray frames;     // zlib compressed, only read when asked for
+
+    [[nodiscard]] qint64 lastCommitMsecs() const { return commits.isEmpty() ? 0 : commits.last().msecs; }
+};
+
+struct WalRestoreReport
+{
+    QString snapshotId;   // BackupStore snapshot the frames were replayed onto
+    QDateTime snapshotCreated;
+    int segments = 0;     // segments replayed
+    QDateTime restoredTo; // time of the last replayed commit, the snapshot time if none
+    QString breakBefore;  // segment the replay stopped at because changes before it were never
+                          // archived, empty if the archive was continuous up to the chosen time
+};
+
+// Archives the WAL of the main connection into <backup directory>/wal. The archiver takes
+// over checkpointing from SQLite: once the WAL holds checkpointFrames frames (or every few
+// minutes with pending commits) the committed frames not archived yet are copied out, then
+// the WAL is checkpointed. Compressing and writing happen on a worker thread, the commit
+// path only records the frame count and time of each commit.
+class WalArchiver : public QObject
+{
+    Q_OBJECT
+
+public:
+    WalArchiver(DatabaseManager *dbManager, const QString &backupDirectory);
+    // Archives what is left and waits for pending writes
+    ~WalArchiver() override;
+
+    // False if the native SQLite handle is not available, SQLite then checkpoints on its own
+    bool install();
+    // Copies committed frames not archived yet and checkpoints
+    void archive();
+
+private:
+    static constexpr int checkpointFrames = 1000; // SQLite's own auto-checkpoint threshold
+
+    static int walHook(void *context, sqlite3 *handle, const char *dbName, int frames);
+    void scheduleArchive();
+
+    DatabaseManager *m_dbManager;
+    QString m_directory;
+    QThreadPool m_writer; // one thread, segments are written in order
+    QTimer *m_timer;
+    QVector<WalCommit> m_commits; // commits not archived yet
+    quint32 m_salt1;
+    quint32 m_salt2;
+    qint32 m_archivedFrames; // frames of the generation m_salt1/m_salt2 already archived
+    bool m_installed;
+    bool m_archiveScheduled;
+    int m_sequence;
+};
+
+// Reading side of the archive: point-in-time restore, verification and pruning
+class WalArchive
+{
+public:
+    // Segments of the archive in <backup directory>/wal, oldest first, without their frames
+    static std::expected<QVector<WalSegment>, ER> segments(const QString &backupDirectory);
+    // Restores the newest BackupStore snapshot taken before until and replays the archived
+    // commits up to until onto it, stopping early where the archive is not continuous.
+    // targetPath is only replaced if everything up to there was applied.
+    static std::expected<WalRestoreReport, ER> restore(const QString &backupDirectory, const QDateTime &until,
+                                                       const QString &targetPath);
+    // Checks every segment against its checksum and for gaps between segments, then replays
+    // the whole archive onto the oldest snapshot to find breaks between WAL generations
+    static QStringList verify(const QString &backupDirectory);
+    // Removes segments whose commits are all older than before, they are covered by every
+    // snapshot that is left
+    static int prune(const QString &backupDirectory, const QDateTime &before);
+
+private:
+    static std::expected<WalSegment, ER> readSegment(const QString &path, bool withFrames);
+    static std::expected<QByteArray, ER> uncompressFrames(const WalSegment &segment);
+    // Writes the commits of segments from report.snapshotCreated up to until into database
+    static std::expected<void, ER> replay(const QString &backupDirectory, const QVector<WalSegment> &segments,
+                                          const QDateTime &until, QFile &database, WalRestoreReport &report);
+};
+
+#endif // WALARCHIVE_H
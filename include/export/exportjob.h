@@ -0,0 +1,53 @@
+#ifndef EXPORTJOB_H
+#define EXPORTJOB_H
+
+#include <QObject>
+#include <QString>
+#include <atomic>
+#include <expected>
+#include <functional>
+#include "ER.h"
+
+class DatabaseManager;
+class QThread;
+
+// Called by exporters after every row with the rows written so far and the total.
+// Returning false cancels the export.
+using ExportProgress = std::function<bool(int exportedRows, int totalRows)>;
+
+// Runs one export on a worker thread. The task gets a DatabaseManager opened with
+// openSnapshot(), so it reads the database as it was when the job started while the
+// application keeps writing to it. Signals are delivered to the thread that owns the job.
+class ExportJob : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Runs on the worker thread and returns the number of exported rows
+    using Task = std::function<std::expected<int, ER>(DatabaseManager *snapshot, const ExportProgress &progress)>;
+
+    ExportJob(const QString &dbPath, Task task, QObject *parent = nullptr);
+    // Cancels a running export and waits for the worker to stop
+    ~ExportJob() override;
+
+    void start();
+    void cancel();
+    [[nodiscard]] bool isRunning() const;
+
+signals:
+    // Throttled to a few updates per second
+    void progressChanged(int exportedRows, int totalRows, double rowsPerSecond);
+    void succeeded(int exportedRows, double seconds);
+    void failed(const QString &errorMessage);
+    void cancelled();
+
+private:
+    void run();
+
+    QString m_dbPath;
+    Task m_task;
+    QThread *m_thread;
+    std::atomic_bool m_cancelRequested;
+};
+
+#endif // EXPORTJOB_H
@@ -0,0 +1,24 @@
+#ifndef EXPORTPROGRESSDIALOG_H
+#define EXPORTPROGRESSDIALOG_H
+
+#include <QProgressDialog>
+
+class ExportJob;
+
+// Non-modal progress of a running ExportJob: items written, total and items per second.
+// Cancel stops the job; the dialog deletes itself when the job ends.
+class ExportProgressDialog : public QProgressDialog
+{
+    Q_OBJECT
+
+public:
+    ExportProgressDialog(ExportJob *job, const QString &title, QWidget *parent = nullptr);
+
+    // Plural shown in the label, "rows" by default
+    void setItemName(const QString &itemName) { m_itemName = itemName; }
+
+private:
+    QString m_itemName;
+};
+
+#endif // EXPORTPROGRESSDIALOG_H
@@ -0,0 +1,30 @@
+#ifndef HTMLTEMPLATE_H
+#define HTMLTEMPLATE_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <expected>
+#include "ER.h"
+
+// Template with {{name}} placeholders, split once into literal and placeholder segments so that
+// rendering is a single pass that writes literals as they are and fills in the placeholders.
+class HtmlTemplate
+{
+public:
+    struct Segment
+    {
+        QByteArray literal;  // UTF-8 text, empty for placeholders
+        QString placeholder; // name between the braces, empty for literals
+    };
+
+    static HtmlTemplate parse(const QString &content);
+    static std::expected<HtmlTemplate, ER> fromFile(const QString &fileName);
+
+    [[nodiscard]] const QVector<Segment> &segments() const { return m_segments; }
+
+private:
+    QVector<Segment> m_segments;
+};
+
+#endif // HTMLTEMPLATE_H
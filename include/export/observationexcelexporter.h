@@ -0,0 +1,34 @@
+#ifndef OBSERVATIONEXCELEXPORTER_H
+#define OBSERVATIONEXCELEXPORTER_H
+
+#include <QString>
+#include <expected>
+#include "db/observationsrepository.h"
+#include "export/exportjob.h"
+#include "ER.h"
+
+class DatabaseManager;
+
+struct ObservationExcelExportOptions
+{
+    ObservationFilter filter;
+    QString filterDescription; // shown above the table
+    bool sheetPerObject = false;
+};
+
+// Writes observations into an .xlsx workbook, either all into one "Observations" sheet or
+// into one sheet per object. Rows are streamed from the database cursor through XlsxWriter.
+class ObservationExcelExporter
+{
+public:
+    explicit ObservationExcelExporter(DatabaseManager *dbManager);
+
+    // Number of exported observations
+    std::expected<int, ER> exportToFile(const QString &fileName, const ObservationExcelExportOptions &options,
+                                        const ExportProgress &progress = {}) const;
+
+private:
+    DatabaseManager *m_dbManager;
+};
+
+#endif // OBSERVATIONEXCELEXPORTER_H
@@ -0,0 +1,70 @@
+#ifndef OBSERVATIONHTMLEXPORTER_H
+#define OBSERVATIONHTMLEXPORTER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <expected>
+#include "db/observationsrepository.h"
+#include "export/exportjob.h"
+#include "ER.h"
+
+class DatabaseManager;
+class Utf8Writer;
+
+struct ObservationHtmlExportOptions
+{
+    ObservationFilter filter;
+    QString filterDescription; // shown in the export information block
+    int moonWarningPercent = 75;
+    int angularWarningDeg = 60;
+};
+
+// Writes observation rows in the table layout of templates/observations_export.html. Dimension
+// names are escaped once per id and reused for every further row that references them.
+class ObservationHtmlRows
+{
+public:
+    ObservationHtmlRows(const ObservationDimensions &dimensions, int moonWarningPercent, int angularWarningDeg);
+
+    // Session and object cells link to sessions/<id>.html and objects/<id>.html below
+    // prefix, as laid out by StaticSiteGenerator. Empty (the default) writes plain cells.
+    void setPageLinkPrefix(const QByteArray &prefix) { m_linkPrefix = prefix; }
+    void write(Utf8Writer &writer, const ObservationData &obs);
+
+private:
+    class EscapedNames
+    {
+    public:
+        const QByteArray &get(int id, const QString &name);
+
+    private:
+        QHash<int, QByteArray> m_names;
+    };
+
+    void writeLinkedCell(Utf8Writer &writer, const char *directory, int id, const QByteArray &escaped) const;
+
+    const ObservationDimensions &m_dimensions;
+    int m_moonWarningPercent;
+    int m_angularWarningDeg;
+    QByteArray m_linkPrefix;
+    EscapedNames m_sessionNames, m_sessionDates, m_objectNames, m_cameraNames, m_telescopeNames, m_filterNames;
+};
+
+// Writes observations into templates/observations_export.html. Rows are streamed from the
+// database cursor into a buffered file writer, memory use does not grow with the row count.
+class ObservationHtmlExporter
+{
+public:
+    explicit ObservationHtmlExporter(DatabaseManager *dbManager);
+
+    // Number of exported observations. The file is replaced only if the export succeeds,
+    // a cancelled export leaves it untouched.
+    std::expected<int, ER> exportToFile(const QString &fileName, const ObservationHtmlExportOptions &options,
+                                        const ExportProgress &progress = {}) const;
+
+private:
+    DatabaseManager *m_dbManager;
+};
+
+#endif // OBSERVATIONHTMLEXPORTER_H
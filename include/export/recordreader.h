@@ -0,0 +1,78 @@
+#ifndef RECORDREADER_H
+#define RECORDREADER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+#include <expected>
+#include <memory>
+#include "ER.h"
+
+class QIODevice;
+
+// Reads records of a CSV or JSON Lines file one at a time. The caller names the fields it
+// needs; their positions are looked up once and next() fills the values in that order.
+// Missing and empty values are null.
+class RecordReader
+{
+public:
+    virtual ~RecordReader() = default;
+
+    // Reader for the file type given by the extension, .csv or .jsonl
+    static std::unique_ptr<RecordReader> create(const QString &fileName, QIODevice *device);
+
+    // Reads the header (CSV) and checks that the required fields are present
+    virtual std::expected<void, ER> open(const QStringList &fields, const QStringList &requiredFields) = 0;
+    // False at the end of the file
+    virtual std::expected<bool, ER> next(QVector<QVariant> &values) = 0;
+    // Line the last record started on, for error messages
+    [[nodiscard]] qint64 lineNumber() const { return m_recordLine; }
+
+protected:
+    explicit RecordReader(QIODevice *device) : m_device(device), m_lineNumber(0), m_recordLine(0) {}
+
+    // Next line without the line break, false at the end
+    bool readLine(QByteArray &line);
+
+    QIODevice *m_device;
+    qint64 m_lineNumber;
+    qint64 m_recordLine;
+};
+
+// RFC 4180: comma separated, header line first, quoted fields may contain commas, doubled
+// quotes and line breaks
+class CsvRecordReader : public RecordReader
+{
+public:
+    explicit CsvRecordReader(QIODevice *device) : RecordReader(device) {}
+
+    std::expected<void, ER> open(const QStringList &fields, const QStringList &requiredFields) override;
+    std::expected<bool, ER> next(QVector<QVariant> &values) override;
+
+private:
+    // Fields of the next record, false at the end
+    std::expected<bool, ER> readRecord();
+
+    QVector<QString> m_record;
+    QVector<int> m_positions; // record position of each requested field, -1 if missing
+    QByteArray m_buffer;
+};
+
+// One JSON object per line, field names are object keys
+class JsonLinesRecordReader : public RecordReader
+{
+public:
+    explicit JsonLinesRecordReader(QIODevice *device) : RecordReader(device) {}
+
+    std::expected<void, ER> open(const QStringList &fields, const QStringList &requiredFields) override;
+    std::expected<bool, ER> next(QVector<QVariant> &values) override;
+
+private:
+    QStringList m_fields;
+    QStringList m_requiredFields;
+    QByteArray m_buffer;
+};
+
+#endif // RECORDREADER_H
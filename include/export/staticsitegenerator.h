@@ -0,0 +1,43 @@
+#ifndef STATICSITEGENERATOR_H
+#define STATICSITEGENERATOR_H
+
+#include <QString>
+#include <expected>
+#include "export/exportjob.h"
+#include "ER.h"
+
+class DatabaseManager;
+
+struct StaticSiteOptions
+{
+    int moonWarningPercent = 75;
+    int angularWarningDeg = 60;
+};
+
+// Renders the whole observation log as a static site: index.html with all objects and
+// sessions, objects/<id>.html with the observations and exposure totals of one object and
+// sessions/<id>.html with the observations of one session.
+//
+// Generation is incremental and does not read the observations of unchanged pages. Each page
+// gets a signature from its own object or session and the SQL aggregates of its observations
+// (count, exposure sum, max id and max revision); site-manifest.json next to index.html keeps
+// the signatures and the hashes of all sessions, objects, cameras, telescopes and filters of
+// the last run. Pages whose signature changed, that list a changed session or object, or whose
+// file is missing are rendered again. Pages of deleted objects and sessions are removed.
+// After one night of logging only the pages of that session, the objects observed in it and
+// the index are written.
+class StaticSiteGenerator
+{
+public:
+    explicit StaticSiteGenerator(DatabaseManager *dbManager);
+
+    // Number of pages written. Progress counts the changed pages; a cancelled run keeps the
+    // pages written so far and records them in the manifest.
+    std::expected<int, ER> generate(const QString &directory, const StaticSiteOptions &options,
+                                    const ExportProgress &progress = {}) const;
+
+private:
+    DatabaseManager *m_dbManager;
+};
+
+#endif // STATICSITEGENERATOR_H
@@ -0,0 +1,62 @@
+#ifndef TABLEDUMP_H
+#define TABLEDUMP_H
+
+#include <QString>
+#include <QStringList>
+#include <expected>
+#include <functional>
+#include "export/exportjob.h"
+#include "ER.h"
+
+class DatabaseManager;
+
+enum class DumpFormat
+{
+    Csv,       // <table>.csv, RFC 4180 with a header line
+    JsonLines  // <table>.jsonl, one JSON object per row
+};
+
+// Called while importing with the bytes read from all files so far and their total size.
+// Returning false stops the import after the rows committed so far.
+using ImportProgress = std::function<bool(qint64 bytesRead, qint64 totalBytes, int importedRows)>;
+
+struct ImportReport
+{
+    int importedRows = 0;
+    int skippedRows = 0;  // reference rows that exist already and rows that cannot be resolved
+    QStringList problems; // why rows were skipped, the first few only
+    double seconds = 0.0;
+};
+
+// Dumps all tables into one file per table. References are written as names instead of ids
+// (filters by filter type, observations by session, object, camera, telescope and filter),
+// so that the files are readable by scripts and can be imported into another database.
+// Rows go straight from the SQLite cursor into a buffered writer, memory use is constant.
+class TableDumper
+{
+public:
+    explicit TableDumper(DatabaseManager *dbManager);
+
+    // Number of rows written in all files. Existing files are replaced only if all dumps succeed.
+    std::expected<int, ER> dump(const QString &directory, DumpFormat format, const ExportProgress &progress = {}) const;
+
+private:
+    DatabaseManager *m_dbManager;
+};
+
+// Reads files written by TableDumper back, tables in dependency order and each file optional.
+// Rows are inserted with prepared statements in batched transactions. Reference rows whose
+// name already exists are kept as they are; observations are always added.
+class TableImporter
+{
+public:
+    explicit TableImporter(DatabaseManager *dbManager);
+
+    std::expected<ImportReport, ER> import(const QString &directory, DumpFormat format,
+                                           const ImportProgress &progress = {}) const;
+
+private:
+    DatabaseManager *m_dbManager;
+};
+
+#endif // TABLEDUMP_H
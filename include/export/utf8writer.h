@@ -0,0 +1,53 @@
+#ifndef UTF8WRITER_H
+#define UTF8WRITER_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QString>
+#include <QStringEncoder>
+#include <QStringView>
+
+class QIODevice;
+
+// Buffered UTF-8 output to a device. Text is encoded into a fixed size buffer that is written
+// out whenever it fills up, so memory use does not depend on the amount of output. Write
+// errors are sticky: later writes are ignored and ok() stays false.
+class Utf8Writer
+{
+public:
+    explicit Utf8Writer(QIODevice *device, qsizetype bufferSize = 64 * 1024);
+    ~Utf8Writer();
+
+    Utf8Writer(const Utf8Writer &) = delete;
+    Utf8Writer &operator=(const Utf8Writer &) = delete;
+
+    // Bytes that are already UTF-8, like template literals
+    void writeRaw(QByteArrayView bytes);
+    void write(QStringView text);
+    // Escapes &, <, > and " like QString::toHtmlEscaped()
+    void writeHtmlEscaped(QStringView text);
+    // Same as writeHtmlEscaped() and drops the control characters XML 1.0 does not allow
+    void writeXmlEscaped(QStringView text);
+    void writeNumber(qint64 value);
+    void writeNumber(double value, int decimals);
+    // Shortest text that reads back as the same double
+    void writeDouble(double value);
+
+    bool flush();
+    [[nodiscard]] bool ok() const { return m_ok; }
+    [[nodiscard]] QString errorString() const;
+    // Total bytes handed to the writer, buffered or not
+    [[nodiscard]] qint64 bytesWritten() const { return m_bytesWritten; }
+
+private:
+    void reserve(qsizetype size);
+
+    QIODevice *m_device;
+    QStringEncoder m_encoder;
+    QByteArray m_buffer;
+    qsizetype m_capacity;
+    qint64 m_bytesWritten;
+    bool m_ok;
+};
+
+#endif // UTF8WRITER_H
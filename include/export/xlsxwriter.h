@@ -0,0 +1,76 @@
+#ifndef XLSXWRITER_H
+#define XLSXWRITER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QStringView>
+#include <expected>
+#include <memory>
+#include <vector>
+#include "ER.h"
+
+class QTemporaryFile;
+class Utf8Writer;
+
+// Streaming writer for .xlsx workbooks. Rows are written straight into the sheet XML, which is
+// kept in temporary files and packed into the workbook with libzip by close(), so memory use
+// does not grow with the number of rows. Strings that repeat, like the names of referenced
+// rows, go into the shared string table once and cells only refer to their index.
+//
+// Rows are written in order: beginRow(), one add*() per column, endRow().
+class XlsxWriter
+{
+public:
+    explicit XlsxWriter(const QString &fileName);
+    // Drops an unfinished workbook, the target file is not touched
+    ~XlsxWriter();
+
+    XlsxWriter(const XlsxWriter &) = delete;
+    XlsxWriter &operator=(const XlsxWriter &) = delete;
+
+    // Finishes the current sheet and starts a new one. The name is made valid (at most 31
+    // characters, none of []:*?/\) and unique within the workbook. Widths are in characters.
+    void beginSheet(const QString &name, const QList<double> &columnWidths = {});
+
+    // Index of text in the shared string table, added on first use
+    int sharedString(const QString &text);
+
+    // Row numbers start at 1 and must increase, skipped rows stay empty
+    void beginRow(int row);
+    void addSharedString(int index);
+    void addString(QStringView text);
+    void addNumber(qint64 value);
+    void addNumber(double value);
+    // Leaves the cell of the current column empty
+    void skipCell();
+    void endRow();
+
+    std::expected<void, ER> close();
+
+private:
+    struct Sheet
+    {
+        QString name;
+        std::unique_ptr<QTemporaryFile> file;
+    };
+
+    void beginCell(const char *type);
+    std::expected<void, ER> finishSheet();
+    QString uniqueSheetName(const QString &name) const;
+
+    QString m_fileName;
+    std::vector<Sheet> m_sheets;
+    std::unique_ptr<Utf8Writer> m_writer; // XML of the current sheet
+    QByteArray m_rowNumber;
+    QList<QByteArray> m_columnNames; // cell reference letters by column
+    int m_column;
+    QStringList m_sharedStrings;
+    QHash<QString, int> m_sharedStringIndex;
+    qint64 m_sharedStringRefs; // cells referring to the table, count attribute of sst
+    bool m_closed;
+};
+
+#endif // XLSXWRITER_H
@@ -1,8 +1,12 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
+#include <QElapsedTimer>
 #include <QMainWindow>
+#include <QVector>
+#include <functional>
 #include <memory>
+#include "db/databasemanager.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui
@@ -11,7 +15,9 @@ namespace Ui
 }
 QT_END_NAMESPACE
 
-class DatabaseManager;
+class DatabaseBackup;
+class QLabel;
+class QTimer;
 class SettingsManager;
 class ObjectsTab;
 class SessionsTab;
@@ -23,6 +29,7 @@ class ObservationsTab;
 class ObjectStatsTab;
 class MonthlyStatsTab;
 class SettingsTab;
+class DiagnosticsTab;
 class AboutTab;
 
 class MainWindow : public QMainWindow
@@ -33,9 +40,39 @@ public:
     explicit MainWindow(const QString &dbPath = "observations.db", QWidget *parent = nullptr);
     ~MainWindow() override;
 
+    // Takes the periodic database backup in the background, progress is shown in the status bar
+    void startBackup();
+
 private:
+    // How to build a tab, the tables it depends on and how to reload it. Tabs are built when
+    // first shown or warmed on idle; built tabs that went stale are reloaded when shown.
+    struct TabEntry
+    {
+        QString title;
+        int warmupPriority; // lower is built earlier after the first paint
+        std::function<void(QWidget *page)> build;
+        DbTables dependsOn;
+        std::function<void()> refresh;
+        bool built = false;
+        bool stale = false;
+        // Build and reload durations, shown on the Diagnostics tab
+        int refreshCount = 0;
+        double lastRefreshMs = 0;
+        double maxRefreshMs = 0;
+        double totalRefreshMs = 0;
+
+        void recordRefresh(double ms);
+    };
+
+    bool event(QEvent *event) override;
+
     void initializeTabs();
+    void ensureTabBuilt(int index);
+    void warmNextTab();
     void setupConnections();
+    void onDataChanged(DbTables tables);
+    void refreshTabIfStale(int index);
+    void onBackupFinished(bool success, const QString &message);
 
 private:
     Ui::MainWindow *ui;
@@ -53,7 +90,16 @@ private:
     std::unique_ptr<ObjectStatsTab> m_objectStatsTab;
     std::unique_ptr<MonthlyStatsTab> m_monthlyStatsTab;
     std::unique_ptr<SettingsTab> m_settingsTab;
+    std::unique_ptr<DiagnosticsTab> m_diagnosticsTab;
     std::unique_ptr<AboutTab> m_aboutTab;
+
+    QVector<TabEntry> m_tabs; // indexed by tab index
+    QTimer *m_warmupTimer;    // builds the remaining tabs on idle after the first paint
+    QElapsedTimer m_startupTimer;
+    bool m_firstPaintDone;
+
+    DatabaseBackup *m_backup;
+    QLabel *m_backupStatusLabel; // permanent status bar widget, hidden while no backup ran
 };
 
 #endif // MAINWINDOW_H
\ No newline at end of file
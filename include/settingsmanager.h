@@ -23,6 +23,12 @@ public:
     [[nodiscard]] QString style() const;
     [[nodiscard]] Qt::ColorScheme colorScheme() const;
     [[nodiscard]] QString sessionsFolderTemplate() const;
+    // Backup retention, see BackupRetention
+    [[nodiscard]] int backupKeepDaily() const;
+    [[nodiscard]] int backupKeepWeekly() const;
+    [[nodiscard]] int backupKeepMonthly() const;
+    // SIMBAD TAP sync endpoint, can point to a mirror or a local test server
+    [[nodiscard]] QString simbadTapUrl() const;
 
     // Setters
     void setMoonIlluminationWarningPercent(int value);
@@ -33,10 +39,17 @@ public:
     void setStyle(const QString &value);
     void setColorScheme(Qt::ColorScheme value);
     void setSessionsFolderTemplate(const QString &value);
+    void setBackupKeepDaily(int value);
+    void setBackupKeepWeekly(int value);
+    void setBackupKeepMonthly(int value);
+    void setSimbadTapUrl(const QString &value);
 
     // Save settings to file
     bool saveSettings();
 
+    // Resolved SIMBAD identifiers, next to the settings file and shared by all databases
+    static QString simbadCacheFilePath();
+
 signals:
     void errorOccurred(const QString &error);
     void settingsInitialized();
@@ -58,6 +71,10 @@ private:
     QString m_style;
     Qt::ColorScheme m_colorScheme;
     QString m_sessionsFolderTemplate;
+    int m_backupKeepDaily;
+    int m_backupKeepWeekly;
+    int m_backupKeepMonthly;
+    QString m_simbadTapUrl;
 
     bool m_initialized;
 };
@@ -0,0 +1,63 @@
+#ifndef SIMBADCACHE_H
+#define SIMBADCACHE_H
+
+#include <QDateTime>
+#include <QSqlDatabase>
+#include <QString>
+#include <QStringList>
+#include <expected>
+#include <optional>
+#include "ER.h"
+
+// One identifier as SIMBAD resolved it
+struct SimbadObject
+{
+    QString queryName;  // name as it was asked for
+    QString mainId;     // SIMBAD main identifier, e.g. "M  31"
+    double ra = 0.0;    // degrees (0-360)
+    double dec = 0.0;   // degrees
+    QStringList aliases; // all identifiers of the object, main id included
+};
+
+// Result of a cache lookup: found or known to be unknown to SIMBAD
+struct SimbadCacheEntry
+{
+    bool found = false;
+    SimbadObject object; // valid when found
+};
+
+// Resolved SIMBAD identifiers in a small SQLite file of their own, kept apart from the
+// observation log so that backups and dumps stay free of it. Names are keyed by
+// normalizedName(), so "m31", "M 31" and "M  31" share one entry. Found objects are trusted
+// for foundTtlDays, names SIMBAD did not know are retried after missingTtlDays.
+class SimbadCache
+{
+public:
+    static constexpr int foundTtlDays = 180;
+    static constexpr int missingTtlDays = 7;
+
+    SimbadCache();
+    ~SimbadCache();
+    SimbadCache(const SimbadCache &) = delete;
+    SimbadCache &operator=(const SimbadCache &) = delete;
+
+    // Opens or creates the cache file
+    std::expected<void, ER> open(const QString &fileName);
+    [[nodiscard]] bool isOpen() const;
+
+    // Entry for name unless it is missing or expired
+    [[nodiscard]] std::optional<SimbadCacheEntry> lookup(const QString &name,
+                                                         const QDateTime &now = QDateTime::currentDateTimeUtc()) const;
+    // Stores resolved objects and the names SIMBAD did not know in one transaction
+    std::expected<void, ER> store(const QVector<SimbadObject> &objects, const QStringList &missingNames,
+                                  const QDateTime &now = QDateTime::currentDateTimeUtc());
+    std::expected<void, ER> clear();
+
+    // Case and spacing insensitive key of an identifier
+    static QString normalizedName(const QString &name);
+
+private:
+    QSqlDatabase m_database;
+};
+
+#endif // SIMBADCACHE_H
@@ -2,13 +2,20 @@
 #define SIMBADQUERY_H
 
 
+#include <QHash>
 #include <QNetworkReply>
+#include <QUrl>
+#include <QVector>
+#include <memory>
+#include "simbadcache.h"
 
 /**
- * @brief The SimbadQuery class queries astronomical object coordinates from SIMBAD database
+ * @brief The SimbadQuery class resolves astronomical object names to coordinates with SIMBAD
  *
- * This class provides an interface to query the SIMBAD astronomical database
- * for celestial object coordinates (Right Ascension and Declination).
+ * Names are looked up in a local SimbadCache first. Whatever is not cached is asked from the
+ * SIMBAD TAP sync endpoint with one ADQL query per maxNamesPerRequest names, and the answers
+ * (main identifier, coordinates, all aliases) as well as the names SIMBAD does not know are
+ * stored in the cache. Several lookups can be in flight at the same time.
  *
  * Usage example:
  * @code
@@ -27,6 +34,10 @@ class SimbadQuery final : public QObject
     Q_OBJECT
 
 public:
+    static constexpr const char *defaultServiceUrl = "https://simbad.cds.unistra.fr/simbad/sim-tap/sync";
+    // ADQL IN lists of this size stay well below the query length SIMBAD accepts
+    static constexpr int maxNamesPerRequest = 1000;
+
     /**
      * @brief Construct a new SimbadQuery object
      * @param parent Parent QObject
@@ -38,6 +49,17 @@ public:
      */
     ~SimbadQuery() override;
 
+    /**
+     * @brief Set the TAP sync endpoint, e.g. a mirror or a local test server
+     */
+    void setServiceUrl(const QUrl &url);
+
+    /**
+     * @brief Set the cache file, SettingsManager::simbadCacheFilePath() unless set before the
+     * first query. An empty name turns the cache off.
+     */
+    void setCacheFile(const QString &fileName);
+
     /**
      * @brief Query SIMBAD database for object coordinates
      * @param objectName Name of the astronomical object (e.g., "M31", "NGC 1234", "Betelgeuse")
@@ -48,7 +70,17 @@ public:
     void queryObject(const QString &objectName);
 
     /**
-     * @brief Cancel any pending query
+     * @brief Resolve many names at once
+     * @param names Object names, duplicates are resolved once
+     * @return Id of the request, passed to objectsResolved or resolveFailed
+     *
+     * Cached names never leave the machine; the rest go to SIMBAD in as few requests as
+     * maxNamesPerRequest allows, a list of a few hundred targets takes one round-trip.
+     */
+    int resolveObjects(const QStringList &names);
+
+    /**
+     * @brief Cancel all pending queries, no signals are emitted for them
      */
     void cancelQuery();
 
@@ -73,31 +105,67 @@ signals:
      */
     void queryStarted(const QString &objectName);
 
-private slots:
     /**
-     * @brief Handle network reply from SIMBAD
+     * @brief Emitted when all names of a resolveObjects() request are answered
+     * @param requestId Id returned by resolveObjects()
+     * @param objects Resolved names, queryName is the name as it was passed in
+     * @param notFound Names SIMBAD does not know
      */
-    void handleNetworkReply();
+    void objectsResolved(int requestId, const QVector<SimbadObject> &objects, const QStringList &notFound);
+
+    /**
+     * @brief Emitted instead of objectsResolved when SIMBAD could not be asked
+     * @param requestId Id returned by resolveObjects()
+     * @param error Error message describing what went wrong
+     */
+    void resolveFailed(int requestId, const QString &error);
 
+private slots:
     /**
-     * @brief Handle network errors
-     * @param code Network error code
+     * @brief Handle network reply from SIMBAD
      */
-    void handleNetworkError(QNetworkReply::NetworkError code);
+    void handleNetworkReply();
 
 private:
+    struct Request
+    {
+        QVector<SimbadObject> objects;
+        QStringList notFound;
+        QString error;
+        int pendingReplies = 0;
+        bool single = false; // started by queryObject(), answered with the single-object signals
+    };
+
+    struct PendingReply
+    {
+        int requestId;
+        QStringList names;
+    };
+
     /**
-     * @brief Parse VOTable XML response from SIMBAD
-     * @param data XML data from SIMBAD
-     * @param ra Output parameter for Right Ascension
-     * @param dec Output parameter for Declination
-     * @return true if parsing successful, false otherwise
+     * @brief Parse the JSON result of the TAP query
+     * @param data Response body
+     * @param names Names the query asked for
+     * @param objects Output, one entry per resolved name
+     * @return false if the response is not a TAP JSON result
      */
-    static bool parseVOTableResponse(const QByteArray &data, double &ra, double &dec);
+    static bool parseTapResponse(const QByteArray &data, const QStringList &names, QVector<SimbadObject> &objects);
+
+    // ADQL query for the names
+    static QString buildQuery(const QStringList &names);
+
+    SimbadCache *cache();
+    void sendRequest(int requestId, const QStringList &names);
+    void finishRequest(int requestId);
 
     QNetworkAccessManager *m_networkManager;
-    QNetworkReply *m_currentReply;
-    QString m_currentObjectName;
+    QUrl m_serviceUrl;
+    QString m_cacheFile;
+    std::unique_ptr<SimbadCache> m_cache; // opened on first use
+    bool m_cacheOpenFailed;
+    QHash<int, Request> m_requests;
+    QHash<QNetworkReply *, PendingReply> m_replies;
+    int m_nextRequestId;
 };
 
-#endif // SIMBADQUERY_H
\ No newline at end of file
+#endif // SIMBADQUERY_H
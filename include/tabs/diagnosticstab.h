@@ -0,0 +1,60 @@
+#ifndef DIAGNOSTICSTAB_H
+#define DIAGNOSTICSTAB_H
+
+#include <QJsonObject>
+#include <QVector>
+#include <QWidget>
+#include <functional>
+
+QT_BEGIN_NAMESPACE
+namespace Ui
+{
+    class DiagnosticsTab;
+}
+QT_END_NAMESPACE
+
+class DatabaseManager;
+class QTimer;
+
+// Time a tab took to build and load, and to reload after changes, as seen by MainWindow
+struct TabRefreshTiming
+{
+    QString tab;
+    int count = 0;
+    double lastMs = 0;
+    double maxMs = 0;
+    double totalMs = 0;
+};
+
+class DiagnosticsTab : public QWidget
+{
+    Q_OBJECT
+
+public:
+    using TabTimingsSource = std::function<QVector<TabRefreshTiming>()>;
+
+    DiagnosticsTab(DatabaseManager *dbManager, TabTimingsSource tabTimings, QWidget *parent = nullptr);
+    ~DiagnosticsTab() override;
+
+    void initialize();
+    void refreshData();
+
+protected:
+    // The numbers are only read while the tab is shown
+    void showEvent(QShowEvent *event) override;
+
+private slots:
+    void onResetClicked();
+    void onExportClicked();
+
+private:
+    // Everything the tab shows, also what is exported
+    [[nodiscard]] QJsonObject snapshot() const;
+
+    Ui::DiagnosticsTab *ui;
+    DatabaseManager *m_dbManager;
+    TabTimingsSource m_tabTimings;
+    QTimer *m_refreshTimer;
+};
+
+#endif // DIAGNOSTICSTAB_H
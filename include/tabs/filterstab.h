@@ -12,7 +12,6 @@ QT_END_NAMESPACE
 
 class DatabaseManager;
 class FiltersRepository;
-class FilterTypesRepository;
 
 class FiltersTab : public QWidget
 {
@@ -38,7 +37,6 @@ private:
     Ui::FiltersTab *ui;
     DatabaseManager *m_dbManager;
     FiltersRepository *m_repository;
-    FilterTypesRepository *m_filterTypesRepository;
 };
 
 #endif // FILTERSTAB_H
\ No newline at end of file
@@ -0,0 +1,18 @@
+#ifndef HTMLITEMDELEGATE_H
+#define HTMLITEMDELEGATE_H
+
+#include <QStyledItemDelegate>
+
+// Renders the display text of items as rich text, used for search results with highlighted words
+class HtmlItemDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+
+public:
+    explicit HtmlItemDelegate(QObject *parent = nullptr) : QStyledItemDelegate(parent) {}
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+    QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+};
+
+#endif // HTMLITEMDELEGATE_H
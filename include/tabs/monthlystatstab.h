@@ -14,6 +14,7 @@ namespace Ui
 QT_END_NAMESPACE
 
 class DatabaseManager;
+class StatsRepository;
 
 class MonthlyStatsTab : public QWidget
 {
@@ -31,6 +32,7 @@ private:
 
     Ui::MonthlyStatsTab *ui;
     DatabaseManager *m_dbManager;
+    StatsRepository *m_repository;
 };
 
 #endif // MONTHLYSTATSTAB_H
\ No newline at end of file
@@ -0,0 +1,84 @@
+#ifndef OBJECTCOMPLETIONMODEL_H
+#define OBJECTCOMPLETIONMODEL_H
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "db/referencedatacache.h"
+
+// Sorted prefix index over object labels. Every label is indexed case-insensitively and
+// without accents at its start, at the start of each further word and by its catalog
+// designations, so "m31", "M 031" and "Messier 31" all find "M 31 / Andromeda Galaxy".
+// Lookups are binary searches, typing does not scan the whole catalog.
+class ObjectNameIndex
+{
+public:
+    void build(const QVector<ReferenceItem> &items);
+
+    [[nodiscard]] const QVector<ReferenceItem> &items() const { return m_items; }
+    // Position of the item whose label equals text ignoring case, -1 if there is none
+    [[nodiscard]] qsizetype findExact(const QString &text) const;
+    // True if any indexed key starts with text
+    [[nodiscard]] bool hasMatch(const QString &text) const;
+    // Positions of up to limit matching items, best match first: label prefixes before catalog
+    // designations before later words, shorter keys (closer matches) before longer ones
+    [[nodiscard]] QVector<qsizetype> match(const QString &text, qsizetype limit) const;
+
+private:
+    enum Tier : quint8
+    {
+        LabelKey,
+        CatalogKey,
+        WordKey
+    };
+
+    struct Key
+    {
+        qsizetype text;   // position in m_texts
+        qsizetype offset; // key starts at this character of the text
+        qsizetype item;   // position in m_items
+        Tier tier;
+    };
+
+    [[nodiscard]] QStringView keyView(const Key &key) const;
+    // First key that is not less than prefix
+    [[nodiscard]] QVector<Key>::const_iterator lowerBound(QStringView prefix) const;
+    // Folded query and, if it names a catalog entry, its normalized designation
+    static QStringList queryKeys(const QString &text);
+
+    QVector<ReferenceItem> m_items;
+    QStringList m_texts; // folded labels and catalog designations the keys point into
+    QVector<Key> m_keys; // sorted by key text
+    QHash<QString, qsizetype> m_exact; // case folded label -> item position
+};
+
+// Completion list for the object combo box, filled with the ranked matches of the last query
+class ObjectCompletionModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    explicit ObjectCompletionModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    // Rebuilds the index, unless items share their data with the indexed list
+    void setItems(const QVector<ReferenceItem> &items);
+    void setQuery(const QString &text);
+
+    [[nodiscard]] const ObjectNameIndex &nameIndex() const { return m_index; }
+
+private:
+    static constexpr qsizetype MaxRows = 100;
+
+    void updateRows();
+
+    ObjectNameIndex m_index;
+    QString m_query;
+    QVector<qsizetype> m_rows; // item positions in the index
+};
+
+#endif // OBJECTCOMPLETIONMODEL_H
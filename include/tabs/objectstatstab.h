@@ -11,6 +11,7 @@ namespace Ui
 QT_END_NAMESPACE
 
 class DatabaseManager;
+class StatsRepository;
 
 class ObjectStatsTab : public QWidget
 {
@@ -28,6 +29,7 @@ private:
 
     Ui::ObjectStatsTab *ui;
     DatabaseManager *m_dbManager;
+    StatsRepository *m_repository;
 };
 
 #endif // OBJECTSTATSTAB_H
\ No newline at end of file
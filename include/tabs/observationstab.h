@@ -4,6 +4,12 @@
 #include <QWidget>
 #include <QValidator>
 #include <QComboBox>
+#include <QSet>
+#include <optional>
+#include "tabs/objectcompletionmodel.h"
+#include "db/databasemanager.h"
+#include "db/observationsrepository.h"
+#include "export/exportjob.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui
@@ -12,9 +18,9 @@ namespace Ui
 }
 QT_END_NAMESPACE
 
-class DatabaseManager;
-class ObservationsRepository;
-class QStringListModel;
+class ObservationsTableModel;
+class QStandardItemModel;
+class QTimer;
 class SettingsManager;
 class QMenu;
 
@@ -33,15 +39,35 @@ private slots:
     void onAddObservationButtonClicked();
     void onEditObservationButtonClicked();
     void onDeleteObservationButtonClicked();
-    void onFilterSelectionChanged();
+    void onFilterChanged();
+    void onClearFilterClicked();
+    void onSearchResultClicked(const QModelIndex &index);
     void onExportToHtmlClicked();
-    void onExportToExcelClicked();
+    void onExportToExcelClicked(bool sheetPerObject);
+    void onGenerateSiteClicked();
     void onExploreSessionsFolder();
+    void onDataChanged(DbTables tables, const QVector<DbChange> &changes);
 
 private:
     void populateTable();
     void populateComboBoxes() const;
-    void populateObjectFilter() const;
+    void populateObjectFilter();
+    // Adds objects that got their first observation and removes those that lost their last one.
+    // previousObjectIds are the objects the changed rows belonged to before the change, every
+    // listed object is checked if they are not known.
+    void updateObjectFilter(const QList<int> &changedIds, const std::optional<QSet<int>> &previousObjectIds);
+    // Selects "< All Objects >" when no object is selected any more
+    void ensureObjectFilterSelection();
+    [[nodiscard]] ObservationFilter filterFromWidgets() const;
+    // Human readable summary of the current filter for exports
+    [[nodiscard]] QString filterDescription() const;
+    // Ranked full text matches of the current filter below the table
+    void updateSearchResults();
+    // Selects the observation in the table, fetching pages until it is loaded
+    void selectObservation(int observationId);
+    // Runs an export in the background with a progress dialog, one export at a time.
+    // itemName is the plural of what the task counts, used in progress and result messages.
+    void startExport(const QString &fileName, ExportJob::Task task, const QString &itemName = "observations");
     bool showObservationDialog(const QString &title, int &sessionId, int &objectId,
                                int &cameraId, int &telescopeId, int &filterId,
                                int &imageCount, int &exposureLength, QString &comments);
@@ -50,10 +76,16 @@ private:
     DatabaseManager *m_dbManager;
     SettingsManager *m_settingsManager;
     ObservationsRepository *m_repository;
-    QStringListModel *m_filterListModel;
+    ObservationsTableModel *m_tableModel;
+    QStandardItemModel *m_filterListModel; // objects with observations, id in Qt::UserRole
+    QStandardItemModel *m_searchResultsModel; // HTML snippets, observation id in Qt::UserRole
+    QTimer *m_searchTimer;
+    ObjectCompletionModel *m_objectCompletionModel;
     QMenu *m_exportMenu;
     QMenu *m_rightClickMenu{};
-    int m_currentFilterObjectId; // -1 for "All Objects"
+    ExportJob *m_exportJob; // running export, nullptr if there is none
+    ObservationFilter m_currentFilter; // filter the table was last loaded with
+    bool m_updatingFilterWidgets;      // filter widgets are changed by code, do not reload on every signal
 };
 
 class ComboBoxItemValidator : public QValidator
@@ -61,8 +93,8 @@ class ComboBoxItemValidator : public QValidator
     Q_OBJECT
 
 public:
-    explicit ComboBoxItemValidator(QComboBox* combo, QObject* parent = nullptr)
-        : QValidator(parent), m_combo(combo) {}
+    explicit ComboBoxItemValidator(const ObjectNameIndex* index, QObject* parent = nullptr)
+        : QValidator(parent), m_index(index) {}
 
     State validate(QString& input, int& pos) const override
     {
@@ -72,44 +104,31 @@ public:
             return Intermediate;
         }
 
-        // 2. Check for an Exact Match
-        // Qt::MatchFixedString ensures strict matching, CaseInsensitive is usually better for UX
-        int index = m_combo->findText(input, Qt::MatchFixedString);
-
-        // If found exactly, it is valid
-        if (index != -1) {
+        // Exact match, case insensitive like QComboBox::findText with Qt::MatchFixedString
+        if (m_index->findExact(input) != -1) {
             return Acceptable;
         }
 
-        // 3. Check for Partial Match (Intermediate)
-        // We loop through items to see if the input is a prefix of any item
-        for (int i = 0; i < m_combo->count(); ++i) {
-            QString itemText = m_combo->itemText(i);
-
-            // Check if item starts with input (Case Sensitive for strictness)
-            if (itemText.startsWith(input, Qt::CaseInsensitive)) {
-                return Intermediate;
-            }
+        // Partial match: the input starts a label, a later word of it or a catalog designation
+        if (m_index->hasMatch(input)) {
+            return Intermediate;
         }
 
-        // 4. No match found at all
+        // No match found at all
         return Invalid;
     }
 
     void fixup(QString& input) const override
     {
-        // auto-correct to the first matching entry
-        for (int i = 0; i < m_combo->count(); ++i) {
-            const QString item = m_combo->itemText(i);
-            if (item.startsWith(input, Qt::CaseInsensitive)) {
-                input = item;
-                return;
-            }
+        // auto-correct to the best matching entry
+        const auto matches = m_index->match(input, 1);
+        if (!matches.isEmpty()) {
+            input = m_index->items()[matches.first()].name;
         }
     }
 
 private:
-    QComboBox* m_combo;
+    const ObjectNameIndex* m_index;
 };
 
 #endif // OBSERVATIONSTAB_H
\ No newline at end of file
@@ -0,0 +1,123 @@
+#ifndef OBSERVATIONSTABLEMODEL_H
+#define OBSERVATIONSTABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <QHash>
+#include <QVector>
+#include <expected>
+#include <optional>
+#include "db/databasemanager.h"
+#include "db/observationdimensions.h"
+#include "db/observationsrepository.h"
+#include "ER.h"
+
+class ReferenceDataCache;
+class SettingsManager;
+
+// Lazily loaded observations table. Rows are fetched in pages using keyset pagination
+// on (sort value, id), sorting and object filtering are done by SQL. Row ids of every
+// fetched page are kept, but only a bounded number of pages keep their row data; evicted
+// pages are read back by their key range when they become visible again. Filtering is
+// done by SQL as well, changed rows are read back through the filter. Names are
+// resolved through the shared reference data dimensions.
+class ObservationsTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column
+    {
+        SessionNameColumn,
+        DateColumn,
+        ObjectColumn,
+        CameraColumn,
+        TelescopeColumn,
+        FilterColumn,
+        ImageCountColumn,
+        ExposureLengthColumn,
+        TotalExposureColumn,
+        MoonIlluminationColumn,
+        AngularSeparationColumn,
+        CommentsColumn,
+        ColumnCount
+    };
+
+    explicit ObservationsTableModel(ObservationsRepository *repository, ReferenceDataCache *referenceData,
+                                    SettingsManager *settingsManager, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+    // Columns the model cannot sort by are ignored, see isSortable()
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+    [[nodiscard]] bool isSortable(int column) const;
+    [[nodiscard]] int sortColumn() const;
+    [[nodiscard]] Qt::SortOrder sortOrder() const;
+
+    // Takes effect with the next reload()
+    void setFilter(const ObservationFilter &filter);
+    // Drops all rows and fetches the first page
+    std::expected<void, ER> reload();
+    // Patches committed observation changes into the loaded rows
+    std::expected<void, ER> applyChanges(const QVector<DbChange> &changes);
+
+    [[nodiscard]] int observationId(int row) const;
+    // Row of a loaded observation, -1 if it is filtered out or not fetched yet
+    [[nodiscard]] int rowOfObservation(int observationId) const;
+    // Object of a row whose data is in memory, nothing if it is not loaded or its page is evicted
+    [[nodiscard]] std::optional<int> loadedObjectId(int observationId) const;
+
+signals:
+    void errorOccurred(const QString &errorMessage) const;
+
+private:
+    struct Page
+    {
+        ObservationKey first;
+        ObservationKey last;
+        QVector<int> ids;              // always kept
+        QVector<ObservationData> rows; // empty while evicted
+        quint64 lastUsed = 0;
+    };
+
+    static constexpr int PageSize = 256;
+    static constexpr int MaxResidentPages = 8;
+
+    std::expected<void, ER> fetchPage();
+    [[nodiscard]] ObservationPageQuery baseQuery() const;
+    [[nodiscard]] ObservationKey keyOf(const ObservationData &obs) const;
+    [[nodiscard]] bool precedes(const ObservationKey &lhs, const ObservationKey &rhs) const;
+    [[nodiscard]] int pageOfRow(int row) const;
+    [[nodiscard]] int findRow(int observationId) const;
+    const ObservationData *rowData(int row) const;
+    bool ensureResident(int pageIndex) const;
+    void evictPages(int keepPageIndex) const;
+    void updateOffsets();
+
+    void removeRow(int row);
+    void insertSorted(const ObservationData &obs);
+    void upsert(const ObservationData &obs);
+
+    ObservationsRepository *m_repository;
+    ReferenceDataCache *m_referenceData;
+    SettingsManager *m_settingsManager;
+
+    ObservationSortField m_sortField;
+    Qt::SortOrder m_sortOrder;
+    ObservationFilter m_filter;
+    bool m_atEnd;
+    ObservationDimensions m_dimensions;
+
+    // Row data is loaded on demand from const data(), so pages are mutable
+    mutable QVector<Page> m_pages;
+    QVector<int> m_pageOffsets; // first row of each page
+    QHash<int, int> m_pageOfId; // observation id -> page index
+    int m_rowCount;
+    mutable quint64 m_useCounter;
+    mutable bool m_reloadScheduled;
+};
+
+#endif // OBSERVATIONSTABLEMODEL_H
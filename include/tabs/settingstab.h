@@ -11,6 +11,8 @@ namespace Ui
 QT_END_NAMESPACE
 
 class DatabaseManager;
+class ExportJob;
+class QThread;
 class SettingsManager;
 
 class SettingsTab : public QWidget
@@ -26,6 +28,11 @@ public:
 
 private slots:
     void onSaveButtonClicked();
+    void onDumpTablesClicked();
+    void onImportTablesClicked();
+    void onRestoreBackupClicked();
+    void onRestoreToTimeClicked();
+    void onVerifyBackupsClicked();
 
 private:
     void loadSettingsToUI();
@@ -33,6 +40,8 @@ private:
     Ui::SettingsTab *ui;
     DatabaseManager *m_dbManager;
     SettingsManager *m_settingsManager;
+    ExportJob *m_dumpJob; // running table dump, nullptr if there is none
+    QThread *m_verifyThread; // running backup verification, nullptr if there is none
 };
 
 #endif // SETTINGSTAB_H
\ No newline at end of file
@@ -0,0 +1,78 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QString>
+#include <QtGlobal>
+#include <atomic>
+#include <expected>
+#include "ER.h"
+
+// Scoped timing spans, written as Chrome trace-event JSON (chrome://tracing, ui.perfetto.dev)
+// when the application is started with --trace <file>. Compiled in when MONOOBSLOG_TRACING is
+// defined, which CMake does for all but Release builds; otherwise TRACE_SPAN expands to
+// nothing. Compiled in but not enabled, a span costs one relaxed atomic load.
+//
+// Each thread records into a fixed-size ring buffer of its own, without locking; when it
+// wraps the oldest events are overwritten. The buffers are only read by writeChromeTrace(),
+// which is meant to run once the traced work has finished.
+namespace Trace
+{
+    namespace detail
+    {
+        inline std::atomic_bool enabled{false};
+        qint64 now();
+        void record(const char *name, const char *category, qint64 start, qint64 end);
+    }
+
+    void setEnabled(bool enabled);
+    [[nodiscard]] inline bool isEnabled() { return detail::enabled.load(std::memory_order_relaxed); }
+    [[nodiscard]] constexpr bool isCompiledIn()
+    {
+#ifdef MONOOBSLOG_TRACING
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // Stable copy of a name built at run time, for spans named after data (tab titles etc.)
+    const char *intern(const QString &name);
+    // Instant event, a point on the timeline without duration
+    void mark(const char *name, const char *category);
+    // Writes the events of all threads recorded so far
+    std::expected<void, ER> writeChromeTrace(const QString &fileName);
+
+    // Times its own lifetime. name and category are kept as pointers: string literals or intern().
+    class Span
+    {
+    public:
+        Span(const char *name, const char *category)
+            : m_name(name), m_category(category), m_start(isEnabled() ? detail::now() : -1)
+        {
+        }
+        ~Span()
+        {
+            if (m_start >= 0)
+                detail::record(m_name, m_category, m_start, detail::now());
+        }
+        Span(const Span &) = delete;
+        Span &operator=(const Span &) = delete;
+
+    private:
+        const char *m_name;
+        const char *m_category;
+        qint64 m_start; // nanoseconds since the trace clock started, -1 when not tracing
+    };
+}
+
+#ifdef MONOOBSLOG_TRACING
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SPAN(name, category) const Trace::Span TRACE_CONCAT(traceSpan_, __LINE__)(name, category)
+#define TRACE_MARK(name, category) Trace::mark(name, category)
+#else
+#define TRACE_SPAN(name, category) static_cast<void>(0)
+#define TRACE_MARK(name, category) static_cast<void>(0)
+#endif
+
+#endif // TRACE_H
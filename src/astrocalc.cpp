@@ -1,4 +1,5 @@
 #include "astrocalc.h"
+#include "trace.h"
 extern "C"
 {
 #include "novas.h"
@@ -7,6 +8,7 @@ extern "C"
 
 ObjectInfo AstroCalc::getObjectInfo(double lat, double lon, double raHours, double decDegrees)
 {
+    TRACE_SPAN("AstroCalc::getObjectInfo", "astro");
 
     cat_entry cat; // Structure to contain information on sidereal source
     novas_init_cat_entry(&cat, nullptr, raHours, decDegrees);
@@ -69,6 +71,7 @@ ObjectInfo AstroCalc::getObjectInfo(double lat, double lon, double raHours, doub
 /// @param dec - returned Dec (decimal degrees)
 void AstroCalc::moonInfoForDate(const QDateTime& time, double lat, double lon, double *illumination, double *ra, double *dec)
 {
+    TRACE_SPAN("AstroCalc::moonInfoForDate", "astro");
     QDateTime utc = time.toUTC();
     double jd = julian_date(static_cast<short>(utc.date().year()), static_cast<short>(utc.date().month()), static_cast<short>(utc.date().day()), utc.time().hour() + utc.time().minute() / 60.0 + utc.time().second() / 3600.0);
 
@@ -0,0 +1,452 @@
+#include "db/backupstore.h"
+#include "trace.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QTimeZone>
+#include <algorithm>
+#include <array>
+
+namespace
+{
+    constexpr int manifestFormat = 1;
+    const QString snapshotIdFormat = "yyyyMMdd-HHmmss";
+
+    // Chunk sizes of the content-defined chunking, cut points are searched between min and max
+    constexpr qsizetype minChunkSize = 8 * 1024;
+    constexpr qsizetype averageChunkSize = 32 * 1024;
+    constexpr qsizetype maxChunkSize = 128 * 1024;
+    // Normalized chunking: a stricter mask before the average size and a looser one after it
+    // keeps most chunks close to the average. Masks test the high bits, which depend on the
+    // most recent 64 bytes.
+    constexpr quint64 strictMask = ~0ULL << (64 - 17);
+    constexpr quint64 looseMask = ~0ULL << (64 - 13);
+    constexpr qint64 readSize = 1024 * 1024;
+
+    // Random values per byte for the gear hash, generated with splitmix64 from a fixed seed.
+    // Changing them moves every cut point, new snapshots would then share no chunks with old ones.
+    constexpr std::array<quint64, 256> gearTable = []
+    {
+        std::array<quint64, 256> table{};
+        quint64 state = 0x4D6F6E6F4F62734CULL;
+        for (quint64 &value : table)
+        {
+            state += 0x9E3779B97F4A7C15ULL;
+            quint64 z = state;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            value = z ^ (z >> 31);
+        }
+        return table;
+    }();
+
+    // Length of the chunk that starts at data, size is what is available (at least
+    // maxChunkSize unless the end of the file is reached)
+    qsizetype chunkLength(const uchar *data, const qsizetype size)
+    {
+        if (size <= minChunkSize)
+            return size;
+
+        quint64 hash = 0;
+        qsizetype i = minChunkSize;
+        const qsizetype normalEnd = std::min(averageChunkSize, size);
+        for (; i < normalEnd; ++i)
+        {
+            hash = (hash << 1) + gearTable[data[i]];
+            if ((hash & strictMask) == 0)
+                return i + 1;
+        }
+        const qsizetype end = std::min(maxChunkSize, size);
+        for (; i < end; ++i)
+        {
+            hash = (hash << 1) + gearTable[data[i]];
+            if ((hash & looseMask) == 0)
+                return i + 1;
+        }
+        return end;
+    }
+
+    QString sha256Hex(const QByteArrayView data)
+    {
+        return QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Sha256).toHex());
+    }
+
+    // Bucket key of a snapshot for each retention rule
+    QString dayKey(const QDate &date)
+    {
+        return date.toString(Qt::ISODate);
+    }
+
+    QString weekKey(const QDate &date)
+    {
+        int year;
+        const int week = date.weekNumber(&year);
+        return QString("%1-W%2").arg(year).arg(week);
+    }
+
+    QString monthKey(const QDate &date)
+    {
+        return date.toString("yyyy-MM");
+    }
+
+    // Marks the newest snapshot of each of the first count buckets as kept
+    void keepPerBucket(const QVector<BackupSnapshot> &snapshots, const int count, QString (*bucket)(const QDate &),
+                       QSet<QString> &kept)
+    {
+        QSet<QString> buckets;
+        for (const BackupSnapshot &snapshot : snapshots)
+        {
+            if (buckets.size() >= count)
+                break;
+
+            const QString key = bucket(snapshot.created.toLocalTime().date());
+            if (!buckets.contains(key))
+            {
+                buckets.insert(key);
+                kept.insert(snapshot.id);
+            }
+        }
+    }
+}
+
+BackupStore::BackupStore(const QString &directory)
+    : m_directory(directory)
+{
+}
+
+std::expected<BackupSnapshot, ER> BackupStore::addSnapshot(const QString &databaseCopyPath, const QDateTime &created,
+                                                          BackupStoreStats *stats)
+{
+    TRACE_SPAN("BackupStore::addSnapshot", "backup");
+    const QDir storeDir(m_directory);
+    if (!storeDir.mkpath("chunks") || !storeDir.mkpath("snapshots"))
+    {
+        return std::unexpected(ER::Error(QString("Failed to create backup store: %1").arg(m_directory)));
+    }
+
+    QFile database(databaseCopyPath);
+    if (!database.open(QIODevice::ReadOnly))
+    {
+        return std::unexpected(ER::Error(QString("Failed to open database copy: %1").arg(database.errorString())));
+    }
+
+    BackupStoreStats added;
+    QCryptographicHash fileHash(QCryptographicHash::Sha256);
+    QJsonArray chunkHashes;
+
+    // The file is read in blocks and cut into chunks as it streams by, at most one block and
+    // one chunk are held in memory
+    QByteArray buffer;
+    qsizetype position = 0;
+    bool atEnd = false;
+    for (;;)
+    {
+        while (!atEnd && buffer.size() - position < maxChunkSize)
+        {
+            buffer.remove(0, position);
+            position = 0;
+            const QByteArray block = database.read(readSize);
+            if (block.isEmpty())
+            {
+                if (database.error() != QFileDevice::NoError)
+                {
+                    return std::unexpected(ER::Error(QString("Failed to read database copy: %1").arg(database.errorString())));
+                }
+                atEnd = true;
+            }
+            buffer.append(block);
+        }
+        if (position == buffer.size())
+            break;
+
+        const qsizetype length = chunkLength(reinterpret_cast<const uchar *>(buffer.constData()) + position,
+                                             buffer.size() - position);
+        const QByteArrayView chunk = QByteArrayView(buffer).sliced(position, length);
+        position += length;
+
+        fileHash.addData(chunk);
+        const QString hash = sha256Hex(chunk);
+        chunkHashes.append(hash);
+        ++added.chunks;
+        added.size += length;
+
+        // Identical content is already stored under the same name
+        const QString path = chunkPath(hash);
+        if (QFileInfo::exists(path))
+            continue;
+
+        if (!storeDir.mkpath(QFileInfo(path).path()))
+        {
+            return std::unexpected(ER::Error(QString("Failed to create chunk directory: %1").arg(QFileInfo(path).path())));
+        }
+        QSaveFile chunkFile(path);
+        const QByteArray compressed = qCompress(reinterpret_cast<const uchar *>(chunk.data()), chunk.size());
+        if (!chunkFile.open(QIODevice::WriteOnly) || chunkFile.write(compressed) != compressed.size() ||
+            !chunkFile.commit())
+        {
+            return std::unexpected(ER::Error(QString("Failed to write backup chunk: %1").arg(chunkFile.errorString())));
+        }
+        ++added.newChunks;
+        added.newBytes += compressed.size();
+    }
+
+    BackupSnapshot snapshot{created.toUTC().toString(snapshotIdFormat), created.toUTC()};
+
+    QJsonObject manifest;
+    manifest.insert("format", manifestFormat);
+    manifest.insert("created", snapshot.created.toString(Qt::ISODate));
+    manifest.insert("size", added.size);
+    manifest.insert("sha256", QString::fromLatin1(fileHash.result().toHex()));
+    manifest.insert("chunks", chunkHashes);
+
+    // Written last: a snapshot exists only once all of its chunks do
+    QSaveFile manifestFile(manifestPath(snapshot.id));
+    if (!manifestFile.open(QIODevice::WriteOnly) || manifestFile.write(QJsonDocument(manifest).toJson(QJsonDocument::Compact)) < 0 ||
+        !manifestFile.commit())
+    {
+        return std::unexpected(ER::Error(QString("Failed to write backup manifest: %1").arg(manifestFile.errorString())));
+    }
+
+    if (stats)
+    {
+        *stats = added;
+    }
+    return snapshot;
+}
+
+std::expected<QVector<BackupSnapshot>, ER> BackupStore::snapshots() const
+{
+    QVector<BackupSnapshot> result;
+    const QDir snapshotsDir(QDir(m_directory).filePath("snapshots"));
+    if (!snapshotsDir.exists())
+    {
+        return result;
+    }
+
+    for (const QFileInfo &fileInfo : snapshotsDir.entryInfoList({"*.json"}, QDir::Files))
+    {
+        QDateTime created = QDateTime::fromString(fileInfo.completeBaseName(), snapshotIdFormat);
+        if (!created.isValid())
+            continue;
+
+        created.setTimeZone(QTimeZone::UTC);
+        result.append({fileInfo.completeBaseName(), created});
+    }
+
+    std::sort(result.begin(), result.end(), [](const BackupSnapshot &a, const BackupSnapshot &b)
+    {
+        return a.created > b.created;
+    });
+    return result;
+}
+
+std::expected<int, ER> BackupStore::prune(const BackupRetention &retention)
+{
+    TRACE_SPAN("BackupStore::prune", "backup");
+    auto all = snapshots();
+    if (!all)
+    {
+        return std::unexpected(all.error());
+    }
+
+    QSet<QString> kept;
+    for (qsizetype i = 0; i < std::min<qsizetype>(retention.keepLast, all->size()); ++i)
+    {
+        kept.insert(all->at(i).id);
+    }
+    keepPerBucket(*all, retention.keepDaily, dayKey, kept);
+    keepPerBucket(*all, retention.keepWeekly, weekKey, kept);
+    keepPerBucket(*all, retention.keepMonthly, monthKey, kept);
+
+    // Chunks are collected from the manifests that stay; if one of them cannot be read
+    // nothing is deleted, its chunks would otherwise look unused
+    QSet<QString> used;
+    QStringList removable;
+    for (const BackupSnapshot &snapshot : std::as_const(*all))
+    {
+        if (!kept.contains(snapshot.id))
+        {
+            removable.append(snapshot.id);
+            continue;
+        }
+
+        auto manifest = readManifest(snapshot.id);
+        if (!manifest)
+        {
+            return std::unexpected(manifest.error());
+        }
+        for (const QString &hash : std::as_const(manifest->chunks))
+        {
+            used.insert(hash);
+        }
+    }
+
+    int removed = 0;
+    for (const QString &snapshotId : std::as_const(removable))
+    {
+        if (QFile::remove(manifestPath(snapshotId)))
+            ++removed;
+    }
+    removeUnusedChunks(used);
+    return removed;
+}
+
+std::expected<void, ER> BackupStore::restore(const QString &snapshotId, const QString &targetPath) const
+{
+    TRACE_SPAN("BackupStore::restore", "backup");
+    auto manifest = readManifest(snapshotId);
+    if (!manifest)
+    {
+        return std::unexpected(manifest.error());
+    }
+
+    QSaveFile target(targetPath);
+    if (!target.open(QIODevice::WriteOnly))
+    {
+        return std::unexpected(ER::Error(QString("Failed to write to file: %1").arg(target.errorString())));
+    }
+
+    QCryptographicHash fileHash(QCryptographicHash::Sha256);
+    for (const QString &hash : std::as_const(manifest->chunks))
+    {
+        auto chunk = readChunk(hash);
+        if (!chunk)
+        {
+            target.cancelWriting();
+            return std::unexpected(chunk.error());
+        }
+        fileHash.addData(*chunk);
+        if (target.write(*chunk) != chunk->size())
+        {
+            target.cancelWriting();
+            return std::unexpected(ER::Error(QString("Failed to write to file: %1").arg(target.errorString())));
+        }
+    }
+
+    if (QString::fromLatin1(fileHash.result().toHex()) != manifest->sha256)
+    {
+        target.cancelWriting();
+        return std::unexpected(ER::Error(QString("Snapshot %1 does not match its checksum").arg(snapshotId)));
+    }
+    if (!target.commit())
+    {
+        return std::unexpected(ER::Error(QString("Failed to write to file: %1").arg(target.errorString())));
+    }
+    return {};
+}
+
+std::expected<BackupVerifyReport, ER> BackupStore::verify(const BackupProgress &progress) const
+{
+    TRACE_SPAN("BackupStore::verify", "backup");
+    auto all = snapshots();
+    if (!all)
+    {
+        return std::unexpected(all.error());
+    }
+
+    BackupVerifyReport report;
+    report.snapshots = static_cast<int>(all->size());
+
+    // Each chunk is checked once, however many snapshots share it
+    QHash<QString, int> chunkUsers;
+    for (const BackupSnapshot &snapshot : std::as_const(*all))
+    {
+        auto manifest = readManifest(snapshot.id);
+        if (!manifest)
+        {
+            report.problems.append(manifest.error().errorMessage);
+            continue;
+        }
+        for (const QString &hash : std::as_const(manifest->chunks))
+        {
+            ++chunkUsers[hash];
+        }
+    }
+
+    const int total = static_cast<int>(chunkUsers.size());
+    for (auto it = chunkUsers.cbegin(); it != chunkUsers.cend(); ++it)
+    {
+        if (auto chunk = readChunk(it.key()); !chunk)
+        {
+            report.problems.append(QString("%1 (used by %2 snapshots)").arg(chunk.error().errorMessage).arg(it.value()));
+        }
+
+        ++report.checkedChunks;
+        if (progress && !progress(report.checkedChunks, total))
+        {
+            return std::unexpected(ER::Warning("Verification cancelled"));
+        }
+    }
+    return report;
+}
+
+QString BackupStore::chunkPath(const QString &hash) const
+{
+    // Two level layout keeps directories small
+    return QDir(m_directory).filePath(QString("chunks/%1/%2").arg(hash.left(2), hash));
+}
+
+QString BackupStore::manifestPath(const QString &snapshotId) const
+{
+    return QDir(m_directory).filePath(QString("snapshots/%1.json").arg(snapshotId));
+}
+
+std::expected<BackupStore::Manifest, ER> BackupStore::readManifest(const QString &snapshotId) const
+{
+    QFile file(manifestPath(snapshotId));
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return std::unexpected(ER::Error(QString("Failed to open snapshot %1: %2").arg(snapshotId, file.errorString())));
+    }
+
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    if (root.value("format").toInt() != manifestFormat)
+    {
+        return std::unexpected(ER::Error(QString("Snapshot %1 has an unknown format").arg(snapshotId)));
+    }
+
+    Manifest manifest;
+    manifest.size = root.value("size").toInteger();
+    manifest.sha256 = root.value("sha256").toString();
+    const QJsonArray chunks = root.value("chunks").toArray();
+    manifest.chunks.reserve(chunks.size());
+    for (const QJsonValue &chunk : chunks)
+    {
+        manifest.chunks.append(chunk.toString());
+    }
+    return manifest;
+}
+
+std::expected<QByteArray, ER> BackupStore::readChunk(const QString &hash) const
+{
+    QFile file(chunkPath(hash));
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return std::unexpected(ER::Error(QString("Backup chunk %1 is missing").arg(hash)));
+    }
+
+    QByteArray chunk = qUncompress(file.readAll());
+    if (chunk.isEmpty() || sha256Hex(chunk) != hash)
+    {
+        return std::unexpected(ER::Error(QString("Backup chunk %1 is corrupt").arg(hash)));
+    }
+    return chunk;
+}
+
+void BackupStore::removeUnusedChunks(const QSet<QString> &used) const
+{
+    QDirIterator chunks(QDir(m_directory).filePath("chunks"), QDir::Files, QDirIterator::Subdirectories);
+    while (chunks.hasNext())
+    {
+        const QFileInfo chunk = chunks.nextFileInfo();
+        if (!used.contains(chunk.fileName()))
+            QFile::remove(chunk.filePath());
+    }
+}
@@ -1,5 +1,6 @@
 #include "db/camerasrepository.h"
 #include "db/databasemanager.h"
+#include "trace.h"
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QDebug>
@@ -11,6 +12,7 @@ CamerasRepository::CamerasRepository(DatabaseManager *dbManager, QObject *parent
 }
 
 std::expected<QVector<CameraData>, ER> CamerasRepository::getAllCameras() const {
+    TRACE_SPAN("CamerasRepository::getAllCameras", "query");
     QVector<CameraData> cameras;
 
     QSqlQuery query(m_dbManager->database());
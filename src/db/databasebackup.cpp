@@ -1,160 +1,209 @@
 #include "db/databasebackup.h"
+#include "db/walarchive.h"
+#include "trace.h"
 #include <QDir>
 #include <QFileInfo>
 #include <QDateTime>
 #include <QDebug>
-#include <QRegularExpression>
-#include <zip.h>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QTemporaryFile>
+#include <QThread>
+#include <sqlite3.h>
+
+namespace
+{
+    // Copy through a connection of Qt's SQLite driver. VACUUM INTO writes the copy inside one
+    // read transaction, so it is consistent while the application writes; unlike the backup
+    // API it cannot be interrupted and renumbers the pages, which only WAL replay would mind.
+    bool copyThroughQtDriver(const QString &dbPath, const QString &copyPath, QString &errorMessage)
+    {
+        const QString connectionName = QString("backup-%1").arg(reinterpret_cast<quintptr>(QThread::currentThread()));
+        bool copied = false;
+        {
+            QSqlDatabase source = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+            source.setDatabaseName(dbPath);
+            source.setConnectOptions("QSQLITE_OPEN_READONLY;QSQLITE_BUSY_TIMEOUT=5000");
+            if (!source.open())
+            {
+                errorMessage = QString("Failed to open database file: %1").arg(source.lastError().text());
+            }
+            else
+            {
+                // The target may exist as long as it is empty, as the temporary file is
+                QSqlQuery query(source);
+                query.prepare("VACUUM INTO ?");
+                query.addBindValue(copyPath);
+                copied = query.exec();
+                if (!copied)
+                {
+                    errorMessage = QString("Database backup failed: %1").arg(query.lastError().text());
+                }
+            }
+        }
+        QSqlDatabase::removeDatabase(connectionName);
+        return copied;
+    }
+}
 
 DatabaseBackup::DatabaseBackup(QObject *parent)
-    : QObject(parent)
+    : QObject(parent), m_thread(nullptr)
 {
 }
 
 DatabaseBackup::~DatabaseBackup()
-= default;
-
-QString DatabaseBackup::getBackupDirectory(const QString &dbPath)
 {
-    const QFileInfo fileInfo(dbPath);
-    const QDir dbDir = fileInfo.dir();
-    QString backupDir = dbDir.filePath("ObsLogBackup");
-    return backupDir;
+    if (m_thread)
+    {
+        // copyDatabase() checks for the interruption between page batches (not during VACUUM INTO)
+        m_thread->requestInterruption();
+        m_thread->wait();
+        delete m_thread;
+    }
 }
 
-QString DatabaseBackup::getLatestBackupPath(const QString &backupDir)
+void DatabaseBackup::startBackupIfNeeded(const QString &dbPath, const BackupRetention &retention)
 {
-    const QDir dir(backupDir);
-    if (!dir.exists())
+    if (m_thread)
     {
-        return {};
+        return;
     }
 
-    // Filter for backup files matching pattern observations_backup_YYYY-MM-DD.zip
-    const QRegularExpression regex(R"(^observations_backup_(\d{4}-\d{2}-\d{2})\.zip$)");
-    QStringList backups;
-
-    QFileInfoList files = dir.entryInfoList(QDir::Files, QDir::Name | QDir::Reversed);
-    for (const QFileInfo &fileInfo : files)
+    // Signals emitted on the worker are queued to the thread that owns this object
+    m_thread = QThread::create([this, dbPath, retention]
     {
-        if (QRegularExpressionMatch match = regex.match(fileInfo.fileName()); match.hasMatch())
+        if (!isBackupNeeded(getBackupDirectory(dbPath)))
         {
-            backups.append(fileInfo.absoluteFilePath());
+            qDebug() << "Recent backup exists, no backup needed";
+            return;
         }
-    }
 
-    if (backups.isEmpty())
+        emit backupStarted();
+        QString errorMessage;
+        const bool success = createBackup(dbPath, retention, errorMessage);
+        emit backupFinished(success, success ? QString("Database backup created") : errorMessage);
+    });
+    connect(m_thread, &QThread::finished, this, [this]
     {
-        return {};
-    }
-
-    // Return the first one (most recent due to sorting)
-    return backups.first();
+        m_thread->deleteLater();
+        m_thread = nullptr;
+    });
+    m_thread->start(QThread::LowPriority);
 }
 
-bool DatabaseBackup::isBackupNeeded(const QString &latestBackupPath)
+QString DatabaseBackup::getBackupDirectory(const QString &dbPath)
 {
-    if (latestBackupPath.isEmpty())
-    {
-        // No backups exist
-        return true;
-    }
-
-    // Extract date from filename
-    const QFileInfo fileInfo(latestBackupPath);
-    const QString filename = fileInfo.fileName();
-
-    const QRegularExpression regex(R"(^observations_backup_(\d{4}-\d{2}-\d{2})\.zip$)");
-    const QRegularExpressionMatch match = regex.match(filename);
-
-    if (!match.hasMatch())
-    {
-        return true;
-    }
-
-    const QString dateString = match.captured(1);
-    const QDate backupDate = QDate::fromString(dateString, "yyyy-MM-dd");
+    const QFileInfo fileInfo(dbPath);
+    const QDir dbDir = fileInfo.dir();
+    QString backupDir = dbDir.filePath("ObsLogBackup");
+    return backupDir;
+}
 
-    if (!backupDate.isValid())
+bool DatabaseBackup::isBackupNeeded(const QString &backupDir)
+{
+    auto snapshots = BackupStore(backupDir).snapshots();
+    if (!snapshots || snapshots->isEmpty())
     {
+        // No backups exist, or the store cannot be read and a new snapshot will tell why
         return true;
     }
 
-    // Check if backup is older than 7 days
-    const QDate currentDate = QDate::currentDate();
-    const auto daysSinceBackup = backupDate.daysTo(currentDate);
-
-    return daysSinceBackup >= 7;
+    // Snapshots are cheap, only the chunks that changed are stored: one per day
+    return snapshots->first().created.toLocalTime().date() < QDate::currentDate();
 }
 
-bool DatabaseBackup::createZipBackup(const QString &dbPath, const QString &backupPath, QString &errorMessage)
+bool DatabaseBackup::copyDatabase(const QString &dbPath, const QString &copyPath, QString &errorMessage)
 {
-    // Open the zip archive for writing
-    int errorp;
-    zip_t *archive = zip_open(backupPath.toUtf8().constData(), ZIP_CREATE | ZIP_TRUNCATE, &errorp);
+    TRACE_SPAN("DatabaseBackup::copyDatabase", "backup");
+#ifndef MONOOBSLOG_QT_SYSTEM_SQLITE
+    // The linked SQLite is another copy of the library than Qt's. Its connection to the live file
+    // would share POSIX locks with Qt's without knowing of them and release them on close,
+    // which is how two SQLite copies in one process corrupt a database.
+    return copyThroughQtDriver(dbPath, copyPath, errorMessage);
+#else
+    // Pages copied per step; the source is read in small batches so memory use stays flat
+    constexpr int pagesPerStep = 256;
+
+    sqlite3 *source = nullptr;
+    sqlite3 *copy = nullptr;
+    const auto closeAll = [&]
+    {
+        sqlite3_close(copy);
+        sqlite3_close(source);
+    };
 
-    if (!archive)
+    if (sqlite3_open_v2(dbPath.toUtf8().constData(), &source, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK)
     {
-        zip_error_t ziperror;
-        zip_error_init_with_code(&ziperror, errorp);
-        errorMessage = QString("Failed to create zip archive: %1").arg(zip_error_strerror(&ziperror));
-        zip_error_fini(&ziperror);
+        errorMessage = QString("Failed to open database file: %1").arg(sqlite3_errmsg(source));
+        closeAll();
         return false;
     }
+    sqlite3_busy_timeout(source, 5000);
 
-    // Open source database file
-    QFile dbFile(dbPath);
-    if (!dbFile.open(QIODevice::ReadOnly))
+    // One read transaction over the whole copy: the backup sees a single consistent state of
+    // the database and is not restarted when the application commits in the meantime
+    if (sqlite3_exec(source, "BEGIN; SELECT count(*) FROM sqlite_master;", nullptr, nullptr, nullptr) != SQLITE_OK)
     {
-        errorMessage = QString("Failed to open database file: %1").arg(dbFile.errorString());
-        zip_close(archive);
+        errorMessage = QString("Failed to read database: %1").arg(sqlite3_errmsg(source));
+        closeAll();
         return false;
     }
 
-    // Read all database content
-    const QByteArray dbData = dbFile.readAll();
-    dbFile.close();
-
-    if (dbData.isEmpty())
+    if (sqlite3_open_v2(copyPath.toUtf8().constData(), &copy, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE,
+                        nullptr) != SQLITE_OK)
     {
-        errorMessage = "Database file is empty";
-        zip_close(archive);
+        errorMessage = QString("Failed to create database copy: %1").arg(sqlite3_errmsg(copy));
+        closeAll();
         return false;
     }
+    // The copy is a temporary file that BackupStore reads into chunks right after, it needs no
+    // journal and no syncing
+    sqlite3_exec(copy, "PRAGMA journal_mode = OFF; PRAGMA synchronous = OFF;", nullptr, nullptr, nullptr);
 
-    // Create a zip source from the database data
-    const QFileInfo dbFileInfo(dbPath);
-    const QString dbFileName = dbFileInfo.fileName();
-
-    zip_source_t *source = zip_source_buffer(archive, dbData.constData(), dbData.size(), 0);
-    if (!source)
+    sqlite3_backup *backup = sqlite3_backup_init(copy, "main", source, "main");
+    if (!backup)
     {
-        errorMessage = QString("Failed to create zip source: %1").arg(zip_strerror(archive));
-        zip_close(archive);
+        errorMessage = QString("Failed to start database backup: %1").arg(sqlite3_errmsg(copy));
+        closeAll();
         return false;
     }
 
-    // Add file to archive
-    if (const zip_int64_t index = zip_file_add(archive, dbFileName.toUtf8().constData(), source, ZIP_FL_ENC_UTF_8); index < 0)
+    int result;
+    do
     {
-        errorMessage = QString("Failed to add file to archive: %1").arg(zip_strerror(archive));
-        zip_source_free(source);
-        zip_close(archive);
-        return false;
-    }
+        if (QThread::currentThread()->isInterruptionRequested())
+        {
+            sqlite3_backup_finish(backup);
+            errorMessage = "Database backup cancelled";
+            closeAll();
+            return false;
+        }
 
-    // Close the archive
-    if (zip_close(archive) < 0)
+        result = sqlite3_backup_step(backup, pagesPerStep);
+        if (result == SQLITE_BUSY || result == SQLITE_LOCKED)
+        {
+            sqlite3_sleep(10);
+        }
+    } while (result == SQLITE_OK || result == SQLITE_BUSY || result == SQLITE_LOCKED);
+
+    sqlite3_backup_finish(backup);
+    if (result != SQLITE_DONE)
     {
-        errorMessage = QString("Failed to finalize zip archive: %1").arg(zip_strerror(archive));
+        errorMessage = QString("Database backup failed: %1").arg(sqlite3_errstr(result));
+        closeAll();
         return false;
     }
 
+    sqlite3_exec(source, "COMMIT", nullptr, nullptr, nullptr);
+    closeAll();
     return true;
+#endif
 }
 
-bool DatabaseBackup::createBackup(const QString &dbPath, QString &errorMessage)
+bool DatabaseBackup::createBackup(const QString &dbPath, const BackupRetention &retention, QString &errorMessage)
 {
+    TRACE_SPAN("DatabaseBackup::createBackup", "backup");
     // Verify database file exists
     if (!QFile::exists(dbPath))
     {
@@ -175,44 +224,67 @@ bool DatabaseBackup::createBackup(const QString &dbPath, QString &errorMessage)
         }
     }
 
-    // Generate backup filename with current date
-    const QString currentDate = QDate::currentDate().toString("yyyy-MM-dd");
-    const QString backupFileName = QString("observations_backup_%1.zip").arg(currentDate);
-    const QString backupPath = QDir(backupDir).filePath(backupFileName);
+    // Consistent copy of the live database next to the store, removed when done
+    QTemporaryFile copyFile(QDir(backupDir).filePath("observations_backup_XXXXXX.db"));
+    if (!copyFile.open())
+    {
+        errorMessage = QString("Failed to create temporary file: %1").arg(copyFile.errorString());
+        return false;
+    }
+    const QString copyPath = copyFile.fileName();
+    copyFile.close();
 
-    // Create the zip backup
-    if (!createZipBackup(dbPath, backupPath, errorMessage))
+    const QDateTime copyStarted = QDateTime::currentDateTimeUtc();
+    if (!copyDatabase(dbPath, copyPath, errorMessage))
     {
         return false;
     }
 
-    qDebug() << "Database backup created:" << backupPath;
+    BackupStore store(backupDir);
+    BackupStoreStats stats;
+    auto snapshot = store.addSnapshot(copyPath, copyStarted, &stats);
+    if (!snapshot)
+    {
+        errorMessage = snapshot.error().errorMessage;
+        return false;
+    }
+    qDebug() << "Database backup created:" << snapshot->id << "-" << stats.newChunks << "of" << stats.chunks
+             << "chunks new," << stats.newBytes << "bytes added";
+
+    // A failed prune keeps more than needed, the new snapshot is there either way
+    if (auto removed = store.prune(retention); !removed)
+    {
+        qWarning() << "Failed to prune backups:" << removed.error().errorMessage;
+    }
+    else if (removed.value() > 0)
+    {
+        qDebug() << "Pruned" << removed.value() << "backup snapshots";
+    }
+
+    // Archived WAL segments are only needed from the oldest snapshot on
+    if (auto snapshots = store.snapshots(); snapshots && !snapshots->isEmpty())
+    {
+        if (const int removedSegments = WalArchive::prune(backupDir, snapshots->last().created); removedSegments > 0)
+        {
+            qDebug() << "Pruned" << removedSegments << "WAL segments";
+        }
+    }
 
     return true;
 }
 
-bool DatabaseBackup::checkAndBackupIfNeeded(const QString &dbPath, QString &errorMessage)
+bool DatabaseBackup::checkAndBackupIfNeeded(const QString &dbPath, const BackupRetention &retention, QString &errorMessage)
 {
     // Get backup directory
     const QString backupDir = getBackupDirectory(dbPath);
 
-    // Get latest backup file
-    const QString latestBackup = getLatestBackupPath(backupDir);
-
     // Check if backup is needed
-
-    if (isBackupNeeded(latestBackup))
+    if (isBackupNeeded(backupDir))
     {
         qDebug() << "Backup needed. Creating new backup...";
-        if (!createBackup(dbPath, errorMessage))
-        {
-            return false;
-        }
-        return true;
+        return createBackup(dbPath, retention, errorMessage);
     }
-    else
-    {
-        qDebug() << "Recent backup exists, no backup needed";
-        return true;
-    }
-}
\ No newline at end of file
+
+    qDebug() << "Recent backup exists, no backup needed";
+    return true;
+}
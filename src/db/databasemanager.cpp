@@ -1,25 +1,60 @@
 #include "db/databasemanager.h"
+#include "db/referencedatacache.h"
+#include "db/databasebackup.h"
+#include "db/walarchive.h"
+#include "trace.h"
 #include <QSqlQuery>
 #include <QSqlError>
+#include <QSqlDriver>
 #include <QDebug>
 #include <QFile>
+#include <QFileInfo>
+#include <iterator>
 #include <vector>
+#include <cstring>
+#include <utility>
+#include <sqlite3.h>
+extern "C"
+{
+#include "novas.h"
+}
 
 DatabaseManager::DatabaseManager(QObject *parent)
-    : QObject(parent), m_initialized(false)
+    : QObject(parent), m_initialized(false), m_nativeApiUsable(false), m_sqlFunctionsRegistered(false),
+      m_mathFunctions(false), m_nativeStatements(true), m_snapshot(false), m_referenceData(nullptr), m_walArchiver(nullptr), m_statementCache(32),
+      m_flushScheduled(false)
 {
+    // Created first so that it sees dataChanged before any other listener
+    m_referenceData = new ReferenceDataCache(this);
 }
 
 DatabaseManager::~DatabaseManager()
 {
     if (m_database.isOpen())
     {
+        // Archives the last frames while the connection is still open
+        delete m_walArchiver;
+        m_walArchiver = nullptr;
+        removeChangeHooks();
+        // Unfinalized statements would keep the connection open
+        m_statementCache.clear();
+        if (m_snapshot)
+        {
+            QSqlQuery(m_database).exec("ROLLBACK");
+        }
         m_database.close();
     }
+    if (m_snapshot)
+    {
+        const QString connectionName = m_database.connectionName();
+        m_database = QSqlDatabase();
+        QSqlDatabase::removeDatabase(connectionName);
+    }
 }
 
-std::expected<void, ER> DatabaseManager::initialize(const QString &dbPath)
+std::expected<void, ER> DatabaseManager::initialize(const QString &dbPath, const WalHandling walHandling)
 {
+    TRACE_SPAN("DatabaseManager::initialize", "startup");
     m_dbPath = dbPath;
 
     // Check if database file exists
@@ -34,6 +69,16 @@ std::expected<void, ER> DatabaseManager::initialize(const QString &dbPath)
         return std::unexpected(ER::Critical(QString("Failed to open database: %1").arg(m_database.lastError().text()) ));
     }
 
+    checkNativeApi();
+    registerSqlFunctions();
+    checkMathFunctions();
+
+    // Readers then work on a snapshot without blocking writes, see openSnapshot()
+    if (QSqlQuery walQuery(m_database); !walQuery.exec("PRAGMA journal_mode = WAL"))
+    {
+        qWarning() << "Failed to enable WAL journal mode:" << walQuery.lastError().text();
+    }
+
     // If database didn't exist, create tables
     if (!dbExists)
     {
@@ -52,15 +97,32 @@ std::expected<void, ER> DatabaseManager::initialize(const QString &dbPath)
     int actual = result.value();
 
     if (actual < getSupportedDbVersion()) {
+        // Also updates the database version, step by step
         if (auto migResult = runMigrations(actual, getSupportedDbVersion()); !migResult) {
             return std::unexpected(migResult.error());
         }
-        // Update the database version
-        QSqlQuery query(m_database);
-        query.prepare(R"(UPDATE internal SET value = :version WHERE key = "DBVERSION")");
-        query.bindValue(":version", getSupportedDbVersion());
-        if (!query.exec()) {
-            return std::unexpected(ER::Critical(QString("Failed to update DB version: %1").arg(query.lastError().text())));
+    }
+
+    installChangeHooks();
+
+    if (walHandling == ArchiveWal)
+    {
+        // Every commit is kept in the backup directory for point-in-time restore
+        m_walArchiver = new WalArchiver(this, DatabaseBackup::getBackupDirectory(m_dbPath));
+        if (!m_walArchiver->install())
+        {
+            qWarning() << "WAL archiving is not available, point-in-time restore only reaches the last backup";
+            delete m_walArchiver;
+            m_walArchiver = nullptr;
+        }
+    }
+    else
+    {
+        // Without own checkpoints the frames stay in the WAL until a running application archives
+        // them with its next commit, or until SQLite checkpoints on close of the last connection
+        if (QSqlQuery checkpointQuery(m_database); !checkpointQuery.exec("PRAGMA wal_autocheckpoint = 0"))
+        {
+            qWarning() << "Failed to disable WAL auto-checkpoints:" << checkpointQuery.lastError().text();
         }
     }
 
@@ -75,6 +137,42 @@ std::expected<void, ER> DatabaseManager::initialize(const QString &dbPath)
     return {};
 }
 
+std::expected<void, ER> DatabaseManager::openSnapshot(const QString &dbPath)
+{
+    TRACE_SPAN("DatabaseManager::openSnapshot", "db");
+    m_dbPath = dbPath;
+    m_snapshot = true;
+
+    // Own connection per manager, the default one belongs to the main thread
+    m_database = QSqlDatabase::addDatabase("QSQLITE", QString("snapshot-%1").arg(reinterpret_cast<quintptr>(this)));
+    m_database.setDatabaseName(m_dbPath);
+    m_database.setConnectOptions("QSQLITE_OPEN_READONLY");
+
+    if (!m_database.open())
+    {
+        return std::unexpected(ER::Error(QString("Failed to open database: %1").arg(m_database.lastError().text())));
+    }
+
+    checkNativeApi();
+    registerSqlFunctions();
+    checkMathFunctions();
+
+    // The first read of a transaction fixes the snapshot; it lasts until the manager is destroyed
+    QSqlQuery query(m_database);
+    if (!query.exec("BEGIN") || !query.exec("SELECT COUNT(*) FROM sqlite_master") || !query.next())
+    {
+        return std::unexpected(ER::Error(QString("Failed to start read transaction: %1").arg(query.lastError().text())));
+    }
+
+    m_initialized = true;
+    return {};
+}
+
+QString DatabaseManager::databasePath() const
+{
+    return m_dbPath;
+}
+
 bool DatabaseManager::isOpen() const
 {
     return m_database.isOpen();
@@ -85,6 +183,441 @@ QSqlDatabase &DatabaseManager::database()
     return m_database;
 }
 
+ReferenceDataCache *DatabaseManager::referenceData() const
+{
+    return m_referenceData;
+}
+
+sqlite3 *DatabaseManager::nativeHandle() const
+{
+    if (!m_nativeApiUsable)
+        return nullptr;
+
+    const QVariant handle = m_database.driver() ? m_database.driver()->handle() : QVariant();
+    if (handle.isValid() && qstrcmp(handle.typeName(), "sqlite3*") == 0)
+    {
+        return *static_cast<sqlite3 *const *>(handle.constData());
+    }
+    return nullptr;
+}
+
+sqlite3 *DatabaseManager::statementHandle() const
+{
+    return m_nativeStatements ? nativeHandle() : nullptr;
+}
+
+void DatabaseManager::setNativeStatements(const bool enabled)
+{
+    m_nativeStatements = enabled;
+}
+
+sqlite3_stmt *DatabaseManager::takeCachedStatement(const QString &sql)
+{
+    CachedStatement *cached = m_statementCache.take(sql);
+    if (!cached)
+        return nullptr;
+
+    sqlite3_stmt *stmt = std::exchange(cached->stmt, nullptr);
+    delete cached;
+    return stmt;
+}
+
+void DatabaseManager::returnCachedStatement(const QString &sql, sqlite3_stmt *stmt)
+{
+    // Replaces a statement with the same text that was prepared meanwhile
+    m_statementCache.insert(sql, new CachedStatement(stmt));
+}
+
+DatabaseManager::CachedStatement::~CachedStatement()
+{
+    sqlite3_finalize(stmt);
+}
+
+namespace
+{
+    DbTable tableFromName(const char *tableName)
+    {
+        static const struct
+        {
+            const char *name;
+            DbTable table;
+        } tables[] = {
+            {"filter_types", DbTable::FilterTypes},
+            {"cameras", DbTable::Cameras},
+            {"telescopes", DbTable::Telescopes},
+            {"objects", DbTable::Objects},
+            {"sessions", DbTable::Sessions},
+            {"filters", DbTable::Filters},
+            {"observations", DbTable::Observations},
+        };
+
+        for (const auto &[name, table] : tables)
+        {
+            if (std::strcmp(tableName, name) == 0)
+                return table;
+        }
+        return DbTable::Unknown;
+    }
+
+    const char *const notifiedTables[] = {"filter_types", "cameras", "telescopes", "objects", "sessions", "filters", "observations"};
+
+    // Indexes behind the observation filters and joins, added with DB version 4
+    const char *const observationIndexSql[] = {
+        R"(CREATE INDEX IF NOT EXISTS "idx_observations_session" ON "observations" ("session_id"))",
+        R"(CREATE INDEX IF NOT EXISTS "idx_observations_object" ON "observations" ("object_id"))",
+        R"(CREATE INDEX IF NOT EXISTS "idx_observations_camera" ON "observations" ("camera_id"))",
+        R"(CREATE INDEX IF NOT EXISTS "idx_observations_telescope" ON "observations" ("telescope_id"))",
+        R"(CREATE INDEX IF NOT EXISTS "idx_observations_filter" ON "observations" ("filter_id"))",
+        R"(CREATE INDEX IF NOT EXISTS "idx_filters_filter_type" ON "filters" ("filter_type_id"))",
+    };
+
+    // Session start dates as day numbers (QDate::toJulianDay()), added with DB version 6. Date
+    // ordering, ranges and grouping use this integer index instead of comparing ISO date text.
+    const char *const sessionStartJdIndexSql =
+        R"(CREATE INDEX IF NOT EXISTS "idx_sessions_start_jd" ON "sessions" ("start_jd"))";
+
+    // Copy of the session day number on each observation, added with DB version 7. Paging in
+    // session date order walks this index instead of sorting the whole join with sessions.
+    const char *const observationStartJdSql[] = {
+        R"(CREATE INDEX IF NOT EXISTS "idx_observations_start_jd" ON "observations" ("start_jd", "id"))",
+        R"(CREATE TRIGGER IF NOT EXISTS "observation_start_jd_insert" AFTER INSERT ON "observations" BEGIN
+            UPDATE observations SET start_jd = (SELECT start_jd FROM sessions WHERE id = new.session_id)
+            WHERE id = new.id;
+        END)",
+        R"(CREATE TRIGGER IF NOT EXISTS "observation_start_jd_update" AFTER UPDATE OF session_id ON "observations" BEGIN
+            UPDATE observations SET start_jd = (SELECT start_jd FROM sessions WHERE id = new.session_id)
+            WHERE id = new.id;
+        END)",
+        R"(CREATE TRIGGER IF NOT EXISTS "observation_start_jd_session" AFTER UPDATE OF start_jd ON "sessions"
+           WHEN new.start_jd IS NOT old.start_jd BEGIN
+            UPDATE observations SET start_jd = new.start_jd WHERE session_id = new.id;
+        END)",
+    };
+
+    // Revision of each observation, added with DB version 8. Every insert and every change of a
+    // shown column takes the next number of a counter in internal that is never reused, so
+    // count(*) and max(revision) of a group of observations change whenever one of its rows does.
+    const char *const observationRevisionSql[] = {
+        R"(INSERT OR IGNORE INTO internal (key, value) VALUES ('OBSERVATION_REVISION', 0))",
+        R"(CREATE TRIGGER IF NOT EXISTS "observation_revision_insert" AFTER INSERT ON "observations" BEGIN
+            UPDATE internal SET value = CAST(value AS INTEGER) + 1 WHERE key = 'OBSERVATION_REVISION';
+            UPDATE observations SET revision = (SELECT CAST(value AS INTEGER) FROM internal WHERE key = 'OBSERVATION_REVISION')
+            WHERE id = new.id;
+        END)",
+        R"(CREATE TRIGGER IF NOT EXISTS "observation_revision_update" AFTER UPDATE OF image_count, exposure_length,
+           total_exposure, comments, session_id, object_id, camera_id, telescope_id, filter_id ON "observations" BEGIN
+            UPDATE internal SET value = CAST(value AS INTEGER) + 1 WHERE key = 'OBSERVATION_REVISION';
+            UPDATE observations SET revision = (SELECT CAST(value AS INTEGER) FROM internal WHERE key = 'OBSERVATION_REVISION')
+            WHERE id = new.id;
+        END)",
+    };
+
+    // Full text index over the comments of each observation and of its session and object, added
+    // with DB version 5. The rowid is the observation id; triggers keep it in sync with all three tables.
+    const char *const observationSearchSql[] = {
+        R"(CREATE VIRTUAL TABLE IF NOT EXISTS "observation_search" USING fts5(
+            observation_comments, session_comments, object_comments,
+            tokenize = 'unicode61 remove_diacritics 2', prefix = '2 3'
+        ))",
+        R"(INSERT INTO "observation_search" (rowid, observation_comments, session_comments, object_comments)
+           SELECT o.id, o.comments, s.comments, obj.comments
+           FROM observations o
+           LEFT JOIN sessions s ON o.session_id = s.id
+           LEFT JOIN objects obj ON o.object_id = obj.id)",
+        R"(CREATE TRIGGER IF NOT EXISTS "observation_search_insert" AFTER INSERT ON "observations" BEGIN
+            INSERT INTO "observation_search" (rowid, observation_comments, session_comments, object_comments)
+            VALUES (new.id, new.comments,
+                    (SELECT comments FROM sessions WHERE id = new.session_id),
+                    (SELECT comments FROM objects WHERE id = new.object_id));
+        END)",
+        R"(CREATE TRIGGER IF NOT EXISTS "observation_search_update"
+           AFTER UPDATE OF comments, session_id, object_id ON "observations" BEGIN
+            UPDATE "observation_search"
+            SET observation_comments = new.comments,
+                session_comments = (SELECT comments FROM sessions WHERE id = new.session_id),
+                object_comments = (SELECT comments FROM objects WHERE id = new.object_id)
+            WHERE rowid = new.id;
+        END)",
+        R"(CREATE TRIGGER IF NOT EXISTS "observation_search_delete" AFTER DELETE ON "observations" BEGIN
+            DELETE FROM "observation_search" WHERE rowid = old.id;
+        END)",
+        R"(CREATE TRIGGER IF NOT EXISTS "observation_search_session" AFTER UPDATE OF comments ON "sessions" BEGIN
+            UPDATE "observation_search" SET session_comments = new.comments
+            WHERE rowid IN (SELECT id FROM observations WHERE session_id = new.id);
+        END)",
+        R"(CREATE TRIGGER IF NOT EXISTS "observation_search_object" AFTER UPDATE OF comments ON "objects" BEGIN
+            UPDATE "observation_search" SET object_comments = new.comments
+            WHERE rowid IN (SELECT id FROM observations WHERE object_id = new.id);
+        END)",
+    };
+
+    // Splits a migration script into statements. A semicolon only ends a statement where
+    // sqlite3_complete() agrees, so trigger bodies and string literals stay in one piece.
+    QStringList splitSqlStatements(const QString &sql)
+    {
+        QStringList statements;
+        QString pending;
+        for (const QString &piece : sql.split(';'))
+        {
+            pending += piece;
+            if (sqlite3_complete((pending + ';').toUtf8().constData()))
+            {
+                if (!pending.trimmed().isEmpty())
+                    statements << pending + ';';
+                pending.clear();
+            }
+            else
+            {
+                pending += ';';
+            }
+        }
+        if (!pending.trimmed().isEmpty())
+            statements << pending;
+        return statements;
+    }
+}
+
+void DatabaseManager::checkNativeApi()
+{
+#ifdef MONOOBSLOG_QT_SYSTEM_SQLITE
+    // Qt is built with -system-sqlite, so the driver's handle belongs to the SQLite we link
+    // against. A different version means the build picked up another copy after all.
+    QSqlQuery query(m_database);
+    if (query.exec("SELECT sqlite_version()") && query.next())
+    {
+        m_nativeApiUsable = query.value(0).toString() == QString::fromLatin1(sqlite3_libversion());
+    }
+
+    if (!m_nativeApiUsable)
+    {
+        qWarning() << "Qt SQLite driver version" << query.value(0).toString() << "does not match linked SQLite"
+                   << sqlite3_libversion() << "- native SQLite features disabled";
+    }
+#else
+    // The driver of a stock Qt build carries its own SQLite; calling into it through a second
+    // copy would mix two sets of mutexes, allocators and global state
+    m_nativeApiUsable = false;
+    qDebug() << "Native SQLite features disabled, configure with -DMONOOBSLOG_QT_SYSTEM_SQLITE=ON"
+             << "if Qt uses the system SQLite";
+#endif
+}
+
+bool DatabaseManager::hasSqlFunctions() const
+{
+    return m_sqlFunctionsRegistered;
+}
+
+bool DatabaseManager::isWalArchived() const
+{
+    return m_walArchiver != nullptr;
+}
+
+bool DatabaseManager::hasMathFunctions() const
+{
+    return m_mathFunctions;
+}
+
+void DatabaseManager::checkMathFunctions()
+{
+    // Compiled in with SQLITE_ENABLE_MATH_FUNCTIONS, which not every bundled SQLite has
+    QSqlQuery query(m_database);
+    m_mathFunctions = query.exec("SELECT acos(1)") && query.next();
+}
+
+void DatabaseManager::registerSqlFunctions()
+{
+    sqlite3 *handle = nativeHandle();
+    if (!handle)
+        return;
+
+    // angular_separation(object_ra_hours, object_dec, moon_ra_deg, moon_dec) in degrees,
+    // NULL if any coordinate is missing. Lets queries sort and filter on the separation.
+    const auto angularSeparation = [](sqlite3_context *context, int, sqlite3_value **values)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            if (sqlite3_value_type(values[i]) == SQLITE_NULL)
+            {
+                sqlite3_result_null(context);
+                return;
+            }
+        }
+        sqlite3_result_double(context, novas_sep(sqlite3_value_double(values[0]) * 15.0, sqlite3_value_double(values[1]),
+                                                 sqlite3_value_double(values[2]), sqlite3_value_double(values[3])));
+    };
+
+    m_sqlFunctionsRegistered = sqlite3_create_function_v2(handle, "angular_separation", 4,
+                                                          SQLITE_UTF8 | SQLITE_DETERMINISTIC, nullptr,
+                                                          angularSeparation, nullptr, nullptr, nullptr) == SQLITE_OK;
+    if (!m_sqlFunctionsRegistered)
+    {
+        qWarning() << "Failed to register SQL functions:" << sqlite3_errmsg(handle);
+    }
+}
+
+void DatabaseManager::installChangeHooks()
+{
+    sqlite3 *handle = nativeHandle();
+    if (!handle)
+    {
+        // Fall back to the driver's own notifications: only table and rowid are known,
+        // so every change is reported as an update and listeners re-read the row.
+        QSqlDriver *driver = m_database.driver();
+        for (const char *table : notifiedTables)
+        {
+            driver->subscribeToNotification(QString::fromLatin1(table));
+        }
+        connect(driver, &QSqlDriver::notification, this,
+                [this](const QString &name, QSqlDriver::NotificationSource, const QVariant &payload)
+                {
+                    const DbTable table = tableFromName(name.toLatin1().constData());
+                    if (table == DbTable::Unknown)
+                        return;
+                    m_committedChanges.append({table, DbOperation::Update, payload.toLongLong()});
+                    if (!m_flushScheduled)
+                    {
+                        m_flushScheduled = true;
+                        QMetaObject::invokeMethod(this, &DatabaseManager::flushChanges, Qt::QueuedConnection);
+                    }
+                });
+        return;
+    }
+
+    sqlite3_update_hook(handle, &DatabaseManager::updateHook, this);
+    sqlite3_commit_hook(handle, &DatabaseManager::commitHook, this);
+    sqlite3_rollback_hook(handle, &DatabaseManager::rollbackHook, this);
+    sqlite3_trace_v2(handle, SQLITE_TRACE_PROFILE | SQLITE_TRACE_ROW, &DatabaseManager::traceHook, this);
+}
+
+void DatabaseManager::removeChangeHooks()
+{
+    if (sqlite3 *handle = nativeHandle())
+    {
+        sqlite3_update_hook(handle, nullptr, nullptr);
+        sqlite3_commit_hook(handle, nullptr, nullptr);
+        sqlite3_rollback_hook(handle, nullptr, nullptr);
+        sqlite3_trace_v2(handle, 0, nullptr, nullptr);
+    }
+}
+
+void DatabaseManager::updateHook(void *context, const int operation, const char *dbName, const char *tableName, const qint64 rowId)
+{
+    // Runs inside sqlite3_step(): only record the change, the connection must not be used here
+    if (std::strcmp(dbName, "main") != 0)
+        return;
+
+    const DbTable table = tableFromName(tableName);
+    if (table == DbTable::Unknown)
+        return;
+
+    DbOperation op = DbOperation::Update;
+    if (operation == SQLITE_INSERT)
+        op = DbOperation::Insert;
+    else if (operation == SQLITE_DELETE)
+        op = DbOperation::Delete;
+
+    static_cast<DatabaseManager *>(context)->m_uncommittedChanges.append({table, op, rowId});
+}
+
+int DatabaseManager::commitHook(void *context)
+{
+    auto *self = static_cast<DatabaseManager *>(context);
+    if (self->m_uncommittedChanges.isEmpty())
+        return 0;
+
+    self->m_committedChanges.append(self->m_uncommittedChanges);
+    self->m_uncommittedChanges.clear();
+
+    // Listeners will query the database, so publish only after the commit has completed
+    if (!self->m_flushScheduled)
+    {
+        self->m_flushScheduled = true;
+        QMetaObject::invokeMethod(self, &DatabaseManager::flushChanges, Qt::QueuedConnection);
+    }
+    return 0; // non-zero would turn the commit into a rollback
+}
+
+void DatabaseManager::rollbackHook(void *context)
+{
+    static_cast<DatabaseManager *>(context)->m_uncommittedChanges.clear();
+}
+
+int DatabaseManager::traceHook(const unsigned type, void *context, void *statement, void *data)
+{
+    // Runs inside sqlite3_step() for every row, keep it to counting
+    auto *self = static_cast<DatabaseManager *>(context);
+    auto *stmt = static_cast<sqlite3_stmt *>(statement);
+    if (type == SQLITE_TRACE_ROW)
+    {
+        ++self->m_statementRows[stmt];
+    }
+    else if (type == SQLITE_TRACE_PROFILE)
+    {
+        // Reported when the statement is done or reset
+        self->m_queryStats.record(sqlite3_sql(stmt), *static_cast<const sqlite3_int64 *>(data),
+                                  self->m_statementRows.take(stmt));
+    }
+    return 0;
+}
+
+const QueryStats &DatabaseManager::queryStats() const
+{
+    return m_queryStats;
+}
+
+void DatabaseManager::clearQueryStats()
+{
+    m_queryStats.clear();
+}
+
+void DatabaseManager::recordQueryStats(const char *sql, const qint64 nanoseconds, const qint64 rows)
+{
+    // Snapshots are read on worker threads, the statistics belong to the main thread
+    if (m_snapshot || nativeHandle())
+        return;
+    m_queryStats.record(sql, nanoseconds, rows);
+}
+
+ConnectionStats DatabaseManager::connectionStats() const
+{
+    ConnectionStats stats;
+    stats.databaseBytes = QFileInfo(m_dbPath).size();
+    stats.walBytes = QFileInfo(m_dbPath + "-wal").size();
+
+    sqlite3 *handle = nativeHandle();
+    if (!handle)
+        return stats;
+
+    int current = 0;
+    int highwater = 0;
+    stats.available = true;
+    if (sqlite3_db_status(handle, SQLITE_DBSTATUS_CACHE_HIT, &current, &highwater, 0) == SQLITE_OK)
+        stats.cacheHits = current;
+    if (sqlite3_db_status(handle, SQLITE_DBSTATUS_CACHE_MISS, &current, &highwater, 0) == SQLITE_OK)
+        stats.cacheMisses = current;
+    if (sqlite3_db_status(handle, SQLITE_DBSTATUS_CACHE_WRITE, &current, &highwater, 0) == SQLITE_OK)
+        stats.cacheWrites = current;
+    if (sqlite3_db_status(handle, SQLITE_DBSTATUS_CACHE_USED, &current, &highwater, 0) == SQLITE_OK)
+        stats.cacheUsedBytes = current;
+    return stats;
+}
+
+void DatabaseManager::flushChanges()
+{
+    m_flushScheduled = false;
+    if (m_committedChanges.isEmpty())
+        return;
+
+    const QVector<DbChange> changes = std::exchange(m_committedChanges, {});
+    DbTables tables;
+    for (const DbChange &change : changes)
+    {
+        tables |= change.table;
+    }
+
+    emit dataChanged(tables, changes);
+}
+
 bool DatabaseManager::createTables() const {
     QSqlQuery query(m_database);
 
@@ -201,6 +734,7 @@ bool DatabaseManager::createTables() const {
             id INTEGER PRIMARY KEY AUTOINCREMENT,
             name TEXT NOT NULL UNIQUE,
             start_date TEXT NOT NULL,
+            start_jd INTEGER,
             moon_illumination REAL,
             moon_ra REAL,
             moon_dec REAL,
@@ -243,6 +777,8 @@ bool DatabaseManager::createTables() const {
             camera_id INTEGER NOT NULL,
             telescope_id INTEGER NOT NULL,
             filter_id INTEGER NOT NULL,
+            start_jd INTEGER,
+            revision INTEGER,
             FOREIGN KEY(session_id) REFERENCES sessions(id),
             FOREIGN KEY(object_id) REFERENCES objects(id),
             FOREIGN KEY(camera_id) REFERENCES cameras(id),
@@ -257,6 +793,48 @@ bool DatabaseManager::createTables() const {
         return false;
     }
 
+    for (const char *indexSql : observationIndexSql)
+    {
+        if (!query.exec(indexSql))
+        {
+            qDebug() << "Failed to create observation indexes:" << query.lastError().text();
+            return false;
+        }
+    }
+
+    if (!query.exec(sessionStartJdIndexSql))
+    {
+        qDebug() << "Failed to create session date index:" << query.lastError().text();
+        return false;
+    }
+
+    for (const char *startJdSql : observationStartJdSql)
+    {
+        if (!query.exec(startJdSql))
+        {
+            qDebug() << "Failed to create observation date index:" << query.lastError().text();
+            return false;
+        }
+    }
+
+    for (const char *revisionSql : observationRevisionSql)
+    {
+        if (!query.exec(revisionSql))
+        {
+            qDebug() << "Failed to create observation revisions:" << query.lastError().text();
+            return false;
+        }
+    }
+
+    for (const char *searchSql : observationSearchSql)
+    {
+        if (!query.exec(searchSql))
+        {
+            qDebug() << "Failed to create observation search index:" << query.lastError().text();
+            return false;
+        }
+    }
+
     qDebug() << "All database tables created successfully";
     return true;
 }
@@ -281,6 +859,7 @@ std::expected<int, ER> DatabaseManager::getActualDbVersion() const {
 }
 
 std::expected<void, ER> DatabaseManager::runMigrations(const int fromVersion, const int toVersion) const {
+    TRACE_SPAN("DatabaseManager::runMigrations", "startup");
     const std::vector<std::vector<QString>> migrations = {
         {}, // index 0: no migration
         {}, // index 1: no migration (initial version)
@@ -303,26 +882,62 @@ std::expected<void, ER> DatabaseManager::runMigrations(const int fromVersion, co
             ON "objects" ("name", IFNULL("comments", ''));
             COMMIT;
             PRAGMA foreign_key_check;
-            PRAGMA foreign_keys = ON;)"}
+            PRAGMA foreign_keys = ON;)"},
+        std::vector<QString>(std::begin(observationIndexSql), std::end(observationIndexSql)),
+        std::vector<QString>(std::begin(observationSearchSql), std::end(observationSearchSql)),
+        {R"(ALTER TABLE sessions ADD COLUMN start_jd INTEGER)",
+         // julianday() counts from noon, the day number of a date is reached half a day after its midnight
+         R"(UPDATE sessions SET start_jd = CAST(julianday(start_date) + 0.5 AS INTEGER))",
+         sessionStartJdIndexSql,
+         // Created by version 4, replaced by the day number index
+         R"(DROP INDEX IF EXISTS "idx_sessions_start_date")"},
+        [] {
+            std::vector<QString> sql = {
+                R"(ALTER TABLE observations ADD COLUMN start_jd INTEGER)",
+                R"(UPDATE observations SET start_jd = (SELECT start_jd FROM sessions WHERE id = observations.session_id))"};
+            sql.insert(sql.end(), std::begin(observationStartJdSql), std::end(observationStartJdSql));
+            return sql;
+        }(),
+        [] {
+            // Rows of earlier versions keep a NULL revision until they are changed
+            std::vector<QString> sql = {R"(ALTER TABLE observations ADD COLUMN revision INTEGER)"};
+            sql.insert(sql.end(), std::begin(observationRevisionSql), std::end(observationRevisionSql));
+            return sql;
+        }()
             };
 
+    QSqlDatabase db = m_database;
     for (int v = fromVersion + 1; v <= toVersion; ++v) {
+        // Each version is committed together with its version number, so a failed step leaves the
+        // database at the previous version and the next start runs it again from the beginning.
+        // Version 3 switches foreign keys, which only works outside a transaction, and commits itself.
+        const bool ownTransaction = v == 3;
+        const auto fail = [&db, ownTransaction, v](const QString &errorMessage) {
+            if (!ownTransaction)
+                db.rollback();
+            return std::unexpected(ER::Critical(QString("Migration to version %1 failed: %2").arg(v).arg(errorMessage)));
+        };
+
+        if (!ownTransaction && !db.transaction()) {
+            return fail(db.lastError().text());
+        }
         for (const auto &sql: migrations[v]) {
-            auto statements = sql.split(";");
-            for (const auto &stmt: statements) {
-                if (stmt.length() == 0)
-                    continue;
-
-                if (QSqlQuery query(m_database); !query.exec(stmt)) {
-                    return std::unexpected(
-                        ER::Critical(
-                            QString("Migration to version %1 failed: %2")
-                            .arg(v)
-                            .arg(query.lastError().text())
-                        ));
+            for (const auto &stmt: splitSqlStatements(sql)) {
+                if (QSqlQuery query(db); !query.exec(stmt)) {
+                    return fail(query.lastError().text());
                 }
             }
         }
+
+        QSqlQuery versionQuery(db);
+        versionQuery.prepare(R"(UPDATE internal SET value = :version WHERE key = "DBVERSION")");
+        versionQuery.bindValue(":version", v);
+        if (!versionQuery.exec()) {
+            return fail(QString("Failed to update DB version: %1").arg(versionQuery.lastError().text()));
+        }
+        if (!ownTransaction && !db.commit()) {
+            return fail(db.lastError().text());
+        }
     }
     return {};
 }
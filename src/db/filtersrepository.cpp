@@ -1,5 +1,6 @@
 #include "db/filtersrepository.h"
 #include "db/databasemanager.h"
+#include "trace.h"
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QDebug>
@@ -10,6 +11,7 @@ FiltersRepository::FiltersRepository(DatabaseManager *dbManager, QObject *parent
 }
 
 std::expected<QVector<FilterData>, ER> FiltersRepository::getAllFilters() const {
+    TRACE_SPAN("FiltersRepository::getAllFilters", "query");
     QVector<FilterData> filters;
 
     QSqlQuery query(m_dbManager->database());
@@ -1,5 +1,6 @@
 #include "db/filtertypesrepository.h"
 #include "db/databasemanager.h"
+#include "trace.h"
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QDebug>
@@ -10,6 +11,7 @@ FilterTypesRepository::FilterTypesRepository(DatabaseManager *dbManager, QObject
 }
 
 std::expected<QVector<FilterTypeData>, ER> FilterTypesRepository::getAllFilterTypes() const {
+    TRACE_SPAN("FilterTypesRepository::getAllFilterTypes", "query");
     QVector<FilterTypeData> filterTypes;
 
     QSqlQuery query(m_dbManager->database());
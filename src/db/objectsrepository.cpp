@@ -1,5 +1,7 @@
 #include "db/objectsrepository.h"
 #include "db/databasemanager.h"
+#include "db/sqlstatement.h"
+#include "trace.h"
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QDebug>
@@ -10,26 +12,26 @@ ObjectsRepository::ObjectsRepository(DatabaseManager *dbManager, QObject *parent
 }
 
 std::expected<QVector<ObjectData>, ER> ObjectsRepository::getAllObjects() const {
+    TRACE_SPAN("ObjectsRepository::getAllObjects", "query");
     QVector<ObjectData> objects;
 
-    QSqlQuery query(m_dbManager->database());
-    query.prepare("SELECT id, name, ra, dec, comments FROM objects ORDER BY name");
+    SqlStatement stmt(m_dbManager, "SELECT id, name, ra, dec, comments FROM objects ORDER BY name");
 
-    if (!query.exec())
+    if (!stmt.exec())
     {
-        QString errorMessage = query.lastError().text();
+        QString errorMessage = stmt.lastError();
         qDebug() << "Failed to query objects:" << errorMessage;
         return std::unexpected(ER::Error(errorMessage));
     }
 
-    while (query.next())
+    while (stmt.next())
     {
         ObjectData obj;
-        obj.id = query.value(0).toInt();
-        obj.name = query.value(1).toString();
-        obj.ra = query.value(2);
-        obj.dec = query.value(3);
-        obj.comments = query.value(4).toString();
+        obj.id = stmt.toInt(0);
+        obj.name = stmt.toString(1);
+        obj.ra = stmt.toOptionalDouble(2);
+        obj.dec = stmt.toOptionalDouble(3);
+        obj.comments = stmt.toString(4);
         objects.append(obj);
     }
 
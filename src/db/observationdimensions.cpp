@@ -0,0 +1,102 @@
+#include "db/observationdimensions.h"
+#include "db/observationsrepository.h"
+extern "C"
+{
+#include "novas.h"
+}
+
+QString StringPool::intern(const QString &value)
+{
+    if (value.isEmpty())
+        return {};
+
+    const auto it = m_strings.constFind(value);
+    if (it != m_strings.cend())
+        return *it;
+
+    m_strings.insert(value);
+    return value;
+}
+
+QString ObjectDimension::displayName() const
+{
+    return comments.isEmpty() ? name : name + " / " + comments;
+}
+
+void ObservationDimensions::addSession(const int id, const SessionDimension &session)
+{
+    SessionDimension interned = session;
+    interned.name = m_strings.intern(session.name);
+    interned.date = m_strings.intern(session.date);
+    m_sessions.insert(id, interned);
+}
+
+void ObservationDimensions::addObject(const int id, const ObjectDimension &object)
+{
+    ObjectDimension interned = object;
+    interned.name = m_strings.intern(object.name);
+    interned.comments = m_strings.intern(object.comments);
+    m_objects.insert(id, interned);
+}
+
+void ObservationDimensions::addCamera(const int id, const QString &name)
+{
+    m_cameras.insert(id, m_strings.intern(name));
+}
+
+void ObservationDimensions::addTelescope(const int id, const QString &name)
+{
+    m_telescopes.insert(id, m_strings.intern(name));
+}
+
+void ObservationDimensions::addFilter(const int id, const QString &name)
+{
+    m_filters.insert(id, m_strings.intern(name));
+}
+
+const SessionDimension &ObservationDimensions::session(const int id) const
+{
+    static const SessionDimension unknown;
+    const auto it = m_sessions.constFind(id);
+    return it != m_sessions.cend() ? *it : unknown;
+}
+
+const ObjectDimension &ObservationDimensions::object(const int id) const
+{
+    static const ObjectDimension unknown;
+    const auto it = m_objects.constFind(id);
+    return it != m_objects.cend() ? *it : unknown;
+}
+
+QString ObservationDimensions::camera(const int id) const
+{
+    return m_cameras.value(id);
+}
+
+QString ObservationDimensions::telescope(const int id) const
+{
+    return m_telescopes.value(id);
+}
+
+QString ObservationDimensions::filter(const int id) const
+{
+    return m_filters.value(id);
+}
+
+double ObservationDimensions::angularSeparation(const ObservationData &obs) const
+{
+    const SessionDimension &sessionDim = session(obs.sessionId);
+    const ObjectDimension &objectDim = object(obs.objectId);
+    if (!objectDim.ra || !objectDim.dec || !sessionDim.moonRa || !sessionDim.moonDec)
+        return -1.0;
+
+    // Object RA is stored in hours, moon RA in degrees
+    return novas_sep(*objectDim.ra * 15.0, *objectDim.dec, *sessionDim.moonRa, *sessionDim.moonDec);
+}
+
+bool ObservationDimensions::contains(const ObservationData &obs) const
+{
+    return m_sessions.contains(obs.sessionId) && m_objects.contains(obs.objectId) &&
+           m_cameras.contains(obs.cameraId) && m_telescopes.contains(obs.telescopeId) &&
+           m_filters.contains(obs.filterId);
+}
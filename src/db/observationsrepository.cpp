@@ -1,166 +1,884 @@
 #include "db/observationsrepository.h"
 #include "db/databasemanager.h"
-extern "C"
-{
-#include "novas.h"
-}
+#include "db/sqlstatement.h"
+#include "trace.h"
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QVariant>
+#include <QStringList>
+#include <QRegularExpression>
+#include <algorithm>
+#include <cmath>
+#include <numbers>
 
 ObservationsRepository::ObservationsRepository(DatabaseManager *dbManager, QObject *parent)
     : QObject(parent), m_dbManager(dbManager)
 {
 }
 
-std::expected<QVector<ObservationData>, ER> ObservationsRepository::getAllObservations() const {
-    QVector<ObservationData> observations;
-
-    QSqlQuery query(m_dbManager->database());
-
-    // Join with related tables to get names and calculate angular separation
-    const QString sql = R"(
-        SELECT
-            o.id, o.image_count, o.exposure_length, o.total_exposure, o.comments,
-            o.session_id, o.object_id, o.camera_id, o.telescope_id, o.filter_id,
-            s.name AS session_name, s.start_date AS session_date,
-            obj.name AS object_name, obj.ra AS object_ra, obj.dec AS object_dec, obj.comments AS object_comments,
-            c.name AS camera_name,
-            t.name AS telescope_name,
-            f.name AS filter_name,
-            s.moon_illumination,
-            s.moon_ra, s.moon_dec
-        FROM observations o
+namespace
+{
+    // Joins of the referenced rows that filter conditions and sort expressions use
+    const QString observationJoinsSql = R"(
         INNER JOIN sessions s ON o.session_id = s.id
         INNER JOIN objects obj ON o.object_id = obj.id
         INNER JOIN cameras c ON o.camera_id = c.id
         INNER JOIN telescopes t ON o.telescope_id = t.id
         INNER JOIN filters f ON o.filter_id = f.id
-        ORDER BY s.start_date DESC, o.id DESC
     )";
 
-    if (!query.exec(sql))
+    // Shared select list of all observation queries. Only the observation columns are read,
+    // the joins are there for filtering and ordering by referenced rows.
+    const QString observationSelectSql = R"(
+        SELECT
+            o.id, o.image_count, o.exposure_length, o.total_exposure, o.comments,
+            o.session_id, o.object_id, o.camera_id, o.telescope_id, o.filter_id
+        FROM observations o
+    )" + observationJoinsSql;
+
+    // Maximum number of ids bound into a single IN (...) list
+    constexpr int maxIdsPerQuery = 500;
+
+    // Column ordinals of observationSelectSql, resolved once per statement
+    struct ObservationColumns
+    {
+        explicit ObservationColumns(const SqlStatement &stmt)
+            : id(stmt.columnIndex("id")), imageCount(stmt.columnIndex("image_count")),
+              exposureLength(stmt.columnIndex("exposure_length")), totalExposure(stmt.columnIndex("total_exposure")),
+              comments(stmt.columnIndex("comments")), sessionId(stmt.columnIndex("session_id")),
+              objectId(stmt.columnIndex("object_id")), cameraId(stmt.columnIndex("camera_id")),
+              telescopeId(stmt.columnIndex("telescope_id")), filterId(stmt.columnIndex("filter_id"))
+        {
+        }
+
+        int id, imageCount, exposureLength, totalExposure, comments;
+        int sessionId, objectId, cameraId, telescopeId, filterId;
+    };
+
+    ObservationData observationFromRow(const SqlStatement &stmt, const ObservationColumns &columns)
     {
-        QString errorMessage = QString("Query failed: %1").arg(query.lastError().text());
+        ObservationData obs;
+        obs.id = stmt.toInt(columns.id);
+        obs.imageCount = stmt.toInt(columns.imageCount);
+        obs.exposureLength = stmt.toInt(columns.exposureLength);
+        obs.totalExposure = stmt.toInt(columns.totalExposure);
+        obs.sessionId = stmt.toInt(columns.sessionId);
+        obs.objectId = stmt.toInt(columns.objectId);
+        obs.cameraId = stmt.toInt(columns.cameraId);
+        obs.telescopeId = stmt.toInt(columns.telescopeId);
+        obs.filterId = stmt.toInt(columns.filterId);
+        obs.comments = stmt.toString(columns.comments);
+        return obs;
+    }
+
+    // Executes a statement over observationSelectSql and appends all rows
+    std::expected<void, ER> readObservations(SqlStatement &stmt, QVector<ObservationData> &observations)
+    {
+        if (!stmt.exec())
+        {
+            QString errorMessage = QString("Query failed: %1").arg(stmt.lastError());
+            return std::unexpected(ER::Error(errorMessage));
+        }
+
+        const ObservationColumns columns(stmt);
+        while (stmt.next())
+        {
+            observations.append(observationFromRow(stmt, columns));
+        }
+
+        if (!stmt.lastError().isEmpty())
+        {
+            QString errorMessage = QString("Query failed: %1").arg(stmt.lastError());
+            return std::unexpected(ER::Error(errorMessage));
+        }
+        return {};
+    }
+
+    // First column of every row
+    std::expected<void, ER> readIds(SqlStatement &stmt, QSet<int> &ids)
+    {
+        if (!stmt.exec())
+        {
+            QString errorMessage = QString("Query failed: %1").arg(stmt.lastError());
+            return std::unexpected(ER::Error(errorMessage));
+        }
+
+        while (stmt.next())
+        {
+            ids.insert(stmt.toInt(0));
+        }
+
+        if (!stmt.lastError().isEmpty())
+        {
+            QString errorMessage = QString("Query failed: %1").arg(stmt.lastError());
+            return std::unexpected(ER::Error(errorMessage));
+        }
+        return {};
+    }
+
+    // Ids of the groupColumn of all observations whose idColumn is in ids, chunked like the other id lists
+    std::expected<QSet<int>, ER> readRelatedIds(DatabaseManager *dbManager, const char *groupColumn,
+                                                const char *idColumn, const QList<int> &ids)
+    {
+        QSet<int> related;
+        for (qsizetype first = 0; first < ids.size(); first += maxIdsPerQuery)
+        {
+            const qsizetype count = qMin<qsizetype>(maxIdsPerQuery, ids.size() - first);
+            SqlStatement stmt(dbManager, QString("SELECT DISTINCT %1 FROM observations WHERE %2 IN (%3)")
+                                             .arg(groupColumn, idColumn, QStringList(count, "?").join(',')));
+            for (qsizetype i = first; i < first + count; ++i)
+            {
+                stmt.addBindValue(ids[i]);
+            }
+            if (auto result = readIds(stmt, related); !result)
+            {
+                return std::unexpected(result.error());
+            }
+        }
+        return related;
+    }
+
+    const char *groupingColumn(const ObservationGrouping grouping)
+    {
+        return grouping == ObservationGrouping::Object ? "object_id" : "session_id";
+    }
+
+    // Spherical law of cosines on SQLite's built-in math functions, for connections without
+    // angular_separation(). Mirrored by plainAngularSeparation(), the two must compute the same
+    // value for keyset paging.
+    const QString plainSeparationSql = R"(degrees(acos(max(-1.0, min(1.0,
+        sin(radians(obj.dec)) * sin(radians(s.moon_dec)) +
+        cos(radians(obj.dec)) * cos(radians(s.moon_dec)) * cos(radians(obj.ra * 15.0 - s.moon_ra))))))";
+
+    double plainAngularSeparation(const ObservationData &obs, const ObservationDimensions &dimensions)
+    {
+        const SessionDimension &session = dimensions.session(obs.sessionId);
+        const ObjectDimension &object = dimensions.object(obs.objectId);
+        if (!object.ra || !object.dec || !session.moonRa || !session.moonDec)
+            return -1.0;
+
+        // Same steps as radians() and degrees() of SQLite
+        constexpr double toRadians = std::numbers::pi / 180.0;
+        constexpr double toDegrees = 180.0 / std::numbers::pi;
+        const double cosine = std::sin(*object.dec * toRadians) * std::sin(*session.moonDec * toRadians) +
+                              std::cos(*object.dec * toRadians) * std::cos(*session.moonDec * toRadians) *
+                                  std::cos((*object.ra * 15.0 - *session.moonRa) * toRadians);
+        return std::acos(std::max(-1.0, std::min(1.0, cosine))) * toDegrees;
+    }
+
+    // Moon angular separation of a row in SQL, NULL if a coordinate is missing. Empty if the
+    // connection can compute it neither way.
+    QString separationSql(const DatabaseManager *dbManager)
+    {
+        if (dbManager->hasSqlFunctions())
+            return "angular_separation(obj.ra, obj.dec, s.moon_ra, s.moon_dec)";
+        if (dbManager->hasMathFunctions())
+            return plainSeparationSql;
+        return {};
+    }
+
+    // ORDER BY expressions matching sortKey(). NULLs are mapped to the values the
+    // decoded dimensions carry so that keys from both sides compare equal.
+    QString sortExpression(const ObservationSortField field, const QString &separation)
+    {
+        switch (field)
+        {
+        case ObservationSortField::SessionName:
+            return "s.name";
+        case ObservationSortField::SessionDate:
+            return "o.start_jd";
+        case ObservationSortField::Object:
+            return "obj.name || IFNULL(NULLIF(' / ' || obj.comments, ' / '), '')";
+        case ObservationSortField::Camera:
+            return "c.name";
+        case ObservationSortField::Telescope:
+            return "t.name";
+        case ObservationSortField::Filter:
+            return "f.name";
+        case ObservationSortField::ImageCount:
+            return "o.image_count";
+        case ObservationSortField::ExposureLength:
+            return "o.exposure_length";
+        case ObservationSortField::TotalExposure:
+            return "o.total_exposure";
+        case ObservationSortField::MoonIllumination:
+            return "IFNULL(s.moon_illumination, 0.0)";
+        case ObservationSortField::AngularSeparation:
+            // Not offered for sorting when the separation cannot be computed, see hasAngularSeparation()
+            return separation.isEmpty() ? "-1.0" : QString("IFNULL(%1, -1.0)").arg(separation);
+        case ObservationSortField::Comments:
+            return "IFNULL(o.comments, '')";
+        }
+        return "o.id";
+    }
+
+    // WHERE conditions of a filter and their bind values in placeholder order. The SQL text only
+    // depends on which conditions are set and on the length of the id lists, so all filters of
+    // the same shape share one cached prepared statement.
+    struct FilterSql
+    {
+        QStringList conditions;
+        QVariantList bindValues;
+    };
+
+    void addIdCondition(FilterSql &filterSql, const QString &column, const QList<int> &ids)
+    {
+        if (ids.isEmpty())
+            return;
+
+        if (ids.size() == 1)
+            filterSql.conditions << QString("%1 = ?").arg(column);
+        else
+            filterSql.conditions << QString("%1 IN (%2)").arg(column, QStringList(ids.size(), "?").join(','));
+        for (const int id : ids)
+        {
+            filterSql.bindValues << id;
+        }
+    }
+
+    void addRangeCondition(FilterSql &filterSql, const QString &expression, const std::optional<double> &min,
+                           const std::optional<double> &max)
+    {
+        if (min)
+        {
+            filterSql.conditions << expression + " >= ?";
+            filterSql.bindValues << *min;
+        }
+        if (max)
+        {
+            filterSql.conditions << expression + " <= ?";
+            filterSql.bindValues << *max;
+        }
+    }
+
+    // FTS5 query for search box input: every word must match, each as a prefix so that results
+    // follow the typing. Words are quoted, FTS5 operators in the input have no effect.
+    QString searchMatchQuery(const QString &text)
+    {
+        static const QRegularExpression separators(R"([^\p{L}\p{N}]+)");
+
+        QStringList terms;
+        for (const QString &word : text.split(separators, Qt::SkipEmptyParts))
+        {
+            terms << QString("\"%1\"*").arg(word);
+        }
+        return terms.join(' ');
+    }
+
+    std::expected<FilterSql, ER> compileFilter(const ObservationFilter &filter, const QString &separation)
+    {
+        FilterSql filterSql;
+
+        // Id lists compare the indexed foreign key columns directly
+        addIdCondition(filterSql, "o.session_id", filter.sessionIds);
+        addIdCondition(filterSql, "o.object_id", filter.objectIds);
+        addIdCondition(filterSql, "o.camera_id", filter.cameraIds);
+        addIdCondition(filterSql, "o.telescope_id", filter.telescopeIds);
+        addIdCondition(filterSql, "o.filter_id", filter.filterIds);
+        addIdCondition(filterSql, "f.filter_type_id", filter.filterTypeIds);
+
+        // Day numbers copied onto the observations, a range scan on the same index as the date order
+        if (filter.fromDate.isValid())
+        {
+            filterSql.conditions << "o.start_jd >= ?";
+            filterSql.bindValues << filter.fromDate.toJulianDay();
+        }
+        if (filter.toDate.isValid())
+        {
+            filterSql.conditions << "o.start_jd <= ?";
+            filterSql.bindValues << filter.toDate.toJulianDay();
+        }
+
+        // Resolved through the full text index, the outer query only sees matching ids
+        if (const QString matchQuery = searchMatchQuery(filter.searchText); !matchQuery.isEmpty())
+        {
+            filterSql.conditions << "o.id IN (SELECT rowid FROM observation_search WHERE observation_search MATCH ?)";
+            filterSql.bindValues << matchQuery;
+        }
+
+        addRangeCondition(filterSql, "IFNULL(s.moon_illumination, 0.0)", filter.minMoonIllumination,
+                          filter.maxMoonIllumination);
+
+        if (filter.minAngularSeparation || filter.maxAngularSeparation)
+        {
+            if (separation.isEmpty())
+            {
+                return std::unexpected(ER::Error("Filtering by angular separation is not available with this SQLite library"));
+            }
+            // NULL for rows without coordinates, which fails every comparison
+            addRangeCondition(filterSql, separation, filter.minAngularSeparation, filter.maxAngularSeparation);
+        }
+
+        return filterSql;
+    }
+}
+
+std::expected<ObservationSet, ER> ObservationsRepository::getAllObservations() const {
+    return getObservations({});
+}
+
+std::expected<ObservationSet, ER> ObservationsRepository::getObservations(const ObservationFilter &filter) const {
+    TRACE_SPAN("ObservationsRepository::getObservations", "query");
+    auto dimensions = getDimensions();
+    if (!dimensions)
+    {
+        return std::unexpected(dimensions.error());
+    }
+
+    ObservationSet observations;
+    observations.dimensions = std::move(dimensions.value());
+
+    auto result = forEachObservation(filter, [&observations](const ObservationData &obs)
+    {
+        observations.rows.append(obs);
+        return true;
+    });
+    if (!result)
+    {
+        return std::unexpected(result.error());
+    }
+
+    return observations;
+}
+
+std::expected<bool, ER> ObservationsRepository::forEachObservation(
+    const ObservationFilter &filter, const std::function<bool(const ObservationData &)> &callback) const {
+    TRACE_SPAN("ObservationsRepository::forEachObservation", "query");
+    auto filterSql = compileFilter(filter, separationSql(m_dbManager));
+    if (!filterSql)
+    {
+        return std::unexpected(filterSql.error());
+    }
+
+    QString sql = observationSelectSql;
+    if (!filterSql->conditions.isEmpty())
+    {
+        sql += "WHERE " + filterSql->conditions.join(" AND ");
+    }
+    sql += " ORDER BY o.start_jd DESC, o.id DESC";
+
+    SqlStatement stmt(m_dbManager, sql);
+    for (const QVariant &value : std::as_const(filterSql->bindValues))
+    {
+        stmt.addBindValue(value);
+    }
+    if (!stmt.exec())
+    {
+        QString errorMessage = QString("Query failed: %1").arg(stmt.lastError());
         return std::unexpected(ER::Error(errorMessage));
     }
 
-    while (query.next())
+    // Rows are handed out one at a time straight from the cursor
+    const ObservationColumns columns(stmt);
+    while (stmt.next())
     {
-        ObservationData obs;
-        obs.id = query.value("id").toInt();
-        obs.imageCount = query.value("image_count").toInt();
-        obs.exposureLength = query.value("exposure_length").toInt();
-        obs.totalExposure = query.value("total_exposure").toInt();
-        obs.comments = query.value("comments").toString();
-        obs.sessionId = query.value("session_id").toInt();
-        obs.objectId = query.value("object_id").toInt();
-        obs.cameraId = query.value("camera_id").toInt();
-        obs.telescopeId = query.value("telescope_id").toInt();
-        obs.filterId = query.value("filter_id").toInt();
-        obs.sessionName = query.value("session_name").toString();
-        obs.sessionDate = query.value("session_date").toString();
-        obs.objectName = query.value("object_name").toString();
-        obs.objectComments = query.value("object_comments").toString();
-        obs.cameraName = query.value("camera_name").toString();
-        obs.telescopeName = query.value("telescope_name").toString();
-        obs.filterName = query.value("filter_name").toString();
-        obs.moonIllumination = query.value("moon_illumination").toDouble();
-
-        if (!query.value("object_ra").isNull() && !query.value("object_dec").isNull() &&
-            !query.value("moon_ra").isNull() && !query.value("moon_dec").isNull())
-        {
-            const double objRa = query.value("object_ra").toDouble(); // in hours
-            const double objDec = query.value("object_dec").toDouble();
-            const double moonRa = query.value("moon_ra").toDouble(); // in degrees
-            const double moonDec = query.value("moon_dec").toDouble();
-
-            const double separation = novas_sep(objRa * 15.0, objDec, moonRa, moonDec);
-            obs.angularSeparation = separation;
-        }
-
-        observations.append(obs);
+        if (!callback(observationFromRow(stmt, columns)))
+        {
+            return false;
+        }
+    }
+
+    if (!stmt.lastError().isEmpty())
+    {
+        QString errorMessage = QString("Query failed: %1").arg(stmt.lastError());
+        return std::unexpected(ER::Error(errorMessage));
+    }
+    return true;
+}
+
+std::expected<int, ER> ObservationsRepository::countObservations(const ObservationFilter &filter) const {
+    TRACE_SPAN("ObservationsRepository::countObservations", "query");
+    auto filterSql = compileFilter(filter, separationSql(m_dbManager));
+    if (!filterSql)
+    {
+        return std::unexpected(filterSql.error());
+    }
+
+    QString sql = "SELECT COUNT(*) FROM observations o" + observationJoinsSql;
+    if (!filterSql->conditions.isEmpty())
+    {
+        sql += "WHERE " + filterSql->conditions.join(" AND ");
+    }
+
+    SqlStatement stmt(m_dbManager, sql);
+    for (const QVariant &value : std::as_const(filterSql->bindValues))
+    {
+        stmt.addBindValue(value);
+    }
+    if (!stmt.exec() || !stmt.next())
+    {
+        QString errorMessage = QString("Query failed: %1").arg(stmt.lastError());
+        return std::unexpected(ER::Error(errorMessage));
+    }
+    return stmt.toInt(0);
+}
+
+std::expected<QVector<ObjectObservationCount>, ER> ObservationsRepository::countObservationsByObject(
+    const ObservationFilter &filter) const {
+    TRACE_SPAN("ObservationsRepository::countObservationsByObject", "query");
+    auto filterSql = compileFilter(filter, separationSql(m_dbManager));
+    if (!filterSql)
+    {
+        return std::unexpected(filterSql.error());
+    }
+
+    QString sql = "SELECT o.object_id, COUNT(*) FROM observations o" + observationJoinsSql;
+    if (!filterSql->conditions.isEmpty())
+    {
+        sql += "WHERE " + filterSql->conditions.join(" AND ");
+    }
+    sql += " GROUP BY o.object_id ORDER BY obj.name, o.object_id";
+
+    SqlStatement stmt(m_dbManager, sql);
+    for (const QVariant &value : std::as_const(filterSql->bindValues))
+    {
+        stmt.addBindValue(value);
+    }
+    if (!stmt.exec())
+    {
+        QString errorMessage = QString("Query failed: %1").arg(stmt.lastError());
+        return std::unexpected(ER::Error(errorMessage));
+    }
+
+    QVector<ObjectObservationCount> counts;
+    while (stmt.next())
+    {
+        counts.append({stmt.toInt(0), stmt.toInt(1)});
+    }
+    if (!stmt.lastError().isEmpty())
+    {
+        QString errorMessage = QString("Query failed: %1").arg(stmt.lastError());
+        return std::unexpected(ER::Error(errorMessage));
+    }
+    return counts;
+}
+
+std::expected<QSet<int>, ER> ObservationsRepository::getObservedObjectIds() const {
+    TRACE_SPAN("ObservationsRepository::getObservedObjectIds", "query");
+    // Answered from idx_observations_object alone
+    SqlStatement stmt(m_dbManager, "SELECT DISTINCT object_id FROM observations");
+    QSet<int> objectIds;
+    if (auto result = readIds(stmt, objectIds); !result)
+    {
+        return std::unexpected(result.error());
+    }
+    return objectIds;
+}
+
+std::expected<QSet<int>, ER> ObservationsRepository::getObservedObjectIds(const QList<int> &objectIds) const {
+    TRACE_SPAN("ObservationsRepository::getObservedObjectIds", "query");
+    QSet<int> observed;
+    for (qsizetype first = 0; first < objectIds.size(); first += maxIdsPerQuery)
+    {
+        const qsizetype count = qMin<qsizetype>(maxIdsPerQuery, objectIds.size() - first);
+        SqlStatement stmt(m_dbManager, QString(R"(
+            SELECT obj.id FROM objects obj
+            WHERE obj.id IN (%1) AND EXISTS (SELECT 1 FROM observations o WHERE o.object_id = obj.id)
+        )").arg(QStringList(count, "?").join(',')));
+        for (qsizetype i = first; i < first + count; ++i)
+        {
+            stmt.addBindValue(objectIds[i]);
+        }
+        if (auto result = readIds(stmt, observed); !result)
+        {
+            return std::unexpected(result.error());
+        }
+    }
+    return observed;
+}
+
+std::expected<QSet<int>, ER> ObservationsRepository::getObjectIdsOfObservations(const QList<int> &ids) const {
+    TRACE_SPAN("ObservationsRepository::getObjectIdsOfObservations", "query");
+    QSet<int> objectIds;
+    for (qsizetype first = 0; first < ids.size(); first += maxIdsPerQuery)
+    {
+        const qsizetype count = qMin<qsizetype>(maxIdsPerQuery, ids.size() - first);
+        SqlStatement stmt(m_dbManager, QString("SELECT DISTINCT object_id FROM observations WHERE id IN (%1)")
+                                           .arg(QStringList(count, "?").join(',')));
+        for (qsizetype i = first; i < first + count; ++i)
+        {
+            stmt.addBindValue(ids[i]);
+        }
+        if (auto result = readIds(stmt, objectIds); !result)
+        {
+            return std::unexpected(result.error());
+        }
+    }
+    return objectIds;
+}
+
+std::expected<QSet<int>, ER> ObservationsRepository::getObjectIdsOfSessions(const QList<int> &sessionIds) const {
+    TRACE_SPAN("ObservationsRepository::getObjectIdsOfSessions", "query");
+    return readRelatedIds(m_dbManager, "object_id", "session_id", sessionIds);
+}
+
+std::expected<QSet<int>, ER> ObservationsRepository::getSessionIdsOfObjects(const QList<int> &objectIds) const {
+    TRACE_SPAN("ObservationsRepository::getSessionIdsOfObjects", "query");
+    return readRelatedIds(m_dbManager, "session_id", "object_id", objectIds);
+}
+
+std::expected<QHash<int, ObservationAggregate>, ER> ObservationsRepository::getAggregates(
+    const ObservationGrouping grouping) const {
+    TRACE_SPAN("ObservationsRepository::getAggregates", "query");
+    // Walks the index of the grouping column, no row is decoded outside SQLite
+    SqlStatement stmt(m_dbManager, QString(R"(
+        SELECT %1, COUNT(*), SUM(total_exposure), MAX(id), MAX(revision), MAX(start_jd)
+        FROM observations GROUP BY %1
+    )").arg(groupingColumn(grouping)));
+    if (!stmt.exec())
+    {
+        QString errorMessage = QString("Query failed: %1").arg(stmt.lastError());
+        return std::unexpected(ER::Error(errorMessage));
+    }
+
+    QHash<int, ObservationAggregate> aggregates;
+    while (stmt.next())
+    {
+        ObservationAggregate &aggregate = aggregates[stmt.toInt(0)];
+        aggregate.observations = stmt.toInt(1);
+        aggregate.totalExposure = stmt.toInt64(2);
+        aggregate.maxId = stmt.toInt64(3);
+        aggregate.maxRevision = stmt.toInt64(4);
+        aggregate.lastJd = stmt.toInt64(5);
+    }
+    if (!stmt.lastError().isEmpty())
+    {
+        QString errorMessage = QString("Query failed: %1").arg(stmt.lastError());
+        return std::unexpected(ER::Error(errorMessage));
+    }
+    return aggregates;
+}
+
+std::expected<QHash<int, qint64>, ER> ObservationsRepository::getExposureByFilter(const ObservationGrouping grouping,
+                                                                                 const int id) const {
+    TRACE_SPAN("ObservationsRepository::getExposureByFilter", "query");
+    SqlStatement stmt(m_dbManager, QString("SELECT filter_id, SUM(total_exposure) FROM observations "
+                                           "WHERE %1 = ? GROUP BY filter_id").arg(groupingColumn(grouping)));
+    stmt.addBindValue(id);
+    if (!stmt.exec())
+    {
+        QString errorMessage = QString("Query failed: %1").arg(stmt.lastError());
+        return std::unexpected(ER::Error(errorMessage));
+    }
+
+    QHash<int, qint64> exposure;
+    while (stmt.next())
+    {
+        exposure.insert(stmt.toInt(0), stmt.toInt64(1));
+    }
+    if (!stmt.lastError().isEmpty())
+    {
+        QString errorMessage = QString("Query failed: %1").arg(stmt.lastError());
+        return std::unexpected(ER::Error(errorMessage));
+    }
+    return exposure;
+}
+
+std::expected<ObservationDimensions, ER> ObservationsRepository::getDimensions() const {
+    TRACE_SPAN("ObservationsRepository::getDimensions", "query");
+    ObservationDimensions dimensions;
+
+    SqlStatement sessions(m_dbManager, "SELECT id, name, start_date, start_jd, moon_illumination, moon_ra, moon_dec FROM sessions");
+    if (!sessions.exec())
+    {
+        QString errorMessage = QString("Query failed: %1").arg(sessions.lastError());
+        return std::unexpected(ER::Error(errorMessage));
+    }
+    while (sessions.next())
+    {
+        SessionDimension session;
+        session.name = sessions.toString(1);
+        session.date = sessions.toString(2);
+        session.startJd = sessions.toInt64(3);
+        session.moonIllumination = sessions.toDouble(4);
+        session.moonRa = sessions.toOptionalDouble(5);
+        session.moonDec = sessions.toOptionalDouble(6);
+        dimensions.addSession(sessions.toInt(0), session);
+    }
+
+    SqlStatement objects(m_dbManager, "SELECT id, name, comments, ra, dec FROM objects");
+    if (!objects.exec())
+    {
+        QString errorMessage = QString("Query failed: %1").arg(objects.lastError());
+        return std::unexpected(ER::Error(errorMessage));
+    }
+    while (objects.next())
+    {
+        ObjectDimension object;
+        object.name = objects.toString(1);
+        object.comments = objects.toString(2);
+        object.ra = objects.toOptionalDouble(3);
+        object.dec = objects.toOptionalDouble(4);
+        dimensions.addObject(objects.toInt(0), object);
+    }
+
+    // Equipment tables only contribute their names
+    const struct
+    {
+        const char *sql;
+        void (ObservationDimensions::*add)(int, const QString &);
+    } nameTables[] = {
+        {"SELECT id, name FROM cameras", &ObservationDimensions::addCamera},
+        {"SELECT id, name FROM telescopes", &ObservationDimensions::addTelescope},
+        {"SELECT id, name FROM filters", &ObservationDimensions::addFilter},
+    };
+    for (const auto &[sql, add] : nameTables)
+    {
+        SqlStatement stmt(m_dbManager, sql);
+        if (!stmt.exec())
+        {
+            QString errorMessage = QString("Query failed: %1").arg(stmt.lastError());
+            return std::unexpected(ER::Error(errorMessage));
+        }
+        while (stmt.next())
+        {
+            (dimensions.*add)(stmt.toInt(0), stmt.toString(1));
+        }
+    }
+
+    return dimensions;
+}
+
+std::expected<ObservationData, ER> ObservationsRepository::getObservationById(const int id) const {
+    TRACE_SPAN("ObservationsRepository::getObservationById", "query");
+    QVector<ObservationData> observations;
+
+    SqlStatement stmt(m_dbManager, observationSelectSql + "WHERE o.id = ?");
+    stmt.addBindValue(id);
+    if (auto result = readObservations(stmt, observations); !result)
+    {
+        return std::unexpected(result.error());
+    }
+
+    if (observations.isEmpty())
+    {
+        return std::unexpected(ER::Error(QString("Observation %1 not found").arg(id)));
+    }
+    return observations.first();
+}
+
+std::expected<QVector<ObservationData>, ER> ObservationsRepository::getObservationsByIds(const QList<int> &ids,
+                                                                                       const ObservationFilter &filter) const {
+    TRACE_SPAN("ObservationsRepository::getObservationsByIds", "query");
+    const auto filterSql = compileFilter(filter, separationSql(m_dbManager));
+    if (!filterSql)
+    {
+        return std::unexpected(filterSql.error());
+    }
+
+    QVector<ObservationData> observations;
+    observations.reserve(ids.size());
+
+    for (qsizetype first = 0; first < ids.size(); first += maxIdsPerQuery)
+    {
+        const qsizetype count = qMin<qsizetype>(maxIdsPerQuery, ids.size() - first);
+
+        QStringList conditions = filterSql->conditions;
+        conditions.prepend(QString("o.id IN (%1)").arg(QStringList(count, "?").join(',')));
+        SqlStatement stmt(m_dbManager, observationSelectSql + "WHERE " + conditions.join(" AND "));
+        for (qsizetype i = first; i < first + count; ++i)
+        {
+            stmt.addBindValue(ids[i]);
+        }
+        for (const QVariant &value : filterSql->bindValues)
+        {
+            stmt.addBindValue(value);
+        }
+
+        if (auto result = readObservations(stmt, observations); !result)
+        {
+            return std::unexpected(result.error());
+        }
     }
 
     return observations;
 }
 
-std::expected<QVector<ObservationData>, ER> ObservationsRepository::getObservationsByObject(int objectId) const {
+std::expected<QVector<ObservationData>, ER> ObservationsRepository::getObservationsPage(const ObservationPageQuery &pageQuery) const {
+    TRACE_SPAN("ObservationsRepository::getObservationsPage", "query");
     QVector<ObservationData> observations;
 
-    QSqlQuery query(m_dbManager->database());
+    const QString key = QString("(%1, o.id)").arg(sortExpression(pageQuery.sortField, separationSql(m_dbManager)));
+    const bool ascending = pageQuery.order == Qt::AscendingOrder;
 
-    const QString sql = R"(
-        SELECT
-            o.id, o.image_count, o.exposure_length, o.total_exposure, o.comments,
-            o.session_id, o.object_id, o.camera_id, o.telescope_id, o.filter_id,
-            s.name AS session_name, s.start_date AS session_date,
-            obj.name AS object_name, obj.ra AS object_ra, obj.dec AS object_dec, obj.comments AS object_comments,
-            c.name AS camera_name,
-            t.name AS telescope_name,
-            f.name AS filter_name,
-            s.moon_illumination,
-            s.moon_ra, s.moon_dec
-        FROM observations o
-        INNER JOIN sessions s ON o.session_id = s.id
-        INNER JOIN objects obj ON o.object_id = obj.id
-        INNER JOIN cameras c ON o.camera_id = c.id
-        INNER JOIN telescopes t ON o.telescope_id = t.id
-        INNER JOIN filters f ON o.filter_id = f.id
-        WHERE o.object_id = :objectId
-        ORDER BY s.start_date DESC, o.id DESC
-    )";
+    auto filterSql = compileFilter(pageQuery.filter, separationSql(m_dbManager));
+    if (!filterSql)
+    {
+        return std::unexpected(filterSql.error());
+    }
+    QStringList conditions = std::move(filterSql->conditions);
+    QVariantList bindValues = std::move(filterSql->bindValues);
+    if (pageQuery.after)
+    {
+        conditions << key + (ascending ? " > (?, ?)" : " < (?, ?)");
+        bindValues << pageQuery.after->value << pageQuery.after->id;
+    }
+    if (pageQuery.from && pageQuery.to)
+    {
+        const ObservationKey &low = ascending ? *pageQuery.from : *pageQuery.to;
+        const ObservationKey &high = ascending ? *pageQuery.to : *pageQuery.from;
+        conditions << key + " BETWEEN (?, ?) AND (?, ?)";
+        bindValues << low.value << low.id << high.value << high.id;
+    }
 
-    query.prepare(sql);
-    query.bindValue(":objectId", objectId);
+    QString sql = observationSelectSql;
+    if (!conditions.isEmpty())
+    {
+        sql += "WHERE " + conditions.join(" AND ");
+    }
+    const QString direction = ascending ? "ASC" : "DESC";
+    sql += QString(" ORDER BY %1 %2, o.id %2").arg(sortExpression(pageQuery.sortField, separationSql(m_dbManager)), direction);
+    if (pageQuery.limit >= 0)
+    {
+        sql += " LIMIT ?";
+        bindValues << pageQuery.limit;
+    }
 
-    if (!query.exec())
+    // Scrolling and reloading evicted pages repeat the same few statements
+    SqlStatement stmt(m_dbManager, sql, SqlStatement::Cached);
+    for (const QVariant &value : std::as_const(bindValues))
     {
-        QString errorMessage = QString("Query failed: %1").arg(query.lastError().text());
-        return std::unexpected(ER::Error(errorMessage));
+        stmt.addBindValue(value);
     }
 
-    while (query.next())
+    if (pageQuery.limit > 0)
     {
-        ObservationData obs;
-        obs.id = query.value("id").toInt();
-        obs.imageCount = query.value("image_count").toInt();
-        obs.exposureLength = query.value("exposure_length").toInt();
-        obs.totalExposure = query.value("total_exposure").toInt();
-        obs.comments = query.value("comments").toString();
-        obs.sessionId = query.value("session_id").toInt();
-        obs.objectId = query.value("object_id").toInt();
-        obs.cameraId = query.value("camera_id").toInt();
-        obs.telescopeId = query.value("telescope_id").toInt();
-        obs.filterId = query.value("filter_id").toInt();
-        obs.sessionName = query.value("session_name").toString();
-        obs.sessionDate = query.value("session_date").toString();
-        obs.objectName = query.value("object_name").toString();
-        obs.objectComments = query.value("object_comments").toString();
-        obs.cameraName = query.value("camera_name").toString();
-        obs.telescopeName = query.value("telescope_name").toString();
-        obs.filterName = query.value("filter_name").toString();
-        obs.moonIllumination = query.value("moon_illumination").toDouble();
-
-        // Calculate angular separation
-        if (!query.value("object_ra").isNull() && !query.value("object_dec").isNull() &&
-            !query.value("moon_ra").isNull() && !query.value("moon_dec").isNull())
-        {
-            const double objRa = query.value("object_ra").toDouble(); // in hours
-            const double objDec = query.value("object_dec").toDouble();
-            const double moonRa = query.value("moon_ra").toDouble(); // in degrees
-            const double moonDec = query.value("moon_dec").toDouble();
-
-            const double separation = novas_sep(objRa * 15.0, objDec, moonRa, moonDec);
-            obs.angularSeparation = separation;
-        }
-
-        observations.append(obs);
+        observations.reserve(pageQuery.limit);
+    }
+    if (auto result = readObservations(stmt, observations); !result)
+    {
+        return std::unexpected(result.error());
     }
 
     return observations;
 }
 
+std::expected<QVector<ObservationSearchHit>, ER> ObservationsRepository::searchObservations(const ObservationFilter &filter,
+                                                                                          const int limit) const {
+    TRACE_SPAN("ObservationsRepository::searchObservations", "query");
+    QVector<ObservationSearchHit> hits;
+    const QString matchQuery = searchMatchQuery(filter.searchText);
+    if (matchQuery.isEmpty())
+    {
+        return hits;
+    }
+
+    // The match is done on the index itself below, the remaining conditions narrow it down
+    ObservationFilter otherConditions = filter;
+    otherConditions.searchText.clear();
+    auto filterSql = compileFilter(otherConditions, separationSql(m_dbManager));
+    if (!filterSql)
+    {
+        return std::unexpected(filterSql.error());
+    }
+
+    // Matched terms are marked with control characters and turned into tags after escaping the text.
+    // Observation comments weigh more than the session and object comments shared by many rows.
+    QString sql = R"(
+        SELECT o.id, o.session_id, o.object_id,
+               snippet(observation_search, -1, char(1), char(2), '…', 12)
+        FROM observation_search
+        INNER JOIN observations o ON o.id = observation_search.rowid
+    )" + observationJoinsSql + "WHERE observation_search MATCH ?";
+    for (const QString &condition : std::as_const(filterSql->conditions))
+    {
+        sql += " AND " + condition;
+    }
+    sql += " ORDER BY bm25(observation_search, 2.0, 1.0, 1.0) LIMIT ?";
+
+    // Runs on every keystroke with the same text
+    SqlStatement stmt(m_dbManager, sql, SqlStatement::Cached);
+    stmt.addBindValue(matchQuery);
+    for (const QVariant &value : std::as_const(filterSql->bindValues))
+    {
+        stmt.addBindValue(value);
+    }
+    stmt.addBindValue(limit);
+
+    if (!stmt.exec())
+    {
+        QString errorMessage = QString("Search failed: %1").arg(stmt.lastError());
+        return std::unexpected(ER::Error(errorMessage));
+    }
+    while (stmt.next())
+    {
+        ObservationSearchHit hit;
+        hit.observationId = stmt.toInt(0);
+        hit.sessionId = stmt.toInt(1);
+        hit.objectId = stmt.toInt(2);
+        hit.snippet = stmt.toString(3).toHtmlEscaped().replace(QChar(1), "<b>").replace(QChar(2), "</b>");
+        hits.append(hit);
+    }
+    if (!stmt.lastError().isEmpty())
+    {
+        QString errorMessage = QString("Search failed: %1").arg(stmt.lastError());
+        return std::unexpected(ER::Error(errorMessage));
+    }
+
+    return hits;
+}
+
+bool ObservationsRepository::hasAngularSeparation() const
+{
+    return !separationSql(m_dbManager).isEmpty();
+}
+
+ObservationKey ObservationsRepository::sortKey(const ObservationData &obs, const ObservationDimensions &dimensions,
+                                              const ObservationSortField field) const
+{
+    switch (field)
+    {
+    case ObservationSortField::SessionName:
+        return {dimensions.session(obs.sessionId).name, obs.id};
+    case ObservationSortField::SessionDate:
+        return {dimensions.session(obs.sessionId).startJd, obs.id};
+    case ObservationSortField::Object:
+        return {dimensions.object(obs.objectId).displayName(), obs.id};
+    case ObservationSortField::Camera:
+        return {dimensions.camera(obs.cameraId), obs.id};
+    case ObservationSortField::Telescope:
+        return {dimensions.telescope(obs.telescopeId), obs.id};
+    case ObservationSortField::Filter:
+        return {dimensions.filter(obs.filterId), obs.id};
+    case ObservationSortField::ImageCount:
+        return {obs.imageCount, obs.id};
+    case ObservationSortField::ExposureLength:
+        return {obs.exposureLength, obs.id};
+    case ObservationSortField::TotalExposure:
+        return {obs.totalExposure, obs.id};
+    case ObservationSortField::MoonIllumination:
+        return {dimensions.session(obs.sessionId).moonIllumination, obs.id};
+    case ObservationSortField::AngularSeparation:
+        // Same constant as sortExpression() when SQL cannot compute the separation
+        if (!separationSql(m_dbManager))
+            return {-1.0, obs.id};
+        return {dimensions.angularSeparation(obs), obs.id};
+    case ObservationSortField::Comments:
+        return {obs.comments, obs.id};
+    }
+    return {obs.id, obs.id};
+}
+
+int ObservationsRepository::compareKeys(const ObservationKey &lhs, const ObservationKey &rhs)
+{
+    int result;
+    if (lhs.value.typeId() == QMetaType::QString || rhs.value.typeId() == QMetaType::QString)
+    {
+        // SQLite BINARY collation compares UTF-8 bytes, which matches UTF-16 code unit order for the BMP
+        result = QString::compare(lhs.value.toString(), rhs.value.toString(), Qt::CaseSensitive);
+    }
+    else
+    {
+        const double l = lhs.value.toDouble();
+        const double r = rhs.value.toDouble();
+        result = l < r ? -1 : (l > r ? 1 : 0);
+    }
+
+    if (result != 0)
+        return result;
+    return lhs.id < rhs.id ? -1 : (lhs.id > rhs.id ? 1 : 0);
+}
+
 std::expected<void, ER> ObservationsRepository::addObservation(int imageCount, int exposureLength, const QString &comments,
                                             int sessionId, int objectId, int cameraId, int telescopeId,
                                             int filterId) const {
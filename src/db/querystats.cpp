@@ -0,0 +1,79 @@
+#include "db/querystats.h"
+#include <algorithm>
+#include <cmath>
+
+void QueryStats::record(const char *sql, const qint64 nanoseconds, const qint64 rows)
+{
+    if (!sql)
+        return;
+
+    // Looked up without copying, the text is only copied the first time it runs
+    const QByteArray key = QByteArray::fromRawData(sql, qstrlen(sql));
+    auto it = m_entries.find(key);
+    if (it == m_entries.end())
+        it = m_entries.insert(QByteArray(sql), Entry());
+
+    Entry &entry = it.value();
+    ++entry.count;
+    entry.rows += rows;
+    entry.totalNs += nanoseconds;
+    entry.maxNs = std::max(entry.maxNs, nanoseconds);
+    ++entry.buckets[bucketIndex(nanoseconds)];
+}
+
+QVector<QueryStat> QueryStats::stats() const
+{
+    QVector<QueryStat> result;
+    result.reserve(m_entries.size());
+    for (auto it = m_entries.cbegin(); it != m_entries.cend(); ++it)
+    {
+        const Entry &entry = it.value();
+        QueryStat stat;
+        // Statements are written over several lines in the source
+        stat.sql = QString::fromUtf8(it.key()).simplified();
+        stat.count = entry.count;
+        stat.rows = entry.rows;
+        stat.p50Ms = std::min(percentileMs(entry, 0.50), entry.maxNs / 1e6);
+        stat.p99Ms = std::min(percentileMs(entry, 0.99), entry.maxNs / 1e6);
+        stat.maxMs = entry.maxNs / 1e6;
+        stat.totalMs = entry.totalNs / 1e6;
+        result.append(stat);
+    }
+    std::sort(result.begin(), result.end(), [](const QueryStat &a, const QueryStat &b)
+    {
+        return a.totalMs > b.totalMs;
+    });
+    return result;
+}
+
+void QueryStats::clear()
+{
+    m_entries.clear();
+}
+
+int QueryStats::bucketIndex(const qint64 nanoseconds)
+{
+    const double microseconds = nanoseconds / 1000.0;
+    if (microseconds <= 1.0)
+        return 0;
+    const int index = static_cast<int>(std::ceil(4.0 * std::log2(microseconds)));
+    return std::min(index, bucketCount - 1);
+}
+
+double QueryStats::bucketUpperMs(const int index)
+{
+    return std::exp2(index / 4.0) / 1000.0;
+}
+
+double QueryStats::percentileMs(const Entry &entry, const double fraction)
+{
+    const auto target = static_cast<qint64>(std::ceil(fraction * entry.count));
+    qint64 seen = 0;
+    for (int i = 0; i < bucketCount; ++i)
+    {
+        seen += entry.buckets[i];
+        if (seen >= target)
+            return bucketUpperMs(i);
+    }
+    return bucketUpperMs(bucketCount - 1);
+}
@@ -0,0 +1,151 @@
+#include "db/referencedatacache.h"
+#include "db/observationsrepository.h"
+#include "db/sqlstatement.h"
+
+namespace
+{
+    const char *itemsSql(const DbTable table)
+    {
+        switch (table)
+        {
+        case DbTable::Sessions:
+            return "SELECT id, name || ' (' || start_date || ')' FROM sessions ORDER BY start_jd DESC";
+        case DbTable::Objects:
+            return "SELECT id, name || IFNULL(NULLIF(' / ' || comments, ' / '), '') FROM objects ORDER BY name";
+        case DbTable::Cameras:
+            return "SELECT id, name FROM cameras ORDER BY name";
+        case DbTable::Telescopes:
+            return "SELECT id, name FROM telescopes ORDER BY name";
+        case DbTable::Filters:
+            return "SELECT f.id, f.name FROM filters f LEFT JOIN filter_types ft ON f.filter_type_id = ft.id "
+                   "ORDER BY ft.priority ASC, f.name ASC";
+        case DbTable::FilterTypes:
+            return "SELECT id, name FROM filter_types ORDER BY priority ASC, name ASC";
+        default:
+            return nullptr;
+        }
+    }
+
+    // Tables whose cached content depends on another table
+    DbTables withDependents(DbTables tables)
+    {
+        // Filters are ordered by the priority of their filter type
+        if (tables.testFlag(DbTable::FilterTypes))
+            tables |= DbTable::Filters;
+        return tables;
+    }
+
+    constexpr DbTables dimensionTables = DbTable::Sessions | DbTable::Objects | DbTable::Cameras |
+                                         DbTable::Telescopes | DbTable::Filters;
+}
+
+ReferenceDataCache::ReferenceDataCache(DatabaseManager *dbManager)
+    : QObject(dbManager), m_dbManager(dbManager)
+{
+    // Connected when DatabaseManager is constructed, so caches are dropped before any tab
+    // reacts to the same change
+    connect(m_dbManager, &DatabaseManager::dataChanged, this, [this](const DbTables tables)
+    {
+        invalidate(tables);
+    });
+}
+
+std::expected<QVector<ReferenceItem>, ER> ReferenceDataCache::items(const DbTable table)
+{
+    auto loaded = load(table);
+    if (!loaded)
+    {
+        return std::unexpected(loaded.error());
+    }
+    return loaded.value()->items;
+}
+
+QString ReferenceDataCache::name(const DbTable table, const int id)
+{
+    auto loaded = load(table);
+    if (!loaded)
+    {
+        return {};
+    }
+
+    const Table *cached = loaded.value();
+    const auto it = cached->indexById.constFind(id);
+    return it != cached->indexById.cend() ? cached->items[it.value()].name : QString();
+}
+
+std::expected<ObservationDimensions, ER> ReferenceDataCache::observationDimensions()
+{
+    if (!m_dimensions)
+    {
+        const ObservationsRepository repository(m_dbManager);
+        auto dimensions = repository.getDimensions();
+        if (!dimensions)
+        {
+            return std::unexpected(dimensions.error());
+        }
+        m_dimensions = std::move(dimensions.value());
+    }
+    return *m_dimensions;
+}
+
+void ReferenceDataCache::invalidate(DbTables tables)
+{
+    tables = withDependents(tables);
+
+    DbTables dropped;
+    for (auto it = m_tables.begin(); it != m_tables.end(); ++it)
+    {
+        if (tables.testFlag(static_cast<DbTable>(it.key())) && it->loaded)
+        {
+            *it = Table();
+            dropped |= static_cast<DbTable>(it.key());
+        }
+    }
+    if (m_dimensions && tables.testAnyFlags(dimensionTables))
+    {
+        m_dimensions.reset();
+        dropped |= tables & dimensionTables;
+    }
+
+    if (dropped.toInt() != 0)
+    {
+        emit invalidated(dropped);
+    }
+}
+
+std::expected<ReferenceDataCache::Table *, ER> ReferenceDataCache::load(const DbTable table)
+{
+    Table &cached = m_tables[static_cast<int>(table)];
+    if (cached.loaded)
+    {
+        return &cached;
+    }
+
+    const char *sql = itemsSql(table);
+    if (!sql)
+    {
+        return std::unexpected(ER::Error(QString("Table %1 is not a reference table").arg(static_cast<int>(table))));
+    }
+
+    SqlStatement stmt(m_dbManager, sql);
+    if (!stmt.exec())
+    {
+        QString errorMessage = QString("Query failed: %1").arg(stmt.lastError());
+        return std::unexpected(ER::Error(errorMessage));
+    }
+
+    QVector<ReferenceItem> items;
+    while (stmt.next())
+    {
+        items.append({stmt.toInt(0), stmt.toString(1)});
+    }
+
+    cached.items = std::move(items);
+    cached.indexById.reserve(cached.items.size());
+    for (qsizetype i = 0; i < cached.items.size(); ++i)
+    {
+        cached.indexById.insert(cached.items[i].id, i);
+    }
+    cached.loaded = true;
+    return &cached;
+}
@@ -1,5 +1,6 @@
 #include "db/sessionsrepository.h"
 #include "db/databasemanager.h"
+#include "trace.h"
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QDebug>
@@ -10,6 +11,7 @@ SessionsRepository::SessionsRepository(DatabaseManager *dbManager, QObject *pare
 }
 
 std::expected<QVector<SessionData>, ER> SessionsRepository::getAllSessions() const {
+    TRACE_SPAN("SessionsRepository::getAllSessions", "query");
     QVector<SessionData> sessions;
 
     QSqlQuery query(m_dbManager->database());
@@ -25,8 +27,8 @@ std::expected<QVector<SessionData>, ER> SessionsRepository::getAllSessions() con
             COALESCE(SUM(o.total_exposure) / 3600.0, 0) as exposure_total_hours
         FROM sessions s
         LEFT JOIN observations o ON s.id = o.session_id
-        GROUP BY s.id, s.name, s.start_date, s.moon_illumination, s.moon_ra, s.moon_dec, s.comments
-        ORDER BY s.start_date DESC
+        GROUP BY s.id
+        ORDER BY s.start_jd DESC
     )");
 
     if (!query.exec())
@@ -55,9 +57,10 @@ std::expected<QVector<SessionData>, ER> SessionsRepository::getAllSessions() con
 
 std::expected<void, ER> SessionsRepository::addSession(const QString &name, const QDate &startDate, const QString &comments, const double &moonIllumination, const double &moonRa, const double &moonDec) const {
     QSqlQuery query(m_dbManager->database());
-    query.prepare("INSERT INTO sessions (name, start_date, moon_illumination, moon_ra, moon_dec, comments) VALUES (:name, :start_date, :moon_illumination, :moon_ra, :moon_dec, :comments)");
+    query.prepare("INSERT INTO sessions (name, start_date, start_jd, moon_illumination, moon_ra, moon_dec, comments) VALUES (:name, :start_date, :start_jd, :moon_illumination, :moon_ra, :moon_dec, :comments)");
     query.bindValue(":name", name);
     query.bindValue(":start_date", startDate.toString(Qt::ISODate));
+    query.bindValue(":start_jd", startDate.toJulianDay());
     query.bindValue(":moon_illumination", moonIllumination);
     query.bindValue(":moon_ra", moonRa);
     query.bindValue(":moon_dec", moonDec);
@@ -75,9 +78,10 @@ std::expected<void, ER> SessionsRepository::addSession(const QString &name, cons
 
 std::expected<void, ER> SessionsRepository::updateSession(int id, const QString &name, const QDate &startDate, const QString &comments, const double &moonIllumination, const double &moonRa, const double &moonDec) const {
     QSqlQuery query(m_dbManager->database());
-    query.prepare("UPDATE sessions SET name = :name, start_date = :start_date, comments = :comments, moon_illumination = :moon_illumination, moon_ra = :moon_ra, moon_dec = :moon_dec WHERE id = :id");
+    query.prepare("UPDATE sessions SET name = :name, start_date = :start_date, start_jd = :start_jd, comments = :comments, moon_illumination = :moon_illumination, moon_ra = :moon_ra, moon_dec = :moon_dec WHERE id = :id");
     query.bindValue(":name", name);
     query.bindValue(":start_date", startDate.toString(Qt::ISODate));
+    query.bindValue(":start_jd", startDate.toJulianDay());
     query.bindValue(":moon_illumination", moonIllumination);
     query.bindValue(":moon_ra", moonRa);
     query.bindValue(":moon_dec", moonDec);
@@ -108,3 +112,21 @@ std::expected<void, ER> SessionsRepository::deleteSession(int id) const {
 
     return {};
 }
+
+std::expected<void, ER> SessionsRepository::updateMoonData(int id, double moonIllumination, double moonRa, double moonDec) const {
+    QSqlQuery query(m_dbManager->database());
+    query.prepare("UPDATE sessions SET moon_illumination = :moon_illumination, moon_ra = :moon_ra, moon_dec = :moon_dec WHERE id = :id");
+    query.bindValue(":moon_illumination", moonIllumination);
+    query.bindValue(":moon_ra", moonRa);
+    query.bindValue(":moon_dec", moonDec);
+    query.bindValue(":id", id);
+
+    if (!query.exec())
+    {
+        QString errorMessage = query.lastError().text();
+        qDebug() << "Failed to update session Moon data:" << errorMessage;
+        return std::unexpected(ER::Error(errorMessage));
+    }
+
+    return {};
+}
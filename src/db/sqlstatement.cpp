@@ -0,0 +1,293 @@
+#include "db/sqlstatement.h"
+#include "db/databasemanager.h"
+#include <QSqlError>
+#include <QSqlRecord>
+#include <cstring>
+#include <sqlite3.h>
+
+SqlStatement::SqlStatement(DatabaseManager *dbManager, const QString &sql, const Preparation preparation)
+    : m_dbManager(dbManager), m_stmt(nullptr), m_bindIndex(0), m_rowPending(false), m_fallbackRows(0)
+{
+    if (sqlite3 *handle = dbManager->statementHandle())
+    {
+        if (preparation == Cached)
+        {
+            m_sql = sql;
+            m_stmt = dbManager->takeCachedStatement(sql);
+            if (m_stmt)
+                return;
+        }
+
+        const QByteArray utf8 = sql.toUtf8();
+        if (sqlite3_prepare_v2(handle, utf8.constData(), static_cast<int>(utf8.size()), &m_stmt, nullptr) != SQLITE_OK)
+        {
+            m_error = QString::fromUtf8(sqlite3_errmsg(handle));
+            sqlite3_finalize(m_stmt);
+            m_stmt = nullptr;
+        }
+        return;
+    }
+
+    m_query.emplace(dbManager->database());
+    m_query->setForwardOnly(true);
+    if (!m_query->prepare(sql))
+    {
+        m_error = m_query->lastError().text();
+    }
+}
+
+SqlStatement::~SqlStatement()
+{
+    if (m_query)
+    {
+        recordFallbackStats();
+        return;
+    }
+    if (m_stmt && !m_sql.isEmpty())
+    {
+        // Hand back in the state a fresh statement has
+        sqlite3_reset(m_stmt);
+        sqlite3_clear_bindings(m_stmt);
+        m_dbManager->returnCachedStatement(m_sql, m_stmt);
+        return;
+    }
+    sqlite3_finalize(m_stmt);
+}
+
+void SqlStatement::addBindValue(const QVariant &value)
+{
+    if (m_query)
+    {
+        m_query->addBindValue(value);
+        return;
+    }
+    if (!m_stmt)
+        return;
+
+    const int index = ++m_bindIndex;
+    if (value.isNull())
+    {
+        sqlite3_bind_null(m_stmt, index);
+        return;
+    }
+
+    switch (value.typeId())
+    {
+    case QMetaType::Bool:
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::LongLong:
+    case QMetaType::ULongLong:
+        sqlite3_bind_int64(m_stmt, index, value.toLongLong());
+        break;
+    case QMetaType::Double:
+    case QMetaType::Float:
+        sqlite3_bind_double(m_stmt, index, value.toDouble());
+        break;
+    case QMetaType::QByteArray:
+    {
+        const QByteArray bytes = value.toByteArray();
+        sqlite3_bind_blob(m_stmt, index, bytes.constData(), static_cast<int>(bytes.size()), SQLITE_TRANSIENT);
+        break;
+    }
+    default:
+    {
+        const QByteArray utf8 = value.toString().toUtf8();
+        sqlite3_bind_text(m_stmt, index, utf8.constData(), static_cast<int>(utf8.size()), SQLITE_TRANSIENT);
+        break;
+    }
+    }
+}
+
+bool SqlStatement::exec()
+{
+    if (m_query)
+    {
+        // Timed like SQLite's profile: from the start of execution until the statement is done
+        recordFallbackStats(); // a previous execution that was not read to the end
+        m_fallbackTimer.start();
+        m_fallbackRows = 0;
+        if (!m_query->exec())
+        {
+            m_error = m_query->lastError().text();
+            recordFallbackStats();
+            return false;
+        }
+        return true;
+    }
+    if (!m_stmt)
+        return false;
+
+    // SQLite has no separate execute step, the first row is fetched here and handed out by next()
+    const int rc = sqlite3_step(m_stmt);
+    if (rc != SQLITE_ROW && rc != SQLITE_DONE)
+    {
+        m_error = QString::fromUtf8(sqlite3_errmsg(sqlite3_db_handle(m_stmt)));
+        sqlite3_reset(m_stmt);
+        return false;
+    }
+    m_rowPending = rc == SQLITE_ROW;
+    return true;
+}
+
+bool SqlStatement::next()
+{
+    if (m_query)
+    {
+        if (m_query->next())
+        {
+            ++m_fallbackRows;
+            return true;
+        }
+        recordFallbackStats();
+        return false;
+    }
+    if (!m_stmt)
+        return false;
+
+    if (m_rowPending)
+    {
+        m_rowPending = false;
+        return true;
+    }
+
+    switch (sqlite3_step(m_stmt))
+    {
+    case SQLITE_ROW:
+        return true;
+    case SQLITE_DONE:
+        // Release the read lock right away instead of on destruction
+        sqlite3_reset(m_stmt);
+        return false;
+    default:
+        m_error = QString::fromUtf8(sqlite3_errmsg(sqlite3_db_handle(m_stmt)));
+        sqlite3_reset(m_stmt);
+        return false;
+    }
+}
+
+void SqlStatement::recordFallbackStats()
+{
+    if (!m_fallbackTimer.isValid())
+        return;
+
+    const QByteArray sql = m_query->lastQuery().toUtf8();
+    m_dbManager->recordQueryStats(sql.constData(), m_fallbackTimer.nsecsElapsed(), m_fallbackRows);
+    m_fallbackTimer.invalidate();
+}
+
+QString SqlStatement::lastError() const
+{
+    return m_error;
+}
+
+int SqlStatement::columnIndex(const char *name) const
+{
+    if (m_query)
+        return m_query->record().indexOf(QString::fromLatin1(name));
+    if (!m_stmt)
+        return -1;
+
+    const int count = sqlite3_column_count(m_stmt);
+    for (int column = 0; column < count; ++column)
+    {
+        if (std::strcmp(sqlite3_column_name(m_stmt, column), name) == 0)
+            return column;
+    }
+    return -1;
+}
+
+int SqlStatement::columnCount() const
+{
+    if (m_query)
+        return m_query->record().count();
+    return m_stmt ? sqlite3_column_count(m_stmt) : 0;
+}
+
+QString SqlStatement::columnName(const int column) const
+{
+    if (m_query)
+        return m_query->record().fieldName(column);
+    return QString::fromUtf8(sqlite3_column_name(m_stmt, column));
+}
+
+bool SqlStatement::isNumeric(const int column) const
+{
+    if (m_query)
+    {
+        const QVariant value = m_query->value(column);
+        if (value.isNull())
+            return false;
+        switch (value.typeId())
+        {
+        case QMetaType::Int:
+        case QMetaType::LongLong:
+        case QMetaType::Double:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    const int type = sqlite3_column_type(m_stmt, column);
+    return type == SQLITE_INTEGER || type == SQLITE_FLOAT;
+}
+
+bool SqlStatement::isNull(const int column) const
+{
+    if (m_query)
+        return m_query->isNull(column);
+    return sqlite3_column_type(m_stmt, column) == SQLITE_NULL;
+}
+
+int SqlStatement::toInt(const int column) const
+{
+    if (m_query)
+        return m_query->value(column).toInt();
+    return sqlite3_column_int(m_stmt, column);
+}
+
+qint64 SqlStatement::toInt64(const int column) const
+{
+    if (m_query)
+        return m_query->value(column).toLongLong();
+    return sqlite3_column_int64(m_stmt, column);
+}
+
+double SqlStatement::toDouble(const int column) const
+{
+    if (m_query)
+        return m_query->value(column).toDouble();
+    return sqlite3_column_double(m_stmt, column);
+}
+
+std::optional<double> SqlStatement::toOptionalDouble(const int column) const
+{
+    if (isNull(column))
+        return std::nullopt;
+    return toDouble(column);
+}
+
+QString SqlStatement::toString(const int column) const
+{
+    if (m_query)
+        return m_query->value(column).toString();
+
+    const std::string_view utf8 = toUtf8(column);
+    return QString::fromUtf8(utf8.data(), static_cast<qsizetype>(utf8.size()));
+}
+
+std::string_view SqlStatement::toUtf8(const int column) const
+{
+    if (m_query)
+    {
+        m_utf8Buffer = m_query->value(column).toString().toUtf8();
+        return {m_utf8Buffer.constData(), static_cast<size_t>(m_utf8Buffer.size())};
+    }
+
+    // sqlite3_column_text() before sqlite3_column_bytes(), the text conversion may change the size
+    const auto *text = reinterpret_cast<const char *>(sqlite3_column_text(m_stmt, column));
+    if (!text)
+        return {};
+    return {text, static_cast<size_t>(sqlite3_column_bytes(m_stmt, column))};
+}
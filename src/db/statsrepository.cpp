@@ -0,0 +1,151 @@
+#include "db/statsrepository.h"
+#include "db/databasemanager.h"
+#include "trace.h"
+#include <QDebug>
+#include <QHash>
+#include <QSqlError>
+#include <QSqlQuery>
+
+StatsRepository::StatsRepository(DatabaseManager *dbManager, QObject *parent)
+    : QObject(parent), m_dbManager(dbManager)
+{
+}
+
+std::expected<QVector<MonthlyExposure>, ER> StatsRepository::getMonthlyExposure() const
+{
+    TRACE_SPAN("StatsRepository::getMonthlyExposure", "query");
+    QSqlQuery query(m_dbManager->database());
+
+    // Grouped by session day number so that SQLite walks the session date index in order
+    // instead of sorting computed month strings; days are folded into months below
+    query.prepare(R"(
+        SELECT
+            s.start_jd AS start_jd,
+            SUM(o.total_exposure) AS total_seconds
+        FROM sessions s
+        INNER JOIN observations o ON o.session_id = s.id
+        GROUP BY s.start_jd
+        ORDER BY s.start_jd ASC
+    )");
+
+    if (!query.exec())
+    {
+        QString errorMessage = query.lastError().text();
+        qDebug() << "Failed to query monthly stats:" << errorMessage;
+        return std::unexpected(ER::Error(errorMessage));
+    }
+
+    QVector<MonthlyExposure> months;
+    while (query.next())
+    {
+        const QDate day = QDate::fromJulianDay(query.value(0).toLongLong());
+        const QDate month(day.year(), day.month(), 1);
+        const qint64 totalSeconds = query.value(1).toLongLong();
+        if (!months.isEmpty() && months.last().month == month)
+            months.last().totalSeconds += totalSeconds;
+        else
+            months.append({month, totalSeconds});
+    }
+
+    return months;
+}
+
+std::expected<ObjectExposureTable, ER> StatsRepository::getObjectExposure() const
+{
+    TRACE_SPAN("StatsRepository::getObjectExposure", "query");
+    const QSqlDatabase &db = m_dbManager->database();
+    ObjectExposureTable table;
+
+    // First, get all filter types ordered by priority
+    QSqlQuery filterTypesQuery(db);
+    filterTypesQuery.prepare(R"(
+        SELECT id, name, priority
+        FROM filter_types
+        ORDER BY priority
+    )");
+
+    if (!filterTypesQuery.exec())
+    {
+        QString errorMessage = filterTypesQuery.lastError().text();
+        qDebug() << "Failed to fetch filter types:" << errorMessage;
+        return std::unexpected(ER::Error(errorMessage));
+    }
+
+    QHash<int, int> filterTypeColumns;
+    while (filterTypesQuery.next())
+    {
+        const int id = filterTypesQuery.value(0).toInt();
+        filterTypeColumns.insert(id, static_cast<int>(table.filterTypes.size()));
+        table.filterTypes.append({id, filterTypesQuery.value(1).toString(), filterTypesQuery.value(2).toInt()});
+    }
+
+    // Get all objects that have observations
+    QSqlQuery objectsQuery(db);
+    objectsQuery.prepare(R"(
+        SELECT DISTINCT o.id, o.name, o.comments
+        FROM objects o
+        INNER JOIN observations obs ON obs.object_id = o.id
+        ORDER BY o.name
+    )");
+
+    if (!objectsQuery.exec())
+    {
+        QString errorMessage = objectsQuery.lastError().text();
+        qDebug() << "Failed to fetch objects:" << errorMessage;
+        return std::unexpected(ER::Error(errorMessage));
+    }
+
+    QHash<int, int> objectRows;
+    while (objectsQuery.next())
+    {
+        ObjectExposure object;
+        object.objectId = objectsQuery.value(0).toInt();
+        object.name = objectsQuery.value(1).toString();
+        if (!objectsQuery.value(2).toString().isEmpty())
+            object.name.append(" / " + objectsQuery.value(2).toString());
+        object.seconds.fill(0, table.filterTypes.size());
+        object.totalSeconds = 0;
+        objectRows.insert(object.objectId, static_cast<int>(table.objects.size()));
+        table.objects.append(object);
+    }
+
+    if (table.objects.isEmpty() || table.filterTypes.isEmpty())
+    {
+        return table;
+    }
+
+    // Query exposure times grouped by object and filter type
+    QSqlQuery exposureQuery(db);
+    exposureQuery.prepare(R"(
+        SELECT
+            o.id as object_id,
+            ft.id as filter_type_id,
+            SUM(obs.total_exposure) as total_exposure
+        FROM observations obs
+        INNER JOIN objects o ON obs.object_id = o.id
+        INNER JOIN filters f ON obs.filter_id = f.id
+        INNER JOIN filter_types ft ON f.filter_type_id = ft.id
+        GROUP BY o.id, ft.id
+    )");
+
+    if (!exposureQuery.exec())
+    {
+        QString errorMessage = exposureQuery.lastError().text();
+        qDebug() << "Failed to fetch exposure data:" << errorMessage;
+        return std::unexpected(ER::Error(errorMessage));
+    }
+
+    while (exposureQuery.next())
+    {
+        const auto row = objectRows.constFind(exposureQuery.value(0).toInt());
+        const auto column = filterTypeColumns.constFind(exposureQuery.value(1).toInt());
+        if (row == objectRows.cend() || column == filterTypeColumns.cend())
+            continue;
+        ObjectExposure &object = table.objects[*row];
+        const qint64 seconds = exposureQuery.value(2).toLongLong();
+        object.seconds[*column] = seconds;
+        object.totalSeconds += seconds;
+    }
+
+    return table;
+}
@@ -1,5 +1,6 @@
 #include "db/telescopesrepository.h"
 #include "db/databasemanager.h"
+#include "trace.h"
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QDebug>
@@ -10,6 +11,7 @@ TelescopesRepository::TelescopesRepository(DatabaseManager *dbManager, QObject *
 }
 
 std::expected<QVector<TelescopeData>, ER> TelescopesRepository::getAllTelescopes() const {
+    TRACE_SPAN("TelescopesRepository::getAllTelescopes", "query");
     QVector<TelescopeData> telescopes;
 
     QSqlQuery query(m_dbManager->database());
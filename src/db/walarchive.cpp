@@ -0,0 +1,563 @@
+#include "db/walarchive.h"
+#include "db/backupstore.h"
+#include "db/databasemanager.h"
+#include "trace.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QTemporaryDir>
+#include <QTimeZone>
+#include <QTimer>
+#include <QtEndian>
+#include <algorithm>
+#include <sqlite3.h>
+
+namespace
+{
+    constexpr quint32 segmentMagic = 0x4F4C5741; // "OLWA"
+    constexpr quint16 segmentVersion = 2; // 2 added baseSha256
+    constexpr qint64 dbHeaderSize = 100;
+    constexpr qint64 walHeaderSize = 32;
+    constexpr qint64 frameHeaderSize = 24;
+    constexpr int archiveIntervalMs = 5 * 60 * 1000;
+
+    QString walDirectory(const QString &backupDirectory)
+    {
+        return QDir(backupDirectory).filePath("wal");
+    }
+
+    quint32 readBigEndian32(const char *data)
+    {
+        return qFromBigEndian<quint32>(data);
+    }
+
+    // Hash of a database file without its header. The change counter and version fields there
+    // differ between the live file and a backup copy of the same pages.
+    QByteArray contentHash(QFile &file)
+    {
+        QCryptographicHash hash(QCryptographicHash::Sha256);
+        if (!file.seek(dbHeaderSize) || !hash.addData(&file))
+            return {};
+        return hash.result();
+    }
+}
+
+WalArchiver::WalArchiver(DatabaseManager *dbManager, const QString &backupDirectory)
+    : QObject(dbManager), m_dbManager(dbManager), m_directory(walDirectory(backupDirectory)),
+      m_timer(new QTimer(this)), m_salt1(0), m_salt2(0), m_archivedFrames(0), m_installed(false),
+      m_archiveScheduled(false), m_sequence(0)
+{
+    m_writer.setMaxThreadCount(1);
+    m_timer->setInterval(archiveIntervalMs);
+    connect(m_timer, &QTimer::timeout, this, [this]
+    {
+        if (!m_commits.isEmpty())
+            archive();
+    });
+}
+
+WalArchiver::~WalArchiver()
+{
+    if (m_installed)
+    {
+        archive();
+        if (sqlite3 *handle = m_dbManager->nativeHandle())
+        {
+            // Back to SQLite's own checkpoints for the rest of the connection's life
+            sqlite3_wal_autocheckpoint(handle, checkpointFrames);
+        }
+    }
+    m_writer.waitForDone();
+}
+
+bool WalArchiver::install()
+{
+    sqlite3 *handle = m_dbManager->nativeHandle();
+    if (!handle || !QDir().mkpath(m_directory))
+    {
+        return false;
+    }
+
+    // Replaces the auto-checkpoint hook, from now on only archive() checkpoints
+    sqlite3_wal_hook(handle, &WalArchiver::walHook, this);
+    m_installed = true;
+    m_timer->start();
+    return true;
+}
+
+int WalArchiver::walHook(void *context, sqlite3 *, const char *dbName, const int frames)
+{
+    // Runs inside the commit: only note it, the connection must not be used here
+    if (qstrcmp(dbName, "main") != 0)
+        return SQLITE_OK;
+
+    auto *archiver = static_cast<WalArchiver *>(context);
+    archiver->m_commits.append({frames, QDateTime::currentMSecsSinceEpoch()});
+    if (frames >= checkpointFrames)
+        archiver->scheduleArchive();
+    return SQLITE_OK;
+}
+
+void WalArchiver::scheduleArchive()
+{
+    if (m_archiveScheduled)
+        return;
+
+    m_archiveScheduled = true;
+    QMetaObject::invokeMethod(this, &WalArchiver::archive, Qt::QueuedConnection);
+}
+
+void WalArchiver::archive()
+{
+    TRACE_SPAN("WalArchiver::archive", "backup");
+    m_archiveScheduled = false;
+    sqlite3 *handle = m_dbManager->nativeHandle();
+    if (!m_installed || !handle || m_commits.isEmpty())
+        return;
+
+    // Progress dialogs process events in the middle of long transactions; checkpointing
+    // needs the connection outside of one
+    if (!sqlite3_get_autocommit(handle))
+    {
+        m_archiveScheduled = true;
+        QTimer::singleShot(1000, this, &WalArchiver::archive);
+        return;
+    }
+
+    QFile wal(m_dbManager->databasePath() + "-wal");
+    if (!wal.open(QIODevice::ReadOnly))
+    {
+        qWarning() << "Failed to open WAL for archiving:" << wal.errorString();
+        return;
+    }
+    const QByteArray header = wal.read(walHeaderSize);
+    if (header.size() != walHeaderSize)
+    {
+        return;
+    }
+    const quint32 pageSize = readBigEndian32(header.constData() + 8);
+    const quint32 salt1 = readBigEndian32(header.constData() + 16);
+    const quint32 salt2 = readBigEndian32(header.constData() + 20);
+
+    // A new generation starts at its first frame
+    if (salt1 != m_salt1 || salt2 != m_salt2)
+    {
+        m_archivedFrames = 0;
+    }
+
+    WalSegment segment;
+    segment.pageSize = pageSize;
+    segment.salt1 = salt1;
+    segment.salt2 = salt2;
+    segment.firstFrame = m_archivedFrames;
+    for (const WalCommit &commit : std::as_const(m_commits))
+    {
+        // Commits reported before a WAL reset belong to frames archived already
+        if (commit.frames > m_archivedFrames && (segment.commits.isEmpty() || commit.frames > segment.commits.last().frames))
+            segment.commits.append(commit);
+    }
+    m_commits.clear();
+    if (segment.commits.isEmpty())
+    {
+        return;
+    }
+    segment.frameCount = segment.commits.last().frames - segment.firstFrame;
+
+    const qint64 frameSize = frameHeaderSize + pageSize;
+    QByteArray frames;
+    if (wal.seek(walHeaderSize + segment.firstFrame * frameSize))
+    {
+        frames = wal.read(segment.frameCount * frameSize);
+    }
+    if (frames.size() != segment.frameCount * frameSize)
+    {
+        qWarning() << "Failed to read WAL frames for archiving:" << wal.errorString();
+        return;
+    }
+    wal.close();
+
+    // Nothing has checkpointed into the database file since this generation started, so it is
+    // still the state the generation builds on. Restore compares it with its own replay of the
+    // generation before to find changes that were checkpointed without being archived.
+    if (segment.firstFrame == 0)
+    {
+        QFile database(m_dbManager->databasePath());
+        if (database.open(QIODevice::ReadOnly))
+            segment.baseSha256 = contentHash(database);
+    }
+
+    // Truncating restarts the WAL, the next frames start a new generation. Readers holding an
+    // older snapshot (running exports) can keep it from resetting; archiving then continues
+    // in the same generation after the frames taken now.
+    const int result = sqlite3_wal_checkpoint_v2(handle, "main", SQLITE_CHECKPOINT_TRUNCATE, nullptr, nullptr);
+    if (result == SQLITE_OK)
+    {
+        m_salt1 = m_salt2 = 0;
+        m_archivedFrames = 0;
+    }
+    else
+    {
+        m_salt1 = salt1;
+        m_salt2 = salt2;
+        m_archivedFrames = segment.firstFrame + segment.frameCount;
+    }
+
+    const QString path = QDir(m_directory).filePath(
+        QString("%1-%2.walseg")
+            .arg(QDateTime::fromMSecsSinceEpoch(segment.commits.last().msecs, QTimeZone::UTC).toString("yyyyMMdd-HHmmss-zzz"))
+            .arg(m_sequence++, 4, 10, QChar('0')));
+    m_writer.start([path, segment, frames]() mutable
+    {
+        segment.sha256 = QCryptographicHash::hash(frames, QCryptographicHash::Sha256);
+        segment.frames = qCompress(frames);
+
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly))
+        {
+            qWarning() << "Failed to write WAL segment:" << file.errorString();
+            return;
+        }
+        QDataStream stream(&file);
+        stream.setVersion(QDataStream::Qt_6_0);
+        stream << segmentMagic << segmentVersion << segment.pageSize << segment.salt1 << segment.salt2
+               << segment.firstFrame << segment.frameCount << qint32(segment.commits.size());
+        for (const WalCommit &commit : std::as_const(segment.commits))
+        {
+            stream << commit.frames << commit.msecs;
+        }
+        stream << segment.baseSha256 << segment.sha256 << segment.frames;
+        if (stream.status() != QDataStream::Ok || !file.commit())
+        {
+            qWarning() << "Failed to write WAL segment:" << file.errorString();
+        }
+    });
+}
+
+std::expected<WalSegment, ER> WalArchive::readSegment(const QString &path, const bool withFrames)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return std::unexpected(ER::Error(QString("Failed to open WAL segment %1: %2").arg(path, file.errorString())));
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+    quint32 magic;
+    quint16 version;
+    WalSegment segment;
+    qint32 commitCount;
+    stream >> magic >> version;
+    if (magic != segmentMagic || version < 1 || version > segmentVersion)
+    {
+        return std::unexpected(ER::Error(QString("%1 is not a WAL segment").arg(path)));
+    }
+    stream >> segment.pageSize >> segment.salt1 >> segment.salt2 >> segment.firstFrame >> segment.frameCount
+           >> commitCount;
+    for (qint32 i = 0; i < commitCount && stream.status() == QDataStream::Ok; ++i)
+    {
+        WalCommit commit;
+        stream >> commit.frames >> commit.msecs;
+        segment.commits.append(commit);
+    }
+    if (version >= 2)
+    {
+        stream >> segment.baseSha256;
+    }
+    stream >> segment.sha256;
+    if (withFrames)
+    {
+        stream >> segment.frames;
+    }
+    if (stream.status() != QDataStream::Ok)
+    {
+        return std::unexpected(ER::Error(QString("WAL segment %1 is truncated").arg(path)));
+    }
+
+    segment.fileName = QFileInfo(path).fileName();
+    return segment;
+}
+
+std::expected<QByteArray, ER> WalArchive::uncompressFrames(const WalSegment &segment)
+{
+    QByteArray frames = qUncompress(segment.frames);
+    if (frames.size() != segment.frameCount * (frameHeaderSize + segment.pageSize) ||
+        QCryptographicHash::hash(frames, QCryptographicHash::Sha256) != segment.sha256)
+    {
+        return std::unexpected(ER::Error(QString("WAL segment %1 is corrupt").arg(segment.fileName)));
+    }
+    return frames;
+}
+
+std::expected<QVector<WalSegment>, ER> WalArchive::segments(const QString &backupDirectory)
+{
+    // Names start with the time of the last commit, name order is archive order
+    const QDir dir(walDirectory(backupDirectory));
+    QVector<WalSegment> result;
+    for (const QString &name : dir.entryList({"*.walseg"}, QDir::Files, QDir::Name))
+    {
+        auto segment = readSegment(dir.filePath(name), false);
+        if (!segment)
+        {
+            return std::unexpected(segment.error());
+        }
+        result.append(std::move(segment.value()));
+    }
+    return result;
+}
+
+std::expected<WalRestoreReport, ER> WalArchive::restore(const QString &backupDirectory, const QDateTime &until,
+                                                        const QString &targetPath)
+{
+    TRACE_SPAN("WalArchive::restore", "backup");
+    BackupStore store(backupDirectory);
+    auto snapshots = store.snapshots();
+    if (!snapshots)
+    {
+        return std::unexpected(snapshots.error());
+    }
+    const auto base = std::find_if(snapshots->cbegin(), snapshots->cend(), [&until](const BackupSnapshot &snapshot)
+    {
+        return snapshot.created <= until;
+    });
+    if (base == snapshots->cend())
+    {
+        return std::unexpected(ER::Warning("There is no backup snapshot from before the chosen time"));
+    }
+
+    auto allSegments = segments(backupDirectory);
+    if (!allSegments)
+    {
+        return std::unexpected(allSegments.error());
+    }
+
+    // Built next to the target and moved over it once complete
+    const QString partialPath = targetPath + ".restoring";
+    QFile::remove(partialPath);
+    if (auto restored = store.restore(base->id, partialPath); !restored)
+    {
+        return std::unexpected(restored.error());
+    }
+
+    WalRestoreReport report;
+    report.snapshotId = base->id;
+    report.snapshotCreated = base->created;
+    report.restoredTo = base->created;
+    const auto fail = [&partialPath](const ER &error)
+    {
+        QFile::remove(partialPath);
+        return std::unexpected(error);
+    };
+
+    QFile database(partialPath);
+    if (!database.open(QIODevice::ReadWrite))
+    {
+        return fail(ER::Error(QString("Failed to open restored database: %1").arg(database.errorString())));
+    }
+
+    if (auto replayed = replay(backupDirectory, *allSegments, until, database, report); !replayed)
+    {
+        return fail(replayed.error());
+    }
+    database.close();
+
+    if (QFile::exists(targetPath) && !QFile::remove(targetPath))
+    {
+        return fail(ER::Error(QString("Failed to replace %1").arg(targetPath)));
+    }
+    if (!QFile::rename(partialPath, targetPath))
+    {
+        return fail(ER::Error(QString("Failed to write %1").arg(targetPath)));
+    }
+    return report;
+}
+
+std::expected<void, ER> WalArchive::replay(const QString &backupDirectory, const QVector<WalSegment> &segments,
+                                           const QDateTime &until, QFile &database, WalRestoreReport &report)
+{
+    // Commits from before the snapshot are in it already; a segment that also has later
+    // ones is replayed from its start, the later frames overwrite the older page versions
+    const qint64 baseMsecs = report.snapshotCreated.toMSecsSinceEpoch();
+    const qint64 untilMsecs = until.toMSecsSinceEpoch();
+    quint32 lastDbPages = 0;
+    const WalSegment *previous = nullptr;
+    for (const WalSegment &header : segments)
+    {
+        if (header.lastCommitMsecs() < baseMsecs)
+            continue;
+
+        // Last commit to replay in this segment
+        qsizetype lastCommit = -1;
+        for (qsizetype i = 0; i < header.commits.size() && header.commits[i].msecs <= untilMsecs; ++i)
+            lastCommit = i;
+        if (lastCommit < 0)
+            break;
+
+        if (previous)
+        {
+            // Within a generation segments follow each other; after a restart of the application
+            // the generation is archived again from its first frame, which is harmless. A new
+            // generation must start from the state the replay has reached.
+            bool continuous = true;
+            if (previous->salt1 == header.salt1 && previous->salt2 == header.salt2)
+            {
+                continuous = header.firstFrame <= previous->firstFrame + previous->frameCount;
+            }
+            else if (header.firstFrame != 0)
+            {
+                continuous = false;
+            }
+            else if (!header.baseSha256.isEmpty())
+            {
+                if (lastDbPages != 0 && !database.resize(qint64(lastDbPages) * previous->pageSize))
+                {
+                    return std::unexpected(ER::Error(QString("Failed to write restored database: %1").arg(database.errorString())));
+                }
+                continuous = contentHash(database) == header.baseSha256;
+            }
+            if (!continuous)
+            {
+                report.breakBefore = header.fileName;
+                break;
+            }
+        }
+
+        auto segment = readSegment(QDir(walDirectory(backupDirectory)).filePath(header.fileName), true);
+        if (!segment)
+        {
+            return std::unexpected(segment.error());
+        }
+        auto frames = uncompressFrames(*segment);
+        if (!frames)
+        {
+            return std::unexpected(frames.error());
+        }
+
+        const qint64 frameSize = frameHeaderSize + segment->pageSize;
+        const qint32 frameCount = segment->commits[lastCommit].frames - segment->firstFrame;
+        for (qint32 frame = 0; frame < frameCount; ++frame)
+        {
+            const char *frameData = frames->constData() + frame * frameSize;
+            const quint32 pageNumber = readBigEndian32(frameData);
+            if (const quint32 dbPages = readBigEndian32(frameData + 4); dbPages != 0)
+                lastDbPages = dbPages; // commit frame, database size after the commit
+
+            if (!database.seek(qint64(pageNumber - 1) * segment->pageSize) ||
+                database.write(frameData + frameHeaderSize, segment->pageSize) != qint64(segment->pageSize))
+            {
+                return std::unexpected(ER::Error(QString("Failed to write restored database: %1").arg(database.errorString())));
+            }
+        }
+
+        ++report.segments;
+        report.restoredTo = QDateTime::fromMSecsSinceEpoch(segment->commits[lastCommit].msecs, QTimeZone::UTC);
+        previous = &header;
+        if (lastCommit < segment->commits.size() - 1)
+            break; // the rest is after until
+    }
+
+    if (lastDbPages != 0 && previous && !database.resize(qint64(lastDbPages) * previous->pageSize))
+    {
+        return std::unexpected(ER::Error(QString("Failed to write restored database: %1").arg(database.errorString())));
+    }
+    return {};
+}
+
+QStringList WalArchive::verify(const QString &backupDirectory)
+{
+    QStringList problems;
+    auto allSegments = segments(backupDirectory);
+    if (!allSegments)
+    {
+        return {allSegments.error().errorMessage};
+    }
+
+    const WalSegment *previous = nullptr;
+    for (const WalSegment &header : std::as_const(*allSegments))
+    {
+        if (previous && previous->salt1 == header.salt1 && previous->salt2 == header.salt2 &&
+            previous->firstFrame + previous->frameCount < header.firstFrame)
+        {
+            problems.append(QString("WAL archive has a gap before %1").arg(header.fileName));
+        }
+        previous = &header;
+
+        auto segment = readSegment(QDir(walDirectory(backupDirectory)).filePath(header.fileName), true);
+        if (!segment)
+        {
+            problems.append(segment.error().errorMessage);
+        }
+        else if (auto frames = uncompressFrames(*segment); !frames)
+        {
+            problems.append(frames.error().errorMessage);
+        }
+    }
+
+    // Breaks between generations only show in the replayed pages
+    BackupStore store(backupDirectory);
+    auto snapshots = store.snapshots();
+    if (!snapshots)
+    {
+        problems.append(snapshots.error().errorMessage);
+        return problems;
+    }
+    if (snapshots->isEmpty() || allSegments->isEmpty())
+    {
+        return problems;
+    }
+    const QTemporaryDir scratch;
+    if (!scratch.isValid())
+    {
+        problems.append(QString("Failed to create a temporary directory: %1").arg(scratch.errorString()));
+        return problems;
+    }
+    const QString scratchPath = scratch.filePath("verify.db");
+    if (auto restored = store.restore(snapshots->last().id, scratchPath); !restored)
+    {
+        problems.append(restored.error().errorMessage);
+        return problems;
+    }
+    QFile database(scratchPath);
+    if (!database.open(QIODevice::ReadWrite))
+    {
+        problems.append(QString("Failed to open restored database: %1").arg(database.errorString()));
+        return problems;
+    }
+    WalRestoreReport report;
+    report.snapshotCreated = snapshots->last().created;
+    const QDateTime lastCommit = QDateTime::fromMSecsSinceEpoch(allSegments->last().lastCommitMsecs(), QTimeZone::UTC);
+    if (auto replayed = replay(backupDirectory, *allSegments, lastCommit, database, report); !replayed)
+    {
+        problems.append(replayed.error().errorMessage);
+    }
+    else if (!report.breakBefore.isEmpty())
+    {
+        problems.append(QString("WAL archive is not continuous before %1, changes made while nothing archived the WAL "
+                                "(obslog-cli with the application closed, another SQLite tool) are missing")
+                            .arg(report.breakBefore));
+    }
+    return problems;
+}
+
+int WalArchive::prune(const QString &backupDirectory, const QDateTime &before)
+{
+    auto allSegments = segments(backupDirectory);
+    if (!allSegments)
+    {
+        return 0;
+    }
+
+    int removed = 0;
+    const qint64 beforeMsecs = before.toMSecsSinceEpoch();
+    const QDir dir(walDirectory(backupDirectory));
+    for (const WalSegment &segment : std::as_const(*allSegments))
+    {
+        if (segment.lastCommitMsecs() < beforeMsecs && QFile::remove(dir.filePath(segment.fileName)))
+            ++removed;
+    }
+    return removed;
+}
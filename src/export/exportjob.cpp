@@ -0,0 +1,82 @@
+#include "export/exportjob.h"
+#include "db/databasemanager.h"
+#include "trace.h"
+#include <QElapsedTimer>
+#include <QThread>
+
+ExportJob::ExportJob(const QString &dbPath, Task task, QObject *parent)
+    : QObject(parent), m_dbPath(dbPath), m_task(std::move(task)), m_thread(nullptr), m_cancelRequested(false)
+{
+}
+
+ExportJob::~ExportJob()
+{
+    if (m_thread)
+    {
+        cancel();
+        m_thread->wait();
+    }
+}
+
+void ExportJob::start()
+{
+    if (m_thread)
+        return;
+
+    m_thread = QThread::create([this] { run(); });
+    m_thread->setParent(this);
+    m_thread->start(QThread::LowPriority);
+}
+
+void ExportJob::cancel()
+{
+    m_cancelRequested = true;
+}
+
+bool ExportJob::isRunning() const
+{
+    return m_thread && m_thread->isRunning();
+}
+
+void ExportJob::run()
+{
+    TRACE_SPAN("ExportJob::run", "export");
+    // Lives on the worker thread together with its connection
+    DatabaseManager snapshot;
+    if (auto opened = snapshot.openSnapshot(m_dbPath); !opened)
+    {
+        emit failed(opened.error().errorMessage);
+        return;
+    }
+
+    QElapsedTimer elapsed;
+    elapsed.start();
+    qint64 lastReport = -1;
+    const ExportProgress progress = [&](const int exportedRows, const int totalRows)
+    {
+        if (m_cancelRequested)
+            return false;
+
+        const qint64 now = elapsed.elapsed();
+        if (lastReport < 0 || now - lastReport >= 100 || exportedRows == totalRows)
+        {
+            lastReport = now;
+            emit progressChanged(exportedRows, totalRows, now > 0 ? exportedRows * 1000.0 / now : 0.0);
+        }
+        return true;
+    };
+
+    const auto result = m_task(&snapshot, progress);
+    if (!result && m_cancelRequested)
+    {
+        emit cancelled();
+    }
+    else if (!result)
+    {
+        emit failed(result.error().errorMessage);
+    }
+    else
+    {
+        emit succeeded(result.value(), elapsed.elapsed() / 1000.0);
+    }
+}
@@ -0,0 +1,27 @@
+#include "export/exportprogressdialog.h"
+#include "export/exportjob.h"
+
+ExportProgressDialog::ExportProgressDialog(ExportJob *job, const QString &title, QWidget *parent)
+    : QProgressDialog("Preparing export...", "Cancel", 0, 0, parent), m_itemName("rows")
+{
+    setWindowTitle(title);
+    // Not modal, the application can be used while the export runs
+    setWindowModality(Qt::NonModal);
+    setMinimumDuration(500);
+    setAutoClose(false);
+    setAutoReset(false);
+    connect(this, &QProgressDialog::canceled, job, &ExportJob::cancel);
+
+    connect(job, &ExportJob::progressChanged, this,
+            [this](const int exportedRows, const int totalRows, const double rowsPerSecond)
+    {
+        setMaximum(totalRows);
+        setValue(exportedRows);
+        setLabelText(QString("Exported %L1 of %L2 %3 (%L4 %3/s)")
+                         .arg(exportedRows).arg(totalRows).arg(m_itemName).arg(rowsPerSecond, 0, 'f', 0));
+    });
+    connect(job, &ExportJob::succeeded, this, &QObject::deleteLater);
+    connect(job, &ExportJob::failed, this, &QObject::deleteLater);
+    connect(job, &ExportJob::cancelled, this, &QObject::deleteLater);
+    connect(job, &QObject::destroyed, this, &QObject::deleteLater);
+}
@@ -0,0 +1,38 @@
+#include "export/htmltemplate.h"
+#include <QFile>
+#include <QRegularExpression>
+
+HtmlTemplate HtmlTemplate::parse(const QString &content)
+{
+    static const QRegularExpression placeholderPattern(R"(\{\{(\w+)\}\})");
+
+    HtmlTemplate parsed;
+    qsizetype literalStart = 0;
+    auto placeholders = placeholderPattern.globalMatch(content);
+    while (placeholders.hasNext())
+    {
+        const auto placeholder = placeholders.next();
+        if (placeholder.capturedStart() > literalStart)
+        {
+            parsed.m_segments.append(
+                {QStringView(content).mid(literalStart, placeholder.capturedStart() - literalStart).toUtf8(), {}});
+        }
+        parsed.m_segments.append({{}, placeholder.captured(1)});
+        literalStart = placeholder.capturedEnd();
+    }
+    if (literalStart < content.size())
+    {
+        parsed.m_segments.append({QStringView(content).mid(literalStart).toUtf8(), {}});
+    }
+    return parsed;
+}
+
+std::expected<HtmlTemplate, ER> HtmlTemplate::fromFile(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        return std::unexpected(ER::Error("Failed to open template file: " + file.errorString()));
+    }
+    return parse(QString::fromUtf8(file.readAll()));
+}
@@ -0,0 +1,175 @@
+#include "export/observationexcelexporter.h"
+#include "export/xlsxwriter.h"
+#include "trace.h"
+#include <QDateTime>
+#include <QHash>
+
+namespace
+{
+    const QList<double> columnWidths = {
+        20, // Session Name
+        12, // Date
+        20, // Object
+        15, // Camera
+        15, // Telescope
+        12, // Filter
+        10, // Images
+        14, // Exposure
+        18, // Total Exposure
+        16, // Moon Phase
+        18, // Angular Separation
+        30, // Comments
+    };
+
+    // Shared string indexes of dimension names, looked up once per id instead of once per row
+    class SharedNames
+    {
+    public:
+        int get(XlsxWriter &xlsx, const int id, const QString &name)
+        {
+            auto it = m_indexes.constFind(id);
+            if (it == m_indexes.cend())
+                it = m_indexes.insert(id, xlsx.sharedString(name));
+            return it.value();
+        }
+
+    private:
+        QHash<int, int> m_indexes;
+    };
+}
+
+ObservationExcelExporter::ObservationExcelExporter(DatabaseManager *dbManager)
+    : m_dbManager(dbManager)
+{
+}
+
+std::expected<int, ER> ObservationExcelExporter::exportToFile(const QString &fileName,
+                                                              const ObservationExcelExportOptions &options,
+                                                              const ExportProgress &progress) const
+{
+    TRACE_SPAN("ObservationExcelExporter::exportToFile", "export");
+    const ObservationsRepository repository(m_dbManager);
+    auto dimensionsResult = repository.getDimensions();
+    if (!dimensionsResult)
+    {
+        return std::unexpected(dimensionsResult.error());
+    }
+    const ObservationDimensions &dimensions = dimensionsResult.value();
+
+    // One sheet per object, or a single sheet that is filtered like the table
+    struct SheetSpec
+    {
+        QString name;
+        ObservationFilter filter;
+        int rowCount;
+    };
+    QVector<SheetSpec> sheets;
+    int totalRecords = 0;
+    if (options.sheetPerObject)
+    {
+        auto counts = repository.countObservationsByObject(options.filter);
+        if (!counts)
+        {
+            return std::unexpected(counts.error());
+        }
+        for (const ObjectObservationCount &count : counts.value())
+        {
+            ObservationFilter objectFilter = options.filter;
+            objectFilter.objectIds = {count.objectId};
+            sheets.append({dimensions.object(count.objectId).name, objectFilter, count.observationCount});
+            totalRecords += count.observationCount;
+        }
+    }
+    else
+    {
+        auto count = repository.countObservations(options.filter);
+        if (!count)
+        {
+            return std::unexpected(count.error());
+        }
+        sheets.append({"Observations", options.filter, count.value()});
+        totalRecords = count.value();
+    }
+
+    const QString exportDateTime = QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss");
+    XlsxWriter xlsx(fileName);
+    SharedNames sessionNames, sessionDates, objectNames, cameraNames, telescopeNames, filterNames;
+    int exportedRows = 0;
+
+    for (const SheetSpec &sheet : sheets)
+    {
+        xlsx.beginSheet(sheet.name, columnWidths);
+
+        // Export information at the top
+        xlsx.beginRow(1);
+        xlsx.addString(u"Observations Export");
+        xlsx.endRow();
+        xlsx.beginRow(2);
+        xlsx.addString(QString("Filter: " + options.filterDescription));
+        xlsx.endRow();
+        xlsx.beginRow(3);
+        xlsx.addString(QString("Export Date: " + exportDateTime));
+        xlsx.endRow();
+        xlsx.beginRow(4);
+        xlsx.addString(QString("Total Records: %1").arg(sheet.rowCount));
+        xlsx.endRow();
+
+        // Header row (row 6)
+        constexpr int headerRow = 6;
+        xlsx.beginRow(headerRow);
+        for (const char16_t *header : {u"Session Name", u"Date", u"Object", u"Camera", u"Telescope", u"Filter",
+                                       u"Images", u"Exposure (s)", u"Total Exposure (s)", u"Moon Phase (%)",
+                                       u"Angular Separation", u"Comments"})
+        {
+            xlsx.addString(header);
+        }
+        xlsx.endRow();
+
+        // Data rows
+        int currentRow = headerRow + 1;
+        auto result = repository.forEachObservation(sheet.filter, [&](const ObservationData &obs)
+        {
+            const SessionDimension &session = dimensions.session(obs.sessionId);
+            const double angularSeparation = dimensions.angularSeparation(obs);
+
+            xlsx.beginRow(currentRow++);
+            xlsx.addSharedString(sessionNames.get(xlsx, obs.sessionId, session.name));
+            xlsx.addSharedString(sessionDates.get(xlsx, obs.sessionId, session.date));
+            xlsx.addSharedString(objectNames.get(xlsx, obs.objectId, dimensions.object(obs.objectId).name));
+            xlsx.addSharedString(cameraNames.get(xlsx, obs.cameraId, dimensions.camera(obs.cameraId)));
+            xlsx.addSharedString(telescopeNames.get(xlsx, obs.telescopeId, dimensions.telescope(obs.telescopeId)));
+            xlsx.addSharedString(filterNames.get(xlsx, obs.filterId, dimensions.filter(obs.filterId)));
+            xlsx.addNumber(static_cast<qint64>(obs.imageCount));
+            xlsx.addNumber(static_cast<qint64>(obs.exposureLength));
+            xlsx.addNumber(static_cast<qint64>(obs.totalExposure));
+            xlsx.addNumber(session.moonIllumination);
+
+            // Angular separation (negative if not calculated)
+            if (angularSeparation >= 0.0)
+                xlsx.addNumber(angularSeparation);
+            else
+                xlsx.skipCell();
+
+            if (!obs.comments.isEmpty())
+                xlsx.addString(obs.comments);
+            xlsx.endRow();
+
+            ++exportedRows;
+            return !progress || progress(exportedRows, totalRecords);
+        });
+        if (!result)
+        {
+            return std::unexpected(result.error());
+        }
+        if (!result.value())
+        {
+            return std::unexpected(ER::Warning("Export cancelled"));
+        }
+    }
+
+    if (auto closed = xlsx.close(); !closed)
+    {
+        return std::unexpected(closed.error());
+    }
+    return exportedRows;
+}
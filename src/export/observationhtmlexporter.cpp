@@ -0,0 +1,206 @@
+#include "export/observationhtmlexporter.h"
+#include "export/htmltemplate.h"
+#include "export/utf8writer.h"
+#include "trace.h"
+#include <QDateTime>
+#include <QHash>
+#include <QSaveFile>
+
+namespace
+{
+    // Parsed on first use and kept for the lifetime of the application
+    std::expected<const HtmlTemplate *, ER> observationsTemplate()
+    {
+        static const auto parsed = HtmlTemplate::fromFile(":/templates/observations_export.html");
+        if (!parsed)
+        {
+            return std::unexpected(parsed.error());
+        }
+        return &parsed.value();
+    }
+
+    void writeCell(Utf8Writer &writer, const QByteArray &escaped)
+    {
+        writer.writeRaw("                    <td>");
+        writer.writeRaw(escaped);
+        writer.writeRaw("</td>\n");
+    }
+
+    void writeCell(Utf8Writer &writer, const qint64 value)
+    {
+        writer.writeRaw("                    <td>");
+        writer.writeNumber(value);
+        writer.writeRaw("</td>\n");
+    }
+}
+
+const QByteArray &ObservationHtmlRows::EscapedNames::get(const int id, const QString &name)
+{
+    auto it = m_names.find(id);
+    if (it == m_names.end())
+        it = m_names.insert(id, name.toHtmlEscaped().toUtf8());
+    return *it;
+}
+
+ObservationHtmlRows::ObservationHtmlRows(const ObservationDimensions &dimensions, const int moonWarningPercent,
+                                         const int angularWarningDeg)
+    : m_dimensions(dimensions), m_moonWarningPercent(moonWarningPercent), m_angularWarningDeg(angularWarningDeg)
+{
+}
+
+void ObservationHtmlRows::write(Utf8Writer &writer, const ObservationData &obs)
+{
+    const SessionDimension &session = m_dimensions.session(obs.sessionId);
+    const double angularSeparation = m_dimensions.angularSeparation(obs);
+
+    writer.writeRaw("                <tr>\n");
+    writeLinkedCell(writer, "sessions/", obs.sessionId, m_sessionNames.get(obs.sessionId, session.name));
+    writeCell(writer, m_sessionDates.get(obs.sessionId, session.date));
+    writeLinkedCell(writer, "objects/", obs.objectId,
+                    m_objectNames.get(obs.objectId, m_dimensions.object(obs.objectId).name));
+    writeCell(writer, m_cameraNames.get(obs.cameraId, m_dimensions.camera(obs.cameraId)));
+    writeCell(writer, m_telescopeNames.get(obs.telescopeId, m_dimensions.telescope(obs.telescopeId)));
+    writeCell(writer, m_filterNames.get(obs.filterId, m_dimensions.filter(obs.filterId)));
+    writeCell(writer, obs.imageCount);
+    writeCell(writer, obs.exposureLength);
+    writeCell(writer, obs.totalExposure);
+
+    // Moon illumination with warning class
+    writer.writeRaw(session.moonIllumination > m_moonWarningPercent
+                        ? "                    <td class=\"moon-warning\">"
+                        : "                    <td>");
+    writer.writeNumber(session.moonIllumination, 0);
+    writer.writeRaw("</td>\n");
+
+    // Angular separation with warning class
+    if (angularSeparation >= 0.0)
+    {
+        writer.writeRaw(angularSeparation < m_angularWarningDeg
+                            ? "                    <td class=\"angular-warning\">"
+                            : "                    <td>");
+        writer.writeNumber(angularSeparation, 0);
+        writer.writeRaw("</td>\n");
+    }
+    else
+    {
+        writer.writeRaw("                    <td></td>\n");
+    }
+
+    writer.writeRaw("                    <td>");
+    writer.writeHtmlEscaped(obs.comments);
+    writer.writeRaw("</td>\n");
+    writer.writeRaw("                </tr>\n");
+}
+
+void ObservationHtmlRows::writeLinkedCell(Utf8Writer &writer, const char *directory, const int id,
+                                          const QByteArray &escaped) const
+{
+    if (m_linkPrefix.isEmpty())
+    {
+        writeCell(writer, escaped);
+        return;
+    }
+
+    writer.writeRaw("                    <td><a href=\"");
+    writer.writeRaw(m_linkPrefix);
+    writer.writeRaw(directory);
+    writer.writeNumber(id);
+    writer.writeRaw(".html\">");
+    writer.writeRaw(escaped);
+    writer.writeRaw("</a></td>\n");
+}
+
+ObservationHtmlExporter::ObservationHtmlExporter(DatabaseManager *dbManager)
+    : m_dbManager(dbManager)
+{
+}
+
+std::expected<int, ER> ObservationHtmlExporter::exportToFile(const QString &fileName,
+                                                             const ObservationHtmlExportOptions &options,
+                                                             const ExportProgress &progress) const
+{
+    TRACE_SPAN("ObservationHtmlExporter::exportToFile", "export");
+    auto htmlTemplate = observationsTemplate();
+    if (!htmlTemplate)
+    {
+        return std::unexpected(htmlTemplate.error());
+    }
+
+    const ObservationsRepository repository(m_dbManager);
+    auto dimensionsResult = repository.getDimensions();
+    if (!dimensionsResult)
+    {
+        return std::unexpected(dimensionsResult.error());
+    }
+    const ObservationDimensions &dimensions = dimensionsResult.value();
+
+    // The total is shown above the table, before the rows are read
+    auto totalRecords = repository.countObservations(options.filter);
+    if (!totalRecords)
+    {
+        return std::unexpected(totalRecords.error());
+    }
+
+    QSaveFile outputFile(fileName);
+    if (!outputFile.open(QIODevice::WriteOnly))
+    {
+        return std::unexpected(ER::Error("Failed to write to file: " + outputFile.errorString()));
+    }
+
+    const QString exportDateTime = QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss");
+    Utf8Writer writer(&outputFile);
+    ObservationHtmlRows rows(dimensions, options.moonWarningPercent, options.angularWarningDeg);
+    int exportedRows = 0;
+
+    for (const HtmlTemplate::Segment &segment : (*htmlTemplate)->segments())
+    {
+        if (segment.placeholder.isEmpty())
+        {
+            writer.writeRaw(segment.literal);
+        }
+        else if (segment.placeholder == "filter_name")
+        {
+            writer.writeHtmlEscaped(options.filterDescription);
+        }
+        else if (segment.placeholder == "export_date" || segment.placeholder == "completion_date")
+        {
+            writer.write(exportDateTime);
+        }
+        else if (segment.placeholder == "total_records")
+        {
+            writer.writeNumber(totalRecords.value());
+        }
+        else if (segment.placeholder == "table_rows")
+        {
+            auto result = repository.forEachObservation(options.filter, [&](const ObservationData &obs)
+            {
+                rows.write(writer, obs);
+                ++exportedRows;
+                return writer.ok() && (!progress || progress(exportedRows, totalRecords.value()));
+            });
+            if (!result)
+            {
+                outputFile.cancelWriting();
+                return std::unexpected(result.error());
+            }
+            if (!result.value() && writer.ok())
+            {
+                outputFile.cancelWriting();
+                return std::unexpected(ER::Warning("Export cancelled"));
+            }
+        }
+        else
+        {
+            // Unknown placeholders are kept as they are
+            writer.writeRaw("{{");
+            writer.write(segment.placeholder);
+            writer.writeRaw("}}");
+        }
+    }
+
+    if (!writer.flush() || !outputFile.commit())
+    {
+        return std::unexpected(ER::Error("Failed to write to file: " + outputFile.errorString()));
+    }
+    return exportedRows;
+}
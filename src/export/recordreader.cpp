@@ -0,0 +1,164 @@
+#include "export/recordreader.h"
+#include <QIODevice>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonParseError>
+
+std::unique_ptr<RecordReader> RecordReader::create(const QString &fileName, QIODevice *device)
+{
+    if (fileName.endsWith(".csv", Qt::CaseInsensitive))
+        return std::make_unique<CsvRecordReader>(device);
+    if (fileName.endsWith(".jsonl", Qt::CaseInsensitive))
+        return std::make_unique<JsonLinesRecordReader>(device);
+    return nullptr;
+}
+
+bool RecordReader::readLine(QByteArray &line)
+{
+    if (m_device->atEnd())
+        return false;
+
+    line = m_device->readLine();
+    ++m_lineNumber;
+    if (line.endsWith('\n'))
+        line.chop(1);
+    if (line.endsWith('\r'))
+        line.chop(1);
+    return true;
+}
+
+std::expected<void, ER> CsvRecordReader::open(const QStringList &fields, const QStringList &requiredFields)
+{
+    auto header = readRecord();
+    if (!header)
+        return std::unexpected(header.error());
+    if (!header.value())
+        return std::unexpected(ER::Error("File is empty"));
+
+    // A byte order mark written by spreadsheet programs is not part of the first name
+    if (!m_record.isEmpty() && m_record.first().startsWith(QChar(0xFEFF)))
+        m_record.first().remove(0, 1);
+
+    m_positions.clear();
+    for (const QString &field : fields)
+    {
+        const int position = static_cast<int>(m_record.indexOf(field));
+        if (position < 0 && requiredFields.contains(field))
+            return std::unexpected(ER::Error(QString("Column \"%1\" is missing").arg(field)));
+        m_positions.append(position);
+    }
+    return {};
+}
+
+std::expected<bool, ER> CsvRecordReader::next(QVector<QVariant> &values)
+{
+    // Blank lines between records are skipped
+    do
+    {
+        auto read = readRecord();
+        if (!read || !read.value())
+            return read;
+    } while (m_record.size() == 1 && m_record.first().isEmpty());
+
+    values.resize(m_positions.size());
+    for (qsizetype i = 0; i < m_positions.size(); ++i)
+    {
+        const int position = m_positions[i];
+        if (position < 0 || position >= m_record.size() || m_record[position].isEmpty())
+            values[i] = QVariant();
+        else
+            values[i] = m_record[position];
+    }
+    return true;
+}
+
+std::expected<bool, ER> CsvRecordReader::readRecord()
+{
+    if (!readLine(m_buffer))
+        return false;
+    m_recordLine = m_lineNumber;
+
+    m_record.clear();
+    QByteArray field;
+    bool quoted = false;
+    qsizetype pos = 0;
+    while (true)
+    {
+        if (pos >= m_buffer.size())
+        {
+            if (!quoted)
+                break;
+            // Line break inside a quoted field, the record goes on in the next line
+            field += '\n';
+            if (!readLine(m_buffer))
+                return std::unexpected(ER::Error(QString("Line %1: unterminated quoted field").arg(m_recordLine)));
+            pos = 0;
+            continue;
+        }
+
+        const char c = m_buffer[pos++];
+        if (quoted)
+        {
+            if (c != '"')
+                field += c;
+            else if (pos < m_buffer.size() && m_buffer[pos] == '"')
+            {
+                field += '"';
+                ++pos;
+            }
+            else
+                quoted = false;
+        }
+        else if (c == '"')
+            quoted = true;
+        else if (c == ',')
+        {
+            m_record.append(QString::fromUtf8(field));
+            field.clear();
+        }
+        else
+            field += c;
+    }
+    m_record.append(QString::fromUtf8(field));
+    return true;
+}
+
+std::expected<void, ER> JsonLinesRecordReader::open(const QStringList &fields, const QStringList &requiredFields)
+{
+    // Field names are checked per record, every line stands for itself
+    m_fields = fields;
+    m_requiredFields = requiredFields;
+    return {};
+}
+
+std::expected<bool, ER> JsonLinesRecordReader::next(QVector<QVariant> &values)
+{
+    do
+    {
+        if (!readLine(m_buffer))
+            return false;
+    } while (m_buffer.trimmed().isEmpty());
+    m_recordLine = m_lineNumber;
+
+    QJsonParseError parseError;
+    const QJsonDocument document = QJsonDocument::fromJson(m_buffer, &parseError);
+    if (!document.isObject())
+    {
+        const QString reason = parseError.error != QJsonParseError::NoError ? parseError.errorString()
+                                                                            : QString("not a JSON object");
+        return std::unexpected(ER::Error(QString("Line %1: %2").arg(m_recordLine).arg(reason)));
+    }
+
+    const QJsonObject object = document.object();
+    values.resize(m_fields.size());
+    for (qsizetype i = 0; i < m_fields.size(); ++i)
+    {
+        const QJsonValue value = object.value(m_fields[i]);
+        if (value.isUndefined() && m_requiredFields.contains(m_fields[i]))
+        {
+            return std::unexpected(ER::Error(QString("Line %1: field \"%2\" is missing").arg(m_recordLine).arg(m_fields[i])));
+        }
+        values[i] = value.isString() && value.toString().isEmpty() ? QVariant() : value.toVariant();
+    }
+    return true;
+}
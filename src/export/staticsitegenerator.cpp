@@ -0,0 +1,671 @@
+#include "export/staticsitegenerator.h"
+#include "export/htmltemplate.h"
+#include "export/observationhtmlexporter.h"
+#include "export/utf8writer.h"
+#include "db/observationsrepository.h"
+#include "trace.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QSaveFile>
+#include <QSet>
+#include <algorithm>
+#include <optional>
+#include <type_traits>
+
+namespace
+{
+    // Part of every page hash, raise it when the code writing the pages changes
+    constexpr int siteFormat = 2;
+    const QString manifestFileName = "site-manifest.json";
+
+    std::expected<const HtmlTemplate *, ER> templatePointer(const std::expected<HtmlTemplate, ER> &parsed)
+    {
+        if (!parsed)
+        {
+            return std::unexpected(parsed.error());
+        }
+        return &parsed.value();
+    }
+
+    // Parsed on first use and kept for the lifetime of the application
+    std::expected<const HtmlTemplate *, ER> indexTemplate()
+    {
+        static const auto parsed = HtmlTemplate::fromFile(":/templates/site_index.html");
+        return templatePointer(parsed);
+    }
+
+    std::expected<const HtmlTemplate *, ER> pageTemplate()
+    {
+        static const auto parsed = HtmlTemplate::fromFile(":/templates/site_page.html");
+        return templatePointer(parsed);
+    }
+
+    // Hash over the values a page shows. Texts are added with their length, so that
+    // ("ab", "c") and ("a", "bc") do not hash the same.
+    class PageHash
+    {
+    public:
+        explicit PageHash(const QByteArrayView seed)
+            : m_hash(QCryptographicHash::Sha1)
+        {
+            m_hash.addData(seed);
+        }
+
+        template <typename T>
+            requires std::is_arithmetic_v<T>
+        void add(const T value)
+        {
+            m_hash.addData(QByteArrayView(reinterpret_cast<const char *>(&value), sizeof(T)));
+        }
+
+        void add(const QStringView text)
+        {
+            add(text.size());
+            m_hash.addData(QByteArrayView(reinterpret_cast<const char *>(text.utf16()),
+                                          text.size() * qsizetype(sizeof(char16_t))));
+        }
+
+        void add(const std::optional<double> &value)
+        {
+            add(value.has_value());
+            if (value)
+                add(*value);
+        }
+
+        [[nodiscard]] QString result() const { return QString::fromLatin1(m_hash.result().toHex()); }
+
+    private:
+        QCryptographicHash m_hash;
+    };
+
+    using AggregateMap = QHash<int, ObservationAggregate>;
+
+    // Values a session or object contributes to the pages that list its observations
+    QString sessionHash(const SessionDimension &session)
+    {
+        PageHash hash({});
+        hash.add(session.name);
+        hash.add(session.date);
+        hash.add(session.moonIllumination);
+        hash.add(session.moonRa);
+        hash.add(session.moonDec);
+        return hash.result();
+    }
+
+    QString objectHash(const ObjectDimension &object)
+    {
+        PageHash hash({});
+        hash.add(object.name);
+        hash.add(object.comments);
+        hash.add(object.ra);
+        hash.add(object.dec);
+        return hash.result();
+    }
+
+    // Names in id order, QHash iterates in a different order in every process
+    void addNames(PageHash &hash, const QHash<int, QString> &names)
+    {
+        QList<int> ids = names.keys();
+        std::sort(ids.begin(), ids.end());
+        hash.add(ids.size());
+        for (const int id : std::as_const(ids))
+        {
+            hash.add(id);
+            hash.add(names.value(id));
+        }
+    }
+
+    void addAggregate(PageHash &hash, const ObservationAggregate &aggregate)
+    {
+        hash.add(aggregate.observations);
+        hash.add(aggregate.totalExposure);
+        hash.add(aggregate.maxId);
+        hash.add(aggregate.maxRevision);
+        hash.add(aggregate.lastJd);
+    }
+
+    void writeHours(Utf8Writer &writer, const qint64 seconds)
+    {
+        writer.writeNumber(seconds / 3600.0, 1);
+    }
+
+    void writeTotals(Utf8Writer &writer, const ObservationAggregate &aggregate,
+                     const QMap<QString, qint64> &filterExposure)
+    {
+        writer.writeRaw("<strong>Observations:</strong> ");
+        writer.writeNumber(aggregate.observations);
+        writer.writeRaw("<br>\n            <strong>Total Exposure:</strong> ");
+        writeHours(writer, aggregate.totalExposure);
+        writer.writeRaw(" h\n");
+        if (filterExposure.isEmpty())
+            return;
+
+        writer.writeRaw("            <table>\n"
+                        "                <thead><tr><th>Filter</th><th>Total Exposure (h)</th></tr></thead>\n"
+                        "                <tbody>\n");
+        for (auto it = filterExposure.cbegin(); it != filterExposure.cend(); ++it)
+        {
+            writer.writeRaw("                    <tr><td>");
+            writer.writeHtmlEscaped(it.key());
+            writer.writeRaw("</td><td>");
+            writeHours(writer, it.value());
+            writer.writeRaw("</td></tr>\n");
+        }
+        writer.writeRaw("                </tbody>\n            </table>");
+    }
+
+    // Link cell of the index tables
+    void writeLinkCell(Utf8Writer &writer, const char *directory, const int id, const QString &text)
+    {
+        writer.writeRaw("                    <td><a href=\"");
+        writer.writeRaw(directory);
+        writer.writeNumber(id);
+        writer.writeRaw(".html\">");
+        writer.writeHtmlEscaped(text);
+        writer.writeRaw("</a></td>\n");
+    }
+
+    // Writes the value of one placeholder, false if the page has no such placeholder
+    using PlaceholderWriter = std::function<std::expected<bool, ER>(Utf8Writer &writer, const QString &placeholder)>;
+
+    // Renders the template into fileName, replacing the file only if every placeholder was written
+    std::expected<void, ER> writePage(const QString &fileName, const HtmlTemplate &htmlTemplate,
+                                      const PlaceholderWriter &writePlaceholder)
+    {
+        QSaveFile outputFile(fileName);
+        if (!outputFile.open(QIODevice::WriteOnly))
+        {
+            return std::unexpected(ER::Error("Failed to write to file: " + outputFile.errorString()));
+        }
+
+        Utf8Writer writer(&outputFile);
+        for (const HtmlTemplate::Segment &segment : htmlTemplate.segments())
+        {
+            if (segment.placeholder.isEmpty())
+            {
+                writer.writeRaw(segment.literal);
+                continue;
+            }
+
+            auto result = writePlaceholder(writer, segment.placeholder);
+            if (!result)
+            {
+                outputFile.cancelWriting();
+                return std::unexpected(result.error());
+            }
+            if (!result.value())
+            {
+                // Unknown placeholders are kept as they are
+                writer.writeRaw("{{");
+                writer.write(segment.placeholder);
+                writer.writeRaw("}}");
+            }
+        }
+
+        if (!writer.flush() || !outputFile.commit())
+        {
+            return std::unexpected(ER::Error("Failed to write to file: " + outputFile.errorString()));
+        }
+        return {};
+    }
+
+    // State of the last run, empty if there is no readable manifest
+    struct SiteManifest
+    {
+        QHash<QString, QString> pages; // path -> signature
+        QHash<int, QString> sessions;  // id -> sessionHash()
+        QHash<int, QString> objects;   // id -> objectHash()
+        QString references;            // cameras, telescopes and filters
+    };
+
+    QHash<int, QString> readIdHashes(const QJsonObject &object)
+    {
+        QHash<int, QString> hashes;
+        for (auto it = object.constBegin(); it != object.constEnd(); ++it)
+        {
+            hashes.insert(it.key().toInt(), it.value().toString());
+        }
+        return hashes;
+    }
+
+    QJsonObject idHashesToJson(const QHash<int, QString> &hashes)
+    {
+        QJsonObject object;
+        for (auto it = hashes.cbegin(); it != hashes.cend(); ++it)
+        {
+            object.insert(QString::number(it.key()), it.value());
+        }
+        return object;
+    }
+
+    SiteManifest readManifest(const QString &fileName)
+    {
+        QFile file(fileName);
+        if (!file.open(QIODevice::ReadOnly))
+            return {};
+
+        const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+        if (root.value("format").toInt() != siteFormat)
+            return {};
+
+        SiteManifest manifest;
+        const QJsonObject pages = root.value("pages").toObject();
+        for (auto it = pages.constBegin(); it != pages.constEnd(); ++it)
+        {
+            manifest.pages.insert(it.key(), it.value().toString());
+        }
+        manifest.sessions = readIdHashes(root.value("sessions").toObject());
+        manifest.objects = readIdHashes(root.value("objects").toObject());
+        manifest.references = root.value("references").toString();
+        return manifest;
+    }
+
+    std::expected<void, ER> writeManifest(const QString &fileName, const SiteManifest &manifest)
+    {
+        QJsonObject pages;
+        for (auto it = manifest.pages.cbegin(); it != manifest.pages.cend(); ++it)
+        {
+            pages.insert(it.key(), it.value());
+        }
+        QJsonObject root;
+        root.insert("format", siteFormat);
+        root.insert("pages", pages);
+        root.insert("sessions", idHashesToJson(manifest.sessions));
+        root.insert("objects", idHashesToJson(manifest.objects));
+        root.insert("references", manifest.references);
+
+        QSaveFile file(fileName);
+        if (!file.open(QIODevice::WriteOnly) || file.write(QJsonDocument(root).toJson()) < 0 || !file.commit())
+        {
+            return std::unexpected(ER::Error("Failed to write site manifest: " + file.errorString()));
+        }
+        return {};
+    }
+}
+
+StaticSiteGenerator::StaticSiteGenerator(DatabaseManager *dbManager)
+    : m_dbManager(dbManager)
+{
+}
+
+std::expected<int, ER> StaticSiteGenerator::generate(const QString &directory, const StaticSiteOptions &options,
+                                                     const ExportProgress &progress) const
+{
+    TRACE_SPAN("StaticSiteGenerator::generate", "export");
+    auto indexHtml = indexTemplate();
+    if (!indexHtml)
+    {
+        return std::unexpected(indexHtml.error());
+    }
+    auto pageHtml = pageTemplate();
+    if (!pageHtml)
+    {
+        return std::unexpected(pageHtml.error());
+    }
+
+    const ObservationsRepository repository(m_dbManager);
+    auto dimensionsResult = repository.getDimensions();
+    if (!dimensionsResult)
+    {
+        return std::unexpected(dimensionsResult.error());
+    }
+    const ObservationDimensions &dimensions = dimensionsResult.value();
+
+    // Everything that changes all pages at once: layout, templates and warning thresholds
+    QCryptographicHash seedHash(QCryptographicHash::Sha1);
+    seedHash.addData(QByteArray::number(siteFormat));
+    for (const HtmlTemplate *htmlTemplate : {*indexHtml, *pageHtml})
+    {
+        for (const HtmlTemplate::Segment &segment : htmlTemplate->segments())
+        {
+            seedHash.addData(segment.literal);
+            seedHash.addData(segment.placeholder.toUtf8());
+        }
+    }
+    seedHash.addData(QByteArray::number(options.moonWarningPercent) + ' ' +
+                     QByteArray::number(options.angularWarningDeg));
+    const QByteArray seed = seedHash.result();
+
+    // Two grouped scans of the observation indexes stand in for reading every row: a page
+    // whose aggregates, own values and referenced rows are unchanged is not looked at again
+    auto objectAggregatesResult = repository.getAggregates(ObservationGrouping::Object);
+    if (!objectAggregatesResult)
+    {
+        return std::unexpected(objectAggregatesResult.error());
+    }
+    const AggregateMap &objectAggregates = objectAggregatesResult.value();
+    auto sessionAggregatesResult = repository.getAggregates(ObservationGrouping::Session);
+    if (!sessionAggregatesResult)
+    {
+        return std::unexpected(sessionAggregatesResult.error());
+    }
+    const AggregateMap &sessionAggregates = sessionAggregatesResult.value();
+
+    const QDir siteDir(directory);
+    if (!siteDir.mkpath("objects") || !siteDir.mkpath("sessions"))
+    {
+        return std::unexpected(ER::Error("Failed to create site directory: " + directory));
+    }
+    const QString manifestPath = siteDir.filePath(manifestFileName);
+    const SiteManifest previous = readManifest(manifestPath);
+
+    SiteManifest manifest;
+    for (auto it = dimensions.sessions().cbegin(); it != dimensions.sessions().cend(); ++it)
+        manifest.sessions.insert(it.key(), sessionHash(*it));
+    for (auto it = dimensions.objects().cbegin(); it != dimensions.objects().cend(); ++it)
+        manifest.objects.insert(it.key(), objectHash(*it));
+    PageHash referencesHash({});
+    addNames(referencesHash, dimensions.cameras());
+    addNames(referencesHash, dimensions.telescopes());
+    addNames(referencesHash, dimensions.filters());
+    manifest.references = referencesHash.result();
+
+    // Rows of a changed session are shown on the pages of the objects observed in it and the
+    // other way round. New sessions and objects only appear through new observations, which
+    // change the aggregates of both pages anyway.
+    QList<int> changedSessions;
+    for (auto it = previous.sessions.cbegin(); it != previous.sessions.cend(); ++it)
+    {
+        if (manifest.sessions.contains(it.key()) && manifest.sessions.value(it.key()) != it.value())
+            changedSessions.append(it.key());
+    }
+    QList<int> changedObjects;
+    for (auto it = previous.objects.cbegin(); it != previous.objects.cend(); ++it)
+    {
+        if (manifest.objects.contains(it.key()) && manifest.objects.value(it.key()) != it.value())
+            changedObjects.append(it.key());
+    }
+    auto staleObjects = repository.getObjectIdsOfSessions(changedSessions);
+    if (!staleObjects)
+    {
+        return std::unexpected(staleObjects.error());
+    }
+    auto staleSessions = repository.getSessionIdsOfObjects(changedObjects);
+    if (!staleSessions)
+    {
+        return std::unexpected(staleSessions.error());
+    }
+    // A renamed camera, telescope or filter may appear on any page
+    const bool referencesChanged = previous.references != manifest.references;
+
+    // Index order: objects by name, sessions newest first
+    QVector<int> objectIds;
+    objectIds.reserve(dimensions.objects().size());
+    for (auto it = dimensions.objects().cbegin(); it != dimensions.objects().cend(); ++it)
+        objectIds.append(it.key());
+    std::sort(objectIds.begin(), objectIds.end(), [&dimensions](const int a, const int b)
+    {
+        const int order = QString::compare(dimensions.object(a).name, dimensions.object(b).name, Qt::CaseInsensitive);
+        return order != 0 ? order < 0 : a < b;
+    });
+    QVector<int> sessionIds;
+    sessionIds.reserve(dimensions.sessions().size());
+    for (auto it = dimensions.sessions().cbegin(); it != dimensions.sessions().cend(); ++it)
+        sessionIds.append(it.key());
+    std::sort(sessionIds.begin(), sessionIds.end(), [&dimensions](const int a, const int b)
+    {
+        const qint64 jdA = dimensions.session(a).startJd;
+        const qint64 jdB = dimensions.session(b).startJd;
+        return jdA != jdB ? jdA > jdB : a > b;
+    });
+
+    // Date of the newest session of each object, sessions of one day share the date
+    QHash<qint64, QString> sessionDates;
+    for (const SessionDimension &session : dimensions.sessions())
+        sessionDates.insert(session.startJd, session.date);
+    const auto lastDate = [&sessionDates](const ObservationAggregate &aggregate)
+    {
+        return aggregate.observations > 0 ? sessionDates.value(aggregate.lastJd) : QString();
+    };
+
+    PageHash indexHash(seed);
+    int totalObservations = 0;
+    qint64 totalExposure = 0;
+    for (const int id : std::as_const(objectIds))
+    {
+        const ObjectDimension &object = dimensions.object(id);
+        const ObservationAggregate aggregate = objectAggregates.value(id);
+        indexHash.add(id);
+        indexHash.add(object.name);
+        indexHash.add(object.comments);
+        indexHash.add(aggregate.observations);
+        indexHash.add(aggregate.totalExposure);
+        indexHash.add(lastDate(aggregate));
+        totalObservations += aggregate.observations;
+        totalExposure += aggregate.totalExposure;
+    }
+    for (const int id : std::as_const(sessionIds))
+    {
+        const SessionDimension &session = dimensions.session(id);
+        const ObservationAggregate aggregate = sessionAggregates.value(id);
+        indexHash.add(id);
+        indexHash.add(session.name);
+        indexHash.add(session.date);
+        indexHash.add(session.moonIllumination);
+        indexHash.add(aggregate.observations);
+        indexHash.add(aggregate.totalExposure);
+    }
+
+    // Pages that changed since the last run
+    struct PendingPage
+    {
+        QString path;
+        QString signature;
+        const AggregateMap *aggregates; // nullptr for the index
+        bool isObject;
+        int id;
+    };
+
+    QVector<PendingPage> pending;
+    QSet<QString> pagePaths;
+    const auto addPage = [&](const QString &path, const QString &signature, const AggregateMap *aggregates,
+                             const bool isObject, const int id, const bool stale)
+    {
+        pagePaths.insert(path);
+        if (!stale && previous.pages.value(path) == signature && QFileInfo::exists(siteDir.filePath(path)))
+            manifest.pages.insert(path, signature);
+        else
+            pending.append({path, signature, aggregates, isObject, id});
+    };
+    for (const int id : std::as_const(objectIds))
+    {
+        PageHash signature(seed);
+        signature.add(manifest.objects.value(id));
+        addAggregate(signature, objectAggregates.value(id));
+        addPage(QString("objects/%1.html").arg(id), signature.result(), &objectAggregates, true, id,
+                referencesChanged || staleObjects->contains(id));
+    }
+    for (const int id : std::as_const(sessionIds))
+    {
+        PageHash signature(seed);
+        signature.add(manifest.sessions.value(id));
+        addAggregate(signature, sessionAggregates.value(id));
+        addPage(QString("sessions/%1.html").arg(id), signature.result(), &sessionAggregates, false, id,
+                referencesChanged || staleSessions->contains(id));
+    }
+    // Written last, so that it never links to a page that is not there yet
+    addPage("index.html", indexHash.result(), nullptr, false, 0, false);
+
+    // Pages of deleted objects and sessions
+    for (auto it = previous.pages.cbegin(); it != previous.pages.cend(); ++it)
+    {
+        if (!pagePaths.contains(it.key()))
+        {
+            QFile::remove(siteDir.filePath(it.key()));
+        }
+    }
+
+    const QString generatedDate = QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss");
+    ObservationHtmlRows rows(dimensions, options.moonWarningPercent, options.angularWarningDeg);
+    rows.setPageLinkPrefix("../");
+
+    int writtenPages = 0;
+    for (const PendingPage &pendingPage : std::as_const(pending))
+    {
+        std::expected<void, ER> written;
+        if (!pendingPage.aggregates)
+        {
+            written = writePage(siteDir.filePath(pendingPage.path), **indexHtml,
+                                [&](Utf8Writer &writer, const QString &placeholder) -> std::expected<bool, ER>
+            {
+                if (placeholder == "total_observations")
+                {
+                    writer.writeNumber(totalObservations);
+                }
+                else if (placeholder == "total_exposure")
+                {
+                    writeHours(writer, totalExposure);
+                }
+                else if (placeholder == "object_rows")
+                {
+                    for (const int id : std::as_const(objectIds))
+                    {
+                        const ObjectDimension &object = dimensions.object(id);
+                        const ObservationAggregate aggregate = objectAggregates.value(id);
+                        writer.writeRaw("                <tr>\n");
+                        writeLinkCell(writer, "objects/", id, object.name);
+                        writer.writeRaw("                    <td>");
+                        writer.writeHtmlEscaped(object.comments);
+                        writer.writeRaw("</td>\n                    <td>");
+                        writer.writeNumber(aggregate.observations);
+                        writer.writeRaw("</td>\n                    <td>");
+                        writeHours(writer, aggregate.totalExposure);
+                        writer.writeRaw("</td>\n                    <td>");
+                        writer.writeHtmlEscaped(lastDate(aggregate));
+                        writer.writeRaw("</td>\n                </tr>\n");
+                    }
+                }
+                else if (placeholder == "session_rows")
+                {
+                    for (const int id : std::as_const(sessionIds))
+                    {
+                        const SessionDimension &session = dimensions.session(id);
+                        const ObservationAggregate aggregate = sessionAggregates.value(id);
+                        writer.writeRaw("                <tr>\n");
+                        writeLinkCell(writer, "sessions/", id, session.name);
+                        writer.writeRaw("                    <td>");
+                        writer.writeHtmlEscaped(session.date);
+                        writer.writeRaw("</td>\n                    <td>");
+                        writer.writeNumber(aggregate.observations);
+                        writer.writeRaw("</td>\n                    <td>");
+                        writeHours(writer, aggregate.totalExposure);
+                        writer.writeRaw("</td>\n                    <td>");
+                        writer.writeNumber(session.moonIllumination, 0);
+                        writer.writeRaw("</td>\n                </tr>\n");
+                    }
+                }
+                else if (placeholder == "generated_date")
+                {
+                    writer.write(generatedDate);
+                }
+                else
+                {
+                    return false;
+                }
+                return true;
+            });
+        }
+        else
+        {
+            const ObservationAggregate aggregate = pendingPage.aggregates->value(pendingPage.id);
+            const ObservationGrouping grouping =
+                pendingPage.isObject ? ObservationGrouping::Object : ObservationGrouping::Session;
+            written = writePage(siteDir.filePath(pendingPage.path), **pageHtml,
+                                [&](Utf8Writer &writer, const QString &placeholder) -> std::expected<bool, ER>
+            {
+                if (placeholder == "title")
+                {
+                    if (pendingPage.isObject)
+                    {
+                        writer.writeHtmlEscaped(dimensions.object(pendingPage.id).displayName());
+                    }
+                    else
+                    {
+                        const SessionDimension &session = dimensions.session(pendingPage.id);
+                        writer.writeHtmlEscaped(session.name + " (" + session.date + ")");
+                    }
+                }
+                else if (placeholder == "summary")
+                {
+                    if (!pendingPage.isObject)
+                    {
+                        writer.writeRaw("<strong>Moon Phase:</strong> ");
+                        writer.writeNumber(dimensions.session(pendingPage.id).moonIllumination, 0);
+                        writer.writeRaw(" %<br>\n            ");
+                    }
+
+                    auto exposureByFilter = repository.getExposureByFilter(grouping, pendingPage.id);
+                    if (!exposureByFilter)
+                    {
+                        return std::unexpected(exposureByFilter.error());
+                    }
+                    // Filters of the same name are listed once
+                    QMap<QString, qint64> filterExposure;
+                    for (auto it = exposureByFilter->cbegin(); it != exposureByFilter->cend(); ++it)
+                        filterExposure[dimensions.filter(it.key())] += it.value();
+                    writeTotals(writer, aggregate, filterExposure);
+                }
+                else if (placeholder == "table_rows")
+                {
+                    ObservationFilter filter;
+                    if (pendingPage.isObject)
+                        filter.objectIds = {pendingPage.id};
+                    else
+                        filter.sessionIds = {pendingPage.id};
+
+                    auto result = repository.forEachObservation(filter, [&](const ObservationData &obs)
+                    {
+                        rows.write(writer, obs);
+                        return writer.ok();
+                    });
+                    if (!result)
+                    {
+                        return std::unexpected(result.error());
+                    }
+                }
+                else if (placeholder == "generated_date")
+                {
+                    writer.write(generatedDate);
+                }
+                else
+                {
+                    return false;
+                }
+                return true;
+            });
+        }
+
+        // Pages not written are missing from the manifest and written on the next run, also
+        // when the session and object hashes saved with it no longer mark them as stale
+        if (!written)
+        {
+            (void)writeManifest(manifestPath, manifest);
+            return std::unexpected(written.error());
+        }
+        manifest.pages.insert(pendingPage.path, pendingPage.signature);
+        ++writtenPages;
+
+        if (progress && !progress(writtenPages, static_cast<int>(pending.size())))
+        {
+            auto saved = writeManifest(manifestPath, manifest);
+            if (!saved)
+            {
+                return std::unexpected(saved.error());
+            }
+            return std::unexpected(ER::Warning("Export cancelled"));
+        }
+    }
+
+    auto saved = writeManifest(manifestPath, manifest);
+    if (!saved)
+    {
+        return std::unexpected(saved.error());
+    }
+    return writtenPages;
+}
@@ -0,0 +1,527 @@
+#include "export/tabledump.h"
+#include "export/recordreader.h"
+#include "export/utf8writer.h"
+#include "db/databasemanager.h"
+#include "db/sqlstatement.h"
+#include "trace.h"
+#include <QDate>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QSaveFile>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+    // Rows inserted per transaction
+    constexpr int importBatchSize = 1000;
+    // Problems listed in the import report, the rest are only counted
+    constexpr int maxReportedProblems = 20;
+
+    // Ids by name of the rows imported records may refer to
+    struct Lookups
+    {
+        QHash<QString, int> filterTypes;
+        QHash<QString, int> sessions;
+        QHash<QString, int> objects; // objectKey()
+        QHash<QString, int> cameras;
+        QHash<QString, int> telescopes;
+        QHash<QString, int> filters;
+    };
+
+    // Objects are unique by name and comments together
+    QString objectKey(const QString &name, const QString &comments)
+    {
+        return name + QChar(0x1F) + comments;
+    }
+
+    using BindResult = std::expected<void, QString>;
+
+    struct TableSpec
+    {
+        const char *table;
+        const char *selectSql; // columns aliased to the field names, in file order
+        QStringList fields;
+        QStringList requiredFields;
+        const char *insertSql;
+        // Binds one record to the insert statement, or says why it cannot be inserted
+        BindResult (*bind)(const QVector<QVariant> &values, const Lookups &lookups, QSqlQuery &insert);
+        const char *lookupSql;                // id and name key of the imported rows, nullptr if nothing refers to them
+        QHash<QString, int> Lookups::*lookup; // filled from lookupSql after the table was imported
+    };
+
+    BindResult bindAll(const QVector<QVariant> &values, const Lookups &, QSqlQuery &insert)
+    {
+        for (qsizetype i = 0; i < values.size(); ++i)
+            insert.bindValue(static_cast<int>(i), values[i]);
+        return {};
+    }
+
+    std::expected<int, QString> resolve(const QHash<QString, int> &lookup, const QString &key, const char *what)
+    {
+        const auto it = lookup.constFind(key);
+        if (it == lookup.cend())
+            return std::unexpected(QString("unknown %1 \"%2\"").arg(what, key));
+        return it.value();
+    }
+
+    // Tables in dependency order, referenced tables first
+    const std::vector<TableSpec> &tableSpecs()
+    {
+        static const std::vector<TableSpec> specs = {
+            {"filter_types", "SELECT name, priority FROM filter_types ORDER BY id",
+             {"name", "priority"}, {"name"},
+             "INSERT OR IGNORE INTO filter_types (name, priority) VALUES (?, ?)",
+             [](const QVector<QVariant> &values, const Lookups &, QSqlQuery &insert) -> BindResult
+             {
+                 insert.bindValue(0, values[0]);
+                 insert.bindValue(1, values[1].isNull() ? QVariant(0) : values[1]);
+                 return {};
+             },
+             "SELECT id, name FROM filter_types", &Lookups::filterTypes},
+            {"cameras", "SELECT name, sensor, pixel_size, width, height FROM cameras ORDER BY id",
+             {"name", "sensor", "pixel_size", "width", "height"}, {"name", "sensor", "pixel_size", "width", "height"},
+             "INSERT OR IGNORE INTO cameras (name, sensor, pixel_size, width, height) VALUES (?, ?, ?, ?, ?)",
+             bindAll, "SELECT id, name FROM cameras", &Lookups::cameras},
+            {"telescopes", "SELECT name, aperture, f_ratio, focal_length FROM telescopes ORDER BY id",
+             {"name", "aperture", "f_ratio", "focal_length"}, {"name", "aperture", "f_ratio", "focal_length"},
+             "INSERT OR IGNORE INTO telescopes (name, aperture, f_ratio, focal_length) VALUES (?, ?, ?, ?)",
+             bindAll, "SELECT id, name FROM telescopes", &Lookups::telescopes},
+            {"objects", "SELECT name, ra, dec, comments FROM objects ORDER BY id",
+             {"name", "ra", "dec", "comments"}, {"name"},
+             "INSERT OR IGNORE INTO objects (name, ra, dec, comments) VALUES (?, ?, ?, ?)",
+             bindAll, "SELECT id, name || char(31) || IFNULL(comments, '') FROM objects", &Lookups::objects},
+            {"sessions", "SELECT name, start_date, moon_illumination, moon_ra, moon_dec, comments FROM sessions ORDER BY id",
+             {"name", "start_date", "moon_illumination", "moon_ra", "moon_dec", "comments"}, {"name", "start_date"},
+             "INSERT OR IGNORE INTO sessions (name, start_date, moon_illumination, moon_ra, moon_dec, comments, start_jd) "
+             "VALUES (?, ?, ?, ?, ?, ?, ?)",
+             [](const QVector<QVariant> &values, const Lookups &lookups, QSqlQuery &insert) -> BindResult
+             {
+                 const QDate startDate = QDate::fromString(values[1].toString(), Qt::ISODate);
+                 if (!startDate.isValid())
+                     return std::unexpected(QString("invalid start date \"%1\"").arg(values[1].toString()));
+                 bindAll(values, lookups, insert);
+                 insert.bindValue(1, startDate.toString(Qt::ISODate));
+                 insert.bindValue(6, startDate.toJulianDay());
+                 return {};
+             },
+             "SELECT id, name FROM sessions", &Lookups::sessions},
+            {"filters", R"(SELECT f.name AS name, ft.name AS filter_type
+                          FROM filters f LEFT JOIN filter_types ft ON f.filter_type_id = ft.id ORDER BY f.id)",
+             {"name", "filter_type"}, {"name", "filter_type"},
+             "INSERT OR IGNORE INTO filters (name, filter_type_id) VALUES (?, ?)",
+             [](const QVector<QVariant> &values, const Lookups &lookups, QSqlQuery &insert) -> BindResult
+             {
+                 const auto filterType = resolve(lookups.filterTypes, values[1].toString(), "filter type");
+                 if (!filterType)
+                     return std::unexpected(filterType.error());
+                 insert.bindValue(0, values[0]);
+                 insert.bindValue(1, filterType.value());
+                 return {};
+             },
+             "SELECT id, name FROM filters", &Lookups::filters},
+            {"observations", R"(SELECT s.name AS session, obj.name AS object, obj.comments AS object_comments,
+                                       c.name AS camera, t.name AS telescope, f.name AS filter,
+                                       o.image_count AS image_count, o.exposure_length AS exposure_length,
+                                       o.total_exposure AS total_exposure, o.comments AS comments
+                                FROM observations o
+                                LEFT JOIN sessions s ON o.session_id = s.id
+                                LEFT JOIN objects obj ON o.object_id = obj.id
+                                LEFT JOIN cameras c ON o.camera_id = c.id
+                                LEFT JOIN telescopes t ON o.telescope_id = t.id
+                                LEFT JOIN filters f ON o.filter_id = f.id
+                                ORDER BY o.id)",
+             {"session", "object", "object_comments", "camera", "telescope", "filter", "image_count",
+              "exposure_length", "total_exposure", "comments"},
+             {"session", "object", "camera", "telescope", "filter", "image_count", "exposure_length"},
+             R"(INSERT INTO observations (image_count, exposure_length, total_exposure, comments,
+                                         session_id, object_id, camera_id, telescope_id, filter_id)
+                VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?))",
+             [](const QVector<QVariant> &values, const Lookups &lookups, QSqlQuery &insert) -> BindResult
+             {
+                 const auto session = resolve(lookups.sessions, values[0].toString(), "session");
+                 const auto object = resolve(lookups.objects, objectKey(values[1].toString(), values[2].toString()), "object");
+                 const auto camera = resolve(lookups.cameras, values[3].toString(), "camera");
+                 const auto telescope = resolve(lookups.telescopes, values[4].toString(), "telescope");
+                 const auto filter = resolve(lookups.filters, values[5].toString(), "filter");
+                 for (const auto *resolved : {&session, &object, &camera, &telescope, &filter})
+                 {
+                     if (!*resolved)
+                         return std::unexpected(resolved->error());
+                 }
+
+                 bool countOk = false;
+                 bool lengthOk = false;
+                 const int imageCount = values[6].toInt(&countOk);
+                 const int exposureLength = values[7].toInt(&lengthOk);
+                 if (!countOk || !lengthOk)
+                     return std::unexpected(QString("image count and exposure length must be whole numbers"));
+
+                 // The total is derived, like when observations are entered
+                 insert.bindValue(0, imageCount);
+                 insert.bindValue(1, exposureLength);
+                 insert.bindValue(2, imageCount * exposureLength);
+                 insert.bindValue(3, values[9]);
+                 insert.bindValue(4, session.value());
+                 insert.bindValue(5, object.value());
+                 insert.bindValue(6, camera.value());
+                 insert.bindValue(7, telescope.value());
+                 insert.bindValue(8, filter.value());
+                 return {};
+             },
+             nullptr, nullptr},
+        };
+        return specs;
+    }
+
+    QString dumpFileName(const char *table, const DumpFormat format)
+    {
+        return QString::fromLatin1(table) + (format == DumpFormat::Csv ? ".csv" : ".jsonl");
+    }
+
+    // RFC 4180, quoted only when needed
+    void writeCsvField(Utf8Writer &writer, const std::string_view utf8)
+    {
+        if (utf8.find_first_of(",\"\r\n") == std::string_view::npos &&
+            (utf8.empty() || (utf8.front() != ' ' && utf8.back() != ' ')))
+        {
+            writer.writeRaw(QByteArrayView(utf8.data(), static_cast<qsizetype>(utf8.size())));
+            return;
+        }
+
+        writer.writeRaw("\"");
+        std::size_t start = 0;
+        for (std::size_t quote = utf8.find('"'); quote != std::string_view::npos; quote = utf8.find('"', start))
+        {
+            writer.writeRaw(QByteArrayView(utf8.data() + start, static_cast<qsizetype>(quote + 1 - start)));
+            writer.writeRaw("\"");
+            start = quote + 1;
+        }
+        writer.writeRaw(QByteArrayView(utf8.data() + start, static_cast<qsizetype>(utf8.size() - start)));
+        writer.writeRaw("\"");
+    }
+
+    void writeJsonString(Utf8Writer &writer, const std::string_view utf8)
+    {
+        static const char hexDigits[] = "0123456789abcdef";
+
+        writer.writeRaw("\"");
+        std::size_t start = 0;
+        for (std::size_t i = 0; i < utf8.size(); ++i)
+        {
+            const auto c = static_cast<unsigned char>(utf8[i]);
+            if (c >= 0x20 && c != '"' && c != '\\')
+                continue;
+
+            writer.writeRaw(QByteArrayView(utf8.data() + start, static_cast<qsizetype>(i - start)));
+            switch (c)
+            {
+            case '"':
+                writer.writeRaw("\\\"");
+                break;
+            case '\\':
+                writer.writeRaw("\\\\");
+                break;
+            case '\n':
+                writer.writeRaw("\\n");
+                break;
+            case '\r':
+                writer.writeRaw("\\r");
+                break;
+            case '\t':
+                writer.writeRaw("\\t");
+                break;
+            default:
+            {
+                const char escape[] = {'\\', 'u', '0', '0', hexDigits[c >> 4], hexDigits[c & 0xF]};
+                writer.writeRaw(QByteArrayView(escape, sizeof(escape)));
+                break;
+            }
+            }
+            start = i + 1;
+        }
+        writer.writeRaw(QByteArrayView(utf8.data() + start, static_cast<qsizetype>(utf8.size() - start)));
+        writer.writeRaw("\"");
+    }
+
+    std::expected<int, ER> countRows(DatabaseManager *dbManager, const char *table)
+    {
+        SqlStatement stmt(dbManager, QString("SELECT COUNT(*) FROM %1").arg(QLatin1String(table)));
+        if (!stmt.exec() || !stmt.next())
+        {
+            return std::unexpected(ER::Error(QString("Query failed: %1").arg(stmt.lastError())));
+        }
+        return stmt.toInt(0);
+    }
+}
+
+TableDumper::TableDumper(DatabaseManager *dbManager)
+    : m_dbManager(dbManager)
+{
+}
+
+std::expected<int, ER> TableDumper::dump(const QString &directory, const DumpFormat format,
+                                         const ExportProgress &progress) const
+{
+    TRACE_SPAN("TableDumper::dump", "export");
+    int totalRows = 0;
+    for (const TableSpec &spec : tableSpecs())
+    {
+        auto count = countRows(m_dbManager, spec.table);
+        if (!count)
+        {
+            return std::unexpected(count.error());
+        }
+        totalRows += count.value();
+    }
+
+    // Committed together at the end, a failed dump leaves all earlier files in place
+    std::vector<std::unique_ptr<QSaveFile>> files;
+    int writtenRows = 0;
+    for (const TableSpec &spec : tableSpecs())
+    {
+        auto &file = files.emplace_back(std::make_unique<QSaveFile>(QDir(directory).filePath(dumpFileName(spec.table, format))));
+        if (!file->open(QIODevice::WriteOnly))
+        {
+            return std::unexpected(ER::Error(QString("Failed to write %1: %2").arg(file->fileName(), file->errorString())));
+        }
+        Utf8Writer writer(file.get());
+
+        SqlStatement stmt(m_dbManager, spec.selectSql);
+        if (!stmt.exec())
+        {
+            return std::unexpected(ER::Error(QString("Query failed: %1").arg(stmt.lastError())));
+        }
+
+        // Field names are encoded once per table
+        const int columnCount = stmt.columnCount();
+        QList<QByteArray> jsonKeys;
+        for (int column = 0; column < columnCount; ++column)
+        {
+            const QByteArray name = stmt.columnName(column).toUtf8();
+            if (format == DumpFormat::Csv)
+            {
+                if (column > 0)
+                    writer.writeRaw(",");
+                writeCsvField(writer, std::string_view(name.constData(), name.size()));
+            }
+            else
+            {
+                jsonKeys.append((column > 0 ? ",\"" : "{\"") + name + "\":");
+            }
+        }
+        if (format == DumpFormat::Csv)
+            writer.writeRaw("\r\n");
+
+        while (stmt.next())
+        {
+            for (int column = 0; column < columnCount; ++column)
+            {
+                if (format == DumpFormat::Csv)
+                {
+                    if (column > 0)
+                        writer.writeRaw(",");
+                    if (!stmt.isNull(column))
+                        writeCsvField(writer, stmt.toUtf8(column));
+                }
+                else
+                {
+                    writer.writeRaw(jsonKeys[column]);
+                    if (stmt.isNull(column))
+                        writer.writeRaw("null");
+                    else if (stmt.isNumeric(column))
+                    {
+                        const std::string_view number = stmt.toUtf8(column);
+                        writer.writeRaw(QByteArrayView(number.data(), static_cast<qsizetype>(number.size())));
+                    }
+                    else
+                        writeJsonString(writer, stmt.toUtf8(column));
+                }
+            }
+            writer.writeRaw(format == DumpFormat::Csv ? "\r\n" : "}\n");
+
+            ++writtenRows;
+            if (!writer.ok() || (progress && !progress(writtenRows, totalRows)))
+                break;
+        }
+
+        if (!stmt.lastError().isEmpty())
+        {
+            return std::unexpected(ER::Error(QString("Query failed: %1").arg(stmt.lastError())));
+        }
+        if (!writer.flush())
+        {
+            return std::unexpected(ER::Error(QString("Failed to write %1: %2").arg(file->fileName(), writer.errorString())));
+        }
+        if (progress && !progress(writtenRows, totalRows))
+        {
+            return std::unexpected(ER::Warning("Dump cancelled"));
+        }
+    }
+
+    for (const auto &file : files)
+    {
+        if (!file->commit())
+        {
+            return std::unexpected(ER::Error(QString("Failed to write %1: %2").arg(file->fileName(), file->errorString())));
+        }
+    }
+    return writtenRows;
+}
+
+TableImporter::TableImporter(DatabaseManager *dbManager)
+    : m_dbManager(dbManager)
+{
+}
+
+std::expected<ImportReport, ER> TableImporter::import(const QString &directory, const DumpFormat format,
+                                                      const ImportProgress &progress) const
+{
+    TRACE_SPAN("TableImporter::import", "export");
+    QElapsedTimer elapsed;
+    elapsed.start();
+
+    qint64 totalBytes = 0;
+    for (const TableSpec &spec : tableSpecs())
+    {
+        const QFileInfo fileInfo(QDir(directory).filePath(dumpFileName(spec.table, format)));
+        if (fileInfo.exists())
+            totalBytes += fileInfo.size();
+    }
+    if (totalBytes == 0)
+    {
+        return std::unexpected(ER::Warning(QString("No %1 files to import in %2")
+                                               .arg(format == DumpFormat::Csv ? ".csv" : ".jsonl", directory)));
+    }
+
+    QSqlDatabase &db = m_dbManager->database();
+    ImportReport report;
+    Lookups lookups;
+    qint64 bytesBefore = 0; // size of the files already imported
+    const auto skip = [&report](const QString &problem)
+    {
+        ++report.skippedRows;
+        if (report.problems.size() < maxReportedProblems)
+            report.problems.append(problem);
+    };
+
+    for (const TableSpec &spec : tableSpecs())
+    {
+        QFile file(QDir(directory).filePath(dumpFileName(spec.table, format)));
+        if (file.exists())
+        {
+            if (!file.open(QIODevice::ReadOnly))
+            {
+                return std::unexpected(ER::Error(QString("Failed to open %1: %2").arg(file.fileName(), file.errorString())));
+            }
+
+            const auto reader = RecordReader::create(file.fileName(), &file);
+            if (auto opened = reader->open(spec.fields, spec.requiredFields); !opened)
+            {
+                return std::unexpected(ER::Error(QString("%1: %2").arg(file.fileName(), opened.error().errorMessage)));
+            }
+
+            QSqlQuery insert(db);
+            if (!insert.prepare(spec.insertSql))
+            {
+                return std::unexpected(ER::Error(QString("Failed to prepare import: %1").arg(insert.lastError().text())));
+            }
+
+            QVector<QVariant> values;
+            int batchRows = 0;
+            db.transaction();
+            while (true)
+            {
+                auto read = reader->next(values);
+                if (!read)
+                {
+                    db.rollback();
+                    return std::unexpected(ER::Error(QString("%1: %2").arg(file.fileName(), read.error().errorMessage)));
+                }
+                if (!read.value())
+                    break;
+
+                const QString location = QString("%1 line %2").arg(QFileInfo(file).fileName()).arg(reader->lineNumber());
+                bool complete = true;
+                for (qsizetype i = 0; i < spec.fields.size(); ++i)
+                {
+                    if (values[i].isNull() && spec.requiredFields.contains(spec.fields[i]))
+                    {
+                        skip(QString("%1: %2 is empty").arg(location, spec.fields[i]));
+                        complete = false;
+                        break;
+                    }
+                }
+                if (!complete)
+                    continue;
+
+                if (auto bound = spec.bind(values, lookups, insert); !bound)
+                {
+                    skip(QString("%1: %2").arg(location, bound.error()));
+                    continue;
+                }
+                if (!insert.exec())
+                {
+                    skip(QString("%1: %2").arg(location, insert.lastError().text()));
+                    continue;
+                }
+                if (insert.numRowsAffected() == 0)
+                {
+                    // Kept by INSERT OR IGNORE, a row with the same name exists already
+                    ++report.skippedRows;
+                    continue;
+                }
+                ++report.importedRows;
+
+                if (++batchRows == importBatchSize)
+                {
+                    if (!db.commit())
+                    {
+                        return std::unexpected(ER::Error(QString("Failed to commit import: %1").arg(db.lastError().text())));
+                    }
+                    db.transaction();
+                    batchRows = 0;
+
+                    if (progress && !progress(bytesBefore + file.pos(), totalBytes, report.importedRows))
+                    {
+                        db.rollback();
+                        report.problems.append("Import stopped, the rows above were kept");
+                        report.seconds = elapsed.elapsed() / 1000.0;
+                        return report;
+                    }
+                }
+            }
+            if (!db.commit())
+            {
+                return std::unexpected(ER::Error(QString("Failed to commit import: %1").arg(db.lastError().text())));
+            }
+            bytesBefore += file.size();
+            if (progress)
+                progress(bytesBefore, totalBytes, report.importedRows);
+        }
+
+        // Later tables refer to this one by name, including rows that existed before the import
+        if (spec.lookupSql)
+        {
+            SqlStatement stmt(m_dbManager, spec.lookupSql);
+            if (!stmt.exec())
+            {
+                return std::unexpected(ER::Error(QString("Query failed: %1").arg(stmt.lastError())));
+            }
+            QHash<QString, int> &lookup = lookups.*spec.lookup;
+            while (stmt.next())
+            {
+                lookup.insert(stmt.toString(1), stmt.toInt(0));
+            }
+        }
+    }
+
+    report.seconds = elapsed.elapsed() / 1000.0;
+    return report;
+}
@@ -0,0 +1,145 @@
+#include "export/utf8writer.h"
+#include <QIODevice>
+#include <charconv>
+
+Utf8Writer::Utf8Writer(QIODevice *device, const qsizetype bufferSize)
+    : m_device(device), m_encoder(QStringEncoder::Utf8), m_capacity(bufferSize), m_bytesWritten(0), m_ok(true)
+{
+    m_buffer.reserve(m_capacity);
+}
+
+Utf8Writer::~Utf8Writer()
+{
+    flush();
+}
+
+void Utf8Writer::writeRaw(const QByteArrayView bytes)
+{
+    reserve(bytes.size());
+    if (bytes.size() > m_capacity)
+    {
+        // Larger than the buffer, nothing to gain from copying it first
+        if (m_ok && m_device->write(bytes.data(), bytes.size()) != bytes.size())
+            m_ok = false;
+    }
+    else
+    {
+        m_buffer.append(bytes);
+    }
+    m_bytesWritten += bytes.size();
+}
+
+void Utf8Writer::write(const QStringView text)
+{
+    // Encode in slices so that long texts do not need a temporary of their full size
+    constexpr qsizetype sliceLength = 4096;
+    for (qsizetype pos = 0; pos < text.size(); pos += sliceLength)
+    {
+        qsizetype length = qMin(sliceLength, text.size() - pos);
+        // Do not split a surrogate pair between two slices
+        if (pos + length < text.size() && text[pos + length - 1].isHighSurrogate())
+            --length;
+
+        const QStringView slice = text.mid(pos, length);
+        reserve(slice.size() * 3);
+        const qsizetype oldSize = m_buffer.size();
+        m_buffer.resize(oldSize + slice.size() * 3);
+        char *end = m_encoder.appendToBuffer(m_buffer.data() + oldSize, slice);
+        m_buffer.resize(end - m_buffer.constData());
+        m_bytesWritten += m_buffer.size() - oldSize;
+
+        pos -= sliceLength - length;
+    }
+}
+
+void Utf8Writer::writeHtmlEscaped(const QStringView text)
+{
+    qsizetype plainStart = 0;
+    for (qsizetype i = 0; i < text.size(); ++i)
+    {
+        const char *entity = nullptr;
+        switch (text[i].unicode())
+        {
+        case '&':
+            entity = "&amp;";
+            break;
+        case '<':
+            entity = "&lt;";
+            break;
+        case '>':
+            entity = "&gt;";
+            break;
+        case '"':
+            entity = "&quot;";
+            break;
+        default:
+            continue;
+        }
+        write(text.mid(plainStart, i - plainStart));
+        writeRaw(entity);
+        plainStart = i + 1;
+    }
+    write(text.mid(plainStart));
+}
+
+void Utf8Writer::writeXmlEscaped(const QStringView text)
+{
+    qsizetype validStart = 0;
+    for (qsizetype i = 0; i < text.size(); ++i)
+    {
+        const char16_t c = text[i].unicode();
+        if ((c < 0x20 && c != '\t' && c != '\n' && c != '\r') || c == 0xFFFE || c == 0xFFFF)
+        {
+            writeHtmlEscaped(text.mid(validStart, i - validStart));
+            validStart = i + 1;
+        }
+    }
+    writeHtmlEscaped(text.mid(validStart));
+}
+
+void Utf8Writer::writeNumber(const qint64 value)
+{
+    char digits[24];
+    const auto result = std::to_chars(std::begin(digits), std::end(digits), value);
+    writeRaw(QByteArrayView(digits, result.ptr - digits));
+}
+
+void Utf8Writer::writeNumber(const double value, const int decimals)
+{
+    char digits[64];
+    if (const auto result = std::to_chars(std::begin(digits), std::end(digits), value, std::chars_format::fixed, decimals);
+        result.ec == std::errc())
+    {
+        writeRaw(QByteArrayView(digits, result.ptr - digits));
+        return;
+    }
+    // Only huge magnitudes do not fit
+    writeRaw(QByteArray::number(value, 'f', decimals));
+}
+
+void Utf8Writer::writeDouble(const double value)
+{
+    char digits[32];
+    const auto result = std::to_chars(std::begin(digits), std::end(digits), value);
+    writeRaw(QByteArrayView(digits, result.ptr - digits));
+}
+
+bool Utf8Writer::flush()
+{
+    if (m_ok && !m_buffer.isEmpty() && m_device->write(m_buffer) != m_buffer.size())
+        m_ok = false;
+    // Keeps the allocation, clear() would free it and the next write allocate it again
+    m_buffer.resize(0);
+    return m_ok;
+}
+
+QString Utf8Writer::errorString() const
+{
+    return m_ok ? QString() : m_device->errorString();
+}
+
+void Utf8Writer::reserve(const qsizetype size)
+{
+    if (m_buffer.size() + size > m_capacity)
+        flush();
+}
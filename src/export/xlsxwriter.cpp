@@ -0,0 +1,387 @@
+#include "export/xlsxwriter.h"
+#include "export/utf8writer.h"
+#include "trace.h"
+#include <QBuffer>
+#include <QDir>
+#include <QTemporaryFile>
+#include <algorithm>
+#include <tuple>
+#include <zip.h>
+
+namespace
+{
+    const char *const xmlHeader = "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n";
+    const char *const mainNamespace = "http://schemas.openxmlformats.org/spreadsheetml/2006/main";
+    const char *const relationshipNamespace = "http://schemas.openxmlformats.org/officeDocument/2006/relationships";
+
+    // "A", "B", ..., "Z", "AA", ... for a zero based column
+    QByteArray columnName(int column)
+    {
+        QByteArray name;
+        do
+        {
+            name.prepend(static_cast<char>('A' + column % 26));
+            column = column / 26 - 1;
+        } while (column >= 0);
+        return name;
+    }
+
+    QByteArray contentTypesXml(const qsizetype sheetCount)
+    {
+        QByteArray xml = xmlHeader;
+        xml += "<Types xmlns=\"http://schemas.openxmlformats.org/package/2006/content-types\">"
+               "<Default Extension=\"rels\" ContentType=\"application/vnd.openxmlformats-package.relationships+xml\"/>"
+               "<Default Extension=\"xml\" ContentType=\"application/xml\"/>"
+               "<Override PartName=\"/xl/workbook.xml\" "
+               "ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.sheet.main+xml\"/>"
+               "<Override PartName=\"/xl/styles.xml\" "
+               "ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.styles+xml\"/>"
+               "<Override PartName=\"/xl/sharedStrings.xml\" "
+               "ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.sharedStrings+xml\"/>";
+        for (qsizetype sheet = 1; sheet <= sheetCount; ++sheet)
+        {
+            xml += "<Override PartName=\"/xl/worksheets/sheet" + QByteArray::number(sheet) +
+                   ".xml\" ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.worksheet+xml\"/>";
+        }
+        xml += "</Types>";
+        return xml;
+    }
+
+    QByteArray packageRelationshipsXml()
+    {
+        QByteArray xml = xmlHeader;
+        xml += "<Relationships xmlns=\"http://schemas.openxmlformats.org/package/2006/relationships\">"
+               "<Relationship Id=\"rId1\" Type=\"" + QByteArray(relationshipNamespace) +
+               "/officeDocument\" Target=\"xl/workbook.xml\"/></Relationships>";
+        return xml;
+    }
+
+    QByteArray workbookXml(const QStringList &sheetNames)
+    {
+        QByteArray xml = xmlHeader;
+        xml += "<workbook xmlns=\"" + QByteArray(mainNamespace) + "\" xmlns:r=\"" + relationshipNamespace + "\"><sheets>";
+        for (qsizetype sheet = 1; sheet <= sheetNames.size(); ++sheet)
+        {
+            const QByteArray number = QByteArray::number(sheet);
+            xml += "<sheet name=\"" + sheetNames[sheet - 1].toHtmlEscaped().toUtf8() + "\" sheetId=\"" + number +
+                   "\" r:id=\"rId" + number + "\"/>";
+        }
+        xml += "</sheets></workbook>";
+        return xml;
+    }
+
+    // Sheets are rId1..rIdN, styles and shared strings follow them
+    QByteArray workbookRelationshipsXml(const qsizetype sheetCount)
+    {
+        QByteArray xml = xmlHeader;
+        xml += "<Relationships xmlns=\"http://schemas.openxmlformats.org/package/2006/relationships\">";
+        for (qsizetype sheet = 1; sheet <= sheetCount; ++sheet)
+        {
+            const QByteArray number = QByteArray::number(sheet);
+            xml += "<Relationship Id=\"rId" + number + "\" Type=\"" + QByteArray(relationshipNamespace) +
+                   "/worksheet\" Target=\"worksheets/sheet" + number + ".xml\"/>";
+        }
+        xml += "<Relationship Id=\"rId" + QByteArray::number(sheetCount + 1) + "\" Type=\"" +
+               QByteArray(relationshipNamespace) + "/styles\" Target=\"styles.xml\"/>";
+        xml += "<Relationship Id=\"rId" + QByteArray::number(sheetCount + 2) + "\" Type=\"" +
+               QByteArray(relationshipNamespace) + "/sharedStrings\" Target=\"sharedStrings.xml\"/>";
+        xml += "</Relationships>";
+        return xml;
+    }
+
+    // Only the default style, which every workbook needs
+    QByteArray stylesXml()
+    {
+        QByteArray xml = xmlHeader;
+        xml += "<styleSheet xmlns=\"" + QByteArray(mainNamespace) + "\">"
+               "<fonts count=\"1\"><font><sz val=\"11\"/><name val=\"Calibri\"/></font></fonts>"
+               "<fills count=\"2\"><fill><patternFill patternType=\"none\"/></fill>"
+               "<fill><patternFill patternType=\"gray125\"/></fill></fills>"
+               "<borders count=\"1\"><border><left/><right/><top/><bottom/><diagonal/></border></borders>"
+               "<cellStyleXfs count=\"1\"><xf numFmtId=\"0\" fontId=\"0\" fillId=\"0\" borderId=\"0\"/></cellStyleXfs>"
+               "<cellXfs count=\"1\"><xf numFmtId=\"0\" fontId=\"0\" fillId=\"0\" borderId=\"0\" xfId=\"0\"/></cellXfs>"
+               "<cellStyles count=\"1\"><cellStyle name=\"Normal\" xfId=\"0\" builtinId=\"0\"/></cellStyles>"
+               "</styleSheet>";
+        return xml;
+    }
+
+    QByteArray sharedStringsXml(const QStringList &strings, const qint64 references)
+    {
+        QByteArray xml;
+        QBuffer buffer(&xml);
+        buffer.open(QIODevice::WriteOnly);
+        {
+            Utf8Writer writer(&buffer);
+            writer.writeRaw(xmlHeader);
+            writer.writeRaw("<sst xmlns=\"");
+            writer.writeRaw(mainNamespace);
+            writer.writeRaw("\" count=\"");
+            writer.writeNumber(references);
+            writer.writeRaw("\" uniqueCount=\"");
+            writer.writeNumber(static_cast<qint64>(strings.size()));
+            writer.writeRaw("\">");
+            for (const QString &text : strings)
+            {
+                writer.writeRaw("<si><t xml:space=\"preserve\">");
+                writer.writeXmlEscaped(text);
+                writer.writeRaw("</t></si>");
+            }
+            writer.writeRaw("</sst>");
+        }
+        return xml;
+    }
+}
+
+XlsxWriter::XlsxWriter(const QString &fileName)
+    : m_fileName(fileName), m_column(0), m_sharedStringRefs(0), m_closed(false)
+{
+}
+
+XlsxWriter::~XlsxWriter() = default;
+
+void XlsxWriter::beginSheet(const QString &name, const QList<double> &columnWidths)
+{
+    if (m_writer)
+        std::ignore = finishSheet();
+
+    Sheet sheet;
+    sheet.name = uniqueSheetName(name);
+    sheet.file = std::make_unique<QTemporaryFile>(QDir::temp().filePath("obslog_sheet_XXXXXX.xml"));
+    // An unopened file makes the writer fail, the error is reported by close()
+    sheet.file->open();
+    m_writer = std::make_unique<Utf8Writer>(sheet.file.get());
+    m_sheets.push_back(std::move(sheet));
+
+    m_writer->writeRaw(xmlHeader);
+    m_writer->writeRaw("<worksheet xmlns=\"");
+    m_writer->writeRaw(mainNamespace);
+    m_writer->writeRaw("\">");
+    if (!columnWidths.isEmpty())
+    {
+        m_writer->writeRaw("<cols>");
+        for (qsizetype column = 1; column <= columnWidths.size(); ++column)
+        {
+            m_writer->writeRaw("<col min=\"");
+            m_writer->writeNumber(static_cast<qint64>(column));
+            m_writer->writeRaw("\" max=\"");
+            m_writer->writeNumber(static_cast<qint64>(column));
+            m_writer->writeRaw("\" width=\"");
+            m_writer->writeDouble(columnWidths[column - 1]);
+            m_writer->writeRaw("\" customWidth=\"1\"/>");
+        }
+        m_writer->writeRaw("</cols>");
+    }
+    m_writer->writeRaw("<sheetData>");
+}
+
+int XlsxWriter::sharedString(const QString &text)
+{
+    auto it = m_sharedStringIndex.constFind(text);
+    if (it == m_sharedStringIndex.cend())
+    {
+        it = m_sharedStringIndex.insert(text, static_cast<int>(m_sharedStrings.size()));
+        m_sharedStrings.append(text);
+    }
+    return it.value();
+}
+
+void XlsxWriter::beginRow(const int row)
+{
+    if (!m_writer)
+        beginSheet("Sheet1");
+
+    m_rowNumber = QByteArray::number(row);
+    m_column = 0;
+    m_writer->writeRaw("<row r=\"");
+    m_writer->writeRaw(m_rowNumber);
+    m_writer->writeRaw("\">");
+}
+
+void XlsxWriter::addSharedString(const int index)
+{
+    beginCell("s");
+    m_writer->writeRaw("<v>");
+    m_writer->writeNumber(static_cast<qint64>(index));
+    m_writer->writeRaw("</v></c>");
+    ++m_sharedStringRefs;
+}
+
+void XlsxWriter::addString(const QStringView text)
+{
+    beginCell("inlineStr");
+    m_writer->writeRaw("<is><t xml:space=\"preserve\">");
+    m_writer->writeXmlEscaped(text);
+    m_writer->writeRaw("</t></is></c>");
+}
+
+void XlsxWriter::addNumber(const qint64 value)
+{
+    beginCell(nullptr);
+    m_writer->writeRaw("<v>");
+    m_writer->writeNumber(value);
+    m_writer->writeRaw("</v></c>");
+}
+
+void XlsxWriter::addNumber(const double value)
+{
+    beginCell(nullptr);
+    m_writer->writeRaw("<v>");
+    m_writer->writeDouble(value);
+    m_writer->writeRaw("</v></c>");
+}
+
+void XlsxWriter::skipCell()
+{
+    ++m_column;
+}
+
+void XlsxWriter::endRow()
+{
+    m_writer->writeRaw("</row>");
+}
+
+std::expected<void, ER> XlsxWriter::close()
+{
+    TRACE_SPAN("XlsxWriter::close", "export");
+    if (m_closed)
+        return {};
+    m_closed = true;
+
+    if (m_sheets.empty())
+        beginSheet("Sheet1");
+    if (auto finished = finishSheet(); !finished)
+        return finished;
+
+    QStringList sheetNames;
+    for (const Sheet &sheet : m_sheets)
+        sheetNames.append(sheet.name);
+
+    // Buffers must stay alive until zip_close() has read them
+    const QList<QPair<const char *, QByteArray>> parts = {
+        {"[Content_Types].xml", contentTypesXml(m_sheets.size())},
+        {"_rels/.rels", packageRelationshipsXml()},
+        {"xl/workbook.xml", workbookXml(sheetNames)},
+        {"xl/_rels/workbook.xml.rels", workbookRelationshipsXml(m_sheets.size())},
+        {"xl/styles.xml", stylesXml()},
+        {"xl/sharedStrings.xml", sharedStringsXml(m_sharedStrings, m_sharedStringRefs)},
+    };
+
+    int errorp;
+    zip_t *archive = zip_open(m_fileName.toUtf8().constData(), ZIP_CREATE | ZIP_TRUNCATE, &errorp);
+    if (!archive)
+    {
+        zip_error_t ziperror;
+        zip_error_init_with_code(&ziperror, errorp);
+        const QString errorMessage = QString("Failed to create Excel file: %1").arg(zip_error_strerror(&ziperror));
+        zip_error_fini(&ziperror);
+        return std::unexpected(ER::Error(errorMessage));
+    }
+
+    const auto fail = [archive](const QString &what)
+    {
+        const QString errorMessage = QString("%1: %2").arg(what, zip_strerror(archive));
+        zip_discard(archive);
+        return std::unexpected(ER::Error(errorMessage));
+    };
+
+    for (const auto &[name, content] : parts)
+    {
+        zip_source_t *source = zip_source_buffer(archive, content.constData(), content.size(), 0);
+        if (!source)
+            return fail("Failed to create zip source");
+        if (zip_file_add(archive, name, source, ZIP_FL_ENC_UTF_8) < 0)
+        {
+            zip_source_free(source);
+            return fail("Failed to add file to archive");
+        }
+    }
+
+    // Sheet XML is read from the temporary files while the archive is written
+    for (std::size_t sheet = 0; sheet < m_sheets.size(); ++sheet)
+    {
+        const QByteArray path = m_sheets[sheet].file->fileName().toUtf8();
+        zip_source_t *source = zip_source_file(archive, path.constData(), 0, ZIP_LENGTH_TO_END);
+        if (!source)
+            return fail("Failed to open sheet data");
+
+        const QByteArray name = "xl/worksheets/sheet" + QByteArray::number(static_cast<qint64>(sheet + 1)) + ".xml";
+        if (zip_file_add(archive, name.constData(), source, ZIP_FL_ENC_UTF_8) < 0)
+        {
+            zip_source_free(source);
+            return fail("Failed to add file to archive");
+        }
+    }
+
+    if (zip_close(archive) < 0)
+        return fail("Failed to finalize Excel file");
+
+    return {};
+}
+
+void XlsxWriter::beginCell(const char *type)
+{
+    while (m_columnNames.size() <= m_column)
+        m_columnNames.append(columnName(static_cast<int>(m_columnNames.size())));
+
+    m_writer->writeRaw("<c r=\"");
+    m_writer->writeRaw(m_columnNames[m_column]);
+    m_writer->writeRaw(m_rowNumber);
+    if (type)
+    {
+        m_writer->writeRaw("\" t=\"");
+        m_writer->writeRaw(type);
+    }
+    m_writer->writeRaw("\">");
+    ++m_column;
+}
+
+std::expected<void, ER> XlsxWriter::finishSheet()
+{
+    m_writer->writeRaw("</sheetData></worksheet>");
+    const bool written = m_writer->flush();
+    const QString errorString = m_writer->errorString();
+    m_writer.reset();
+
+    QTemporaryFile *file = m_sheets.back().file.get();
+    if (!written || !file->isOpen())
+    {
+        return std::unexpected(ER::Error("Failed to write sheet data: " +
+                                         (errorString.isEmpty() ? file->errorString() : errorString)));
+    }
+    file->close();
+    return {};
+}
+
+QString XlsxWriter::uniqueSheetName(const QString &name) const
+{
+    constexpr qsizetype maxLength = 31;
+
+    QString base = name;
+    for (QChar &c : base)
+    {
+        if (QStringView(u"[]:*?/\\").contains(c) || c.unicode() < 0x20)
+            c = '_';
+    }
+    // Names must not start or end with an apostrophe
+    while (base.startsWith('\'') || base.endsWith('\''))
+        base = base.startsWith('\'') ? base.mid(1) : base.chopped(1);
+    base = base.trimmed().left(maxLength);
+    if (base.isEmpty())
+        base = "Sheet";
+
+    const auto taken = [this](const QString &candidate)
+    {
+        return std::any_of(m_sheets.cbegin(), m_sheets.cend(), [&candidate](const Sheet &sheet)
+        {
+            return sheet.name.compare(candidate, Qt::CaseInsensitive) == 0;
+        });
+    };
+
+    QString unique = base;
+    for (int number = 2; taken(unique); ++number)
+    {
+        const QString suffix = QString(" (%1)").arg(number);
+        unique = base.left(maxLength - suffix.size()) + suffix;
+    }
+    return unique;
+}
@@ -1,12 +1,15 @@
 #include "mainwindow.h"
 #include "settingsmanager.h"
-#include "db/databasebackup.h"
+#include "trace.h"
 #include <QApplication>
+#include <QCommandLineParser>
 #include <QFileDialog>
 #include <QFileInfo>
 #include <QMessageBox>
 #include <QDir>
+#include <QDebug>
 #include <QStyleHints>
+#include <QTimer>
 
 int main(int argc, char *argv[])
 {
@@ -18,6 +21,20 @@ int main(int argc, char *argv[])
     QApplication::setOrganizationName("Prookyon");
     QApplication::setWindowIcon(QIcon(":/images/icon.ico"));
 
+    // --trace <file> records timing spans and writes them as Chrome trace JSON on exit
+    QCommandLineParser parser;
+    const QCommandLineOption traceOption("trace", "Write a Chrome trace of the session to <file>.", "file");
+    parser.addOption(traceOption);
+    parser.parse(QApplication::arguments());
+    const QString traceFile = parser.value(traceOption);
+    if (!traceFile.isEmpty())
+    {
+        if (Trace::isCompiledIn())
+            Trace::setEnabled(true);
+        else
+            qWarning() << "Tracing is not compiled into this build, configure with -DMONOOBSLOG_TRACING=ON";
+    }
+
     // Initialize settings manager early to check database path
     SettingsManager settingsManager;
     if (!settingsManager.initialize())
@@ -80,22 +97,6 @@ int main(int argc, char *argv[])
         dbPath = selectedPath;
     }
 
-    if (!needsNewPath)
-    { // skip the backup for first run as DB file has not been created yet
-
-        // Check and create database backup if needed
-        DatabaseBackup backupManager;
-        QString backupErrorMessage;
-        if (!backupManager.checkAndBackupIfNeeded(dbPath, backupErrorMessage))
-        {
-            // Backup failed, but we can still continue - just warn the user
-            QMessageBox::warning(nullptr, "Backup Warning",
-                                 QString("Failed to create database backup:\n%1\n\n"
-                                         "The application will continue, but your database may not be backed up.")
-                                     .arg(backupErrorMessage));
-        }
-    }
-
     QString style = settingsManager.style();
     if (!style.isEmpty())
     {
@@ -111,5 +112,19 @@ int main(int argc, char *argv[])
     MainWindow window(dbPath);
     window.show();
 
-    return QApplication::exec();
+    // Skip the backup for first run as the database has just been created. The backup runs
+    // in the background once the event loop is up, the window does not wait for it.
+    if (!needsNewPath)
+    {
+        QTimer::singleShot(0, &window, &MainWindow::startBackup);
+    }
+
+    const int result = QApplication::exec();
+
+    if (Trace::isEnabled())
+    {
+        if (auto written = Trace::writeChromeTrace(traceFile); !written)
+            qWarning() << written.error().errorMessage;
+    }
+    return result;
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 #include "settingsmanager.h"
+#include "db/databasebackup.h"
 #include "db/databasemanager.h"
 #include "tabs/objectstab.h"
 #include "tabs/sessionstab.h"
@@ -12,15 +13,26 @@
 #include "tabs/objectstatstab.h"
 #include "tabs/monthlystatstab.h"
 #include "tabs/settingstab.h"
+#include "tabs/diagnosticstab.h"
 #include "tabs/abouttab.h"
+#include "trace.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QLabel>
 #include <QMessageBox>
+#include <QStatusBar>
+#include <QTimer>
 #include <QVBoxLayout>
 
 MainWindow::MainWindow(const QString &dbPath, QWidget *parent)
     : QMainWindow(parent), ui(new Ui::MainWindow),
       m_dbManager(std::make_unique<DatabaseManager>(this)),
-      m_settingsManager(std::make_unique<SettingsManager>(this))
+      m_settingsManager(std::make_unique<SettingsManager>(this)),
+      m_warmupTimer(new QTimer(this)), m_firstPaintDone(false),
+      m_backup(new DatabaseBackup(this)), m_backupStatusLabel(new QLabel(this))
 {
+    TRACE_SPAN("MainWindow::MainWindow", "startup");
+    m_startupTimer.start();
     ui->setupUi(this);
 
     // Initialize database with the provided path
@@ -40,11 +52,24 @@ MainWindow::MainWindow(const QString &dbPath, QWidget *parent)
                               "Failed to initialize settings. Application may not function correctly.");
     }
 
-    // Initialize all tabs
+    qDebug() << "Startup: database ready at" << m_startupTimer.elapsed() << "ms";
+
+    // Create the tab pages, only the visible tab is built now
     initializeTabs();
 
     // Setup connections
     setupConnections();
+
+    m_backupStatusLabel->hide();
+    ui->statusbar->addPermanentWidget(m_backupStatusLabel);
+    connect(m_backup, &DatabaseBackup::backupStarted, this, [this]
+    {
+        m_backupStatusLabel->setStyleSheet({});
+        m_backupStatusLabel->setToolTip({});
+        m_backupStatusLabel->setText("Backing up database...");
+        m_backupStatusLabel->show();
+    });
+    connect(m_backup, &DatabaseBackup::backupFinished, this, &MainWindow::onBackupFinished);
 }
 
 MainWindow::~MainWindow()
@@ -52,132 +77,201 @@ MainWindow::~MainWindow()
     delete ui;
 }
 
+void MainWindow::startBackup()
+{
+    BackupRetention retention;
+    retention.keepDaily = m_settingsManager->backupKeepDaily();
+    retention.keepWeekly = m_settingsManager->backupKeepWeekly();
+    retention.keepMonthly = m_settingsManager->backupKeepMonthly();
+    m_backup->startBackupIfNeeded(m_dbManager->databasePath(), retention);
+}
+
+void MainWindow::onBackupFinished(const bool success, const QString &message)
+{
+    if (success)
+    {
+        m_backupStatusLabel->setText(message);
+        // Success is only worth a glance
+        QTimer::singleShot(10000, m_backupStatusLabel, &QLabel::hide);
+        return;
+    }
+
+    // Stays visible, no dialog: the application is usable without the backup
+    m_backupStatusLabel->setStyleSheet("color: red;");
+    m_backupStatusLabel->setText("Database backup failed");
+    m_backupStatusLabel->setToolTip(message);
+    qWarning() << "Database backup failed:" << message;
+}
+
 void MainWindow::initializeTabs()
 {
-    // Create tab widgets and add them to tabWidget
-    auto *objectsTabWidget = new QWidget();
-    // ReSharper disable once CppDFAMemoryLeak
-    auto *objectsLayout = new QVBoxLayout(objectsTabWidget);
-    objectsTabWidget->setLayout(objectsLayout);
-    objectsLayout->setContentsMargins(0, 0, 0, 0);
-    ui->tabWidget->addTab(objectsTabWidget, "Objects");
-
-    auto *sessionsTabWidget = new QWidget();
-    // ReSharper disable once CppDFAMemoryLeak
-    auto *sessionsLayout = new QVBoxLayout(sessionsTabWidget);
-    sessionsTabWidget->setLayout(sessionsLayout);
-    sessionsLayout->setContentsMargins(0, 0, 0, 0);
-    ui->tabWidget->addTab(sessionsTabWidget, "Sessions");
-
-    auto *camerasTabWidget = new QWidget();
-    // ReSharper disable once CppDFAMemoryLeak
-    auto *camerasLayout = new QVBoxLayout(camerasTabWidget);
-    camerasTabWidget->setLayout(camerasLayout);
-    camerasLayout->setContentsMargins(0, 0, 0, 0);
-    ui->tabWidget->addTab(camerasTabWidget, "Cameras");
-
-    auto *filterTypesTabWidget = new QWidget();
-    // ReSharper disable once CppDFAMemoryLeak
-    auto *filterTypesLayout = new QVBoxLayout(filterTypesTabWidget);
-    filterTypesTabWidget->setLayout(filterTypesLayout);
-    filterTypesLayout->setContentsMargins(0, 0, 0, 0);
-    ui->tabWidget->addTab(filterTypesTabWidget, "Filter Types");
-
-    auto *filtersTabWidget = new QWidget();
-    // ReSharper disable once CppDFAMemoryLeak
-    auto *filtersLayout = new QVBoxLayout(filtersTabWidget);
-    filtersTabWidget->setLayout(filtersLayout);
-    filtersLayout->setContentsMargins(0, 0, 0, 0);
-    ui->tabWidget->addTab(filtersTabWidget, "Filters");
-
-    auto *telescopesTabWidget = new QWidget();
-    // ReSharper disable once CppDFAMemoryLeak
-    auto *telescopesLayout = new QVBoxLayout(telescopesTabWidget);
-    telescopesTabWidget->setLayout(telescopesLayout);
-    telescopesLayout->setContentsMargins(0, 0, 0, 0);
-    ui->tabWidget->addTab(telescopesTabWidget, "Telescopes");
-
-    auto *observationsTabWidget = new QWidget();
-    // ReSharper disable once CppDFAMemoryLeak
-    auto *observationsLayout = new QVBoxLayout(observationsTabWidget);
-    observationsTabWidget->setLayout(observationsLayout);
-    observationsLayout->setContentsMargins(0, 0, 0, 0);
-    ui->tabWidget->addTab(observationsTabWidget, "Observations");
-
-    auto *objectStatsTabWidget = new QWidget();
-    // ReSharper disable once CppDFAMemoryLeak
-    auto *objectStatsLayout = new QVBoxLayout(objectStatsTabWidget);
-    objectStatsTabWidget->setLayout(objectStatsLayout);
-    objectStatsLayout->setContentsMargins(0, 0, 0, 0);
-    ui->tabWidget->addTab(objectStatsTabWidget, "Object Stats");
-
-    auto *monthlyStatsTabWidget = new QWidget();
-    // ReSharper disable once CppDFAMemoryLeak
-    auto *monthlyStatsLayout = new QVBoxLayout(monthlyStatsTabWidget);
-    monthlyStatsTabWidget->setLayout(monthlyStatsLayout);
-    monthlyStatsLayout->setContentsMargins(0, 0, 0, 0);
-    ui->tabWidget->addTab(monthlyStatsTabWidget, "Monthly Stats");
-
-    auto *settingsTabWidget = new QWidget();
-    // ReSharper disable once CppDFAMemoryLeak
-    auto *settingsLayout = new QVBoxLayout(settingsTabWidget);
-    settingsTabWidget->setLayout(settingsLayout);
-    settingsLayout->setContentsMargins(0, 0, 0, 0);
-    ui->tabWidget->addTab(settingsTabWidget, "Settings");
-
-    auto *aboutTabWidget = new QWidget();
-    // ReSharper disable once CppDFAMemoryLeak
-    auto *aboutLayout = new QVBoxLayout(aboutTabWidget);
-    aboutTabWidget->setLayout(aboutLayout);
-    aboutLayout->setContentsMargins(0, 0, 0, 0);
-    ui->tabWidget->addTab(aboutTabWidget, "About");
-
-    // Create tab instances with the newly created widgets
-    m_objectsTab = std::make_unique<ObjectsTab>(m_dbManager.get(), m_settingsManager.get(), objectsTabWidget);
-    objectsLayout->addWidget(m_objectsTab.get());
-
-    m_sessionsTab = std::make_unique<SessionsTab>(m_dbManager.get(), m_settingsManager.get(), sessionsTabWidget);
-    sessionsLayout->addWidget(m_sessionsTab.get());
-
-    m_camerasTab = std::make_unique<CamerasTab>(m_dbManager.get(), camerasTabWidget);
-    camerasLayout->addWidget(m_camerasTab.get());
-
-    m_filterTypesTab = std::make_unique<FilterTypesTab>(m_dbManager.get(), filterTypesTabWidget);
-    filterTypesLayout->addWidget(m_filterTypesTab.get());
-
-    m_filtersTab = std::make_unique<FiltersTab>(m_dbManager.get(), filtersTabWidget);
-    filtersLayout->addWidget(m_filtersTab.get());
-
-    m_telescopesTab = std::make_unique<TelescopesTab>(m_dbManager.get(), telescopesTabWidget);
-    telescopesLayout->addWidget(m_telescopesTab.get());
-
-    m_observationsTab = std::make_unique<ObservationsTab>(m_dbManager.get(), m_settingsManager.get(), observationsTabWidget);
-    observationsLayout->addWidget(m_observationsTab.get());
-
-    m_objectStatsTab = std::make_unique<ObjectStatsTab>(m_dbManager.get(), objectStatsTabWidget);
-    objectStatsLayout->addWidget(m_objectStatsTab.get());
-
-    m_monthlyStatsTab = std::make_unique<MonthlyStatsTab>(m_dbManager.get(), monthlyStatsTabWidget);
-    monthlyStatsLayout->addWidget(m_monthlyStatsTab.get());
-
-    m_settingsTab = std::make_unique<SettingsTab>(m_dbManager.get(), m_settingsManager.get(), settingsTabWidget);
-    settingsLayout->addWidget(m_settingsTab.get());
-
-    m_aboutTab = std::make_unique<AboutTab>(m_dbManager.get(), aboutTabWidget);
-    aboutLayout->addWidget(m_aboutTab.get());
-
-    // Initialize each tab
-    m_objectsTab->initialize();
-    m_sessionsTab->initialize();
-    m_camerasTab->initialize();
-    m_filterTypesTab->initialize();
-    m_filtersTab->initialize();
-    m_telescopesTab->initialize();
-    m_observationsTab->initialize();
-    m_objectStatsTab->initialize();
-    m_monthlyStatsTab->initialize();
-    m_settingsTab->initialize();
-    m_aboutTab->initialize();
+    // Order of the tabs. A tab is built and loaded when it is first shown, the others are
+    // warmed one per event loop pass after the window has painted, lowest warmupPriority first.
+    // Observations are the usual next stop, About needs nothing loaded.
+    m_tabs = {
+        {"Objects", 2, [this](QWidget *page)
+         {
+             m_objectsTab = std::make_unique<ObjectsTab>(m_dbManager.get(), m_settingsManager.get(), page);
+             page->layout()->addWidget(m_objectsTab.get());
+             m_objectsTab->initialize();
+         },
+         DbTable::Objects, [this] { m_objectsTab->refreshData(); }},
+        {"Sessions", 1, [this](QWidget *page)
+         {
+             m_sessionsTab = std::make_unique<SessionsTab>(m_dbManager.get(), m_settingsManager.get(), page);
+             page->layout()->addWidget(m_sessionsTab.get());
+             m_sessionsTab->initialize();
+         },
+         DbTable::Sessions | DbTable::Observations, [this] { m_sessionsTab->refreshData(); }},
+        {"Cameras", 7, [this](QWidget *page)
+         {
+             m_camerasTab = std::make_unique<CamerasTab>(m_dbManager.get(), page);
+             page->layout()->addWidget(m_camerasTab.get());
+             m_camerasTab->initialize();
+         },
+         DbTable::Cameras, [this] { m_camerasTab->refreshData(); }},
+        {"Filter Types", 8, [this](QWidget *page)
+         {
+             m_filterTypesTab = std::make_unique<FilterTypesTab>(m_dbManager.get(), page);
+             page->layout()->addWidget(m_filterTypesTab.get());
+             m_filterTypesTab->initialize();
+         },
+         DbTable::FilterTypes, [this] { m_filterTypesTab->refreshData(); }},
+        {"Filters", 5, [this](QWidget *page)
+         {
+             m_filtersTab = std::make_unique<FiltersTab>(m_dbManager.get(), page);
+             page->layout()->addWidget(m_filtersTab.get());
+             m_filtersTab->initialize();
+         },
+         DbTable::Filters | DbTable::FilterTypes, [this] { m_filtersTab->refreshData(); }},
+        {"Telescopes", 6, [this](QWidget *page)
+         {
+             m_telescopesTab = std::make_unique<TelescopesTab>(m_dbManager.get(), page);
+             page->layout()->addWidget(m_telescopesTab.get());
+             m_telescopesTab->initialize();
+         },
+         DbTable::Telescopes, [this] { m_telescopesTab->refreshData(); }},
+        {"Observations", 0, [this](QWidget *page)
+         {
+             m_observationsTab = std::make_unique<ObservationsTab>(m_dbManager.get(), m_settingsManager.get(), page);
+             page->layout()->addWidget(m_observationsTab.get());
+             m_observationsTab->initialize();
+         },
+         // Observation rows are patched by the tab itself, reload only when reference data changes
+         DbTable::Sessions | DbTable::Objects | DbTable::Cameras | DbTable::Telescopes | DbTable::Filters | DbTable::FilterTypes,
+         [this] { m_observationsTab->refreshData(); }},
+        {"Object Stats", 3, [this](QWidget *page)
+         {
+             m_objectStatsTab = std::make_unique<ObjectStatsTab>(m_dbManager.get(), page);
+             page->layout()->addWidget(m_objectStatsTab.get());
+             m_objectStatsTab->initialize();
+         },
+         DbTable::Observations | DbTable::Objects | DbTable::Filters | DbTable::FilterTypes,
+         [this] { m_objectStatsTab->refreshData(); }},
+        {"Monthly Stats", 4, [this](QWidget *page)
+         {
+             m_monthlyStatsTab = std::make_unique<MonthlyStatsTab>(m_dbManager.get(), page);
+             page->layout()->addWidget(m_monthlyStatsTab.get());
+             m_monthlyStatsTab->initialize();
+         },
+         DbTable::Observations | DbTable::Sessions, [this] { m_monthlyStatsTab->refreshData(); }},
+        {"Settings", 9, [this](QWidget *page)
+         {
+             m_settingsTab = std::make_unique<SettingsTab>(m_dbManager.get(), m_settingsManager.get(), page);
+             page->layout()->addWidget(m_settingsTab.get());
+             m_settingsTab->initialize();
+         },
+         {}, nullptr},
+        {"Diagnostics", 10, [this](QWidget *page)
+         {
+             m_diagnosticsTab = std::make_unique<DiagnosticsTab>(m_dbManager.get(), [this]
+             {
+                 QVector<TabRefreshTiming> timings;
+                 for (const TabEntry &tab : std::as_const(m_tabs))
+                 {
+                     if (tab.refreshCount > 0)
+                         timings.append({tab.title, tab.refreshCount, tab.lastRefreshMs, tab.maxRefreshMs, tab.totalRefreshMs});
+                 }
+                 return timings;
+             }, page);
+             page->layout()->addWidget(m_diagnosticsTab.get());
+             m_diagnosticsTab->initialize();
+         },
+         {}, nullptr},
+        {"About", 11, [this](QWidget *page)
+         {
+             m_aboutTab = std::make_unique<AboutTab>(m_dbManager.get(), page);
+             page->layout()->addWidget(m_aboutTab.get());
+             m_aboutTab->initialize();
+         },
+         {}, nullptr},
+    };
+
+    // Empty pages until the tabs are built
+    for (const TabEntry &tab : std::as_const(m_tabs))
+    {
+        auto *page = new QWidget();
+        // ReSharper disable once CppDFAMemoryLeak
+        auto *layout = new QVBoxLayout(page);
+        layout->setContentsMargins(0, 0, 0, 0);
+        ui->tabWidget->addTab(page, tab.title);
+    }
+
+    // The visible tab is needed for the first paint
+    ensureTabBuilt(ui->tabWidget->currentIndex());
+
+    m_warmupTimer->setInterval(0);
+    connect(m_warmupTimer, &QTimer::timeout, this, &MainWindow::warmNextTab);
+}
+
+void MainWindow::ensureTabBuilt(const int index)
+{
+    if (index < 0 || index >= m_tabs.size() || m_tabs[index].built)
+        return;
+
+    TabEntry &tab = m_tabs[index];
+    QElapsedTimer timer;
+    timer.start();
+    tab.built = true;
+    {
+        TRACE_SPAN(Trace::intern("Build " + tab.title + " tab"), "startup");
+        tab.build(ui->tabWidget->widget(index));
+    }
+    tab.recordRefresh(timer.nsecsElapsed() / 1e6);
+    qDebug() << "Startup:" << tab.title << "tab built in" << timer.elapsed() << "ms, at"
+             << m_startupTimer.elapsed() << "ms";
+}
+
+void MainWindow::warmNextTab()
+{
+    int next = -1;
+    for (int i = 0; i < m_tabs.size(); ++i)
+    {
+        if (!m_tabs[i].built && (next < 0 || m_tabs[i].warmupPriority < m_tabs[next].warmupPriority))
+            next = i;
+    }
+    if (next < 0)
+    {
+        m_warmupTimer->stop();
+        qDebug() << "Startup: all tabs built at" << m_startupTimer.elapsed() << "ms";
+        return;
+    }
+
+    // One tab per pass, input and repaints are handled in between
+    ensureTabBuilt(next);
+}
+
+bool MainWindow::event(QEvent *event)
+{
+    if (event->type() == QEvent::Paint && !m_firstPaintDone)
+    {
+        m_firstPaintDone = true;
+        qDebug() << "Startup: first paint at" << m_startupTimer.elapsed() << "ms";
+        TRACE_MARK("First paint", "startup");
+        // Fires once this paint has been flushed and the event loop is idle
+        m_warmupTimer->start();
+    }
+    return QMainWindow::event(event);
 }
 
 void MainWindow::setupConnections()
@@ -186,32 +280,60 @@ void MainWindow::setupConnections()
     connect(m_dbManager.get(), &DatabaseManager::errorOccurred, this, [this](const QString &error)
             { QMessageBox::warning(this, "Database Error", error); });
 
-    // Connect tab switching to refresh data
-    connect(ui->tabWidget, QOverload<int>::of(&QTabWidget::currentChanged), this, [this](const int index)
+    connect(m_dbManager.get(), &DatabaseManager::dataChanged, this, [this](const DbTables tables)
+            { onDataChanged(tables); });
+
+    // Warning thresholds and location are used by the Objects, Sessions and Observations tabs
+    connect(m_settingsManager.get(), &SettingsManager::settingsChanged, this, [this]
             {
-        // Refresh Sessions tab when it's activated (index 1)
-        if (index == 1 && m_sessionsTab)
+        for (TabEntry &tab : m_tabs)
         {
-            m_sessionsTab->refreshData();
+            tab.stale = tab.built && tab.refresh;
         }
-        // Refresh Filters tab when it's activated (index 4)
-        if (index == 4 && m_filtersTab)
-        {
-            m_filtersTab->refreshData();
-        }
-        // Refresh Observations tab when it's activated (index 6)
-        else if (index == 6 && m_observationsTab)
-        {
-            m_observationsTab->refreshData();
-        }
-        // Refresh Object Stats tab when it's activated (index 7)
-        else if (index == 7 && m_objectStatsTab)
+        refreshTabIfStale(ui->tabWidget->currentIndex()); });
+
+    // Build a tab on first activation, after that reload it only if something it depends on has changed
+    connect(ui->tabWidget, QOverload<int>::of(&QTabWidget::currentChanged), this, [this](const int index)
+            {
+        ensureTabBuilt(index);
+        refreshTabIfStale(index); });
+}
+
+void MainWindow::onDataChanged(const DbTables tables)
+{
+    // Tabs not built yet load current data when they are
+    for (TabEntry &tab : m_tabs)
+    {
+        if (tab.built && tab.refresh && tab.dependsOn.testAnyFlags(tables))
         {
-            m_objectStatsTab->refreshData();
+            tab.stale = true;
         }
-        // Refresh Monthly Stats tab when it's activated (index 8)
-        else if (index == 8 && m_monthlyStatsTab)
-        {
-            m_monthlyStatsTab->refreshData();
-        } });
-}
\ No newline at end of file
+    }
+
+    // The visible tab is reloaded right away, the others when they are shown
+    refreshTabIfStale(ui->tabWidget->currentIndex());
+}
+
+void MainWindow::refreshTabIfStale(const int index)
+{
+    if (index < 0 || index >= m_tabs.size())
+        return;
+
+    TabEntry &tab = m_tabs[index];
+    if (!tab.stale)
+        return;
+
+    tab.stale = false;
+    QElapsedTimer timer;
+    timer.start();
+    tab.refresh();
+    tab.recordRefresh(timer.nsecsElapsed() / 1e6);
+}
+
+void MainWindow::TabEntry::recordRefresh(const double ms)
+{
+    ++refreshCount;
+    lastRefreshMs = ms;
+    maxRefreshMs = std::max(maxRefreshMs, ms);
+    totalRefreshMs += ms;
+}
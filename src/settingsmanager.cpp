@@ -1,4 +1,6 @@
 #include "settingsmanager.h"
+#include "simbadquery.h"
+#include "trace.h"
 #include <QDir>
 #include <QJsonObject>
 #include <QDebug>
@@ -14,6 +16,10 @@ SettingsManager::SettingsManager(QObject *parent)
       m_style(""),
       m_colorScheme(Qt::ColorScheme::Unknown),
       m_sessionsFolderTemplate(""),
+      m_backupKeepDaily(14),
+      m_backupKeepWeekly(8),
+      m_backupKeepMonthly(12),
+      m_simbadTapUrl(SimbadQuery::defaultServiceUrl),
       m_initialized(false)
 {
 }
@@ -23,6 +29,7 @@ SettingsManager::~SettingsManager()
 
 bool SettingsManager::initialize()
 {
+    TRACE_SPAN("SettingsManager::initialize", "startup");
     const QString settingsDir = getSettingsDirectoryPath();
     const QString settingsFile = getSettingsFilePath();
 
@@ -85,6 +92,10 @@ bool SettingsManager::createDefaultSettings()
     m_style = "";                             // use Qt default at first
     m_colorScheme = Qt::ColorScheme::Unknown; // use Qt default at first
     m_sessionsFolderTemplate = "";
+    m_backupKeepDaily = 14;
+    m_backupKeepWeekly = 8;
+    m_backupKeepMonthly = 12;
+    m_simbadTapUrl = SimbadQuery::defaultServiceUrl;
     // Note: m_databasePath has no default - must be set by user
 
     // Create JSON object with default values
@@ -96,6 +107,10 @@ bool SettingsManager::createDefaultSettings()
     jsonObj["style"] = m_style;
     jsonObj["color_scheme"] = static_cast<int>(m_colorScheme);
     jsonObj["sessions_folder_template"] = m_sessionsFolderTemplate;
+    jsonObj["backup_keep_daily"] = m_backupKeepDaily;
+    jsonObj["backup_keep_weekly"] = m_backupKeepWeekly;
+    jsonObj["backup_keep_monthly"] = m_backupKeepMonthly;
+    jsonObj["simbad_tap_url"] = m_simbadTapUrl;
     // Do not add database_path to default settings
 
     // Write to file
@@ -121,6 +136,7 @@ bool SettingsManager::createDefaultSettings()
 
 bool SettingsManager::loadSettings()
 {
+    TRACE_SPAN("SettingsManager::loadSettings", "startup");
     QFile file(getSettingsFilePath());
 
     if (!file.open(QIODevice::ReadOnly))
@@ -152,12 +168,17 @@ bool SettingsManager::loadSettings()
     m_style = jsonObj.value("style").toString("");
     m_colorScheme = static_cast<Qt::ColorScheme>(jsonObj.value("color_scheme").toInt(static_cast<int>(Qt::ColorScheme::Unknown)));
     m_sessionsFolderTemplate = jsonObj.value("sessions_folder_template").toString("");
+    m_backupKeepDaily = jsonObj.value("backup_keep_daily").toInt(14);
+    m_backupKeepWeekly = jsonObj.value("backup_keep_weekly").toInt(8);
+    m_backupKeepMonthly = jsonObj.value("backup_keep_monthly").toInt(12);
+    m_simbadTapUrl = jsonObj.value("simbad_tap_url").toString(SimbadQuery::defaultServiceUrl);
 
     return true;
 }
 
 bool SettingsManager::saveSettings()
 {
+    TRACE_SPAN("SettingsManager::saveSettings", "settings");
     QJsonObject jsonObj;
     jsonObj["moon_illumination_warning_percent"] = m_moonIlluminationWarningPercent;
     jsonObj["moon_angular_separation_warning_deg"] = m_moonAngularSeparationWarningDeg;
@@ -167,6 +188,10 @@ bool SettingsManager::saveSettings()
     jsonObj["style"] = m_style;
     jsonObj["color_scheme"] = static_cast<int>(m_colorScheme);
     jsonObj["sessions_folder_template"] = m_sessionsFolderTemplate;
+    jsonObj["backup_keep_daily"] = m_backupKeepDaily;
+    jsonObj["backup_keep_weekly"] = m_backupKeepWeekly;
+    jsonObj["backup_keep_monthly"] = m_backupKeepMonthly;
+    jsonObj["simbad_tap_url"] = m_simbadTapUrl;
 
     const QJsonDocument doc(jsonObj);
     QFile file(getSettingsFilePath());
@@ -231,6 +256,26 @@ QString SettingsManager::sessionsFolderTemplate() const {
     return m_sessionsFolderTemplate;
 }
 
+int SettingsManager::backupKeepDaily() const
+{
+    return m_backupKeepDaily;
+}
+
+int SettingsManager::backupKeepWeekly() const
+{
+    return m_backupKeepWeekly;
+}
+
+int SettingsManager::backupKeepMonthly() const
+{
+    return m_backupKeepMonthly;
+}
+
+QString SettingsManager::simbadTapUrl() const
+{
+    return m_simbadTapUrl;
+}
+
 // Setters
 void SettingsManager::setMoonIlluminationWarningPercent(const int value)
 {
@@ -292,4 +337,41 @@ void SettingsManager::setSessionsFolderTemplate(const QString &value) {
     if (m_sessionsFolderTemplate != value) {
         m_sessionsFolderTemplate = value;
     }
-}
\ No newline at end of file
+}
+
+void SettingsManager::setBackupKeepDaily(const int value)
+{
+    if (m_backupKeepDaily != value)
+    {
+        m_backupKeepDaily = value;
+    }
+}
+
+void SettingsManager::setBackupKeepWeekly(const int value)
+{
+    if (m_backupKeepWeekly != value)
+    {
+        m_backupKeepWeekly = value;
+    }
+}
+
+void SettingsManager::setBackupKeepMonthly(const int value)
+{
+    if (m_backupKeepMonthly != value)
+    {
+        m_backupKeepMonthly = value;
+    }
+}
+
+void SettingsManager::setSimbadTapUrl(const QString &value)
+{
+    if (m_simbadTapUrl != value)
+    {
+        m_simbadTapUrl = value;
+    }
+}
+
+QString SettingsManager::simbadCacheFilePath()
+{
+    return QDir(getSettingsDirectoryPath()).filePath("simbad_cache.db");
+}
@@ -0,0 +1,205 @@
+#include "simbadcache.h"
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QSet>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QTimeZone>
+
+namespace
+{
+    // SIMBAD's ids table separates identifiers the same way
+    constexpr QChar aliasSeparator = u'|';
+}
+
+SimbadCache::SimbadCache() = default;
+
+SimbadCache::~SimbadCache()
+{
+    if (m_database.isValid())
+    {
+        const QString connectionName = m_database.connectionName();
+        m_database.close();
+        m_database = QSqlDatabase();
+        QSqlDatabase::removeDatabase(connectionName);
+    }
+}
+
+std::expected<void, ER> SimbadCache::open(const QString &fileName)
+{
+    if (const QDir dir = QFileInfo(fileName).dir(); !dir.exists() && !dir.mkpath("."))
+    {
+        return std::unexpected(ER::Error(QString("Failed to create directory for %1").arg(fileName)));
+    }
+
+    m_database = QSqlDatabase::addDatabase("QSQLITE", QString("simbad-cache-%1").arg(reinterpret_cast<quintptr>(this)));
+    m_database.setDatabaseName(fileName);
+    if (!m_database.open())
+    {
+        return std::unexpected(ER::Error(QString("Failed to open SIMBAD cache: %1").arg(m_database.lastError().text())));
+    }
+
+    // Every name SIMBAD was asked for or listed as an alias, pointing to its object;
+    // object_id NULL remembers that SIMBAD did not know the name
+    QSqlQuery query(m_database);
+    for (const char *sql : {
+             R"(
+                CREATE TABLE IF NOT EXISTS simbad_objects (
+                    id INTEGER PRIMARY KEY AUTOINCREMENT,
+                    main_id TEXT NOT NULL UNIQUE,
+                    ra REAL NOT NULL,
+                    dec REAL NOT NULL,
+                    aliases TEXT NOT NULL
+                )
+             )",
+             R"(
+                CREATE TABLE IF NOT EXISTS simbad_names (
+                    name TEXT PRIMARY KEY,
+                    object_id INTEGER REFERENCES simbad_objects(id),
+                    fetched_at INTEGER NOT NULL
+                )
+             )"})
+    {
+        if (!query.exec(sql))
+        {
+            return std::unexpected(ER::Error(QString("Failed to create SIMBAD cache: %1").arg(query.lastError().text())));
+        }
+    }
+    return {};
+}
+
+bool SimbadCache::isOpen() const
+{
+    return m_database.isOpen();
+}
+
+std::optional<SimbadCacheEntry> SimbadCache::lookup(const QString &name, const QDateTime &now) const
+{
+    if (!isOpen())
+        return std::nullopt;
+
+    QSqlQuery query(m_database);
+    query.prepare(R"(
+        SELECT n.object_id, n.fetched_at, o.main_id, o.ra, o.dec, o.aliases
+        FROM simbad_names n
+        LEFT JOIN simbad_objects o ON o.id = n.object_id
+        WHERE n.name = ?
+    )");
+    query.addBindValue(normalizedName(name));
+    if (!query.exec())
+    {
+        qDebug() << "SIMBAD cache lookup failed:" << query.lastError().text();
+        return std::nullopt;
+    }
+    if (!query.next())
+        return std::nullopt;
+
+    SimbadCacheEntry entry;
+    entry.found = !query.value(0).isNull() && !query.value(2).isNull();
+    const QDateTime fetched = QDateTime::fromSecsSinceEpoch(query.value(1).toLongLong(), QTimeZone::UTC);
+    if (fetched.addDays(entry.found ? foundTtlDays : missingTtlDays) < now)
+        return std::nullopt; // expired, ask SIMBAD again
+
+    if (entry.found)
+    {
+        entry.object.queryName = name;
+        entry.object.mainId = query.value(2).toString();
+        entry.object.ra = query.value(3).toDouble();
+        entry.object.dec = query.value(4).toDouble();
+        entry.object.aliases = query.value(5).toString().split(aliasSeparator, Qt::SkipEmptyParts);
+    }
+    return entry;
+}
+
+std::expected<void, ER> SimbadCache::store(const QVector<SimbadObject> &objects, const QStringList &missingNames,
+                                           const QDateTime &now)
+{
+    if (!isOpen())
+        return std::unexpected(ER::Error("SIMBAD cache is not open"));
+
+    if (!m_database.transaction())
+    {
+        return std::unexpected(ER::Error(m_database.lastError().text()));
+    }
+    const auto fail = [this](const QSqlQuery &query)
+    {
+        const QString errorMessage = query.lastError().text();
+        m_database.rollback();
+        qDebug() << "Failed to update SIMBAD cache:" << errorMessage;
+        return std::unexpected(ER::Error(errorMessage));
+    };
+
+    const qint64 fetchedAt = now.toSecsSinceEpoch();
+    QSqlQuery objectQuery(m_database);
+    objectQuery.prepare(R"(
+        INSERT INTO simbad_objects (main_id, ra, dec, aliases) VALUES (?, ?, ?, ?)
+        ON CONFLICT(main_id) DO UPDATE SET ra = excluded.ra, dec = excluded.dec, aliases = excluded.aliases
+    )");
+    QSqlQuery idQuery(m_database);
+    idQuery.prepare("SELECT id FROM simbad_objects WHERE main_id = ?");
+    QSqlQuery nameQuery(m_database);
+    nameQuery.prepare("INSERT OR REPLACE INTO simbad_names (name, object_id, fetched_at) VALUES (?, ?, ?)");
+
+    for (const SimbadObject &object : objects)
+    {
+        objectQuery.bindValue(0, object.mainId);
+        objectQuery.bindValue(1, object.ra);
+        objectQuery.bindValue(2, object.dec);
+        objectQuery.bindValue(3, object.aliases.join(aliasSeparator));
+        if (!objectQuery.exec())
+            return fail(objectQuery);
+
+        idQuery.bindValue(0, object.mainId);
+        if (!idQuery.exec() || !idQuery.next())
+            return fail(idQuery);
+        const qint64 objectId = idQuery.value(0).toLongLong();
+
+        // Under every identifier, so that a later lookup by another catalog name is a hit too
+        QSet<QString> names{normalizedName(object.queryName), normalizedName(object.mainId)};
+        for (const QString &alias : object.aliases)
+            names.insert(normalizedName(alias));
+        for (const QString &name : names)
+        {
+            nameQuery.bindValue(0, name);
+            nameQuery.bindValue(1, objectId);
+            nameQuery.bindValue(2, fetchedAt);
+            if (!nameQuery.exec())
+                return fail(nameQuery);
+        }
+    }
+
+    for (const QString &name : missingNames)
+    {
+        nameQuery.bindValue(0, normalizedName(name));
+        nameQuery.bindValue(1, QVariant());
+        nameQuery.bindValue(2, fetchedAt);
+        if (!nameQuery.exec())
+            return fail(nameQuery);
+    }
+
+    if (!m_database.commit())
+    {
+        const QString errorMessage = m_database.lastError().text();
+        m_database.rollback();
+        return std::unexpected(ER::Error(errorMessage));
+    }
+    return {};
+}
+
+std::expected<void, ER> SimbadCache::clear()
+{
+    QSqlQuery query(m_database);
+    if (!query.exec("DELETE FROM simbad_names") || !query.exec("DELETE FROM simbad_objects"))
+    {
+        return std::unexpected(ER::Error(query.lastError().text()));
+    }
+    return {};
+}
+
+QString SimbadCache::normalizedName(const QString &name)
+{
+    static const QRegularExpression whitespace("\\s+");
+    return name.toUpper().remove(whitespace);
+}
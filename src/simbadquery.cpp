@@ -1,11 +1,17 @@
 #include "simbadquery.h"
+#include "settingsmanager.h"
+#include "trace.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QNetworkRequest>
+#include <QSet>
 #include <QUrlQuery>
-#include <QXmlStreamReader>
 #include <QDebug>
 
 SimbadQuery::SimbadQuery(QObject *parent)
-    : QObject(parent), m_networkManager(new QNetworkAccessManager(this)), m_currentReply(nullptr)
+    : QObject(parent), m_networkManager(new QNetworkAccessManager(this)), m_serviceUrl(QString(defaultServiceUrl)),
+      m_cacheFile(SettingsManager::simbadCacheFilePath()), m_cacheOpenFailed(false), m_nextRequestId(1)
 {
 }
 
@@ -14,6 +20,35 @@ SimbadQuery::~SimbadQuery()
     cancelQuery();
 }
 
+void SimbadQuery::setServiceUrl(const QUrl &url)
+{
+    m_serviceUrl = url;
+}
+
+void SimbadQuery::setCacheFile(const QString &fileName)
+{
+    m_cacheFile = fileName;
+    m_cache.reset();
+    m_cacheOpenFailed = false;
+}
+
+SimbadCache *SimbadQuery::cache()
+{
+    if (!m_cache && !m_cacheOpenFailed && !m_cacheFile.isEmpty())
+    {
+        auto cache = std::make_unique<SimbadCache>();
+        if (auto result = cache->open(m_cacheFile); !result)
+        {
+            // Lookups still work, they just always go to SIMBAD
+            qWarning() << result.error().errorMessage;
+            m_cacheOpenFailed = true;
+            return nullptr;
+        }
+        m_cache = std::move(cache);
+    }
+    return m_cache.get();
+}
+
 void SimbadQuery::queryObject(const QString &objectName)
 {
     if (objectName.isEmpty())
@@ -22,199 +57,256 @@ void SimbadQuery::queryObject(const QString &objectName)
         return;
     }
 
-    // Cancel any existing query
-    cancelQuery();
-
-    m_currentObjectName = objectName;
     emit queryStarted(objectName);
+    const int requestId = resolveObjects({objectName});
+    m_requests[requestId].single = true;
+}
 
-    // Build SIMBAD query URL
-    // Using SIMBAD's sim-id service which returns VOTable format
-    QUrl url("https://simbad.u-strasbg.fr/simbad/sim-id");
-    QUrlQuery query;
-    query.addQueryItem("output.format", "votable");
-    query.addQueryItem("Ident", objectName);
-    url.setQuery(query);
-
-    qDebug() << "Querying SIMBAD for object:" << objectName;
-    qDebug() << "URL:" << url.toString();
+int SimbadQuery::resolveObjects(const QStringList &names)
+{
+    TRACE_SPAN("SimbadQuery::resolveObjects", "network");
+    const int requestId = m_nextRequestId++;
+    Request &request = m_requests[requestId];
+
+    // Cached names are answered locally, each normalized name is asked for once
+    QStringList uncached;
+    QSet<QString> seen;
+    SimbadCache *simbadCache = cache();
+    for (const QString &name : names)
+    {
+        const QString trimmed = name.trimmed();
+        if (trimmed.isEmpty() || seen.contains(SimbadCache::normalizedName(trimmed)))
+            continue;
+        seen.insert(SimbadCache::normalizedName(trimmed));
 
-    // Create network request
-    QNetworkRequest request(url);
-    request.setHeader(QNetworkRequest::UserAgentHeader, "MonoObsLog/1.0");
+        if (simbadCache)
+        {
+            if (const auto entry = simbadCache->lookup(trimmed); entry)
+            {
+                if (entry->found)
+                    request.objects.append(entry->object);
+                else
+                    request.notFound.append(trimmed);
+                continue;
+            }
+        }
+        uncached.append(trimmed);
+    }
 
-    // Send GET request
-    m_currentReply = m_networkManager->get(request);
+    qDebug() << "SIMBAD lookup:" << names.size() - uncached.size() << "cached," << uncached.size() << "to query";
+    for (qsizetype start = 0; start < uncached.size(); start += maxNamesPerRequest)
+    {
+        sendRequest(requestId, uncached.mid(start, maxNamesPerRequest));
+    }
 
-    // Connect signals
-    connect(m_currentReply, &QNetworkReply::finished,
-            this, &SimbadQuery::handleNetworkReply);
-    connect(m_currentReply, &QNetworkReply::errorOccurred,
-            this, &SimbadQuery::handleNetworkError);
+    // Signals always arrive after this returns, also when nothing had to be fetched
+    if (request.pendingReplies == 0)
+    {
+        QMetaObject::invokeMethod(this, [this, requestId] { finishRequest(requestId); }, Qt::QueuedConnection);
+    }
+    return requestId;
 }
 
-void SimbadQuery::cancelQuery()
+QString SimbadQuery::buildQuery(const QStringList &names)
 {
-    if (m_currentReply)
+    QStringList quoted;
+    quoted.reserve(names.size());
+    for (const QString &name : names)
     {
-        m_currentReply->abort();
-        m_currentReply->deleteLater();
-        m_currentReply = nullptr;
+        QString escaped = name;
+        quoted.append("'" + escaped.replace("'", "''") + "'");
     }
+
+    // ident.id comparisons are case and spacing insensitive in SIMBAD; ids.ids lists every
+    // identifier of the object separated by '|'
+    return QString(R"(
+        SELECT i.id, b.main_id, b.ra, b.dec, s.ids
+        FROM ident AS i
+        JOIN basic AS b ON b.oid = i.oidref
+        JOIN ids AS s ON s.oidref = b.oid
+        WHERE i.id IN (%1)
+    )").arg(quoted.join(", "));
 }
 
-void SimbadQuery::handleNetworkReply()
+void SimbadQuery::sendRequest(const int requestId, const QStringList &names)
 {
-    if (!m_currentReply)
-        return;
-
-    // Check for network errors
-    if (m_currentReply->error() != QNetworkReply::NoError)
-    {
-        const QString errorMsg = QString("Network error: %1").arg(m_currentReply->errorString());
-        qDebug() << errorMsg;
-        emit errorOccurred(errorMsg);
-        m_currentReply->deleteLater();
-        m_currentReply = nullptr;
-        return;
-    }
+    QUrlQuery form;
+    form.addQueryItem("REQUEST", "doQuery");
+    form.addQueryItem("LANG", "ADQL");
+    form.addQueryItem("FORMAT", "json");
+    form.addQueryItem("QUERY", buildQuery(names));
 
-    // Read response data
-    const QByteArray responseData = m_currentReply->readAll();
-    m_currentReply->deleteLater();
-    m_currentReply = nullptr;
+    QNetworkRequest request(m_serviceUrl);
+    request.setHeader(QNetworkRequest::UserAgentHeader, "MonoObsLog/1.0");
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/x-www-form-urlencoded");
 
-    qDebug() << "Received response, size:" << responseData.size() << "bytes";
+    qDebug() << "Querying SIMBAD for" << names.size() << "objects:" << m_serviceUrl.toString();
+    QNetworkReply *reply = m_networkManager->post(request, form.query(QUrl::FullyEncoded).toUtf8());
+    m_replies.insert(reply, {requestId, names});
+    ++m_requests[requestId].pendingReplies;
 
-    // Parse the VOTable response
-    if (double ra = 0.0, dec = 0.0; parseVOTableResponse(responseData, ra, dec))
-    {
-        qDebug() << "Successfully parsed coordinates - RA:" << ra << "Dec:" << dec;
-        emit coordinatesReceived(ra, dec, m_currentObjectName);
-    }
-    else
-    {
-        const QString errorMsg = QString("Failed to parse coordinates for object '%1'").arg(m_currentObjectName);
-        qDebug() << errorMsg;
-        emit errorOccurred(errorMsg);
-    }
+    connect(reply, &QNetworkReply::finished, this, &SimbadQuery::handleNetworkReply);
 }
 
-void SimbadQuery::handleNetworkError(const QNetworkReply::NetworkError code)
+void SimbadQuery::cancelQuery()
 {
-    if (m_currentReply)
+    // Forget the replies first, abort() emits finished synchronously
+    const QList<QNetworkReply *> replies = m_replies.keys();
+    m_replies.clear();
+    m_requests.clear();
+    for (QNetworkReply *reply : replies)
     {
-        const QString errorMsg = QString("Network error (%1): %2")
-                               .arg(code)
-                               .arg(m_currentReply->errorString());
-        qDebug() << errorMsg;
-        emit errorOccurred(errorMsg);
+        disconnect(reply, nullptr, this, nullptr);
+        reply->abort();
+        reply->deleteLater();
     }
 }
 
-bool SimbadQuery::parseVOTableResponse(const QByteArray &data, double &ra, double &dec)
+void SimbadQuery::handleNetworkReply()
 {
-    QXmlStreamReader xml(data);
+    auto *reply = qobject_cast<QNetworkReply *>(sender());
+    if (!reply || !m_replies.contains(reply))
+        return;
+    const PendingReply pending = m_replies.take(reply);
+    reply->deleteLater();
 
-    bool raFound = false;
-    bool decFound = false;
-    QString raFieldId;
-    QString decFieldId;
-    QStringList fieldIds;
-    QStringList fieldNames;
+    auto requestIt = m_requests.find(pending.requestId);
+    if (requestIt == m_requests.end())
+        return;
+    Request &request = *requestIt;
+    --request.pendingReplies;
 
-    // First pass: find FIELD elements for RA and DEC
-    while (!xml.atEnd() && !xml.hasError())
+    if (reply->error() != QNetworkReply::NoError)
     {
-        xml.readNext();
+        request.error = QString("Network error: %1").arg(reply->errorString());
+        qDebug() << request.error;
+    }
+    else
+    {
+        TRACE_SPAN("SimbadQuery::parseTapResponse", "network");
+        const QByteArray responseData = reply->readAll();
+        qDebug() << "Received response, size:" << responseData.size() << "bytes";
 
-        if (xml.isStartElement() && xml.name() == QStringLiteral("FIELD"))
+        QVector<SimbadObject> objects;
+        if (parseTapResponse(responseData, pending.names, objects))
         {
-            QString id = xml.attributes().value("ID").toString();
-            QString name = xml.attributes().value("name").toString();
-            QString ucd = xml.attributes().value("ucd").toString();
-
-            fieldIds.append(id);
-            fieldNames.append(name);
-
-            // SIMBAD uses these UCDs for coordinates:
-            // RA: pos.eq.ra;meta.main
-            // DEC: pos.eq.dec;meta.main
-            if (ucd.contains("pos.eq.ra;meta.main") || name.toLower() == "ra")
+            QSet<QString> resolved;
+            for (const SimbadObject &object : objects)
+                resolved.insert(object.queryName);
+            QStringList notFound;
+            for (const QString &name : pending.names)
             {
-                raFieldId = id;
-                qDebug() << "Found RA field:" << id << name << ucd;
+                if (!resolved.contains(name))
+                    notFound.append(name);
             }
-            else if (ucd.contains("pos.eq.dec;meta.main") || name.toLower() == "dec")
+
+            if (SimbadCache *simbadCache = cache())
             {
-                decFieldId = id;
-                qDebug() << "Found DEC field:" << id << name << ucd;
+                if (auto result = simbadCache->store(objects, notFound); !result)
+                    qWarning() << "Failed to cache SIMBAD results:" << result.error().errorMessage;
             }
+            request.objects += objects;
+            request.notFound += notFound;
+        }
+        else
+        {
+            request.error = "Failed to parse the SIMBAD response";
+            qDebug() << request.error;
         }
     }
 
-    // Reset reader for second pass
-    xml.clear();
-    xml.addData(data);
+    if (request.pendingReplies == 0)
+        finishRequest(pending.requestId);
+}
 
-    // Second pass: extract data from TR/TD elements
-    const qsizetype raIndex = fieldIds.indexOf(raFieldId);
-    const qsizetype decIndex = fieldIds.indexOf(decFieldId);
+void SimbadQuery::finishRequest(const int requestId)
+{
+    if (!m_requests.contains(requestId))
+        return; // cancelled
+    const Request request = m_requests.take(requestId);
 
-    if (raIndex == -1 || decIndex == -1)
+    if (request.single)
     {
-        qDebug() << "Could not find RA/DEC field indices";
-        return false;
+        if (!request.objects.isEmpty())
+        {
+            const SimbadObject &object = request.objects.first();
+            qDebug() << "Resolved" << object.queryName << "as" << object.mainId << "- RA:" << object.ra << "Dec:" << object.dec;
+            emit coordinatesReceived(object.ra, object.dec, object.queryName);
+        }
+        else if (!request.error.isEmpty())
+        {
+            emit errorOccurred(request.error);
+        }
+        else
+        {
+            emit errorOccurred(QString("Object '%1' not found in SIMBAD").arg(request.notFound.value(0)));
+        }
+        return;
     }
 
-    qDebug() << "RA index:" << raIndex << "DEC index:" << decIndex;
+    // Names answered before a failed reply are still delivered, the failure wins only
+    // if nothing could be resolved at all
+    if (!request.error.isEmpty() && request.objects.isEmpty())
+        emit resolveFailed(requestId, request.error);
+    else
+        emit objectsResolved(requestId, request.objects, request.notFound);
+}
 
-    // Find the data row
-    while (!xml.atEnd() && !xml.hasError())
+bool SimbadQuery::parseTapResponse(const QByteArray &data, const QStringList &names, QVector<SimbadObject> &objects)
+{
+    QJsonParseError parseError;
+    const QJsonDocument document = QJsonDocument::fromJson(data, &parseError);
+    if (parseError.error != QJsonParseError::NoError || !document.isObject())
     {
-        xml.readNext();
-
-        if (xml.isStartElement() && xml.name() == QStringLiteral("TR"))
-        {
-            // Read all TD elements in this row
-            QStringList tdValues;
-
-            while (!(xml.isEndElement() && xml.name() == QStringLiteral("TR")))
-            {
-                xml.readNext();
-
-                if (xml.isStartElement() && xml.name() == QStringLiteral("TD"))
-                {
-                    QString value = xml.readElementText();
-                    tdValues.append(value);
-                }
-            }
-
-            // Extract RA and DEC from the collected values
-            if (tdValues.size() > raIndex && tdValues.size() > decIndex)
-            {
-                bool raOk = false;
-                bool decOk = false;
-
-                ra = tdValues[raIndex].toDouble(&raOk);
-                dec = tdValues[decIndex].toDouble(&decOk);
-
-                if (raOk && decOk)
-                {
-                    raFound = true;
-                    decFound = true;
-                    qDebug() << "Extracted values - RA:" << ra << "DEC:" << dec;
-                    break;
-                }
-            }
-        }
+        qDebug() << "JSON parse error:" << parseError.errorString();
+        return false;
     }
 
-    if (xml.hasError())
+    // {"metadata": [{"name": "id"}, ...], "data": [[...], ...]}
+    const QJsonObject root = document.object();
+    const QJsonArray metadata = root.value("metadata").toArray();
+    const QJsonArray rows = root.value("data").toArray();
+    QHash<QString, int> columns;
+    for (int i = 0; i < metadata.size(); ++i)
+        columns.insert(metadata[i].toObject().value("name").toString().toLower(), i);
+
+    const int idColumn = columns.value("id", -1);
+    const int mainIdColumn = columns.value("main_id", -1);
+    const int raColumn = columns.value("ra", -1);
+    const int decColumn = columns.value("dec", -1);
+    const int idsColumn = columns.value("ids", -1);
+    if (idColumn < 0 || mainIdColumn < 0 || raColumn < 0 || decColumn < 0)
     {
-        qDebug() << "XML parse error:" << xml.errorString();
+        qDebug() << "Could not find the id, main_id, ra and dec columns";
         return false;
     }
 
-    return raFound && decFound;
+    // SIMBAD answers with its own spelling of the identifier, matched back by normalized name
+    QHash<QString, QString> requestedNames;
+    for (const QString &name : names)
+        requestedNames.insert(SimbadCache::normalizedName(name), name);
+
+    QSet<QString> resolved;
+    for (const QJsonValue &value : rows)
+    {
+        const QJsonArray row = value.toArray();
+        const QString name = requestedNames.value(SimbadCache::normalizedName(row.at(idColumn).toString()));
+        // Objects without coordinates are no use for the log
+        if (name.isEmpty() || resolved.contains(name) || !row.at(raColumn).isDouble() || !row.at(decColumn).isDouble())
+            continue;
+        resolved.insert(name);
+
+        SimbadObject object;
+        object.queryName = name;
+        object.mainId = row.at(mainIdColumn).toString();
+        object.ra = row.at(raColumn).toDouble();
+        object.dec = row.at(decColumn).toDouble();
+        if (idsColumn >= 0)
+        {
+            for (const QString &alias : row.at(idsColumn).toString().split('|', Qt::SkipEmptyParts))
+                object.aliases.append(alias.simplified());
+        }
+        objects.append(object);
+    }
+    return true;
 }
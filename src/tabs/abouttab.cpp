@@ -1,6 +1,7 @@
 #include "tabs/abouttab.h"
 #include "ui_about_tab.h"
 #include "db/databasemanager.h"
+#include "trace.h"
 
 AboutTab::AboutTab(DatabaseManager *dbManager, QWidget *parent)
     : QWidget(parent), ui(new Ui::AboutTab), m_dbManager(dbManager)
@@ -26,6 +27,7 @@ void AboutTab::initialize() const {
 
 void AboutTab::refreshData()
 {
+    TRACE_SPAN("AboutTab::refreshData", "tab");
     // Refresh data from database
     // To be implemented
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "ui_cameras_tab.h"
 #include "db/databasemanager.h"
 #include "db/camerasrepository.h"
+#include "trace.h"
 #include <QMessageBox>
 #include <QDialog>
 #include <QFormLayout>
@@ -43,6 +44,7 @@ void CamerasTab::initialize()
 
 void CamerasTab::refreshData()
 {
+    TRACE_SPAN("CamerasTab::refreshData", "tab");
     // Refresh data from database
     populateTable();
 }
@@ -205,8 +207,6 @@ void CamerasTab::onAddCameraButtonClicked()
     ui->pixelSizeSpinBox->setValue(0.0);
     ui->widthSpinBox->setValue(0);
     ui->heightSpinBox->setValue(0);
-
-    refreshData();
 }
 
 void CamerasTab::onEditCameraButtonClicked()
@@ -248,8 +248,6 @@ void CamerasTab::onEditCameraButtonClicked()
                              QString("Failed to update camera: %1").arg(updateResult.error().errorMessage));
         return;
     }
-
-    refreshData();
 }
 
 void CamerasTab::onDeleteCameraButtonClicked()
@@ -288,6 +286,4 @@ void CamerasTab::onDeleteCameraButtonClicked()
                              QString("Failed to delete camera: %1").arg(deleteResult.error().errorMessage));
         return;
     }
-
-    refreshData();
 }
\ No newline at end of file
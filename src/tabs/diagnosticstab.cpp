@@ -0,0 +1,209 @@
+#include "tabs/diagnosticstab.h"
+#include "ui_diagnostics_tab.h"
+#include "db/databasemanager.h"
+#include "numerictablewidgetitem.h"
+#include "trace.h"
+#include <QCheckBox>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFileDialog>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QLocale>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QSaveFile>
+#include <QTimer>
+
+namespace
+{
+    constexpr int autoRefreshIntervalMs = 2000;
+
+    QString formatBytes(const qint64 bytes)
+    {
+        return QLocale().formattedDataSize(bytes);
+    }
+
+    QTableWidgetItem *numberItem(const double value, const int decimals)
+    {
+        auto *item = new NumericTableWidgetItem(QString::number(value, 'f', decimals));
+        item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+        return item;
+    }
+}
+
+DiagnosticsTab::DiagnosticsTab(DatabaseManager *dbManager, TabTimingsSource tabTimings, QWidget *parent)
+    : QWidget(parent), ui(new Ui::DiagnosticsTab), m_dbManager(dbManager), m_tabTimings(std::move(tabTimings)),
+      m_refreshTimer(new QTimer(this))
+{
+    ui->setupUi(this);
+}
+
+DiagnosticsTab::~DiagnosticsTab()
+{
+    delete ui;
+}
+
+void DiagnosticsTab::initialize()
+{
+    connect(ui->refreshButton, &QPushButton::clicked, this, &DiagnosticsTab::refreshData);
+    connect(ui->resetButton, &QPushButton::clicked, this, &DiagnosticsTab::onResetClicked);
+    connect(ui->exportButton, &QPushButton::clicked, this, &DiagnosticsTab::onExportClicked);
+
+    // Only while the tab is on screen
+    m_refreshTimer->setInterval(autoRefreshIntervalMs);
+    connect(m_refreshTimer, &QTimer::timeout, this, [this]
+    {
+        if (isVisible())
+            refreshData();
+    });
+    connect(ui->autoRefreshCheckBox, &QCheckBox::toggled, this, [this](const bool checked)
+    {
+        if (checked)
+            m_refreshTimer->start();
+        else
+            m_refreshTimer->stop();
+    });
+
+    ui->queriesTable->setColumnWidth(0, 420); // SQL
+    ui->tabsTable->setColumnWidth(0, 150);    // Tab
+}
+
+void DiagnosticsTab::refreshData()
+{
+    TRACE_SPAN("DiagnosticsTab::refreshData", "tab");
+
+    const ConnectionStats connection = m_dbManager->connectionStats();
+    QString text = QString("Database file: %1, WAL: %2")
+                       .arg(formatBytes(connection.databaseBytes), formatBytes(connection.walBytes));
+    if (connection.available)
+    {
+        const qint64 lookups = connection.cacheHits + connection.cacheMisses;
+        text += QString("\nPage cache: %L1 hits, %L2 misses (%3% hit rate), %L4 writes, %5 in use")
+                    .arg(connection.cacheHits)
+                    .arg(connection.cacheMisses)
+                    .arg(lookups > 0 ? 100.0 * connection.cacheHits / lookups : 0.0, 0, 'f', 1)
+                    .arg(connection.cacheWrites)
+                    .arg(formatBytes(connection.cacheUsedBytes));
+    }
+    else
+    {
+        text += "\nPage cache and query statistics need the SQLite library used by the Qt driver.";
+    }
+    ui->connectionLabel->setText(text);
+
+    ui->queriesTable->setSortingEnabled(false);
+    const QVector<QueryStat> queries = m_dbManager->queryStats().stats();
+    ui->queriesTable->setRowCount(static_cast<int>(queries.size()));
+    for (int row = 0; row < queries.size(); ++row)
+    {
+        const QueryStat &query = queries[row];
+        auto *sqlItem = new QTableWidgetItem(query.sql);
+        sqlItem->setToolTip(query.sql);
+        ui->queriesTable->setItem(row, 0, sqlItem);
+        ui->queriesTable->setItem(row, 1, numberItem(query.count, 0));
+        ui->queriesTable->setItem(row, 2, numberItem(query.rows, 0));
+        ui->queriesTable->setItem(row, 3, numberItem(query.p50Ms, 3));
+        ui->queriesTable->setItem(row, 4, numberItem(query.p99Ms, 3));
+        ui->queriesTable->setItem(row, 5, numberItem(query.maxMs, 3));
+        ui->queriesTable->setItem(row, 6, numberItem(query.totalMs, 1));
+    }
+    ui->queriesTable->setSortingEnabled(true);
+
+    ui->tabsTable->setSortingEnabled(false);
+    const QVector<TabRefreshTiming> tabs = m_tabTimings ? m_tabTimings() : QVector<TabRefreshTiming>();
+    ui->tabsTable->setRowCount(static_cast<int>(tabs.size()));
+    for (int row = 0; row < tabs.size(); ++row)
+    {
+        const TabRefreshTiming &tab = tabs[row];
+        ui->tabsTable->setItem(row, 0, new QTableWidgetItem(tab.tab));
+        ui->tabsTable->setItem(row, 1, numberItem(tab.count, 0));
+        ui->tabsTable->setItem(row, 2, numberItem(tab.lastMs, 1));
+        ui->tabsTable->setItem(row, 3, numberItem(tab.maxMs, 1));
+        ui->tabsTable->setItem(row, 4, numberItem(tab.totalMs, 1));
+    }
+    ui->tabsTable->setSortingEnabled(true);
+}
+
+void DiagnosticsTab::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+    refreshData();
+}
+
+void DiagnosticsTab::onResetClicked()
+{
+    m_dbManager->clearQueryStats();
+    refreshData();
+}
+
+QJsonObject DiagnosticsTab::snapshot() const
+{
+    const ConnectionStats connection = m_dbManager->connectionStats();
+    QJsonObject database;
+    database.insert("path", m_dbManager->databasePath());
+    database.insert("database_bytes", connection.databaseBytes);
+    database.insert("wal_bytes", connection.walBytes);
+    if (connection.available)
+    {
+        database.insert("cache_hits", connection.cacheHits);
+        database.insert("cache_misses", connection.cacheMisses);
+        database.insert("cache_writes", connection.cacheWrites);
+        database.insert("cache_used_bytes", connection.cacheUsedBytes);
+    }
+
+    QJsonArray queries;
+    for (const QueryStat &query : m_dbManager->queryStats().stats())
+    {
+        queries.append(QJsonObject{
+            {"sql", query.sql},
+            {"count", query.count},
+            {"rows", query.rows},
+            {"p50_ms", query.p50Ms},
+            {"p99_ms", query.p99Ms},
+            {"max_ms", query.maxMs},
+            {"total_ms", query.totalMs},
+        });
+    }
+
+    QJsonArray tabs;
+    for (const TabRefreshTiming &tab : m_tabTimings ? m_tabTimings() : QVector<TabRefreshTiming>())
+    {
+        tabs.append(QJsonObject{
+            {"tab", tab.tab},
+            {"refreshes", tab.count},
+            {"last_ms", tab.lastMs},
+            {"max_ms", tab.maxMs},
+            {"total_ms", tab.totalMs},
+        });
+    }
+
+    QJsonObject result;
+    result.insert("created", QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
+    result.insert("application_version", QCoreApplication::applicationVersion());
+    result.insert("database", database);
+    result.insert("queries", queries);
+    result.insert("tabs", tabs);
+    return result;
+}
+
+void DiagnosticsTab::onExportClicked()
+{
+    const QString fileName = QFileDialog::getSaveFileName(
+        this, "Export Diagnostics",
+        QDir::homePath() + QString("/MonoObsLog_diagnostics_%1.json")
+                               .arg(QDateTime::currentDateTime().toString("yyyy-MM-dd_HHmm")),
+        "JSON Files (*.json);;All Files (*.*)");
+    if (fileName.isEmpty())
+    {
+        return; // User cancelled
+    }
+
+    QSaveFile file(fileName);
+    const QByteArray json = QJsonDocument(snapshot()).toJson();
+    if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size() || !file.commit())
+    {
+        QMessageBox::warning(this, "Export Error", QString("Failed to write %1: %2").arg(fileName, file.errorString()));
+    }
+}
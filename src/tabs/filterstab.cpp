@@ -2,7 +2,8 @@
 #include "ui_filters_tab.h"
 #include "db/databasemanager.h"
 #include "db/filtersrepository.h"
-#include "db/filtertypesrepository.h"
+#include "db/referencedatacache.h"
+#include "trace.h"
 #include <QMessageBox>
 #include <QDialog>
 #include <QFormLayout>
@@ -13,11 +14,10 @@
 #include <QPushButton>
 
 FiltersTab::FiltersTab(DatabaseManager *dbManager, QWidget *parent)
-    : QWidget(parent), ui(new Ui::FiltersTab), m_dbManager(dbManager), m_repository(nullptr), m_filterTypesRepository(nullptr)
+    : QWidget(parent), ui(new Ui::FiltersTab), m_dbManager(dbManager), m_repository(nullptr)
 {
     ui->setupUi(this);
     m_repository = new FiltersRepository(m_dbManager, this);
-    m_filterTypesRepository = new FilterTypesRepository(m_dbManager, this);
 }
 
 FiltersTab::~FiltersTab()
@@ -42,6 +42,7 @@ void FiltersTab::initialize()
 
 void FiltersTab::refreshData()
 {
+    TRACE_SPAN("FiltersTab::refreshData", "tab");
     // Refresh filter types first, then populate table
     populateFilterTypeComboBox();
     populateTable();
@@ -51,18 +52,17 @@ void FiltersTab::populateFilterTypeComboBox()
 {
     ui->typeComboBox->clear();
 
-    auto filterTypesResult = m_filterTypesRepository->getAllFilterTypes();
+    auto filterTypesResult = m_dbManager->referenceData()->items(DbTable::FilterTypes);
     if (!filterTypesResult)
     {
         QMessageBox::warning(this, "Database Error",
                              QString("Failed to load filter types: %1").arg(filterTypesResult.error().errorMessage));
         return;
     }
-    QVector<FilterTypeData> filterTypes = filterTypesResult.value();
 
-    for (const FilterTypeData &filterType : filterTypes)
+    for (const auto &[id, name] : filterTypesResult.value())
     {
-        ui->typeComboBox->addItem(filterType.name, filterType.id);
+        ui->typeComboBox->addItem(name, id);
     }
 }
 
@@ -119,14 +119,14 @@ bool FiltersTab::showFilterDialog(const QString &title, QString &name, int &filt
     const auto typeCombo = new QComboBox(&dialog);
 
     // Populate combo box with filter types
-    auto filterTypesResult = m_filterTypesRepository->getAllFilterTypes();
+    auto filterTypesResult = m_dbManager->referenceData()->items(DbTable::FilterTypes);
     if (!filterTypesResult)
     {
         QMessageBox::warning(&dialog, "Database Error",
                              QString("Failed to load filter types: %1").arg(filterTypesResult.error().errorMessage));
         return false;
     }
-    QVector<FilterTypeData> filterTypes = filterTypesResult.value();
+    const QVector<ReferenceItem> &filterTypes = filterTypesResult.value();
 
     int selectedIndex = 0;
     for (int i = 0; i < filterTypes.size(); ++i)
@@ -195,8 +195,6 @@ void FiltersTab::onAddFilterButtonClicked()
     // Clear input fields
     ui->nameLineEdit->clear();
     ui->typeComboBox->setCurrentIndex(0);
-
-    refreshData();
 }
 
 void FiltersTab::onEditFilterButtonClicked()
@@ -234,8 +232,6 @@ void FiltersTab::onEditFilterButtonClicked()
                              QString("Failed to update filter: %1").arg(updateResult.error().errorMessage));
         return;
     }
-
-    refreshData();
 }
 
 void FiltersTab::onDeleteFilterButtonClicked()
@@ -274,6 +270,4 @@ void FiltersTab::onDeleteFilterButtonClicked()
                              QString("Failed to delete filter: %1").arg(deleteResult.error().errorMessage));
         return;
     }
-
-    refreshData();
 }
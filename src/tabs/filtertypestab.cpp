@@ -2,6 +2,7 @@
 #include "ui_filtertypes_tab.h"
 #include "db/databasemanager.h"
 #include "db/filtertypesrepository.h"
+#include "trace.h"
 #include <QMessageBox>
 #include <QDialog>
 #include <QFormLayout>
@@ -40,6 +41,7 @@ void FilterTypesTab::initialize()
 
 void FilterTypesTab::refreshData()
 {
+    TRACE_SPAN("FilterTypesTab::refreshData", "tab");
     // Refresh data from database
     populateTable();
 }
@@ -151,8 +153,6 @@ void FilterTypesTab::onAddFilterTypeButtonClicked()
     // Clear input fields
     ui->nameLineEdit->clear();
     ui->prioritySpinBox->setValue(0);
-
-    refreshData();
 }
 
 void FilterTypesTab::onEditFilterTypeButtonClicked()
@@ -188,8 +188,6 @@ void FilterTypesTab::onEditFilterTypeButtonClicked()
                              QString("Failed to update filter type: %1").arg(updateResult.error().errorMessage));
         return;
     }
-
-    refreshData();
 }
 
 void FilterTypesTab::onDeleteFilterTypeButtonClicked()
@@ -228,6 +226,4 @@ void FilterTypesTab::onDeleteFilterTypeButtonClicked()
                              QString("Failed to delete filter type: %1").arg(deleteResult.error().errorMessage));
         return;
     }
-
-    refreshData();
 }
\ No newline at end of file
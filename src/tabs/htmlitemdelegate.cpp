@@ -0,0 +1,54 @@
+#include "tabs/htmlitemdelegate.h"
+#include <QAbstractTextDocumentLayout>
+#include <QApplication>
+#include <QPainter>
+#include <QTextDocument>
+
+namespace
+{
+    void setupDocument(QTextDocument &document, const QStyleOptionViewItem &option)
+    {
+        document.setDefaultFont(option.font);
+        document.setDocumentMargin(2);
+        document.setHtml(option.text);
+        if (option.rect.width() > 0)
+            document.setTextWidth(option.rect.width());
+    }
+}
+
+void HtmlItemDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    QStyleOptionViewItem opt = option;
+    initStyleOption(&opt, index);
+
+    QTextDocument document;
+    setupDocument(document, opt);
+
+    // Let the style draw selection and focus, then the text on top
+    opt.text.clear();
+    QStyle *style = opt.widget ? opt.widget->style() : QApplication::style();
+    style->drawControl(QStyle::CE_ItemViewItem, &opt, painter, opt.widget);
+
+    QAbstractTextDocumentLayout::PaintContext context;
+    const QPalette::ColorGroup group = opt.state & QStyle::State_Enabled ? QPalette::Normal : QPalette::Disabled;
+    context.palette.setColor(QPalette::Text, opt.palette.color(group, opt.state & QStyle::State_Selected
+                                                                          ? QPalette::HighlightedText
+                                                                          : QPalette::Text));
+
+    const QRect textRect = style->subElementRect(QStyle::SE_ItemViewItemText, &opt, opt.widget);
+    painter->save();
+    painter->translate(textRect.topLeft());
+    painter->setClipRect(textRect.translated(-textRect.topLeft()));
+    document.documentLayout()->draw(painter, context);
+    painter->restore();
+}
+
+QSize HtmlItemDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    QStyleOptionViewItem opt = option;
+    initStyleOption(&opt, index);
+
+    QTextDocument document;
+    setupDocument(document, opt);
+    return {static_cast<int>(document.idealWidth()), static_cast<int>(document.size().height())};
+}
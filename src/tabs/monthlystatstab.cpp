@@ -1,8 +1,8 @@
 #include "tabs/monthlystatstab.h"
 #include "ui_monthlystats_tab.h"
 #include "db/databasemanager.h"
-#include <QSqlQuery>
-#include <QSqlError>
+#include "db/statsrepository.h"
+#include "trace.h"
 #include <QMap>
 #include <QDate>
 #include <QMessageBox>
@@ -13,9 +13,10 @@
 #include <utility>
 
 MonthlyStatsTab::MonthlyStatsTab(DatabaseManager *dbManager, QWidget *parent)
-    : QWidget(parent), ui(new Ui::MonthlyStatsTab), m_dbManager(dbManager)
+    : QWidget(parent), ui(new Ui::MonthlyStatsTab), m_dbManager(dbManager), m_repository(nullptr)
 {
     ui->setupUi(this);
+    m_repository = new StatsRepository(m_dbManager, this);
 }
 
 MonthlyStatsTab::~MonthlyStatsTab()
@@ -31,6 +32,7 @@ void MonthlyStatsTab::initialize()
 
 void MonthlyStatsTab::refreshData()
 {
+    TRACE_SPAN("MonthlyStatsTab::refreshData", "tab");
     // Refresh data from database and recreate the chart
     createChart();
 }
@@ -39,34 +41,20 @@ void MonthlyStatsTab::createChart()
 {
     ui->chartView->detachItems();
 
-    // Query database to get monthly exposure times
-    QSqlQuery query(m_dbManager->database());
-
-    const QString sql = R"(
-        SELECT 
-            strftime('%Y-%m', s.start_date) AS month,
-            SUM(o.total_exposure) AS total_seconds
-        FROM observations o
-        INNER JOIN sessions s ON o.session_id = s.id
-        GROUP BY month
-        ORDER BY month ASC
-    )";
-
-    if (!query.exec(sql))
+    auto monthsResult = m_repository->getMonthlyExposure();
+    if (!monthsResult)
     {
         QMessageBox::warning(this, "Error",
-                             QString("Failed to query monthly stats: %1").arg(query.lastError().text()));
+                             QString("Failed to query monthly stats: %1").arg(monthsResult.error().errorMessage));
         return;
     }
 
     // Collect data: month -> total hours
     QMap<QString, double> monthlyData;
-    while (query.next())
+    for (const MonthlyExposure &month : *monthsResult)
     {
-        QString month = query.value("month").toString();
-        const int totalSeconds = query.value("total_seconds").toInt();
-        const double totalHours = totalSeconds / 3600.0; // Convert seconds to hours
-        monthlyData[month] = totalHours;
+        const double totalHours = month.totalSeconds / 3600.0; // Convert seconds to hours
+        monthlyData[month.month.toString("yyyy-MM")] += totalHours;
     }
 
     // test for extreme amount of data
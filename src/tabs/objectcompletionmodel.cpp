@@ -0,0 +1,227 @@
+#include "tabs/objectcompletionmodel.h"
+#include <QRegularExpression>
+#include <algorithm>
+#include <tuple>
+
+namespace
+{
+    // Case folded, compatibility decomposed and without combining marks
+    QString foldText(const QString &text)
+    {
+        const QString decomposed = text.normalized(QString::NormalizationForm_KD);
+        QString folded;
+        folded.reserve(decomposed.size());
+        for (const QChar c : decomposed)
+        {
+            if (c.category() != QChar::Mark_NonSpacing)
+                folded.append(c);
+        }
+        return folded.toCaseFolded();
+    }
+
+    // "m" + number for Messier, "ngc"/"ic" + number without leading zeros
+    QString catalogDesignation(const QString &catalog, const QString &number)
+    {
+        return (catalog == QLatin1String("messier") ? QString("m") : catalog) + number;
+    }
+
+    bool isWordStart(const QString &text, const qsizetype pos)
+    {
+        return text[pos].isLetterOrNumber() && (pos == 0 || !text[pos - 1].isLetterOrNumber());
+    }
+}
+
+void ObjectNameIndex::build(const QVector<ReferenceItem> &items)
+{
+    static const QRegularExpression designationPattern(
+        R"((?<![\p{L}\p{N}])(messier|m|ngc|ic)[\s-]*0*(\d+)(?!\d))");
+
+    m_items = items;
+    m_texts.clear();
+    m_keys.clear();
+    m_exact.clear();
+    m_exact.reserve(items.size());
+
+    for (qsizetype item = 0; item < items.size(); ++item)
+    {
+        const QString &label = items[item].name;
+        m_exact.insert(label.toCaseFolded(), item);
+
+        const QString folded = foldText(label);
+        const qsizetype text = m_texts.size();
+        m_texts.append(folded);
+        m_keys.append({text, 0, item, LabelKey});
+        for (qsizetype pos = 1; pos < folded.size(); ++pos)
+        {
+            if (isWordStart(folded, pos))
+                m_keys.append({text, pos, item, WordKey});
+        }
+
+        auto designations = designationPattern.globalMatch(folded);
+        while (designations.hasNext())
+        {
+            const auto designation = designations.next();
+            m_keys.append({m_texts.size(), 0, item, CatalogKey});
+            m_texts.append(catalogDesignation(designation.captured(1), designation.captured(2)));
+        }
+    }
+
+    std::sort(m_keys.begin(), m_keys.end(), [this](const Key &a, const Key &b)
+    {
+        return keyView(a) < keyView(b);
+    });
+}
+
+qsizetype ObjectNameIndex::findExact(const QString &text) const
+{
+    return m_exact.value(text.toCaseFolded(), -1);
+}
+
+bool ObjectNameIndex::hasMatch(const QString &text) const
+{
+    for (const QString &prefix : queryKeys(text))
+    {
+        const auto it = lowerBound(prefix);
+        if (it != m_keys.cend() && keyView(*it).startsWith(prefix))
+            return true;
+    }
+    return false;
+}
+
+QVector<qsizetype> ObjectNameIndex::match(const QString &text, const qsizetype limit) const
+{
+    QVector<qsizetype> result;
+    const QStringList prefixes = queryKeys(text);
+    if (prefixes.isEmpty())
+    {
+        // Nothing typed yet, offer the list in its own order
+        for (qsizetype item = 0; item < qMin(limit, m_items.size()); ++item)
+            result.append(item);
+        return result;
+    }
+
+    // Best (tier, key length) per item, an item may be reached by several keys
+    struct Rank
+    {
+        Tier tier;
+        qsizetype length;
+    };
+    QHash<qsizetype, Rank> ranks;
+    for (const QString &prefix : prefixes)
+    {
+        for (auto it = lowerBound(prefix); it != m_keys.cend(); ++it)
+        {
+            const QStringView key = keyView(*it);
+            if (!key.startsWith(prefix))
+                break;
+
+            const Rank rank{it->tier, key.size()};
+            auto existing = ranks.find(it->item);
+            if (existing == ranks.end())
+                ranks.insert(it->item, rank);
+            else if (std::tie(rank.tier, rank.length) < std::tie(existing->tier, existing->length))
+                *existing = rank;
+        }
+    }
+
+    result.reserve(ranks.size());
+    for (auto it = ranks.cbegin(); it != ranks.cend(); ++it)
+        result.append(it.key());
+
+    const auto better = [&ranks](const qsizetype a, const qsizetype b)
+    {
+        const Rank rankA = ranks.value(a);
+        const Rank rankB = ranks.value(b);
+        return std::tie(rankA.tier, rankA.length, a) < std::tie(rankB.tier, rankB.length, b);
+    };
+    const qsizetype count = qMin(limit, result.size());
+    std::partial_sort(result.begin(), result.begin() + count, result.end(), better);
+    result.resize(count);
+    return result;
+}
+
+QStringView ObjectNameIndex::keyView(const Key &key) const
+{
+    return QStringView(m_texts[key.text]).mid(key.offset);
+}
+
+QVector<ObjectNameIndex::Key>::const_iterator ObjectNameIndex::lowerBound(const QStringView prefix) const
+{
+    return std::lower_bound(m_keys.cbegin(), m_keys.cend(), prefix, [this](const Key &key, const QStringView value)
+    {
+        return keyView(key) < value;
+    });
+}
+
+QStringList ObjectNameIndex::queryKeys(const QString &text)
+{
+    static const QRegularExpression designationPattern(R"(^(messier|m|ngc|ic)[\s-]*0*(\d*)$)");
+
+    const QString folded = foldText(text.trimmed());
+    if (folded.isEmpty())
+        return {};
+
+    QStringList keys{folded};
+    const auto designation = designationPattern.match(folded);
+    if (designation.hasMatch())
+    {
+        const QString normalized = catalogDesignation(designation.captured(1), designation.captured(2));
+        if (normalized != folded)
+            keys.append(normalized);
+    }
+    return keys;
+}
+
+ObjectCompletionModel::ObjectCompletionModel(QObject *parent)
+    : QAbstractListModel(parent)
+{
+}
+
+int ObjectCompletionModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : static_cast<int>(m_rows.size());
+}
+
+QVariant ObjectCompletionModel::data(const QModelIndex &index, const int role) const
+{
+    if (!index.isValid() || index.row() >= m_rows.size())
+        return {};
+
+    const ReferenceItem &item = m_index.items()[m_rows[index.row()]];
+    switch (role)
+    {
+    case Qt::DisplayRole:
+    case Qt::EditRole:
+        return item.name;
+    case Qt::UserRole:
+        return item.id;
+    default:
+        return {};
+    }
+}
+
+void ObjectCompletionModel::setItems(const QVector<ReferenceItem> &items)
+{
+    // The reference data cache hands out copies of the same list until objects change
+    if (items.constData() == m_index.items().constData() && items.size() == m_index.items().size())
+        return;
+
+    m_index.build(items);
+    updateRows();
+}
+
+void ObjectCompletionModel::setQuery(const QString &text)
+{
+    if (text == m_query)
+        return;
+
+    m_query = text;
+    updateRows();
+}
+
+void ObjectCompletionModel::updateRows()
+{
+    beginResetModel();
+    m_rows = m_index.match(m_query, MaxRows);
+    endResetModel();
+}
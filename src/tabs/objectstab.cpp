@@ -6,6 +6,7 @@
 #include "numerictablewidgetitem.h"
 #include "astrocalc.h"
 #include "settingsmanager.h"
+#include "trace.h"
 #include <QDebug>
 #include <QMessageBox>
 #include <QDialog>
@@ -92,6 +93,7 @@ void ObjectsTab::initialize()
 
 void ObjectsTab::refreshData()
 {
+    TRACE_SPAN("ObjectsTab::refreshData", "tab");
     // Refresh data from database
     populateTable();
 }
@@ -127,21 +129,21 @@ void ObjectsTab::populateTable()
         ui->objectsTable->setItem(row, 0, nameItem);
 
         // RA column
-        QString raText = obj.ra.isNull() ? "" : QString::number(obj.ra.toDouble(), 'f', 6);
+        QString raText = obj.ra ? QString::number(*obj.ra, 'f', 6) : "";
         auto raItem = new NumericTableWidgetItem(raText);
         raItem->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
         ui->objectsTable->setItem(row, 1, raItem);
 
         // Dec column
-        QString decText = obj.dec.isNull() ? "" : QString::number(obj.dec.toDouble(), 'f', 6);
+        QString decText = obj.dec ? QString::number(*obj.dec, 'f', 6) : "";
         auto decItem = new NumericTableWidgetItem(decText);
         decItem->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
         ui->objectsTable->setItem(row, 2, decItem);
 
         // Get object info for transit time and position
-        if (!obj.ra.isNull() && !obj.dec.isNull())
+        if (obj.ra && obj.dec)
         {
-            ObjectInfo info = AstroCalc::getObjectInfo(lat, lon, obj.ra.toDouble(), obj.dec.toDouble());
+            ObjectInfo info = AstroCalc::getObjectInfo(lat, lon, *obj.ra, *obj.dec);
             
             // Transit time column
             auto transitItem = new QTableWidgetItem(info.transitTime.toLocalTime().toString("hh:mm"));
@@ -260,6 +262,7 @@ bool ObjectsTab::showObjectDialog(const QString &title, QString &name, QString &
     if (!m_simbadQuery)
     {
         m_simbadQuery = new SimbadQuery(this);
+        m_simbadQuery->setServiceUrl(QUrl(m_settingsManager->simbadTapUrl()));
         connect(m_simbadQuery, &SimbadQuery::coordinatesReceived,
                 this, &ObjectsTab::onCoordinatesReceived);
         connect(m_simbadQuery, &SimbadQuery::errorOccurred,
@@ -367,8 +370,6 @@ void ObjectsTab::onAddButtonClicked()
                              QString("Failed to add object: %1").arg(addResult.error().errorMessage));
         return;
     }
-
-    refreshData();
 }
 
 void ObjectsTab::onEditButtonClicked()
@@ -417,8 +418,6 @@ void ObjectsTab::onEditButtonClicked()
                              QString("Failed to update object: %1").arg(updateResult.error().errorMessage));
         return;
     }
-
-    refreshData();
 }
 
 void ObjectsTab::onDeleteButtonClicked()
@@ -457,8 +456,6 @@ void ObjectsTab::onDeleteButtonClicked()
                              QString("Failed to delete object: %1").arg(deleteResult.error().errorMessage));
         return;
     }
-
-    refreshData();
 }
 
 void ObjectsTab::onCoordinatesReceived(const double ra, const double dec, const QString &objectName) const {
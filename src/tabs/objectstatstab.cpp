@@ -1,20 +1,20 @@
 #include "tabs/objectstatstab.h"
 #include "ui_objectstats_tab.h"
 #include "db/databasemanager.h"
+#include "db/statsrepository.h"
 #include "numerictablewidgetitem.h"
-#include <QSqlQuery>
-#include <QSqlError>
+#include "trace.h"
 #include <QDebug>
 #include <QMessageBox>
-#include <QMap>
 #include <QHeaderView>
 #include <QColor>
 #include <algorithm>
 
 ObjectStatsTab::ObjectStatsTab(DatabaseManager *dbManager, QWidget *parent)
-    : QWidget(parent), ui(new Ui::ObjectStatsTab), m_dbManager(dbManager)
+    : QWidget(parent), ui(new Ui::ObjectStatsTab), m_dbManager(dbManager), m_repository(nullptr)
 {
     ui->setupUi(this);
+    m_repository = new StatsRepository(m_dbManager, this);
 }
 
 ObjectStatsTab::~ObjectStatsTab()
@@ -30,106 +30,34 @@ void ObjectStatsTab::initialize()
 
 void ObjectStatsTab::refreshData()
 {
+    TRACE_SPAN("ObjectStatsTab::refreshData", "tab");
     // Clear the table
     ui->objectStatsTable->clear();
     ui->objectStatsTable->setRowCount(0);
     ui->objectStatsTable->setColumnCount(0);
 
-    const QSqlDatabase &db = m_dbManager->database();
-
-    // First, get all filter types ordered by priority
-    QSqlQuery filterTypesQuery(db);
-    filterTypesQuery.prepare(R"(
-        SELECT id, name, priority
-        FROM filter_types
-        ORDER BY priority
-    )");
-
-    if (!filterTypesQuery.exec())
-    {
-        QMessageBox::warning(this, "Database Error",
-                             QString("Failed to fetch filter types: %1").arg(filterTypesQuery.lastError().text()));
-        return;
-    }
-
-    QVector<int> filterTypeIds;
-    QVector<QString> filterTypeNames;
-
-    while (filterTypesQuery.next())
-    {
-        filterTypeIds.append(filterTypesQuery.value(0).toInt());
-        filterTypeNames.append(filterTypesQuery.value(1).toString());
-    }
-
-    // Get all objects that have observations
-    QSqlQuery objectsQuery(db);
-    objectsQuery.prepare(R"(
-        SELECT DISTINCT o.id, o.name, o.comments
-        FROM objects o
-        INNER JOIN observations obs ON obs.object_id = o.id
-        ORDER BY o.name
-    )");
-
-    if (!objectsQuery.exec())
+    auto exposureResult = m_repository->getObjectExposure();
+    if (!exposureResult)
     {
         QMessageBox::warning(this, "Database Error",
-                             QString("Failed to fetch objects: %1").arg(objectsQuery.lastError().text()));
+                             QString("Failed to fetch exposure data: %1").arg(exposureResult.error().errorMessage));
         return;
     }
-
-    QVector<int> objectIds;
-    QVector<QString> objectNames;
-
-    while (objectsQuery.next())
-    {
-        objectIds.append(objectsQuery.value(0).toInt());
-        QString name = objectsQuery.value(1).toString();
-        if (!objectsQuery.value(2).toString().isEmpty())
-            name.append(" / " + objectsQuery.value(2).toString());
-        objectNames.append(name);
-    }
+    const ObjectExposureTable &exposureTable = *exposureResult;
 
     // If no objects or filter types, show empty table
-    if (objectIds.isEmpty() || filterTypeIds.isEmpty())
+    if (exposureTable.objects.isEmpty() || exposureTable.filterTypes.isEmpty())
     {
         return;
     }
 
-    // Query exposure times grouped by object and filter type
-    QSqlQuery exposureQuery(db);
-    exposureQuery.prepare(R"(
-        SELECT
-            o.id as object_id,
-            ft.id as filter_type_id,
-            SUM(obs.total_exposure) as total_exposure
-        FROM observations obs
-        INNER JOIN objects o ON obs.object_id = o.id
-        INNER JOIN filters f ON obs.filter_id = f.id
-        INNER JOIN filter_types ft ON f.filter_type_id = ft.id
-        GROUP BY o.id, ft.id
-    )");
-
-    if (!exposureQuery.exec())
-    {
-        QMessageBox::warning(this, "Database Error",
-                             QString("Failed to fetch exposure data: %1").arg(exposureQuery.lastError().text()));
-        return;
-    }
-
-    // Store exposure times in a map: (objectId, filterTypeId) -> totalExposure
-    QMap<QPair<int, int>, int> exposureMap;
-
-    while (exposureQuery.next())
-    {
-        int objectId = exposureQuery.value(0).toInt();
-        int filterTypeId = exposureQuery.value(1).toInt();
-        const int totalExposure = exposureQuery.value(2).toInt();
-        exposureMap[qMakePair(objectId, filterTypeId)] = totalExposure;
-    }
+    QVector<QString> filterTypeNames;
+    for (const FilterTypeData &filterType : exposureTable.filterTypes)
+        filterTypeNames.append(filterType.name);
 
     // Setup table: columns = Object Name + Filter Types + Total
     const int numCols = static_cast<int>( 1 + filterTypeNames.size() + 1); // Object Name column + filter type columns + Total column
-    const int numRows = static_cast<int>( objectNames.size());
+    const int numRows = static_cast<int>( exposureTable.objects.size());
 
     ui->objectStatsTable->setRowCount(numRows);
     ui->objectStatsTable->setColumnCount(numCols);
@@ -143,27 +71,23 @@ void ObjectStatsTab::refreshData()
 
     // Populate the table and collect totals
     QVector<double> totals;
-    totals.reserve(objectNames.size());
+    totals.reserve(numRows);
 
-    for (int row = 0; row < objectNames.size(); ++row)
+    for (int row = 0; row < numRows; ++row)
     {
-        int objectId = objectIds[row];
-        QString objectName = objectNames[row];
+        const ObjectExposure &object = exposureTable.objects[row];
 
         // First column: Object name
-        const auto objectItem = new QTableWidgetItem(objectName);
+        const auto objectItem = new QTableWidgetItem(object.name);
         objectItem->setTextAlignment(Qt::AlignLeft | Qt::AlignVCenter);
         ui->objectStatsTable->setItem(row, 0, objectItem);
 
-        int rowTotal = 0;
+        const qint64 rowTotal = object.totalSeconds;
 
         // Filter type columns
         for (int col = 0; col < filterTypeNames.size(); ++col)
         {
-            int filterTypeId = filterTypeIds[col];
-            const int exposure = exposureMap.value(qMakePair(objectId, filterTypeId), 0);
-
-            rowTotal += exposure;
+            const qint64 exposure = object.seconds[col];
 
             // Format exposure time in seconds
             QString exposureText = exposure > 0 ? QString::number(exposure) : "";
@@ -2,8 +2,15 @@
 #include "ui_observations_tab.h"
 #include "db/databasemanager.h"
 #include "db/observationsrepository.h"
-#include "numerictablewidgetitem.h"
+#include "db/referencedatacache.h"
+#include "tabs/observationstablemodel.h"
+#include "tabs/htmlitemdelegate.h"
+#include "export/observationhtmlexporter.h"
+#include "export/observationexcelexporter.h"
+#include "export/staticsitegenerator.h"
+#include "export/exportprogressdialog.h"
 #include "settingsmanager.h"
+#include "trace.h"
 #include <QMessageBox>
 #include <QDialog>
 #include <QFormLayout>
@@ -11,32 +18,81 @@
 #include <QSpinBox>
 #include <QLineEdit>
 #include <QDialogButtonBox>
-#include <QTableWidgetItem>
 #include <QPushButton>
-#include <QSqlQuery>
-#include <QStringListModel>
+#include <QStandardItemModel>
+#include <QItemSelection>
+#include <QCheckBox>
+#include <QDateEdit>
+#include <QHash>
+#include <QHeaderView>
+#include <QSet>
+#include <QTimer>
 #include <QMenu>
 #include <QFileDialog>
-#include <QFile>
-#include <QTextStream>
-#include <QDateTime>
-#include <OpenXLSX.hpp>
 #include <QDesktopServices>
-#include <QSortFilterProxyModel>
 #include <QCompleter>
+#include <QSignalBlocker>
+#include <algorithm>
+#include <functional>
+
+namespace
+{
+    // First entry of the filter bar combo boxes, matches no restriction
+    const QString anyItemLabel = "< Any >";
+
+    // Id of the selected filter bar entry, nothing if "< Any >" or the list is empty
+    std::optional<int> filterComboBoxId(const QComboBox *comboBox)
+    {
+        const QVariant id = comboBox->currentData();
+        if (!id.isValid() || id.toInt() == -1)
+            return std::nullopt;
+        return id.toInt();
+    }
+
+    // Replaces the items of a combo box with cached reference rows and selects the given id if it still exists.
+    // A failed load leaves the combo box empty, the user cannot pick a row that may not exist.
+    // With anyLabel the list starts with an entry for "no restriction" that has id -1.
+    void fillComboBox(QComboBox *comboBox, const std::expected<QVector<ReferenceItem>, ER> &items, const QVariant &selectedId,
+                      const QString &anyLabel = QString())
+    {
+        const QSignalBlocker blocker(comboBox);
+        comboBox->clear();
+        if (!anyLabel.isEmpty())
+            comboBox->addItem(anyLabel, -1);
+        if (!items)
+            return;
+
+        for (const auto &[id, name] : items.value())
+        {
+            comboBox->addItem(name, id);
+        }
+
+        if (const int index = comboBox->findData(selectedId); index >= 0)
+            comboBox->setCurrentIndex(index);
+    }
+}
 
 ObservationsTab::ObservationsTab(DatabaseManager *dbManager, SettingsManager *settingsManager, QWidget *parent)
     : QWidget(parent), ui(new Ui::ObservationsTab), m_dbManager(dbManager), m_settingsManager(settingsManager),
-      m_repository(nullptr), m_filterListModel(nullptr), m_exportMenu(nullptr), m_currentFilterObjectId(-1)
+      m_repository(nullptr), m_tableModel(nullptr), m_filterListModel(nullptr), m_searchResultsModel(nullptr),
+      m_searchTimer(nullptr), m_objectCompletionModel(nullptr), m_exportMenu(nullptr),
+      m_exportJob(nullptr), m_updatingFilterWidgets(false)
 {
     ui->setupUi(this);
     m_repository = new ObservationsRepository(m_dbManager, this);
-    m_filterListModel = new QStringListModel(this);
+    m_tableModel = new ObservationsTableModel(m_repository, m_dbManager->referenceData(), m_settingsManager, this);
+    ui->observationsTable->setModel(m_tableModel);
+    m_filterListModel = new QStandardItemModel(this);
     ui->observationFilterListView->setModel(m_filterListModel);
+    m_searchResultsModel = new QStandardItemModel(this);
+    ui->searchResultsListView->setModel(m_searchResultsModel);
+    m_objectCompletionModel = new ObjectCompletionModel(this);
 }
 
 ObservationsTab::~ObservationsTab()
 {
+    // Stops a running export before the widgets it reports to are gone
+    delete m_exportJob;
     delete ui;
 }
 
@@ -52,7 +108,7 @@ void ObservationsTab::initialize()
     connect(openExplorerAction, &QAction::triggered, this, &ObservationsTab::onExploreSessionsFolder);
 
     ui->observationsTable->setContextMenuPolicy(Qt::ContextMenuPolicy::CustomContextMenu);
-    connect(ui->observationsTable,&QTableWidget::customContextMenuRequested,this,[this]{
+    connect(ui->observationsTable,&QTableView::customContextMenuRequested,this,[this]{
         if (m_settingsManager->sessionsFolderTemplate().isEmpty())
             return;
         m_rightClickMenu->popup(QCursor::pos());
@@ -62,14 +118,56 @@ void ObservationsTab::initialize()
     m_exportMenu = new QMenu(this);
     const auto exportToHtmlAction = m_exportMenu->addAction("Export to HTML");
     const auto exportToExcelAction = m_exportMenu->addAction("Export to Excel");
+    const auto exportToExcelPerObjectAction = m_exportMenu->addAction("Export to Excel (Sheet per Object)");
     connect(exportToHtmlAction, &QAction::triggered, this, &ObservationsTab::onExportToHtmlClicked);
-    connect(exportToExcelAction, &QAction::triggered, this, &ObservationsTab::onExportToExcelClicked);
+    connect(exportToExcelAction, &QAction::triggered, this, [this] { onExportToExcelClicked(false); });
+    connect(exportToExcelPerObjectAction, &QAction::triggered, this, [this] { onExportToExcelClicked(true); });
+    m_exportMenu->addSeparator();
+    const auto generateSiteAction = m_exportMenu->addAction("Generate Static Site...");
+    connect(generateSiteAction, &QAction::triggered, this, &ObservationsTab::onGenerateSiteClicked);
     ui->exportObservationButton->setMenu(m_exportMenu);
 
 
-    // Connect filter list view
+    // Connect filter list view and filter bar, every change reloads the table through SQL
     connect(ui->observationFilterListView->selectionModel(), &QItemSelectionModel::selectionChanged,
-            this, &ObservationsTab::onFilterSelectionChanged);
+            this, &ObservationsTab::onFilterChanged);
+    for (QComboBox *comboBox : {ui->filterBarCameraComboBox, ui->filterBarTelescopeComboBox,
+                                ui->filterBarFilterComboBox, ui->filterBarFilterTypeComboBox})
+    {
+        connect(comboBox, &QComboBox::currentIndexChanged, this, &ObservationsTab::onFilterChanged);
+    }
+    ui->filterBarFromDateEdit->setDate(QDate::currentDate().addYears(-1));
+    ui->filterBarToDateEdit->setDate(QDate::currentDate());
+    connect(ui->filterBarDateCheckBox, &QCheckBox::toggled, this, [this](const bool checked)
+    {
+        ui->filterBarFromDateEdit->setEnabled(checked);
+        ui->filterBarToDateEdit->setEnabled(checked);
+        onFilterChanged();
+    });
+    connect(ui->filterBarFromDateEdit, &QDateEdit::dateChanged, this, &ObservationsTab::onFilterChanged);
+    connect(ui->filterBarToDateEdit, &QDateEdit::dateChanged, this, &ObservationsTab::onFilterChanged);
+    for (QSpinBox *spinBox : {ui->filterBarMoonMinSpinBox, ui->filterBarMoonMaxSpinBox,
+                              ui->filterBarSeparationMinSpinBox, ui->filterBarSeparationMaxSpinBox})
+    {
+        connect(spinBox, &QSpinBox::valueChanged, this, &ObservationsTab::onFilterChanged);
+    }
+    if (!m_repository->hasAngularSeparation())
+    {
+        // SQL cannot compute the separation with this SQLite library
+        ui->filterBarSeparationMinSpinBox->setEnabled(false);
+        ui->filterBarSeparationMaxSpinBox->setEnabled(false);
+    }
+    connect(ui->clearFilterButton, &QPushButton::clicked, this, &ObservationsTab::onClearFilterClicked);
+
+    // Search runs once typing pauses, results are shown only while there is something to search for
+    m_searchTimer = new QTimer(this);
+    m_searchTimer->setSingleShot(true);
+    m_searchTimer->setInterval(150);
+    connect(ui->searchLineEdit, &QLineEdit::textChanged, m_searchTimer, qOverload<>(&QTimer::start));
+    connect(m_searchTimer, &QTimer::timeout, this, &ObservationsTab::onFilterChanged);
+    ui->searchResultsListView->setItemDelegate(new HtmlItemDelegate(ui->searchResultsListView));
+    ui->searchResultsListView->hide();
+    connect(ui->searchResultsListView, &QListView::clicked, this, &ObservationsTab::onSearchResultClicked);
 
     // Configure table columns
     ui->observationsTable->setColumnWidth(0, 120);  // Session Name
@@ -85,26 +183,45 @@ void ObservationsTab::initialize()
     ui->observationsTable->setColumnWidth(10, 80);  // Angular Separation
     ui->observationsTable->setColumnWidth(11, 200); // Comments
 
+    // Sorting is done by the model in SQL, newest sessions first
+    ui->observationsTable->sortByColumn(ObservationsTableModel::DateColumn, Qt::DescendingOrder);
+    // The header sets its indicator before asking the model, put it back on columns the model refuses
+    QHeaderView *header = ui->observationsTable->horizontalHeader();
+    connect(header, &QHeaderView::sortIndicatorChanged, this, [this, header](const int column)
+    {
+        if (m_tableModel->isSortable(column))
+            return;
+        const QSignalBlocker blocker(header);
+        header->setSortIndicator(m_tableModel->sortColumn(), m_tableModel->sortOrder());
+    });
+    connect(m_tableModel, &ObservationsTableModel::errorOccurred, this, [this](const QString &errorMessage)
+    {
+        QMessageBox::warning(this, "Database Error", QString("Failed to load observations: %1").arg(errorMessage));
+    });
+
     ui->objectComboBox->setFocusPolicy(Qt::StrongFocus);
     ui->objectComboBox->setEditable(true);
     ui->objectComboBox->setInsertPolicy(QComboBox::NoInsert);
-    const auto filterModel = new QSortFilterProxyModel(ui->objectComboBox);
-    filterModel->setFilterCaseSensitivity(Qt::CaseInsensitive);
-    filterModel->setSourceModel(ui->objectComboBox->model());
-    const auto completer = new QCompleter(filterModel,ui->objectComboBox);
+    // The completion model is already filtered and ranked by the object name index
+    const auto completer = new QCompleter(m_objectCompletionModel,ui->objectComboBox);
+    completer->setCaseSensitivity(Qt::CaseInsensitive);
     completer->setCompletionMode(QCompleter::UnfilteredPopupCompletion);
     ui->objectComboBox->setCompleter(completer);
-    connect(ui->objectComboBox->lineEdit(),&QLineEdit::textEdited, filterModel, &QSortFilterProxyModel::setFilterFixedString);
+    connect(ui->objectComboBox->lineEdit(),&QLineEdit::textEdited, m_objectCompletionModel, &ObjectCompletionModel::setQuery);
 
-    const auto validator = new ComboBoxItemValidator(ui->objectComboBox, this);
+    const auto validator = new ComboBoxItemValidator(&m_objectCompletionModel->nameIndex(), this);
     ui->objectComboBox->lineEdit()->setValidator(validator);
 
+    // Observation rows are patched in place, reference data changes are handled by MainWindow
+    connect(m_dbManager, &DatabaseManager::dataChanged, this, &ObservationsTab::onDataChanged);
+
     // Initialize data
     refreshData();
 }
 
 void ObservationsTab::refreshData()
 {
+    TRACE_SPAN("ObservationsTab::refreshData", "tab");
     // Refresh combo boxes with latest data
     populateComboBoxes();
 
@@ -116,278 +233,409 @@ void ObservationsTab::refreshData()
 }
 
 void ObservationsTab::populateComboBoxes() const {
-    // Save current selections
-    // TODO: this is very naive, maybe use actual user data to restore selected item
-    const int sessionIndex = ui->sessionNameComboBox->currentIndex();
-    const int objectIndex = ui->objectComboBox->currentIndex();
-    const int cameraIndex = ui->cameraComboBox->currentIndex();
-    const int telescopeIndex = ui->telescopeComboBox->currentIndex();
-    const int filterIndex = ui->filterComboBox->currentIndex();
-
-    // Clear all combo boxes
-    ui->sessionNameComboBox->clear();
-    ui->objectComboBox->clear();
-    ui->cameraComboBox->clear();
-    ui->telescopeComboBox->clear();
-    ui->filterComboBox->clear();
-
-    QSqlQuery query(m_dbManager->database());
-
-    // Populate Sessions
-    if (query.exec("SELECT id, concat(name,' (', start_date, ')') as name FROM sessions ORDER BY start_date DESC"))
-    {
-        while (query.next())
-        {
-            const int id = query.value("id").toInt();
-            QString name = query.value("name").toString();
-            ui->sessionNameComboBox->addItem(name, id);
-        }
-    }
+    // Keep the selected rows, the lists may have been reordered
+    const QVariant sessionId = ui->sessionNameComboBox->currentData();
+    const QVariant objectId = ui->objectComboBox->currentData();
+    const QVariant cameraId = ui->cameraComboBox->currentData();
+    const QVariant telescopeId = ui->telescopeComboBox->currentData();
+    const QVariant filterId = ui->filterComboBox->currentData();
+
+    ReferenceDataCache *referenceData = m_dbManager->referenceData();
+    fillComboBox(ui->sessionNameComboBox, referenceData->items(DbTable::Sessions), sessionId);
+    const auto objects = referenceData->items(DbTable::Objects);
+    fillComboBox(ui->objectComboBox, objects, objectId);
+    m_objectCompletionModel->setItems(objects ? objects.value() : QVector<ReferenceItem>());
+    fillComboBox(ui->cameraComboBox, referenceData->items(DbTable::Cameras), cameraId);
+    fillComboBox(ui->telescopeComboBox, referenceData->items(DbTable::Telescopes), telescopeId);
+    fillComboBox(ui->filterComboBox, referenceData->items(DbTable::Filters), filterId);
+
+    fillComboBox(ui->filterBarCameraComboBox, referenceData->items(DbTable::Cameras),
+                 ui->filterBarCameraComboBox->currentData(), anyItemLabel);
+    fillComboBox(ui->filterBarTelescopeComboBox, referenceData->items(DbTable::Telescopes),
+                 ui->filterBarTelescopeComboBox->currentData(), anyItemLabel);
+    fillComboBox(ui->filterBarFilterComboBox, referenceData->items(DbTable::Filters),
+                 ui->filterBarFilterComboBox->currentData(), anyItemLabel);
+    fillComboBox(ui->filterBarFilterTypeComboBox, referenceData->items(DbTable::FilterTypes),
+                 ui->filterBarFilterTypeComboBox->currentData(), anyItemLabel);
+}
 
-    // Populate Objects
-    if (query.exec("SELECT id, name, comments FROM objects ORDER BY name"))
+void ObservationsTab::populateObjectFilter() {
+    // Keep the selected objects, the list is rebuilt from scratch
+    QSet<int> selectedIds;
+    for (const QModelIndex &index : ui->observationFilterListView->selectionModel()->selectedIndexes())
     {
-        while (query.next())
-        {
-            const int id = query.value("id").toInt();
-            QString name = query.value("name").toString();
-            QString comments = query.value("comments").toString();
-            if (!comments.isEmpty()) {
-                name.append(" / " + comments);
-            }
-            ui->objectComboBox->addItem(name, id);
-        }
+        selectedIds.insert(index.data(Qt::UserRole).toInt());
     }
 
-    // Populate Cameras
-    if (query.exec("SELECT id, name FROM cameras ORDER BY name"))
+    m_updatingFilterWidgets = true;
+    m_filterListModel->clear();
+
+    auto *allObjectsItem = new QStandardItem("< All Objects >");
+    allObjectsItem->setData(-1, Qt::UserRole);
+    m_filterListModel->appendRow(allObjectsItem);
+
+    // Objects are listed by id, so objects with the same name and different comments stay apart.
+    // Labels come from the shared cache, only the ids of observed objects are queried.
+    const auto observedIds = m_repository->getObservedObjectIds();
+    const auto objects = m_dbManager->referenceData()->items(DbTable::Objects);
+    if (observedIds && objects)
     {
-        while (query.next())
+        QVector<ReferenceItem> listed;
+        for (const ReferenceItem &object : objects.value())
         {
-            int id = query.value("id").toInt();
-            QString name = query.value("name").toString();
-            ui->cameraComboBox->addItem(name, id);
+            if (observedIds->contains(object.id))
+                listed.append(object);
         }
-    }
-
-    // Populate Telescopes
-    if (query.exec("SELECT id, name FROM telescopes ORDER BY name"))
-    {
-        while (query.next())
+        std::ranges::sort(listed, {}, &ReferenceItem::name);
+        for (const auto &[id, name] : std::as_const(listed))
         {
-            int id = query.value("id").toInt();
-            QString name = query.value("name").toString();
-            ui->telescopeComboBox->addItem(name, id);
+            auto *item = new QStandardItem(name);
+            item->setData(id, Qt::UserRole);
+            m_filterListModel->appendRow(item);
         }
     }
 
-    // Populate Filters
-    if (query.exec("SELECT f.id, f.name FROM filters f LEFT JOIN filter_types ft on f.filter_type_id = ft.id ORDER BY ft.priority ASC, f.name ASC"))
+    // Restore previous selection, select "All Objects" if it is gone or nothing was selected
+    QItemSelection selection;
+    for (int row = 1; row < m_filterListModel->rowCount(); ++row)
     {
-        while (query.next())
-        {
-            int id = query.value("id").toInt();
-            QString name = query.value("name").toString();
-            ui->filterComboBox->addItem(name, id);
-        }
+        const QModelIndex index = m_filterListModel->index(row, 0);
+        if (selectedIds.contains(index.data(Qt::UserRole).toInt()))
+            selection.select(index, index);
     }
-
-    // Restore selections if possible
-    if (sessionIndex >= 0 && sessionIndex < ui->sessionNameComboBox->count())
-        ui->sessionNameComboBox->setCurrentIndex(sessionIndex);
-    if (objectIndex >= 0 && objectIndex < ui->objectComboBox->count())
-        ui->objectComboBox->setCurrentIndex(objectIndex);
-    if (cameraIndex >= 0 && cameraIndex < ui->cameraComboBox->count())
-        ui->cameraComboBox->setCurrentIndex(cameraIndex);
-    if (telescopeIndex >= 0 && telescopeIndex < ui->telescopeComboBox->count())
-        ui->telescopeComboBox->setCurrentIndex(telescopeIndex);
-    if (filterIndex >= 0 && filterIndex < ui->filterComboBox->count())
-        ui->filterComboBox->setCurrentIndex(filterIndex);
+    QItemSelectionModel *selectionModel = ui->observationFilterListView->selectionModel();
+    selectionModel->select(selection, QItemSelectionModel::ClearAndSelect);
+    if (!selection.isEmpty())
+        selectionModel->setCurrentIndex(selection.indexes().first(), QItemSelectionModel::NoUpdate);
+    ensureObjectFilterSelection();
+    m_updatingFilterWidgets = false;
 }
 
-void ObservationsTab::populateObjectFilter() const {
-    // TODO: Store object ID instead of name. Then it would be possible to filter for objects that have same name but different comment.
-    QStringList objectNames;
-    objectNames << "< All Objects >";
+void ObservationsTab::updateObjectFilter(const QList<int> &changedIds, const std::optional<QSet<int>> &previousObjectIds)
+{
+    QHash<int, int> listedRows; // object id -> row
+    for (int row = 1; row < m_filterListModel->rowCount(); ++row)
+    {
+        listedRows.insert(m_filterListModel->index(row, 0).data(Qt::UserRole).toInt(), row);
+    }
+
+    // Objects the rows belong to now are observed, those not listed yet are added
+    const auto currentObjectIds = m_repository->getObjectIdsOfObservations(changedIds);
+    if (!currentObjectIds)
+    {
+        QMessageBox::warning(this, "Database Error",
+                             QString("Failed to load observations: %1").arg(currentObjectIds.error().errorMessage));
+        return;
+    }
+    QSet<int> addedIds;
+    for (const int objectId : currentObjectIds.value())
+    {
+        if (!listedRows.contains(objectId))
+            addedIds.insert(objectId);
+    }
 
-    QSqlQuery query(m_dbManager->database());
-    if (query.exec("SELECT DISTINCT objects.name FROM objects INNER JOIN observations ON objects.id = observations.object_id ORDER BY objects.name"))
+    // Objects the rows left may have lost their last observation
+    QList<int> candidateIds;
+    for (auto it = listedRows.cbegin(); it != listedRows.cend(); ++it)
     {
-        while (query.next())
+        if ((!previousObjectIds || previousObjectIds->contains(it.key())) && !currentObjectIds->contains(it.key()))
+            candidateIds.append(it.key());
+    }
+    QList<int> removedRows;
+    if (!candidateIds.isEmpty())
+    {
+        const auto observedIds = m_repository->getObservedObjectIds(candidateIds);
+        if (!observedIds)
+        {
+            QMessageBox::warning(this, "Database Error",
+                                 QString("Failed to load observations: %1").arg(observedIds.error().errorMessage));
+            return;
+        }
+        for (const int objectId : std::as_const(candidateIds))
         {
-            objectNames << query.value(0).toString();
+            if (!observedIds->contains(objectId))
+                removedRows.append(listedRows.value(objectId));
         }
     }
 
-    m_filterListModel->setStringList(objectNames);
+    if (addedIds.isEmpty() && removedRows.isEmpty())
+        return;
+
+    m_updatingFilterWidgets = true;
+    std::ranges::sort(removedRows, std::greater());
+    for (const int row : std::as_const(removedRows))
+    {
+        m_filterListModel->removeRow(row);
+    }
 
-    // Select "All Objects" by default if nothing is selected
-    if (!ui->observationFilterListView->currentIndex().isValid())
+    ReferenceDataCache *referenceData = m_dbManager->referenceData();
+    for (const int objectId : std::as_const(addedIds))
     {
-        ui->observationFilterListView->setCurrentIndex(m_filterListModel->index(0, 0));
+        const QString name = referenceData->name(DbTable::Objects, objectId);
+        int row = 1;
+        while (row < m_filterListModel->rowCount() && m_filterListModel->item(row)->text() < name)
+            ++row;
+        auto *item = new QStandardItem(name);
+        item->setData(objectId, Qt::UserRole);
+        m_filterListModel->insertRow(row, item);
     }
+    ensureObjectFilterSelection();
+    m_updatingFilterWidgets = false;
 }
 
-void ObservationsTab::populateTable()
+void ObservationsTab::ensureObjectFilterSelection()
 {
-    ui->observationsTable->setSortingEnabled(false);
-    ui->observationsTable->setRowCount(0);
+    QItemSelectionModel *selectionModel = ui->observationFilterListView->selectionModel();
+    if (selectionModel->hasSelection())
+        return;
 
-    QVector<ObservationData> observations;
+    const QModelIndex allObjects = m_filterListModel->index(0, 0);
+    selectionModel->select(allObjects, QItemSelectionModel::ClearAndSelect);
+    selectionModel->setCurrentIndex(allObjects, QItemSelectionModel::NoUpdate);
+}
+
+ObservationFilter ObservationsTab::filterFromWidgets() const
+{
+    ObservationFilter filter;
 
-    // Get observations based on current filter
-    if (m_currentFilterObjectId == -1)
+    for (const QModelIndex &index : ui->observationFilterListView->selectionModel()->selectedIndexes())
     {
-        // Show all observations
-        auto allObsResult = m_repository->getAllObservations();
-        if (!allObsResult)
+        const int objectId = index.data(Qt::UserRole).toInt();
+        if (objectId == -1)
         {
-            QMessageBox::warning(this, "Database Error",
-                                 QString("Failed to load observations: %1").arg(allObsResult.error().errorMessage));
-            return;
+            // "All Objects" wins over any other selected object
+            filter.objectIds.clear();
+            break;
         }
-        observations = allObsResult.value();
+        filter.objectIds.append(objectId);
     }
-    else
+    // Selection order must not make equal filters compare different
+    std::ranges::sort(filter.objectIds);
+
+    if (const auto id = filterComboBoxId(ui->filterBarCameraComboBox))
+        filter.cameraIds.append(*id);
+    if (const auto id = filterComboBoxId(ui->filterBarTelescopeComboBox))
+        filter.telescopeIds.append(*id);
+    if (const auto id = filterComboBoxId(ui->filterBarFilterComboBox))
+        filter.filterIds.append(*id);
+    if (const auto id = filterComboBoxId(ui->filterBarFilterTypeComboBox))
+        filter.filterTypeIds.append(*id);
+
+    filter.searchText = ui->searchLineEdit->text().trimmed();
+
+    if (ui->filterBarDateCheckBox->isChecked())
     {
-        // Show filtered observations
-        auto filteredObsResult = m_repository->getObservationsByObject(m_currentFilterObjectId);
-        if (!filteredObsResult)
+        filter.fromDate = ui->filterBarFromDateEdit->date();
+        filter.toDate = ui->filterBarToDateEdit->date();
+    }
+
+    // Bounds at the ends of the spin box ranges do not restrict
+    if (ui->filterBarMoonMinSpinBox->value() > ui->filterBarMoonMinSpinBox->minimum())
+        filter.minMoonIllumination = ui->filterBarMoonMinSpinBox->value();
+    if (ui->filterBarMoonMaxSpinBox->value() < ui->filterBarMoonMaxSpinBox->maximum())
+        filter.maxMoonIllumination = ui->filterBarMoonMaxSpinBox->value();
+    if (ui->filterBarSeparationMinSpinBox->isEnabled())
+    {
+        if (ui->filterBarSeparationMinSpinBox->value() > ui->filterBarSeparationMinSpinBox->minimum())
+            filter.minAngularSeparation = ui->filterBarSeparationMinSpinBox->value();
+        if (ui->filterBarSeparationMaxSpinBox->value() < ui->filterBarSeparationMaxSpinBox->maximum())
+            filter.maxAngularSeparation = ui->filterBarSeparationMaxSpinBox->value();
+    }
+
+    return filter;
+}
+
+QString ObservationsTab::filterDescription() const
+{
+    if (m_currentFilter.isEmpty())
+        return "All Objects";
+
+    QStringList parts;
+    if (!m_currentFilter.searchText.isEmpty())
+        parts << QString("Search: \"%1\"").arg(m_currentFilter.searchText);
+    if (!m_currentFilter.objectIds.isEmpty())
+    {
+        QStringList objectNames;
+        for (const QModelIndex &index : ui->observationFilterListView->selectionModel()->selectedIndexes())
         {
-            QMessageBox::warning(this, "Database Error",
-                                 QString("Failed to load observations: %1").arg(filteredObsResult.error().errorMessage));
-            return;
+            objectNames << index.data(Qt::DisplayRole).toString();
         }
-        observations = filteredObsResult.value();
+        objectNames.sort();
+        parts << objectNames.join(", ");
     }
+    if (!m_currentFilter.cameraIds.isEmpty())
+        parts << "Camera: " + ui->filterBarCameraComboBox->currentText();
+    if (!m_currentFilter.telescopeIds.isEmpty())
+        parts << "Telescope: " + ui->filterBarTelescopeComboBox->currentText();
+    if (!m_currentFilter.filterIds.isEmpty())
+        parts << "Filter: " + ui->filterBarFilterComboBox->currentText();
+    if (!m_currentFilter.filterTypeIds.isEmpty())
+        parts << "Filter Type: " + ui->filterBarFilterTypeComboBox->currentText();
+    if (m_currentFilter.fromDate.isValid())
+        parts << QString("Date: %1 - %2").arg(m_currentFilter.fromDate.toString(Qt::ISODate),
+                                              m_currentFilter.toDate.toString(Qt::ISODate));
+    if (m_currentFilter.minMoonIllumination || m_currentFilter.maxMoonIllumination)
+        parts << QString("Moon: %1 - %2 %").arg(m_currentFilter.minMoonIllumination.value_or(0))
+                                           .arg(m_currentFilter.maxMoonIllumination.value_or(100));
+    if (m_currentFilter.minAngularSeparation || m_currentFilter.maxAngularSeparation)
+        parts << QString("Separation: %1 - %2°").arg(m_currentFilter.minAngularSeparation.value_or(0))
+                                                .arg(m_currentFilter.maxAngularSeparation.value_or(180));
+    return parts.join("; ");
+}
 
-    int row = 0;
-    for (const ObservationData &obs : observations)
+void ObservationsTab::populateTable()
+{
+    m_currentFilter = filterFromWidgets();
+    m_tableModel->setFilter(m_currentFilter);
+    if (const auto result = m_tableModel->reload(); !result)
     {
-        ui->observationsTable->insertRow(row);
-
-        // Session Name
-        const auto sessionItem = new QTableWidgetItem(obs.sessionName);
-        sessionItem->setData(Qt::UserRole, obs.id); // Store observation ID
-        ui->observationsTable->setItem(row, 0, sessionItem);
+        QMessageBox::warning(this, "Database Error",
+                             QString("Failed to load observations: %1").arg(result.error().errorMessage));
+        return;
+    }
 
-        // Date
-        const auto dateItem = new QTableWidgetItem(obs.sessionDate);
-        ui->observationsTable->setItem(row, 1, dateItem);
+    ui->observationsTable->resizeColumnsToContents();
+    updateSearchResults();
+}
 
-        // Object
-        auto name = obs.objectComments.isEmpty() ? obs.objectName : obs.objectName + " / " + obs.objectComments;
-        const auto objectItem = new QTableWidgetItem(name);
-        ui->observationsTable->setItem(row, 2, objectItem);
+void ObservationsTab::updateSearchResults()
+{
+    constexpr int maxSearchResults = 50;
 
-        // Camera
-        const auto cameraItem = new QTableWidgetItem(obs.cameraName);
-        ui->observationsTable->setItem(row, 3, cameraItem);
+    m_searchResultsModel->clear();
+    if (m_currentFilter.searchText.isEmpty())
+    {
+        ui->searchResultsListView->hide();
+        return;
+    }
+    ui->searchResultsListView->show();
 
-        // Telescope
-        const auto telescopeItem = new QTableWidgetItem(obs.telescopeName);
-        ui->observationsTable->setItem(row, 4, telescopeItem);
+    const auto hits = m_repository->searchObservations(m_currentFilter, maxSearchResults);
+    if (!hits)
+    {
+        QMessageBox::warning(this, "Database Error", QString("Search failed: %1").arg(hits.error().errorMessage));
+        return;
+    }
+    const auto dimensions = m_dbManager->referenceData()->observationDimensions();
+    if (!dimensions)
+    {
+        QMessageBox::warning(this, "Database Error",
+                             QString("Failed to load observations: %1").arg(dimensions.error().errorMessage));
+        return;
+    }
 
-        // Filter
-        const auto filterItem = new QTableWidgetItem(obs.filterName);
-        ui->observationsTable->setItem(row, 5, filterItem);
+    for (const ObservationSearchHit &hit : hits.value())
+    {
+        const SessionDimension &session = dimensions->session(hit.sessionId);
+        auto *item = new QStandardItem(QString("<b>%1</b> &ndash; %2 %3<br>%4")
+                                           .arg(dimensions->object(hit.objectId).displayName().toHtmlEscaped(),
+                                                session.date, session.name.toHtmlEscaped(), hit.snippet));
+        item->setData(hit.observationId, Qt::UserRole);
+        m_searchResultsModel->appendRow(item);
+    }
+}
 
-        // Image Count
-        const auto imageCountItem = new NumericTableWidgetItem(QString::number(obs.imageCount));
-        imageCountItem->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
-        ui->observationsTable->setItem(row, 6, imageCountItem);
+void ObservationsTab::selectObservation(const int observationId)
+{
+    // Search results are part of the filtered table, at worst all of its pages get fetched
+    int row = m_tableModel->rowOfObservation(observationId);
+    while (row < 0 && m_tableModel->canFetchMore(QModelIndex()))
+    {
+        m_tableModel->fetchMore(QModelIndex());
+        row = m_tableModel->rowOfObservation(observationId);
+    }
+    if (row < 0)
+        return;
 
-        // Exposure Length
-        const auto exposureLengthItem = new NumericTableWidgetItem(QString::number(obs.exposureLength));
-        exposureLengthItem->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
-        ui->observationsTable->setItem(row, 7, exposureLengthItem);
+    ui->observationsTable->selectRow(row);
+    ui->observationsTable->scrollTo(m_tableModel->index(row, 0));
+}
 
-        // Total Exposure
-        const auto totalExposureItem = new NumericTableWidgetItem(QString::number(obs.totalExposure));
-        totalExposureItem->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
-        ui->observationsTable->setItem(row, 8, totalExposureItem);
+void ObservationsTab::onDataChanged(const DbTables tables, const QVector<DbChange> &changes)
+{
+    if (!tables.testFlag(DbTable::Observations))
+    {
+        return;
+    }
 
-        // Moon Illumination
-        const auto moonIllumItem = new NumericTableWidgetItem(QString::number(obs.moonIllumination, 'f', 0));
-        moonIllumItem->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
-        // Apply background color if moon illumination exceeds warning threshold
-        if (m_settingsManager)
-        {
-            int warningThreshold = m_settingsManager->moonIlluminationWarningPercent();
-            if (obs.moonIllumination > warningThreshold)
-            {
-                QColor warningColor = QColor::fromHsv(0, 40 * 255 / 100, 95 * 255 / 100);
-                moonIllumItem->setBackground(warningColor);
-            }
-        }
-        ui->observationsTable->setItem(row, 9, moonIllumItem);
+    // Objects the changed rows belonged to before the change, as long as the table has all
+    // of them in memory; read before the rows are patched
+    QList<int> changedIds;
+    std::optional<QSet<int>> previousObjectIds = QSet<int>();
+    for (const auto &[table, operation, rowId] : changes)
+    {
+        if (table != DbTable::Observations)
+            continue;
 
-        // Angular Separation
-        if (obs.angularSeparation >= 0.0)
+        const int id = static_cast<int>(rowId);
+        if (operation != DbOperation::Delete)
+            changedIds.append(id);
+        if (operation != DbOperation::Insert && previousObjectIds)
         {
-            const auto angSepItem = new NumericTableWidgetItem(QString::number(obs.angularSeparation, 'f', 0));
-            angSepItem->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
-            // Apply background color if angular separation is smaller than warning threshold
-            if (m_settingsManager)
-            {
-                int warningThreshold = m_settingsManager->moonAngularSeparationWarningDeg();
-                if (obs.angularSeparation < warningThreshold)
-                {
-                    QColor warningColor = QColor::fromHsv(0, 40 * 255 / 100, 95 * 255 / 100);
-                    angSepItem->setBackground(warningColor);
-                }
-            }
-            ui->observationsTable->setItem(row, 10, angSepItem);
-        }
-        else
-        {
-            const auto angSepItem = new QTableWidgetItem("");
-            angSepItem->setTextAlignment(Qt::AlignCenter);
-            ui->observationsTable->setItem(row, 10, angSepItem);
+            if (const auto objectId = m_tableModel->loadedObjectId(id))
+                previousObjectIds->insert(*objectId);
+            else
+                previousObjectIds.reset();
         }
+    }
 
-        // Comments
-        const auto commentsItem = new QTableWidgetItem(obs.comments);
-        ui->observationsTable->setItem(row, 11, commentsItem);
-
-        row++;
+    if (const auto result = m_tableModel->applyChanges(changes); !result)
+    {
+        QMessageBox::warning(this, "Database Error",
+                             QString("Failed to load observations: %1").arg(result.error().errorMessage));
     }
 
-    ui->observationsTable->setSortingEnabled(true);
-    ui->observationsTable->resizeColumnsToContents();
+    // Snippets and ranking may have changed with the comments
+    updateSearchResults();
+
+    // Object list only contains objects that have observations, a selected object may be gone
+    updateObjectFilter(changedIds, previousObjectIds);
+    onFilterChanged();
 }
 
-void ObservationsTab::onFilterSelectionChanged()
+void ObservationsTab::onFilterChanged()
 {
-    QModelIndex index = ui->observationFilterListView->currentIndex();
-    if (!index.isValid())
+    if (m_updatingFilterWidgets)
         return;
 
-    QString selectedObject = m_filterListModel->data(index, Qt::DisplayRole).toString();
+    // Selection is restored after the object list is refreshed, nothing to reload then
+    if (filterFromWidgets() == m_currentFilter)
+    {
+        return;
+    }
+
+    // Refresh the table with the new filter
+    populateTable();
+}
 
-    if (selectedObject == "< All Objects >")
+void ObservationsTab::onSearchResultClicked(const QModelIndex &index)
+{
+    selectObservation(index.data(Qt::UserRole).toInt());
+}
+
+void ObservationsTab::onClearFilterClicked()
+{
+    m_updatingFilterWidgets = true;
+    ui->observationFilterListView->setCurrentIndex(m_filterListModel->index(0, 0));
+    for (QComboBox *comboBox : {ui->filterBarCameraComboBox, ui->filterBarTelescopeComboBox,
+                                ui->filterBarFilterComboBox, ui->filterBarFilterTypeComboBox})
     {
-        m_currentFilterObjectId = -1;
+        comboBox->setCurrentIndex(0);
     }
-    else
+    ui->filterBarDateCheckBox->setChecked(false);
+    ui->searchLineEdit->clear();
+    m_searchTimer->stop();
+    for (QSpinBox *spinBox : {ui->filterBarMoonMinSpinBox, ui->filterBarSeparationMinSpinBox})
     {
-        // Find the object ID by name
-        QSqlQuery query(m_dbManager->database());
-        query.prepare("SELECT id FROM objects WHERE name = :name");
-        query.bindValue(":name", selectedObject);
-
-        if (query.exec() && query.next())
-        {
-            m_currentFilterObjectId = query.value(0).toInt();
-        }
-        else
-        {
-            m_currentFilterObjectId = -1;
-        }
+        spinBox->setValue(spinBox->minimum());
+    }
+    for (QSpinBox *spinBox : {ui->filterBarMoonMaxSpinBox, ui->filterBarSeparationMaxSpinBox})
+    {
+        spinBox->setValue(spinBox->maximum());
     }
+    m_updatingFilterWidgets = false;
 
-    // Refresh the table with the new filter
-    populateTable();
+    onFilterChanged();
 }
 
 bool ObservationsTab::showObservationDialog(const QString &title, int &sessionId, int &objectId,
@@ -400,76 +648,31 @@ bool ObservationsTab::showObservationDialog(const QString &title, int &sessionId
 
     const auto formLayout = new QFormLayout(&dialog);
 
+    ReferenceDataCache *referenceData = m_dbManager->referenceData();
+
     // Session combo box
     const auto sessionCombo = new QComboBox(&dialog);
-    QSqlQuery query(m_dbManager->database());
-    if (query.exec("SELECT id, concat(name,' (', start_date, ')') as name FROM sessions ORDER BY start_date DESC"))
-    {
-        while (query.next())
-        {
-            sessionCombo->addItem(query.value("name").toString(), query.value("id").toInt());
-        }
-    }
-    // Set current value
-    int sessionIndex = sessionCombo->findData(sessionId);
-    if (sessionIndex >= 0)
-        sessionCombo->setCurrentIndex(sessionIndex);
+    fillComboBox(sessionCombo, referenceData->items(DbTable::Sessions), sessionId);
     formLayout->addRow("Session:", sessionCombo);
 
     // Object combo box
     const auto objectCombo = new QComboBox(&dialog);
-    if (query.exec("SELECT id, name FROM objects ORDER BY name"))
-    {
-        while (query.next())
-        {
-            objectCombo->addItem(query.value("name").toString(), query.value("id").toInt());
-        }
-    }
-    int objectIndex = objectCombo->findData(objectId);
-    if (objectIndex >= 0)
-        objectCombo->setCurrentIndex(objectIndex);
+    fillComboBox(objectCombo, referenceData->items(DbTable::Objects), objectId);
     formLayout->addRow("Object:", objectCombo);
 
     // Camera combo box
     const auto cameraCombo = new QComboBox(&dialog);
-    if (query.exec("SELECT id, name FROM cameras ORDER BY name"))
-    {
-        while (query.next())
-        {
-            cameraCombo->addItem(query.value("name").toString(), query.value("id").toInt());
-        }
-    }
-    int cameraIndex = cameraCombo->findData(cameraId);
-    if (cameraIndex >= 0)
-        cameraCombo->setCurrentIndex(cameraIndex);
+    fillComboBox(cameraCombo, referenceData->items(DbTable::Cameras), cameraId);
     formLayout->addRow("Camera:", cameraCombo);
 
     // Telescope combo box
     const auto telescopeCombo = new QComboBox(&dialog);
-    if (query.exec("SELECT id, name FROM telescopes ORDER BY name"))
-    {
-        while (query.next())
-        {
-            telescopeCombo->addItem(query.value("name").toString(), query.value("id").toInt());
-        }
-    }
-    int telescopeIndex = telescopeCombo->findData(telescopeId);
-    if (telescopeIndex >= 0)
-        telescopeCombo->setCurrentIndex(telescopeIndex);
+    fillComboBox(telescopeCombo, referenceData->items(DbTable::Telescopes), telescopeId);
     formLayout->addRow("Telescope:", telescopeCombo);
 
     // Filter combo box
     const auto filterCombo = new QComboBox(&dialog);
-    if (query.exec("SELECT id, name FROM filters ORDER BY name"))
-    {
-        while (query.next())
-        {
-            filterCombo->addItem(query.value("name").toString(), query.value("id").toInt());
-        }
-    }
-    int filterIndex = filterCombo->findData(filterId);
-    if (filterIndex >= 0)
-        filterCombo->setCurrentIndex(filterIndex);
+    fillComboBox(filterCombo, referenceData->items(DbTable::Filters), filterId);
     formLayout->addRow("Filter:", filterCombo);
 
     // Image Count spin box
@@ -615,15 +818,12 @@ void ObservationsTab::onAddObservationButtonClicked()
     ui->imageCountSpinBox->setValue(0);
     ui->exposureLengthSpinBox->setValue(0);
     ui->commentsLineEdit->clear();
-
-    // Refresh data
-    refreshData();
 }
 
 void ObservationsTab::onEditObservationButtonClicked()
 {
     // Check if a row is selected
-    const int currentRow = ui->observationsTable->currentRow();
+    const int currentRow = ui->observationsTable->currentIndex().row();
     if (currentRow < 0)
     {
         QMessageBox::information(this, "No Selection", "Please select an observation to edit.");
@@ -631,36 +831,17 @@ void ObservationsTab::onEditObservationButtonClicked()
     }
 
     // Get observation ID from the table
-    const QTableWidgetItem *sessionItem = ui->observationsTable->item(currentRow, 0);
-    const int observationId = sessionItem->data(Qt::UserRole).toInt();
+    const int observationId = m_tableModel->observationId(currentRow);
 
     // Find the observation data
-    auto allObsResult = m_repository->getAllObservations();
-    if (!allObsResult)
+    auto obsResult = m_repository->getObservationById(observationId);
+    if (!obsResult)
     {
         QMessageBox::warning(this, "Database Error",
-                             QString("Failed to load observations: %1").arg(allObsResult.error().errorMessage));
-        return;
-    }
-
-    QVector<ObservationData> allObs = allObsResult.value();
-    ObservationData currentObs{};
-    bool found = false;
-    for (const ObservationData &obs : allObs)
-    {
-        if (obs.id == observationId)
-        {
-            currentObs = obs;
-            found = true;
-            break;
-        }
-    }
-
-    if (!found)
-    {
-        QMessageBox::warning(this, "Error", "Could not find observation data.");
+                             QString("Failed to load observation: %1").arg(obsResult.error().errorMessage));
         return;
     }
+    const ObservationData &currentObs = obsResult.value();
 
     // Show dialog with current values
     int sessionId = currentObs.sessionId;
@@ -685,16 +866,13 @@ void ObservationsTab::onEditObservationButtonClicked()
     {
         QMessageBox::warning(this, "Database Error",
                              QString("Failed to update observation: %1").arg(updateResult.error().errorMessage));
-        return;
     }
-
-    refreshData();
 }
 
 void ObservationsTab::onDeleteObservationButtonClicked()
 {
     // Check if a row is selected
-    const int currentRow = ui->observationsTable->currentRow();
+    const int currentRow = ui->observationsTable->currentIndex().row();
     if (currentRow < 0)
     {
         QMessageBox::information(this, "No Selection", "Please select an observation to delete.");
@@ -702,10 +880,9 @@ void ObservationsTab::onDeleteObservationButtonClicked()
     }
 
     // Get observation data
-    const QTableWidgetItem *sessionItem = ui->observationsTable->item(currentRow, 0);
-    const int observationId = sessionItem->data(Qt::UserRole).toInt();
-    QString sessionName = sessionItem->text();
-    QString objectName = ui->observationsTable->item(currentRow, 2)->text();
+    const int observationId = m_tableModel->observationId(currentRow);
+    QString sessionName = m_tableModel->index(currentRow, ObservationsTableModel::SessionNameColumn).data().toString();
+    QString objectName = m_tableModel->index(currentRow, ObservationsTableModel::ObjectColumn).data().toString();
 
     // Confirm deletion
     const QMessageBox::StandardButton reply = QMessageBox::question(
@@ -727,10 +904,7 @@ void ObservationsTab::onDeleteObservationButtonClicked()
     {
         QMessageBox::warning(this, "Database Error",
                              QString("Failed to delete observation: %1").arg(deleteResult.error().errorMessage));
-        return;
     }
-
-    refreshData();
 }
 
 void ObservationsTab::onExportToHtmlClicked()
@@ -747,124 +921,22 @@ void ObservationsTab::onExportToHtmlClicked()
         return; // User cancelled
     }
 
-    // Read the template file
-    QFile templateFile(":/templates/observations_export.html");
-    if (!templateFile.open(QIODevice::ReadOnly | QIODevice::Text))
-    {
-        QMessageBox::warning(this, "Export Error",
-                             "Failed to open template file: " + templateFile.errorString());
-        return;
-    }
-
-    QString templateContent = QTextStream(&templateFile).readAll();
-    templateFile.close();
-
-    // Get current observations (respecting filter)
-    QVector<ObservationData> observations;
-
-    if (m_currentFilterObjectId == -1)
+    ObservationHtmlExportOptions options;
+    options.filter = m_currentFilter;
+    options.filterDescription = filterDescription();
+    if (m_settingsManager)
     {
-        auto allObsResult = m_repository->getAllObservations();
-        if (!allObsResult)
-        {
-            QMessageBox::warning(this, "Export Error",
-                                 QString("Failed to load observations: %1").arg(allObsResult.error().errorMessage));
-            return;
-        }
-        observations = allObsResult.value();
+        options.moonWarningPercent = m_settingsManager->moonIlluminationWarningPercent();
+        options.angularWarningDeg = m_settingsManager->moonAngularSeparationWarningDeg();
     }
-    else
-    {
-        auto filteredObsResult = m_repository->getObservationsByObject(m_currentFilterObjectId);
-        if (!filteredObsResult)
-        {
-            QMessageBox::warning(this, "Export Error",
-                                 QString("Failed to load observations: %1").arg(filteredObsResult.error().errorMessage));
-            return;
-        }
-        observations = filteredObsResult.value();
-    }
-
-    // Generate table rows HTML
-    QString tableRowsHtml;
-    const int moonWarningThreshold = m_settingsManager ? m_settingsManager->moonIlluminationWarningPercent() : 75;
-    const int angularWarningThreshold = m_settingsManager ? m_settingsManager->moonAngularSeparationWarningDeg() : 60;
-
-    for (const ObservationData &obs : observations)
-    {
-        tableRowsHtml += "                <tr>\n";
-        tableRowsHtml += QString("                    <td>%1</td>\n").arg(obs.sessionName);
-        tableRowsHtml += QString("                    <td>%1</td>\n").arg(obs.sessionDate);
-        tableRowsHtml += QString("                    <td>%1</td>\n").arg(obs.objectName);
-        tableRowsHtml += QString("                    <td>%1</td>\n").arg(obs.cameraName);
-        tableRowsHtml += QString("                    <td>%1</td>\n").arg(obs.telescopeName);
-        tableRowsHtml += QString("                    <td>%1</td>\n").arg(obs.filterName);
-        tableRowsHtml += QString("                    <td>%1</td>\n").arg(obs.imageCount);
-        tableRowsHtml += QString("                    <td>%1</td>\n").arg(obs.exposureLength);
-        tableRowsHtml += QString("                    <td>%1</td>\n").arg(obs.totalExposure);
-
-        // Moon illumination with warning class
-        QString moonClass = obs.moonIllumination > moonWarningThreshold ? " class=\"moon-warning\"" : "";
-        tableRowsHtml += QString("                    <td%1>%2</td>\n")
-                             .arg(moonClass, QString::number(obs.moonIllumination, 'f', 0));
-
-        // Angular separation with warning class
-        if (obs.angularSeparation >= 0.0)
-        {
-            QString angularClass = obs.angularSeparation < angularWarningThreshold ? " class=\"angular-warning\"" : "";
-            tableRowsHtml += QString("                    <td%1>%2</td>\n")
-                                 .arg(angularClass, QString::number(obs.angularSeparation, 'f', 0));
-        }
-        else
-        {
-            tableRowsHtml += "                    <td></td>\n";
-        }
 
-        tableRowsHtml += QString("                    <td>%1</td>\n").arg(obs.comments);
-        tableRowsHtml += "                </tr>\n";
-    }
-
-    // Determine filter name
-    QString filterName = "All Objects";
-    if (m_currentFilterObjectId != -1)
+    startExport(fileName, [fileName, options](DatabaseManager *snapshot, const ExportProgress &progress)
     {
-        QModelIndex index = ui->observationFilterListView->currentIndex();
-        if (index.isValid())
-        {
-            filterName = m_filterListModel->data(index, Qt::DisplayRole).toString();
-        }
-    }
-
-    // Get current date/time
-    const QString exportDateTime = QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss");
-
-    // Replace placeholders
-    templateContent.replace("{{filter_name}}", filterName);
-    templateContent.replace("{{export_date}}", exportDateTime);
-    templateContent.replace("{{total_records}}", QString::number(observations.size()));
-    templateContent.replace("{{table_rows}}", tableRowsHtml);
-    templateContent.replace("{{completion_date}}", exportDateTime);
-
-    // Write to file
-    QFile outputFile(fileName);
-    if (!outputFile.open(QIODevice::WriteOnly | QIODevice::Text))
-    {
-        QMessageBox::warning(this, "Export Error",
-                             "Failed to write to file: " + outputFile.errorString());
-        return;
-    }
-
-    QTextStream out(&outputFile);
-    out << templateContent;
-    outputFile.close();
-
-    QMessageBox::information(this, "Export Successful",
-                             QString("Exported %1 observations to:\n%2")
-                                 .arg(observations.size())
-                                 .arg(fileName));
+        return ObservationHtmlExporter(snapshot).exportToFile(fileName, options, progress);
+    });
 }
 
-void ObservationsTab::onExportToExcelClicked() {
+void ObservationsTab::onExportToExcelClicked(const bool sheetPerObject) {
     // Ask user for save location
     const QString fileName = QFileDialog::getSaveFileName(
         this,
@@ -877,139 +949,92 @@ void ObservationsTab::onExportToExcelClicked() {
         return; // User cancelled
     }
 
-    // Get current observations (respecting filter)
-    QVector<ObservationData> observations;
+    ObservationExcelExportOptions options;
+    options.filter = m_currentFilter;
+    options.filterDescription = filterDescription();
+    options.sheetPerObject = sheetPerObject;
 
-    if (m_currentFilterObjectId == -1)
+    startExport(fileName, [fileName, options](DatabaseManager *snapshot, const ExportProgress &progress)
     {
-        auto allObsResult = m_repository->getAllObservations();
-        if (!allObsResult)
-        {
-            QMessageBox::warning(this, "Export Error",
-                                 QString("Failed to load observations: %1").arg(allObsResult.error().errorMessage));
-            return;
-        }
-        observations = allObsResult.value();
-    }
-    else
+        return ObservationExcelExporter(snapshot).exportToFile(fileName, options, progress);
+    });
+}
+
+void ObservationsTab::onGenerateSiteClicked()
+{
+    // The site always covers the whole log, regenerating into the same folder only
+    // rewrites the pages that changed since the last run
+    const QString directory = QFileDialog::getExistingDirectory(
+        this,
+        "Generate Static Site",
+        QDir::homePath());
+
+    if (directory.isEmpty())
     {
-        auto filteredObsResult = m_repository->getObservationsByObject(m_currentFilterObjectId);
-        if (!filteredObsResult)
-        {
-            QMessageBox::warning(this, "Export Error",
-                                 QString("Failed to load observations: %1").arg(filteredObsResult.error().errorMessage));
-            return;
-        }
-        observations = filteredObsResult.value();
+        return; // User cancelled
     }
 
-    try
+    StaticSiteOptions options;
+    if (m_settingsManager)
     {
-        // Create a new Excel document
-        OpenXLSX::XLDocument doc;
-        doc.create(fileName.toStdString(), true);
-        auto wks = doc.workbook().worksheet("Sheet1");
+        options.moonWarningPercent = m_settingsManager->moonIlluminationWarningPercent();
+        options.angularWarningDeg = m_settingsManager->moonAngularSeparationWarningDeg();
+    }
 
-        // Set worksheet name
-        wks.setName("Observations");
+    startExport(directory, [directory, options](DatabaseManager *snapshot, const ExportProgress &progress)
+    {
+        return StaticSiteGenerator(snapshot).generate(directory, options, progress);
+    }, "changed pages");
+}
 
-        // Determine filter name
-        QString filterName = "All Objects";
-        if (m_currentFilterObjectId != -1)
-        {
-            QModelIndex index = ui->observationFilterListView->currentIndex();
-            if (index.isValid())
-            {
-                filterName = m_filterListModel->data(index, Qt::DisplayRole).toString();
-            }
-        }
+void ObservationsTab::startExport(const QString &fileName, ExportJob::Task task, const QString &itemName)
+{
+    if (m_exportJob)
+    {
+        QMessageBox::information(this, "Export Running", "Wait for the running export to finish or cancel it first.");
+        return;
+    }
 
-        // Get current date/time
-        const QString exportDateTime = QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss");
-
-        // Add export information at the top
-        wks.cell("A1").value() = "Observations Export";
-        wks.cell("A2").value() = "Filter: " + filterName.toStdString();
-        wks.cell("A3").value() = "Export Date: " + exportDateTime.toStdString();
-        wks.cell("A4").value() = "Total Records: " + std::to_string(observations.size());
-
-        // Add header row (starting at row 6)
-        constexpr int headerRow = 6;
-        wks.cell(headerRow, 1).value() = "Session Name";
-        wks.cell(headerRow, 2).value() = "Date";
-        wks.cell(headerRow, 3).value() = "Object";
-        wks.cell(headerRow, 4).value() = "Camera";
-        wks.cell(headerRow, 5).value() = "Telescope";
-        wks.cell(headerRow, 6).value() = "Filter";
-        wks.cell(headerRow, 7).value() = "Images";
-        wks.cell(headerRow, 8).value() = "Exposure (s)";
-        wks.cell(headerRow, 9).value() = "Total Exposure (s)";
-        wks.cell(headerRow, 10).value() = "Moon Phase (%)";
-        wks.cell(headerRow, 11).value() = "Angular Separation";
-        wks.cell(headerRow, 12).value() = "Comments";
-
-        // Add data rows
-        int currentRow = headerRow + 1;
-        for (const ObservationData &obs : observations)
-        {
-            wks.cell(currentRow, 1).value() = obs.sessionName.toStdString();
-            wks.cell(currentRow, 2).value() = obs.sessionDate.toStdString();
-            wks.cell(currentRow, 3).value() = obs.objectName.toStdString();
-            wks.cell(currentRow, 4).value() = obs.cameraName.toStdString();
-            wks.cell(currentRow, 5).value() = obs.telescopeName.toStdString();
-            wks.cell(currentRow, 6).value() = obs.filterName.toStdString();
-            wks.cell(currentRow, 7).value() = obs.imageCount;
-            wks.cell(currentRow, 8).value() = obs.exposureLength;
-            wks.cell(currentRow, 9).value() = obs.totalExposure;
-            wks.cell(currentRow, 10).value() = obs.moonIllumination;
-            
-            // Angular separation (may be negative if not calculated)
-            if (obs.angularSeparation >= 0.0)
-            {
-                wks.cell(currentRow, 11).value() = obs.angularSeparation;
-            }
-            else
-            {
-                wks.cell(currentRow, 11).value() = "";
-            }
-            
-            wks.cell(currentRow, 12).value() = obs.comments.toStdString();
+    m_exportJob = new ExportJob(m_dbManager->databasePath(), std::move(task), this);
+    ui->exportObservationButton->setEnabled(false);
 
-            currentRow++;
-        }
-        // Auto-fit columns (set reasonable widths)
-        wks.column(1).setWidth(20);  // Session Name
-        wks.column(2).setWidth(12);  // Date
-        wks.column(3).setWidth(20);  // Object
-        wks.column(4).setWidth(15);  // Camera
-        wks.column(5).setWidth(15);  // Telescope
-        wks.column(6).setWidth(12);  // Filter
-        wks.column(7).setWidth(10);  // Images
-        wks.column(8).setWidth(14);  // Exposure
-        wks.column(9).setWidth(18);  // Total Exposure
-        wks.column(10).setWidth(16); // Moon Phase
-        wks.column(11).setWidth(18); // Angular Separation
-        wks.column(12).setWidth(30); // Comments
-
-        // Save the document
-        doc.save();
-        doc.close();
+    // Observations can be logged while the export runs, the dialog deletes itself at the end
+    const auto progressDialog = new ExportProgressDialog(m_exportJob, "Exporting Observations", this);
+    progressDialog->setItemName(itemName);
 
+    const auto finish = [this]
+    {
+        m_exportJob->deleteLater();
+        m_exportJob = nullptr;
+        ui->exportObservationButton->setEnabled(true);
+    };
+    connect(m_exportJob, &ExportJob::succeeded, this,
+            [this, finish, fileName, itemName](const int exportedRows, const double seconds)
+    {
+        finish();
         QMessageBox::information(this, "Export Successful",
-                                 QString("Exported %1 observations to:\n%2")
-                                     .arg(observations.size())
-                                     .arg(fileName));
-    }
-    catch (const std::exception &e)
+                                 QString("Exported %1 %2 to:\n%3\n\nTook %4 s (%L5 %2/s)")
+                                     .arg(exportedRows)
+                                     .arg(itemName)
+                                     .arg(fileName)
+                                     .arg(seconds, 0, 'f', 1)
+                                     .arg(seconds > 0.0 ? exportedRows / seconds : 0.0, 0, 'f', 0));
+    });
+    connect(m_exportJob, &ExportJob::failed, this, [this, finish](const QString &errorMessage)
     {
-        QMessageBox::warning(this, "Export Error",
-                             QString("Failed to create Excel file: %1").arg(e.what()));
-    }
+        finish();
+        QMessageBox::warning(this, "Export Error", errorMessage);
+    });
+    connect(m_exportJob, &ExportJob::cancelled, this, finish);
+
+    m_exportJob->start();
 }
 
 void ObservationsTab::onExploreSessionsFolder() {
-    const int currentRow = ui->observationsTable->currentRow();
-    const QString sessionId = ui->observationsTable->item(currentRow, 0)->text();
+    const int currentRow = ui->observationsTable->currentIndex().row();
+    if (currentRow < 0)
+        return;
+    const QString sessionId = m_tableModel->index(currentRow, ObservationsTableModel::SessionNameColumn).data().toString();
     QString folderTemplate = m_settingsManager->sessionsFolderTemplate();
     const QString finalPath = folderTemplate.replace("{{sessionid}}", sessionId);
     //Test path exists
@@ -0,0 +1,662 @@
+#include "tabs/observationstablemodel.h"
+#include "db/referencedatacache.h"
+#include "settingsmanager.h"
+#include <QColor>
+#include <QHash>
+#include <QSet>
+#include <algorithm>
+#include <utility>
+
+ObservationsTableModel::ObservationsTableModel(ObservationsRepository *repository, ReferenceDataCache *referenceData,
+                                               SettingsManager *settingsManager, QObject *parent)
+    : QAbstractTableModel(parent), m_repository(repository), m_referenceData(referenceData),
+      m_settingsManager(settingsManager),
+      m_sortField(ObservationSortField::SessionDate), m_sortOrder(Qt::DescendingOrder),
+      m_atEnd(true), m_rowCount(0), m_useCounter(0), m_reloadScheduled(false)
+{
+}
+
+int ObservationsTableModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_rowCount;
+}
+
+int ObservationsTableModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant ObservationsTableModel::data(const QModelIndex &index, const int role) const
+{
+    if (!index.isValid())
+        return {};
+
+    const ObservationData *obs = rowData(index.row());
+    if (!obs)
+        return {};
+
+    const SessionDimension &session = m_dimensions.session(obs->sessionId);
+    const QColor warningColor = QColor::fromHsv(0, 40 * 255 / 100, 95 * 255 / 100);
+
+    switch (role)
+    {
+    case Qt::DisplayRole:
+        switch (index.column())
+        {
+        case SessionNameColumn:
+            return session.name;
+        case DateColumn:
+            return session.date;
+        case ObjectColumn:
+            return m_dimensions.object(obs->objectId).displayName();
+        case CameraColumn:
+            return m_dimensions.camera(obs->cameraId);
+        case TelescopeColumn:
+            return m_dimensions.telescope(obs->telescopeId);
+        case FilterColumn:
+            return m_dimensions.filter(obs->filterId);
+        case ImageCountColumn:
+            return QString::number(obs->imageCount);
+        case ExposureLengthColumn:
+            return QString::number(obs->exposureLength);
+        case TotalExposureColumn:
+            return QString::number(obs->totalExposure);
+        case MoonIlluminationColumn:
+            return QString::number(session.moonIllumination, 'f', 0);
+        case AngularSeparationColumn:
+        {
+            const double angularSeparation = m_dimensions.angularSeparation(*obs);
+            return angularSeparation >= 0.0 ? QString::number(angularSeparation, 'f', 0) : QString();
+        }
+        case CommentsColumn:
+            return obs->comments;
+        default:
+            return {};
+        }
+
+    case Qt::TextAlignmentRole:
+        switch (index.column())
+        {
+        case ImageCountColumn:
+        case ExposureLengthColumn:
+        case TotalExposureColumn:
+        case MoonIlluminationColumn:
+            return QVariant::fromValue(Qt::AlignRight | Qt::AlignVCenter);
+        case AngularSeparationColumn:
+            return QVariant::fromValue(m_dimensions.angularSeparation(*obs) >= 0.0 ? Qt::AlignRight | Qt::AlignVCenter
+                                                                                   : Qt::Alignment(Qt::AlignCenter));
+        default:
+            return {};
+        }
+
+    case Qt::BackgroundRole:
+        if (!m_settingsManager)
+            return {};
+        // Moon illumination above or angular separation below the warning threshold
+        if (index.column() == MoonIlluminationColumn &&
+            session.moonIllumination > m_settingsManager->moonIlluminationWarningPercent())
+            return warningColor;
+        if (index.column() == AngularSeparationColumn)
+        {
+            const double angularSeparation = m_dimensions.angularSeparation(*obs);
+            if (angularSeparation >= 0.0 && angularSeparation < m_settingsManager->moonAngularSeparationWarningDeg())
+                return warningColor;
+        }
+        return {};
+
+    case Qt::UserRole:
+        return obs->id;
+
+    default:
+        return {};
+    }
+}
+
+QVariant ObservationsTableModel::headerData(const int section, const Qt::Orientation orientation, const int role) const
+{
+    if (orientation == Qt::Horizontal && role == Qt::ToolTipRole && !isSortable(section))
+        return "Sorting by this column needs an SQLite library with math functions";
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+        return QAbstractTableModel::headerData(section, orientation, role);
+
+    switch (section)
+    {
+    case SessionNameColumn:
+        return "Session\nName";
+    case DateColumn:
+        return "Date";
+    case ObjectColumn:
+        return "Object";
+    case CameraColumn:
+        return "Camera";
+    case TelescopeColumn:
+        return "Telescope";
+    case FilterColumn:
+        return "Filter";
+    case ImageCountColumn:
+        return "Images";
+    case ExposureLengthColumn:
+        return "Exposure (s)";
+    case TotalExposureColumn:
+        return "Total\nExposure (s)";
+    case MoonIlluminationColumn:
+        return "Moon\nIllumination (%)";
+    case AngularSeparationColumn:
+        return QString("Angular\nSeparation (°)");
+    case CommentsColumn:
+        return "Comments";
+    default:
+        return {};
+    }
+}
+
+bool ObservationsTableModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && !m_atEnd;
+}
+
+void ObservationsTableModel::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid() || m_atEnd)
+        return;
+
+    if (const auto result = fetchPage(); !result)
+    {
+        emit errorOccurred(result.error().errorMessage);
+    }
+}
+
+void ObservationsTableModel::sort(const int column, const Qt::SortOrder order)
+{
+    if (column < 0 || column >= ColumnCount)
+        return;
+
+    // Columns are declared in the order of ObservationSortField
+    const auto field = static_cast<ObservationSortField>(column);
+    if ((field == m_sortField && order == m_sortOrder) || !isSortable(column))
+        return;
+
+    m_sortField = field;
+    m_sortOrder = order;
+    if (const auto result = reload(); !result)
+    {
+        emit errorOccurred(result.error().errorMessage);
+    }
+}
+
+bool ObservationsTableModel::isSortable(const int column) const
+{
+    // SQL can only order by the separation if it can compute it
+    return column != AngularSeparationColumn || m_repository->hasAngularSeparation();
+}
+
+int ObservationsTableModel::sortColumn() const
+{
+    return static_cast<int>(m_sortField);
+}
+
+Qt::SortOrder ObservationsTableModel::sortOrder() const
+{
+    return m_sortOrder;
+}
+
+void ObservationsTableModel::setFilter(const ObservationFilter &filter)
+{
+    m_filter = filter;
+}
+
+std::expected<void, ER> ObservationsTableModel::reload()
+{
+    auto dimensions = m_referenceData->observationDimensions();
+    if (!dimensions)
+    {
+        return std::unexpected(dimensions.error());
+    }
+
+    beginResetModel();
+    m_dimensions = std::move(dimensions.value());
+    m_pages.clear();
+    m_pageOffsets.clear();
+    m_pageOfId.clear();
+    m_rowCount = 0;
+    m_atEnd = false;
+    endResetModel();
+
+    // Fetch the first page here instead of waiting for the view so that errors reach the caller
+    return fetchPage();
+}
+
+std::expected<void, ER> ObservationsTableModel::fetchPage()
+{
+    ObservationPageQuery pageQuery = baseQuery();
+    pageQuery.limit = PageSize;
+    if (!m_pages.isEmpty())
+    {
+        pageQuery.after = m_pages.last().last;
+    }
+
+    auto result = m_repository->getObservationsPage(pageQuery);
+    if (!result)
+    {
+        // Stop the view from retrying on every scroll
+        m_atEnd = true;
+        return std::unexpected(result.error());
+    }
+
+    QVector<ObservationData> rows = std::move(result.value());
+    if (rows.size() < PageSize)
+    {
+        m_atEnd = true;
+    }
+    // A computed sort value can differ from the key in its last bit, the boundary row is then returned again
+    rows.removeIf([this](const ObservationData &obs) { return m_pageOfId.contains(obs.id); });
+    if (rows.isEmpty())
+    {
+        return {};
+    }
+
+    Page page;
+    page.first = keyOf(rows.first());
+    page.last = keyOf(rows.last());
+    page.ids.reserve(rows.size());
+    for (const ObservationData &obs : rows)
+    {
+        page.ids.append(obs.id);
+    }
+    page.rows = std::move(rows);
+    page.lastUsed = ++m_useCounter;
+
+    const int count = static_cast<int>(page.ids.size());
+    const int pageIndex = static_cast<int>(m_pages.size());
+    for (const int id : std::as_const(page.ids))
+    {
+        m_pageOfId.insert(id, pageIndex);
+    }
+
+    beginInsertRows(QModelIndex(), m_rowCount, m_rowCount + count - 1);
+    m_pages.append(std::move(page));
+    updateOffsets();
+    endInsertRows();
+
+    evictPages(static_cast<int>(m_pages.size()) - 1);
+    return {};
+}
+
+std::expected<void, ER> ObservationsTableModel::applyChanges(const QVector<DbChange> &changes)
+{
+    // Collapse the change list to the final state of each observation row
+    QSet<int> removedIds;
+    QSet<int> changedIds;
+    for (const auto &[table, operation, rowId] : changes)
+    {
+        if (table != DbTable::Observations)
+            continue;
+
+        const int id = static_cast<int>(rowId);
+        if (operation == DbOperation::Delete)
+        {
+            changedIds.remove(id);
+            removedIds.insert(id);
+        }
+        else
+        {
+            removedIds.remove(id);
+            changedIds.insert(id);
+        }
+    }
+
+    for (const int id : std::as_const(removedIds))
+    {
+        if (const int row = findRow(id); row >= 0)
+        {
+            removeRow(row);
+        }
+    }
+
+    if (changedIds.isEmpty())
+    {
+        return {};
+    }
+
+    // Rows that no longer match the filter are not returned and are removed below like deleted ones
+    auto changedResult = m_repository->getObservationsByIds(changedIds.values(), m_filter);
+    if (!changedResult)
+    {
+        return std::unexpected(changedResult.error());
+    }
+
+    // Rows can reference sessions or objects that were added after the last reload
+    const bool unknownReferences = std::ranges::any_of(changedResult.value(), [this](const ObservationData &obs)
+    {
+        return !m_dimensions.contains(obs);
+    });
+    if (unknownReferences)
+    {
+        auto dimensions = m_referenceData->observationDimensions();
+        if (!dimensions)
+        {
+            return std::unexpected(dimensions.error());
+        }
+        m_dimensions = std::move(dimensions.value());
+        if (m_rowCount > 0)
+        {
+            emit dataChanged(index(0, 0), index(m_rowCount - 1, ColumnCount - 1));
+        }
+    }
+
+    for (const ObservationData &obs : changedResult.value())
+    {
+        changedIds.remove(obs.id);
+        upsert(obs);
+    }
+
+    // Rows that could not be read back have been deleted meanwhile or are filtered out now
+    for (const int id : std::as_const(changedIds))
+    {
+        if (const int row = findRow(id); row >= 0)
+            removeRow(row);
+    }
+
+    return {};
+}
+
+int ObservationsTableModel::observationId(const int row) const
+{
+    if (row < 0 || row >= m_rowCount)
+        return -1;
+
+    const int pageIndex = pageOfRow(row);
+    return m_pages[pageIndex].ids[row - m_pageOffsets[pageIndex]];
+}
+
+int ObservationsTableModel::rowOfObservation(const int observationId) const
+{
+    return findRow(observationId);
+}
+
+std::optional<int> ObservationsTableModel::loadedObjectId(const int observationId) const
+{
+    const auto it = m_pageOfId.constFind(observationId);
+    if (it == m_pageOfId.cend())
+        return std::nullopt;
+
+    // Evicted pages are not read back, the row may already be gone from the database
+    const Page &page = m_pages[it.value()];
+    const qsizetype index = page.ids.indexOf(observationId);
+    if (index < 0 || page.rows.isEmpty())
+        return std::nullopt;
+    return page.rows[index].objectId;
+}
+
+ObservationPageQuery ObservationsTableModel::baseQuery() const
+{
+    ObservationPageQuery pageQuery;
+    pageQuery.sortField = m_sortField;
+    pageQuery.order = m_sortOrder;
+    pageQuery.filter = m_filter;
+    return pageQuery;
+}
+
+ObservationKey ObservationsTableModel::keyOf(const ObservationData &obs) const
+{
+    return m_repository->sortKey(obs, m_dimensions, m_sortField);
+}
+
+bool ObservationsTableModel::precedes(const ObservationKey &lhs, const ObservationKey &rhs) const
+{
+    const int result = ObservationsRepository::compareKeys(lhs, rhs);
+    return m_sortOrder == Qt::AscendingOrder ? result < 0 : result > 0;
+}
+
+int ObservationsTableModel::pageOfRow(const int row) const
+{
+    const auto it = std::upper_bound(m_pageOffsets.cbegin(), m_pageOffsets.cend(), row);
+    return static_cast<int>(it - m_pageOffsets.cbegin()) - 1;
+}
+
+int ObservationsTableModel::findRow(const int observationId) const
+{
+    const auto it = m_pageOfId.constFind(observationId);
+    if (it == m_pageOfId.cend())
+        return -1;
+
+    // Pages are short, the position inside one is a cheap scan
+    const int pageIndex = it.value();
+    const qsizetype index = m_pages[pageIndex].ids.indexOf(observationId);
+    return index >= 0 ? m_pageOffsets[pageIndex] + static_cast<int>(index) : -1;
+}
+
+const ObservationData *ObservationsTableModel::rowData(const int row) const
+{
+    if (row < 0 || row >= m_rowCount)
+        return nullptr;
+
+    const int pageIndex = pageOfRow(row);
+    if (!ensureResident(pageIndex))
+        return nullptr;
+
+    return &m_pages[pageIndex].rows[row - m_pageOffsets[pageIndex]];
+}
+
+bool ObservationsTableModel::ensureResident(const int pageIndex) const
+{
+    Page &page = m_pages[pageIndex];
+    page.lastUsed = ++m_useCounter;
+    if (!page.rows.isEmpty() || page.ids.isEmpty())
+        return true;
+
+    ObservationPageQuery pageQuery = baseQuery();
+    pageQuery.from = page.first;
+    pageQuery.to = page.last;
+    auto result = m_repository->getObservationsPage(pageQuery);
+    if (!result)
+    {
+        emit errorOccurred(result.error().errorMessage);
+        return false;
+    }
+
+    QHash<int, ObservationData> fetched;
+    fetched.reserve(result->size());
+    for (ObservationData &obs : result.value())
+    {
+        fetched.insert(obs.id, std::move(obs));
+    }
+
+    // The key range can miss rows whose sort value changed and contain rows that were
+    // inserted since; both are pending change notifications. Rows are matched to the
+    // known ids, missing ones are read by id.
+    QList<int> missingIds;
+    for (const int id : std::as_const(page.ids))
+    {
+        if (!fetched.contains(id))
+            missingIds.append(id);
+    }
+    if (!missingIds.isEmpty())
+    {
+        if (auto missingResult = m_repository->getObservationsByIds(missingIds))
+        {
+            for (ObservationData &obs : missingResult.value())
+            {
+                fetched.insert(obs.id, std::move(obs));
+            }
+        }
+    }
+
+    page.rows.reserve(page.ids.size());
+    for (const int id : std::as_const(page.ids))
+    {
+        if (const auto it = fetched.constFind(id); it != fetched.cend())
+        {
+            page.rows.append(it.value());
+            continue;
+        }
+
+        // Deleted without a notification, show an empty row until the model is reloaded
+        ObservationData placeholder{};
+        placeholder.id = id;
+        page.rows.append(placeholder);
+        if (!m_reloadScheduled)
+        {
+            m_reloadScheduled = true;
+            auto *self = const_cast<ObservationsTableModel *>(this);
+            QMetaObject::invokeMethod(self, [self]
+            {
+                self->m_reloadScheduled = false;
+                if (const auto reloadResult = self->reload(); !reloadResult)
+                    emit self->errorOccurred(reloadResult.error().errorMessage);
+            }, Qt::QueuedConnection);
+        }
+    }
+
+    evictPages(pageIndex);
+    return true;
+}
+
+void ObservationsTableModel::evictPages(const int keepPageIndex) const
+{
+    int resident = 0;
+    for (const Page &page : std::as_const(m_pages))
+    {
+        if (!page.rows.isEmpty())
+            ++resident;
+    }
+
+    while (resident > MaxResidentPages)
+    {
+        int oldest = -1;
+        for (int p = 0; p < m_pages.size(); ++p)
+        {
+            if (p == keepPageIndex || m_pages[p].rows.isEmpty())
+                continue;
+            if (oldest < 0 || m_pages[p].lastUsed < m_pages[oldest].lastUsed)
+                oldest = p;
+        }
+        if (oldest < 0)
+            break;
+
+        m_pages[oldest].rows = QVector<ObservationData>();
+        --resident;
+    }
+}
+
+void ObservationsTableModel::updateOffsets()
+{
+    m_pageOffsets.resize(m_pages.size());
+    int offset = 0;
+    for (qsizetype p = 0; p < m_pages.size(); ++p)
+    {
+        m_pageOffsets[p] = offset;
+        offset += static_cast<int>(m_pages[p].ids.size());
+    }
+    m_rowCount = offset;
+}
+
+void ObservationsTableModel::removeRow(const int row)
+{
+    const int pageIndex = pageOfRow(row);
+    const int index = row - m_pageOffsets[pageIndex];
+
+    beginRemoveRows(QModelIndex(), row, row);
+    // The page keys stay valid as bounds, no other row can sort between them
+    Page &page = m_pages[pageIndex];
+    m_pageOfId.remove(page.ids[index]);
+    page.ids.removeAt(index);
+    if (!page.rows.isEmpty())
+        page.rows.removeAt(index);
+    if (page.ids.isEmpty())
+    {
+        m_pages.removeAt(pageIndex);
+        // Rare: only the ids of the following pages need their page index shifted
+        for (qsizetype p = pageIndex; p < m_pages.size(); ++p)
+        {
+            for (const int id : std::as_const(m_pages[p].ids))
+                m_pageOfId.insert(id, static_cast<int>(p));
+        }
+    }
+    updateOffsets();
+    endRemoveRows();
+}
+
+void ObservationsTableModel::insertSorted(const ObservationData &obs)
+{
+    const ObservationKey key = keyOf(obs);
+
+    if (m_pages.isEmpty())
+    {
+        // Otherwise the row arrives with the first fetched page
+        if (!m_atEnd)
+            return;
+
+        Page page;
+        page.first = key;
+        page.last = key;
+        page.ids.append(obs.id);
+        page.rows.append(obs);
+        page.lastUsed = ++m_useCounter;
+
+        m_pageOfId.insert(obs.id, 0);
+        beginInsertRows(QModelIndex(), 0, 0);
+        m_pages.append(std::move(page));
+        updateOffsets();
+        endInsertRows();
+        return;
+    }
+
+    // First page whose range ends at or after the key
+    int pageIndex = 0;
+    while (pageIndex < m_pages.size() && precedes(m_pages[pageIndex].last, key))
+        ++pageIndex;
+
+    if (pageIndex == m_pages.size())
+    {
+        // Beyond the fetched range, fetchMore() will pick it up
+        if (!m_atEnd)
+            return;
+        pageIndex = static_cast<int>(m_pages.size()) - 1;
+    }
+
+    if (!ensureResident(pageIndex))
+        return;
+
+    Page &page = m_pages[pageIndex];
+    const auto it = std::partition_point(page.rows.cbegin(), page.rows.cend(),
+                                         [this, &key](const ObservationData &row) { return precedes(keyOf(row), key); });
+    const int index = static_cast<int>(it - page.rows.cbegin());
+    const int row = m_pageOffsets[pageIndex] + index;
+
+    beginInsertRows(QModelIndex(), row, row);
+    page.ids.insert(index, obs.id);
+    page.rows.insert(index, obs);
+    m_pageOfId.insert(obs.id, pageIndex);
+    if (precedes(key, page.first))
+        page.first = key;
+    if (precedes(page.last, key))
+        page.last = key;
+    updateOffsets();
+    endInsertRows();
+}
+
+void ObservationsTableModel::upsert(const ObservationData &obs)
+{
+    const int row = findRow(obs.id);
+    if (row < 0)
+    {
+        insertSorted(obs);
+        return;
+    }
+
+    // Update in place if the row keeps its position. Evicted pages would read the
+    // new values back, so their rows are always moved.
+    const int pageIndex = pageOfRow(row);
+    Page &page = m_pages[pageIndex];
+    const int index = row - m_pageOffsets[pageIndex];
+    if (!page.rows.isEmpty() && ObservationsRepository::compareKeys(keyOf(page.rows[index]), keyOf(obs)) == 0)
+    {
+        page.rows[index] = obs;
+        emit dataChanged(this->index(row, 0), this->index(row, ColumnCount - 1));
+        return;
+    }
+
+    removeRow(row);
+    insertSorted(obs);
+}
@@ -4,6 +4,7 @@
 #include "db/sessionsrepository.h"
 #include "numerictablewidgetitem.h"
 #include "astrocalc.h"
+#include "trace.h"
 #include <QMessageBox>
 #include <QDialog>
 #include <QFormLayout>
@@ -61,6 +62,7 @@ void SessionsTab::initialize()
 
 void SessionsTab::refreshData()
 {
+    TRACE_SPAN("SessionsTab::refreshData", "tab");
     // Refresh data from database
     populateTable();
 }
@@ -214,8 +216,6 @@ void SessionsTab::onAddButtonClicked()
     ui->sessionNameLineEdit->clear();
     ui->startDateEdit->setDate(QDate::currentDate());
     ui->sessionCommentsLineEdit->clear();
-
-    refreshData();
 }
 
 void SessionsTab::onEditButtonClicked()
@@ -258,8 +258,6 @@ void SessionsTab::onEditButtonClicked()
                              QString("Failed to update session: %1").arg(updateResult.error().errorMessage));
         return;
     }
-
-    refreshData();
 }
 
 void SessionsTab::onDeleteButtonClicked()
@@ -298,8 +296,6 @@ void SessionsTab::onDeleteButtonClicked()
                              QString("Failed to delete session: %1").arg(deleteResult.error().errorMessage));
         return;
     }
-
-    refreshData();
 }
 
 void SessionsTab::onExploreSessionsFolder() {
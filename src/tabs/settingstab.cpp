@@ -1,19 +1,46 @@
 #include "tabs/settingstab.h"
 #include "ui_settings_tab.h"
 #include "settingsmanager.h"
+#include "db/databasebackup.h"
+#include "db/databasemanager.h"
+#include "db/walarchive.h"
+#include "export/exportjob.h"
+#include "export/exportprogressdialog.h"
+#include "export/tabledump.h"
+#include "trace.h"
+#include <QApplication>
+#include <QDateTimeEdit>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QFileDialog>
+#include <QFormLayout>
+#include <QFileInfo>
+#include <QInputDialog>
 #include <QMessageBox>
+#include <QProgressDialog>
 #include <QPushButton>
 #include <QStyleFactory>
+#include <QThread>
 #include <QstyleHints>
+#include <memory>
 
 SettingsTab::SettingsTab(DatabaseManager *dbManager, SettingsManager *settingsManager, QWidget *parent)
-    : QWidget(parent), ui(new Ui::SettingsTab), m_dbManager(dbManager), m_settingsManager(settingsManager)
+    : QWidget(parent), ui(new Ui::SettingsTab), m_dbManager(dbManager), m_settingsManager(settingsManager),
+      m_dumpJob(nullptr), m_verifyThread(nullptr)
 {
     ui->setupUi(this);
 }
 
 SettingsTab::~SettingsTab()
 {
+    // Stops a running dump before the widgets it reports to are gone
+    delete m_dumpJob;
+    if (m_verifyThread)
+    {
+        m_verifyThread->requestInterruption();
+        m_verifyThread->wait();
+        delete m_verifyThread;
+    }
     delete ui;
 }
 
@@ -22,12 +49,28 @@ void SettingsTab::initialize()
     // Connect Save button
     connect(ui->saveButton, &QPushButton::clicked, this, &SettingsTab::onSaveButtonClicked);
 
+    ui->dumpFormatComboBox->addItem("CSV", QVariant::fromValue(static_cast<int>(DumpFormat::Csv)));
+    ui->dumpFormatComboBox->addItem("JSON Lines", QVariant::fromValue(static_cast<int>(DumpFormat::JsonLines)));
+    connect(ui->dumpTablesButton, &QPushButton::clicked, this, &SettingsTab::onDumpTablesClicked);
+    connect(ui->importTablesButton, &QPushButton::clicked, this, &SettingsTab::onImportTablesClicked);
+    connect(ui->restoreBackupButton, &QPushButton::clicked, this, &SettingsTab::onRestoreBackupClicked);
+    connect(ui->restoreToTimeButton, &QPushButton::clicked, this, &SettingsTab::onRestoreToTimeClicked);
+    if (!m_dbManager->isWalArchived())
+    {
+        // Without the archive there is nothing to replay onto a snapshot
+        ui->restoreToTimeButton->setEnabled(false);
+        ui->restoreToTimeButton->setToolTip("Point-in-time restore needs Qt built against the system SQLite "
+                                            "(MONOOBSLOG_QT_SYSTEM_SQLITE), this build does not archive the WAL");
+    }
+    connect(ui->verifyBackupsButton, &QPushButton::clicked, this, &SettingsTab::onVerifyBackupsClicked);
+
     // Initialize the tab UI and data
     refreshData();
 }
 
 void SettingsTab::refreshData()
 {
+    TRACE_SPAN("SettingsTab::refreshData", "tab");
     // Load settings from SettingsManager and populate UI
     loadSettingsToUI();
 }
@@ -71,6 +114,10 @@ void SettingsTab::loadSettingsToUI()
                 qApp->styleHints()->setColorScheme(colorScheme); });
 
     ui->sessionsFolderEdit->setText(m_settingsManager->sessionsFolderTemplate());
+
+    ui->backupKeepDailySpinBox->setValue(m_settingsManager->backupKeepDaily());
+    ui->backupKeepWeeklySpinBox->setValue(m_settingsManager->backupKeepWeekly());
+    ui->backupKeepMonthlySpinBox->setValue(m_settingsManager->backupKeepMonthly());
 }
 
 void SettingsTab::onSaveButtonClicked()
@@ -98,10 +145,282 @@ void SettingsTab::onSaveButtonClicked()
     m_settingsManager->setStyle(style);
     m_settingsManager->setColorScheme(colorScheme);
     m_settingsManager->setSessionsFolderTemplate(sessionsFolderTemplate);
+    m_settingsManager->setBackupKeepDaily(ui->backupKeepDailySpinBox->value());
+    m_settingsManager->setBackupKeepWeekly(ui->backupKeepWeeklySpinBox->value());
+    m_settingsManager->setBackupKeepMonthly(ui->backupKeepMonthlySpinBox->value());
 
     // Save to file
     if (!m_settingsManager->saveSettings())
     {
         QMessageBox::warning(this, "Error", "Failed to save settings.");
     }
-}
\ No newline at end of file
+}
+
+void SettingsTab::onDumpTablesClicked()
+{
+    if (m_dumpJob)
+    {
+        return;
+    }
+
+    const QString directory = QFileDialog::getExistingDirectory(this, "Dump Tables to Folder", QDir::homePath());
+    if (directory.isEmpty())
+    {
+        return; // User cancelled
+    }
+
+    // Runs on a snapshot, all tables are dumped as they were when the dump started
+    const auto format = static_cast<DumpFormat>(ui->dumpFormatComboBox->currentData().toInt());
+    m_dumpJob = new ExportJob(m_dbManager->databasePath(), [directory, format](DatabaseManager *snapshot, const ExportProgress &progress)
+    {
+        return TableDumper(snapshot).dump(directory, format, progress);
+    }, this);
+    ui->dumpTablesButton->setEnabled(false);
+    new ExportProgressDialog(m_dumpJob, "Dumping Tables", this);
+
+    const auto finish = [this]
+    {
+        m_dumpJob->deleteLater();
+        m_dumpJob = nullptr;
+        ui->dumpTablesButton->setEnabled(true);
+    };
+    connect(m_dumpJob, &ExportJob::succeeded, this, [this, finish, directory](const int rows, const double seconds)
+    {
+        finish();
+        QMessageBox::information(this, "Dump Successful",
+                                 QString("Dumped %1 rows to:\n%2\n\nTook %3 s (%L4 rows/s)")
+                                     .arg(rows)
+                                     .arg(directory)
+                                     .arg(seconds, 0, 'f', 1)
+                                     .arg(seconds > 0.0 ? rows / seconds : 0.0, 0, 'f', 0));
+    });
+    connect(m_dumpJob, &ExportJob::failed, this, [this, finish](const QString &errorMessage)
+    {
+        finish();
+        QMessageBox::warning(this, "Dump Error", errorMessage);
+    });
+    connect(m_dumpJob, &ExportJob::cancelled, this, finish);
+
+    m_dumpJob->start();
+}
+
+void SettingsTab::onImportTablesClicked()
+{
+    const QString directory = QFileDialog::getExistingDirectory(this, "Import Tables from Folder", QDir::homePath());
+    if (directory.isEmpty())
+    {
+        return; // User cancelled
+    }
+
+    // Writes go through the main connection so that all tabs see the new rows
+    QProgressDialog progressDialog("Importing...", "Stop", 0, 1000, this);
+    progressDialog.setWindowTitle("Importing Tables");
+    progressDialog.setWindowModality(Qt::WindowModal);
+    progressDialog.setMinimumDuration(500);
+
+    const auto format = static_cast<DumpFormat>(ui->dumpFormatComboBox->currentData().toInt());
+    const TableImporter importer(m_dbManager);
+    auto report = importer.import(directory, format, [&progressDialog](const qint64 bytesRead, const qint64 totalBytes,
+                                                                       const int importedRows)
+    {
+        progressDialog.setLabelText(QString("Imported %L1 rows").arg(importedRows));
+        progressDialog.setValue(static_cast<int>(totalBytes > 0 ? bytesRead * 1000 / totalBytes : 0));
+        return !progressDialog.wasCanceled();
+    });
+    progressDialog.reset();
+
+    if (!report)
+    {
+        QMessageBox::warning(this, "Import Error", report.error().errorMessage);
+        return;
+    }
+
+    QString message = QString("Imported %1 rows in %2 s (%L3 rows/s), skipped %4.")
+                          .arg(report->importedRows)
+                          .arg(report->seconds, 0, 'f', 1)
+                          .arg(report->seconds > 0.0 ? report->importedRows / report->seconds : 0.0, 0, 'f', 0)
+                          .arg(report->skippedRows);
+    if (!report->problems.isEmpty())
+    {
+        message += "\n\n" + report->problems.join("\n");
+    }
+    QMessageBox::information(this, "Import Finished", message);
+}
+
+void SettingsTab::onRestoreBackupClicked()
+{
+    const QString dbPath = m_dbManager->databasePath();
+    auto snapshots = BackupStore(DatabaseBackup::getBackupDirectory(dbPath)).snapshots();
+    if (!snapshots)
+    {
+        QMessageBox::warning(this, "Restore Error", snapshots.error().errorMessage);
+        return;
+    }
+    if (snapshots->isEmpty())
+    {
+        QMessageBox::information(this, "Restore Snapshot", "There are no backup snapshots yet.");
+        return;
+    }
+
+    QStringList labels;
+    for (const BackupSnapshot &snapshot : std::as_const(*snapshots))
+    {
+        labels.append(snapshot.created.toLocalTime().toString("yyyy-MM-dd HH:mm:ss"));
+    }
+    bool ok = false;
+    const QString label = QInputDialog::getItem(this, "Restore Snapshot", "Snapshot:", labels, 0, false, &ok);
+    if (!ok)
+    {
+        return; // User cancelled
+    }
+    const BackupSnapshot &snapshot = snapshots->at(labels.indexOf(label));
+
+    // Restored to a new file, the open database is never overwritten
+    const QString targetPath = QFileDialog::getSaveFileName(
+        this, "Restore Snapshot To",
+        QDir::homePath() + QString("/MonoObsLog_%1.db").arg(snapshot.created.toLocalTime().toString("yyyy-MM-dd")),
+        "SQLite Database (*.db);;All Files (*.*)");
+    if (targetPath.isEmpty())
+    {
+        return; // User cancelled
+    }
+    if (QFileInfo(targetPath) == QFileInfo(dbPath))
+    {
+        QMessageBox::warning(this, "Restore Error",
+                             "The snapshot cannot be restored over the open database, choose another file.");
+        return;
+    }
+
+    if (auto restored = BackupStore(DatabaseBackup::getBackupDirectory(dbPath)).restore(snapshot.id, targetPath); !restored)
+    {
+        QMessageBox::warning(this, "Restore Error", restored.error().errorMessage);
+        return;
+    }
+    QMessageBox::information(this, "Restore Snapshot",
+                             QString("Snapshot of %1 restored to:\n%2").arg(label, targetPath));
+}
+
+void SettingsTab::onRestoreToTimeClicked()
+{
+    const QString dbPath = m_dbManager->databasePath();
+    const QString backupDir = DatabaseBackup::getBackupDirectory(dbPath);
+    auto snapshots = BackupStore(backupDir).snapshots();
+    if (!snapshots)
+    {
+        QMessageBox::warning(this, "Restore Error", snapshots.error().errorMessage);
+        return;
+    }
+    if (snapshots->isEmpty())
+    {
+        QMessageBox::information(this, "Restore to Point in Time", "There are no backup snapshots yet.");
+        return;
+    }
+
+    QDialog dialog(this);
+    dialog.setWindowTitle("Restore to Point in Time");
+    auto *timeEdit = new QDateTimeEdit(QDateTime::currentDateTime(), &dialog);
+    timeEdit->setDisplayFormat("yyyy-MM-dd HH:mm:ss");
+    timeEdit->setCalendarPopup(true);
+    timeEdit->setMinimumDateTime(snapshots->last().created.toLocalTime());
+    auto *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    auto *layout = new QFormLayout(&dialog);
+    layout->addRow("Restore the database as it was at:", timeEdit);
+    layout->addRow(buttons);
+    if (dialog.exec() != QDialog::Accepted)
+    {
+        return; // User cancelled
+    }
+    const QDateTime until = timeEdit->dateTime().toUTC();
+
+    // Restored to a new file, the open database is never overwritten
+    const QString targetPath = QFileDialog::getSaveFileName(
+        this, "Restore Database To",
+        QDir::homePath() + QString("/MonoObsLog_%1.db").arg(until.toLocalTime().toString("yyyy-MM-dd_HHmm")),
+        "SQLite Database (*.db);;All Files (*.*)");
+    if (targetPath.isEmpty())
+    {
+        return; // User cancelled
+    }
+    if (QFileInfo(targetPath) == QFileInfo(dbPath))
+    {
+        QMessageBox::warning(this, "Restore Error",
+                             "The backup cannot be restored over the open database, choose another file.");
+        return;
+    }
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    const auto report = WalArchive::restore(backupDir, until, targetPath);
+    QApplication::restoreOverrideCursor();
+    if (!report)
+    {
+        QMessageBox::warning(this, "Restore Error", report.error().errorMessage);
+        return;
+    }
+    if (!report->breakBefore.isEmpty())
+    {
+        QMessageBox::warning(this, "Restore to Point in Time",
+                             QString("The WAL archive is not continuous after %1: changes made while the application was not "
+                                     "archiving (for example with obslog-cli) are missing from it.\n\n"
+                                     "The database was restored as of that time to:\n%2")
+                                 .arg(report->restoredTo.toLocalTime().toString("yyyy-MM-dd HH:mm:ss"), targetPath));
+        return;
+    }
+    QMessageBox::information(this, "Restore to Point in Time",
+                             QString("Database as of %1 restored to:\n%2\n\n%3 archived WAL segments replayed onto the snapshot of %4.")
+                                 .arg(report->restoredTo.toLocalTime().toString("yyyy-MM-dd HH:mm:ss"), targetPath)
+                                 .arg(report->segments)
+                                 .arg(report->snapshotCreated.toLocalTime().toString("yyyy-MM-dd HH:mm:ss")));
+}
+
+void SettingsTab::onVerifyBackupsClicked()
+{
+    if (m_verifyThread)
+    {
+        return;
+    }
+
+    // Reads every stored chunk, which can take a while for a long history: runs in the
+    // background and reports in the status label
+    const QString backupDir = DatabaseBackup::getBackupDirectory(m_dbManager->databasePath());
+    const auto result = std::make_shared<std::expected<BackupVerifyReport, ER>>();
+    m_verifyThread = QThread::create([backupDir, result]
+    {
+        *result = BackupStore(backupDir).verify([](int, int)
+        {
+            return !QThread::currentThread()->isInterruptionRequested();
+        });
+        if (result->has_value() && !QThread::currentThread()->isInterruptionRequested())
+        {
+            (*result)->problems.append(WalArchive::verify(backupDir));
+        }
+    });
+    ui->verifyBackupsButton->setEnabled(false);
+    ui->backupStatusLabel->setText("Verifying backups...");
+
+    connect(m_verifyThread, &QThread::finished, this, [this, result]
+    {
+        m_verifyThread->deleteLater();
+        m_verifyThread = nullptr;
+        ui->verifyBackupsButton->setEnabled(true);
+
+        if (!result->has_value())
+        {
+            ui->backupStatusLabel->setText(result->error().errorMessage);
+            return;
+        }
+        const BackupVerifyReport &report = result->value();
+        if (report.problems.isEmpty())
+        {
+            ui->backupStatusLabel->setText(QString("%1 snapshots verified, %L2 chunks intact.")
+                                               .arg(report.snapshots)
+                                               .arg(report.checkedChunks));
+            return;
+        }
+        ui->backupStatusLabel->setText(QString("%1 problems found.").arg(report.problems.size()));
+        QMessageBox::warning(this, "Backup Verification", report.problems.join("\n"));
+    });
+
+    m_verifyThread->start(QThread::LowPriority);
+}
@@ -2,6 +2,7 @@
 #include "ui_telescopes_tab.h"
 #include "db/databasemanager.h"
 #include "db/telescopesrepository.h"
+#include "trace.h"
 #include <QMessageBox>
 #include <QDialog>
 #include <QFormLayout>
@@ -46,6 +47,7 @@ void TelescopesTab::initialize()
 
 void TelescopesTab::refreshData()
 {
+    TRACE_SPAN("TelescopesTab::refreshData", "tab");
     // Refresh data from database
     populateTable();
 }
@@ -186,8 +188,6 @@ void TelescopesTab::onAddTelescopeButtonClicked()
     ui->apertureSpinBox->setValue(0);
     ui->fRatioSpinBox->setValue(0.0);
     ui->focalLengthSpinBox->setValue(0);
-
-    refreshData();
 }
 
 void TelescopesTab::onEditTelescopeButtonClicked()
@@ -227,8 +227,6 @@ void TelescopesTab::onEditTelescopeButtonClicked()
                              QString("Failed to update telescope: %1").arg(updateResult.error().errorMessage));
         return;
     }
-
-    refreshData();
 }
 
 void TelescopesTab::onDeleteTelescopeButtonClicked()
@@ -267,8 +265,6 @@ void TelescopesTab::onDeleteTelescopeButtonClicked()
                              QString("Failed to delete telescope: %1").arg(deleteResult.error().errorMessage));
         return;
     }
-
-    refreshData();
 }
 
 void TelescopesTab::onApertureOrFocalLengthChanged() const {
@@ -0,0 +1,189 @@
+#include "trace.h"
+#include <QCoreApplication>
+#include <QMutex>
+#include <QSaveFile>
+#include <QThread>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // 32 bytes per event, 512 KiB per thread that records
+    constexpr quint64 ringSize = 1 << 14;
+
+    struct Event
+    {
+        const char *name;
+        const char *category;
+        qint64 start;    // nanoseconds since the trace clock started
+        qint64 duration; // nanoseconds, -1 for marks
+    };
+
+    struct ThreadBuffer
+    {
+        std::array<Event, ringSize> events;
+        // Events ever recorded; written only by the owning thread, read by writeChromeTrace()
+        std::atomic<quint64> written{0};
+        int threadId = 0;
+        QString threadName;
+    };
+
+    // Buffers outlive their threads, events of finished workers stay in the trace
+    struct Registry
+    {
+        QMutex mutex;
+        std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+        std::set<std::string> names;
+    };
+
+    Registry &registry()
+    {
+        static Registry instance;
+        return instance;
+    }
+
+    const std::chrono::steady_clock::time_point clockStart = std::chrono::steady_clock::now();
+    thread_local ThreadBuffer *threadBuffer = nullptr;
+
+    ThreadBuffer *registerThread()
+    {
+        auto buffer = std::make_unique<ThreadBuffer>();
+        const QThread *thread = QThread::currentThread();
+        const QCoreApplication *app = QCoreApplication::instance();
+
+        Registry &reg = registry();
+        const QMutexLocker locker(&reg.mutex);
+        buffer->threadId = static_cast<int>(reg.buffers.size()) + 1;
+        if (app && thread == app->thread())
+            buffer->threadName = "Main";
+        else if (!thread->objectName().isEmpty())
+            buffer->threadName = thread->objectName();
+        else
+            buffer->threadName = QString("Worker %1").arg(buffer->threadId);
+
+        threadBuffer = buffer.get();
+        reg.buffers.push_back(std::move(buffer));
+        return threadBuffer;
+    }
+
+    void recordEvent(const char *name, const char *category, const qint64 start, const qint64 duration)
+    {
+        ThreadBuffer *buffer = threadBuffer ? threadBuffer : registerThread();
+        const quint64 index = buffer->written.load(std::memory_order_relaxed);
+        buffer->events[index % ringSize] = {name, category, start, duration};
+        buffer->written.store(index + 1, std::memory_order_release);
+    }
+
+    void appendJsonString(QByteArray &out, const QByteArray &text)
+    {
+        out.append('"');
+        for (const char c : text)
+        {
+            if (c == '"' || c == '\\')
+                out.append('\\').append(c);
+            else if (static_cast<uchar>(c) < 0x20)
+                out.append(' ');
+            else
+                out.append(c);
+        }
+        out.append('"');
+    }
+
+    void appendMicroseconds(QByteArray &out, const qint64 nanoseconds)
+    {
+        out.append(QByteArray::number(static_cast<double>(nanoseconds) / 1000.0, 'f', 3));
+    }
+}
+
+qint64 Trace::detail::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - clockStart).count();
+}
+
+void Trace::detail::record(const char *name, const char *category, const qint64 start, const qint64 end)
+{
+    recordEvent(name, category, start, end - start);
+}
+
+void Trace::setEnabled(const bool enabled)
+{
+    detail::enabled.store(enabled, std::memory_order_relaxed);
+}
+
+const char *Trace::intern(const QString &name)
+{
+    Registry &reg = registry();
+    const QMutexLocker locker(&reg.mutex);
+    // Set nodes do not move, the pointer stays valid
+    return reg.names.insert(name.toStdString()).first->c_str();
+}
+
+void Trace::mark(const char *name, const char *category)
+{
+    if (isEnabled())
+        recordEvent(name, category, detail::now(), -1);
+}
+
+std::expected<void, ER> Trace::writeChromeTrace(const QString &fileName)
+{
+    QByteArray out;
+    out.append("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    const auto separator = [&out, &first]
+    {
+        if (!first)
+            out.append(",\n");
+        first = false;
+    };
+
+    Registry &reg = registry();
+    {
+        const QMutexLocker locker(&reg.mutex);
+        for (const auto &buffer : reg.buffers)
+        {
+            separator();
+            out.append(R"({"name":"thread_name","ph":"M","pid":1,"tid":)")
+                .append(QByteArray::number(buffer->threadId))
+                .append(R"(,"args":{"name":)");
+            appendJsonString(out, buffer->threadName.toUtf8());
+            out.append("}}");
+
+            const quint64 written = buffer->written.load(std::memory_order_acquire);
+            const quint64 count = std::min(written, ringSize);
+            for (quint64 i = written - count; i < written; ++i)
+            {
+                const Event &event = buffer->events[i % ringSize];
+                separator();
+                out.append(R"({"name":)");
+                appendJsonString(out, event.name);
+                out.append(R"(,"cat":)");
+                appendJsonString(out, event.category);
+                if (event.duration < 0)
+                {
+                    out.append(R"(,"ph":"i","s":"t","ts":)");
+                }
+                else
+                {
+                    out.append(R"(,"ph":"X","dur":)");
+                    appendMicroseconds(out, event.duration);
+                    out.append(R"(,"ts":)");
+                }
+                appendMicroseconds(out, event.start);
+                out.append(R"(,"pid":1,"tid":)").append(QByteArray::number(buffer->threadId)).append('}');
+            }
+        }
+    }
+    out.append("\n]}\n");
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly) || file.write(out) != out.size() || !file.commit())
+    {
+        return std::unexpected(ER::Error(QString("Failed to write trace file: %1").arg(file.errorString())));
+    }
+    return {};
+}
@@ -0,0 +1,220 @@
+#include "simbadcache.h"
+#include "simbadquery.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QSignalSpy>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QTimeZone>
+#include <QUrlQuery>
+
+namespace
+{
+    // Stand-in for the SIMBAD TAP sync endpoint. Knows every name except those starting with
+    // "Unknown" and answers in the JSON layout SimbadQuery asks for.
+    class MockTapServer : public QObject
+    {
+    public:
+        MockTapServer()
+        {
+            connect(&m_server, &QTcpServer::newConnection, this, [this]
+            {
+                while (QTcpSocket *socket = m_server.nextPendingConnection())
+                {
+                    connect(socket, &QTcpSocket::readyRead, this, [this, socket] { handleData(socket); });
+                    connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+                }
+            });
+        }
+
+        bool listen() { return m_server.listen(QHostAddress::LocalHost); }
+        QUrl url() const { return QUrl(QString("http://127.0.0.1:%1/sim-tap/sync").arg(m_server.serverPort())); }
+        int requestCount() const { return m_requestCount; }
+        qsizetype lastNameCount() const { return m_lastNameCount; }
+
+    private:
+        void handleData(QTcpSocket *socket)
+        {
+            QByteArray &buffer = m_buffers[socket];
+            buffer += socket->readAll();
+            const qsizetype headerEnd = buffer.indexOf("\r\n\r\n");
+            if (headerEnd < 0)
+                return;
+
+            static const QRegularExpression contentLengthPattern("content-length:\\s*(\\d+)",
+                                                                 QRegularExpression::CaseInsensitiveOption);
+            const auto lengthMatch = contentLengthPattern.match(QString::fromLatin1(buffer.left(headerEnd)));
+            const qsizetype contentLength = lengthMatch.hasMatch() ? lengthMatch.captured(1).toLongLong() : 0;
+            if (buffer.size() < headerEnd + 4 + contentLength)
+                return;
+
+            const bool isPost = buffer.startsWith("POST ");
+            const QUrlQuery form(QString::fromUtf8(buffer.mid(headerEnd + 4, contentLength)));
+            m_buffers.remove(socket);
+            ++m_requestCount;
+
+            QByteArray body;
+            if (isPost)
+                body = answer(form.queryItemValue("QUERY", QUrl::FullyDecoded));
+            socket->write("HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nConnection: close\r\nContent-Length: " +
+                          QByteArray::number(body.size()) + "\r\n\r\n" + body);
+            socket->disconnectFromHost();
+        }
+
+        QByteArray answer(const QString &adql)
+        {
+            // The quoted names of the IN (...) list
+            static const QRegularExpression namePattern("'((?:[^']|'')*)'");
+            QJsonArray rows;
+            m_lastNameCount = 0;
+            for (const auto &match : namePattern.globalMatch(adql))
+            {
+                ++m_lastNameCount;
+                const QString name = match.captured(1).replace("''", "'");
+                if (name.startsWith("Unknown"))
+                    continue;
+                const QString mainId = "MOCK " + name;
+                rows.append(QJsonArray{name, mainId, 10.0 + m_lastNameCount * 0.01, 20.0, mainId + "|" + name});
+            }
+
+            QJsonArray metadata;
+            for (const char *column : {"id", "main_id", "ra", "dec", "ids"})
+                metadata.append(QJsonObject{{"name", column}});
+            return QJsonDocument(QJsonObject{{"metadata", metadata}, {"data", rows}}).toJson(QJsonDocument::Compact);
+        }
+
+        QTcpServer m_server;
+        QHash<QTcpSocket *, QByteArray> m_buffers;
+        int m_requestCount = 0;
+        qsizetype m_lastNameCount = 0;
+    };
+
+    QStringList targetNames(const int known, const int unknown)
+    {
+        QStringList names;
+        for (int i = 1; i <= known; ++i)
+            names.append(QString("NGC %1").arg(i));
+        for (int i = 1; i <= unknown; ++i)
+            names.append(QString("Unknown %1").arg(i));
+        return names;
+    }
+}
+
+class TestSimbadQuery : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void batchIsOneRequest();
+    void secondLookupIsCached();
+    void missingNamesExpire();
+
+private:
+    // Runs resolveObjects() and waits for objectsResolved
+    bool resolve(SimbadQuery &query, const QStringList &names, QVector<SimbadObject> &objects, QStringList &notFound);
+
+    std::unique_ptr<QTemporaryDir> m_dir;
+    std::unique_ptr<MockTapServer> m_server;
+};
+
+void TestSimbadQuery::init()
+{
+    m_dir = std::make_unique<QTemporaryDir>();
+    QVERIFY(m_dir->isValid());
+    m_server = std::make_unique<MockTapServer>();
+    QVERIFY(m_server->listen());
+}
+
+bool TestSimbadQuery::resolve(SimbadQuery &query, const QStringList &names, QVector<SimbadObject> &objects,
+                              QStringList &notFound)
+{
+    QSignalSpy resolved(&query, &SimbadQuery::objectsResolved);
+    QSignalSpy failed(&query, &SimbadQuery::resolveFailed);
+    const int requestId = query.resolveObjects(names);
+    if (!resolved.wait(10000) || !failed.isEmpty())
+        return false;
+
+    const QList<QVariant> arguments = resolved.takeFirst();
+    objects = arguments.at(1).value<QVector<SimbadObject>>();
+    notFound = arguments.at(2).toStringList();
+    return arguments.at(0).toInt() == requestId;
+}
+
+void TestSimbadQuery::batchIsOneRequest()
+{
+    SimbadQuery query;
+    query.setServiceUrl(m_server->url());
+    query.setCacheFile(m_dir->filePath("simbad_cache.db"));
+
+    QVector<SimbadObject> objects;
+    QStringList notFound;
+    QVERIFY(resolve(query, targetNames(495, 5), objects, notFound));
+
+    QCOMPARE(m_server->requestCount(), 1);
+    QCOMPARE(m_server->lastNameCount(), qsizetype(500));
+    QCOMPARE(objects.size(), qsizetype(495));
+    QCOMPARE(notFound.size(), qsizetype(5));
+    QCOMPARE(objects.first().mainId, QString("MOCK ") + objects.first().queryName);
+}
+
+void TestSimbadQuery::secondLookupIsCached()
+{
+    const QStringList names = targetNames(495, 5);
+    QVector<SimbadObject> objects;
+    QStringList notFound;
+    {
+        SimbadQuery query;
+        query.setServiceUrl(m_server->url());
+        query.setCacheFile(m_dir->filePath("simbad_cache.db"));
+        QVERIFY(resolve(query, names, objects, notFound));
+    }
+    QCOMPARE(m_server->requestCount(), 1);
+
+    // A new instance on the same file, as after a restart of the application
+    SimbadQuery query;
+    query.setServiceUrl(m_server->url());
+    query.setCacheFile(m_dir->filePath("simbad_cache.db"));
+    QVector<SimbadObject> cachedObjects;
+    QStringList cachedNotFound;
+    QVERIFY(resolve(query, names, cachedObjects, cachedNotFound));
+
+    QCOMPARE(m_server->requestCount(), 1);
+    QCOMPARE(cachedObjects.size(), objects.size());
+    QCOMPARE(cachedNotFound.size(), notFound.size());
+    QCOMPARE(cachedObjects.first().ra, objects.first().ra);
+}
+
+void TestSimbadQuery::missingNamesExpire()
+{
+    SimbadCache cache;
+    QVERIFY(cache.open(m_dir->filePath("simbad_cache.db")).has_value());
+
+    SimbadObject m31;
+    m31.queryName = "M31";
+    m31.mainId = "M  31";
+    m31.ra = 10.6847;
+    m31.dec = 41.2690;
+    m31.aliases = {"M  31", "NGC  224"};
+    const QDateTime stored(QDate(2026, 1, 1), QTime(12, 0), QTimeZone::UTC);
+    QVERIFY(cache.store({m31}, {"Unknown 1"}, stored).has_value());
+
+    const QDateTime beforeMissingTtl = stored.addDays(SimbadCache::missingTtlDays - 1);
+    QVERIFY(cache.lookup("Unknown 1", beforeMissingTtl).has_value());
+    QVERIFY(!cache.lookup("Unknown 1", beforeMissingTtl)->found);
+
+    // Unknown names are asked again after a week, found ones are kept
+    const QDateTime afterMissingTtl = stored.addDays(SimbadCache::missingTtlDays + 1);
+    QVERIFY(!cache.lookup("Unknown 1", afterMissingTtl).has_value());
+    QVERIFY(cache.lookup("NGC 224", afterMissingTtl).has_value());
+    QVERIFY(cache.lookup("m 31", afterMissingTtl)->found);
+
+    QVERIFY(!cache.lookup("M31", stored.addDays(SimbadCache::foundTtlDays + 1)).has_value());
+}
+
+QTEST_GUILESS_MAIN(TestSimbadQuery)
+#include "tst_simbadquery.moc"